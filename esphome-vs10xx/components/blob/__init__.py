@@ -1,16 +1,49 @@
 import os
+import struct
+import wave
+import zlib
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome import automation
-from esphome.core import CORE, HexInt
-from esphome.const import CONF_ID, CONF_FILE, CONF_RAW_DATA_ID
+from esphome.core import CORE, EsphomeError, HexInt, ID
+from esphome.const import CONF_ID, CONF_FILE, CONF_RAW_DATA_ID, CONF_URL
+import esphome.final_validate as fv
+from .clip_bank import CLIP_NAME_SIZE, build_clip_bank, clip_name
 
+CONF_PARTITION = "partition"
+CONF_CLIPS = "clips"
+CONF_FILES = "files"
+CONF_GAP = "gap"
+CONF_SAMPLE_RATE = "sample_rate"
 
 CODEOWNERS = ["@mmakaay"]
 MULTI_CONF = True
 
+DOMAIN = "blob"
+
 blob_ns = cg.esphome_ns.namespace("blob")
 Blob = blob_ns.class_("Blob")
+ClipBank = blob_ns.class_("ClipBank", Blob)
+BlobBundle = blob_ns.class_("BlobBundle", cg.Component)
+UpdateBundleAction = blob_ns.class_(
+    "UpdateBundleAction", automation.Action, cg.Parented.template(BlobBundle)
+)
+
+# The layout of a blob bundle. Keep this in sync with blob_bundle.h and
+# tools/blob_pack.py.
+BUNDLE_MAGIC = b"BLBN"
+BUNDLE_VERSION = 1
+BUNDLE_HEADER = struct.Struct("<4sHHII")
+BUNDLE_ENTRY = struct.Struct("<32sIII8s")
+BUNDLE_NAME_SIZE = 32
+BUNDLE_TYPE_SIZE = 8
+BUNDLE_ALIGNMENT = 4
+
+# The key under which the bundles (by partition label) are stored in the
+# code generation data.
+DATA_BUNDLES = "blob_bundles"
+# The partition labels that are used by blob.update_bundle actions.
+DATA_UPDATE_PARTITIONS = "blob_update_partitions"
 
 
 def validate_file(value):
@@ -25,18 +58,200 @@ def validate_file(value):
     return path
 
 
-CONFIG_SCHEMA = cv.Schema(
-    {
-        cv.GenerateID(): cv.declare_id(Blob),
-        cv.GenerateID(CONF_RAW_DATA_ID): cv.declare_id(cg.uint8),
-        cv.Required(CONF_FILE): cv.All(cv.string, validate_file),
-    }
+def validate_clip_file(value):
+    path = validate_file(value)
+    try:
+        with wave.open(path, "rb") as fh:
+            if fh.getsampwidth() not in (1, 2):
+                raise cv.Invalid("Only 8 and 16 bit WAV files are supported")
+    except (wave.Error, EOFError) as err:
+        raise cv.Invalid(f"Not a PCM WAV file: {str(err)}")
+    return path
+
+
+def validate_clip_names(value):
+    names = [clip_name(path) for path in value]
+    for name in names:
+        if len(name) >= CLIP_NAME_SIZE:
+            raise cv.Invalid(
+                f"The name of clip '{name}' must be shorter than {CLIP_NAME_SIZE} characters"
+            )
+        if names.count(name) > 1:
+            raise cv.Invalid(f"Clip '{name}' is used more than once")
+    return value
+
+
+def validate_clip_bank(config):
+    # A blob with clips is a ClipBank, which can assemble phrases.
+    if CONF_CLIPS in config:
+        config[CONF_ID].type = ClipBank
+    return config
+
+
+def validate_bundle_name(config):
+    # The ID is used as the name of the blob in the bundle index.
+    if CONF_PARTITION in config and len(config[CONF_ID].id) >= BUNDLE_NAME_SIZE:
+        raise cv.Invalid(
+            f"The ID of a blob in a partition must be shorter than {BUNDLE_NAME_SIZE} characters"
+        )
+    return config
+
+
+CONFIG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(Blob),
+            cv.GenerateID(CONF_RAW_DATA_ID): cv.declare_id(cg.uint8),
+            cv.Optional(CONF_FILE): cv.All(cv.string, validate_file),
+            cv.Optional(CONF_CLIPS): cv.Schema(
+                {
+                    cv.Required(CONF_FILES): cv.All(
+                        cv.ensure_list(cv.string, validate_clip_file),
+                        cv.Length(min=1, max=255),
+                        validate_clip_names,
+                    ),
+                    cv.Optional(CONF_SAMPLE_RATE, default=16000): cv.int_range(min=8000, max=48000),
+                    cv.Optional(CONF_GAP, default="60ms"): cv.All(
+                        cv.positive_time_period_milliseconds,
+                        cv.Range(max=cv.TimePeriod(milliseconds=1000)),
+                    ),
+                }
+            ),
+            cv.Optional(CONF_PARTITION): cv.All(cv.only_on_esp32, cv.string),
+        }
+    ),
+    cv.has_exactly_one_key(CONF_FILE, CONF_CLIPS),
+    validate_clip_bank,
+    validate_bundle_name,
 )
 
 
-async def to_code(config):
-    path = CORE.relative_config_path(config[CONF_FILE])  
+def final_validate(config):
+    # Actions are validated before this, so they can be checked here.
+    labels = {c.get(CONF_PARTITION) for c in fv.full_config.get()[DOMAIN]}
+    for label in CORE.data.get(DATA_UPDATE_PARTITIONS, []):
+        if label not in labels:
+            raise cv.Invalid(f"blob.update_bundle: no blob is stored in partition '{label}'")
+    return config
+
+
+FINAL_VALIDATE_SCHEMA = final_validate
+
+
+def bundle_id(label):
+    """The ID of the BlobBundle for a partition."""
+    return ID(f"blob_bundle_{label}", is_declaration=True, type=BlobBundle)
+
+
+def blob_data(config):
+    """The data of a blob, and their type (the file extension). The clips
+    of a clip bank are normalized and packed into a single clip bank."""
+    if CONF_CLIPS in config:
+        clips = config[CONF_CLIPS]
+        try:
+            data = build_clip_bank(
+                [CORE.relative_config_path(path) for path in clips[CONF_FILES]],
+                clips[CONF_SAMPLE_RATE],
+                clips[CONF_GAP].total_milliseconds,
+            )
+        except ValueError as err:
+            raise EsphomeError(f"Cannot build clip bank {config[CONF_ID].id}: {err}") from err
+        return "clips", data
+    path = CORE.relative_config_path(config[CONF_FILE])
     with open(path, "rb") as fh:
-        rhs = list(map(HexInt, fh.read()))
+        return os.path.splitext(path)[1].lstrip(".").lower(), fh.read()
+
+
+def pack_bundle(blobs):
+    """Pack a list of (name, type, data) tuples into a blob bundle."""
+    index_size = BUNDLE_HEADER.size + BUNDLE_ENTRY.size * len(blobs)
+    offset = index_size
+    index = b""
+    data = b""
+    for name, type_, content in blobs:
+        padding = -(offset + len(data)) % BUNDLE_ALIGNMENT
+        data += b"\0" * padding
+        index += BUNDLE_ENTRY.pack(
+            name.encode(),
+            offset + len(data),
+            len(content),
+            zlib.crc32(content),
+            type_.encode()[:BUNDLE_TYPE_SIZE],
+        )
+        data += content
+    header = BUNDLE_HEADER.pack(
+        BUNDLE_MAGIC, BUNDLE_VERSION, len(blobs), index_size + len(data), zlib.crc32(index)
+    )
+    return header + index + data
+
+
+def bundle_to_code(label):
+    """Generate the bundle for a partition, and write its contents to the
+    build directory, from where it can be flashed to the partition."""
+    configs = [c for c in CORE.config[DOMAIN] if c.get(CONF_PARTITION) == label]
+    blobs = []
+    for config in sorted(configs, key=lambda c: c[CONF_ID].id):
+        type_, data = blob_data(config)
+        blobs.append((config[CONF_ID].id, type_, data))
+    bundle_path = CORE.relative_build_path(f"blob_{label}.bin")
+    os.makedirs(os.path.dirname(bundle_path), exist_ok=True)
+    with open(bundle_path, "wb") as fh:
+        fh.write(pack_bundle(blobs))
+
+    return cg.new_Pvariable(bundle_id(label), label)
+
+
+async def to_code(config):
+    if CONF_CLIPS in config:
+        cg.add_define("USE_BLOB_CLIPS")
+
+    if CONF_PARTITION in config:
+        # The blob data are not stored in the firmware, but in a bundle that
+        # is flashed to a separate data partition.
+        label = config[CONF_PARTITION]
+        bundles = CORE.data.setdefault(DATA_BUNDLES, {})
+        if not bundles:
+            # The blob storage of the bundles is statically sized, based on
+            # the largest bundle.
+            labels = [c.get(CONF_PARTITION) for c in CORE.config[DOMAIN]]
+            cg.add_define("USE_BLOB_BUNDLE")
+            cg.add_define(
+                "BLOB_BUNDLE_MAX_BLOBS",
+                max(labels.count(l) for l in labels if l is not None),
+            )
+        if label not in bundles:
+            bundles[label] = bundle_to_code(label)
+            await cg.register_component(bundles[label], {})
+        var = cg.new_Pvariable(config[CONF_ID])
+        cg.add(bundles[label].add_blob(var, config[CONF_ID].id))
+        return
+
+    _, data = blob_data(config)
+    rhs = list(map(HexInt, data))
     prog_arr = cg.progmem_array(config[CONF_RAW_DATA_ID], rhs)
     cg.new_Pvariable(config[CONF_ID], prog_arr, len(rhs))
+
+
+def validate_update_partition(value):
+    value = cv.string(value)
+    CORE.data.setdefault(DATA_UPDATE_PARTITIONS, []).append(value)
+    return value
+
+
+@automation.register_action(
+    "blob.update_bundle",
+    UpdateBundleAction,
+    cv.Schema(
+        {
+            cv.Required(CONF_PARTITION): validate_update_partition,
+            cv.Required(CONF_URL): cv.templatable(cv.url),
+        }
+    ),
+)
+async def blob_update_bundle_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    bundle = await cg.get_variable(bundle_id(config[CONF_PARTITION]))
+    cg.add(var.set_parent(bundle))
+    template_ = await cg.templatable(config[CONF_URL], args, cg.std_string)
+    cg.add(var.set_url(template_))
+    return var
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_BLOB_BUNDLE
+
+#include "esphome/core/automation.h"
+#include "blob_bundle.h"
+
+namespace esphome {
+namespace blob {
+
+template<typename... Ts> class UpdateBundleAction : public Action<Ts...>, public Parented<BlobBundle> {
+ public:
+  TEMPLATABLE_VALUE(std::string, url)
+
+  void play(Ts... x) override { this->parent_->update_from_url(this->url_.value(x...)); }
+};
+
+}  // namespace blob
+}  // namespace esphome
+
+#endif
@@ -6,6 +6,12 @@ namespace blob {
 
 static const char *const TAG = "blob";
 
+void Blob::set_data(const uint8_t* data, size_t size) {
+  this->data = data;
+  this->size = size;
+  this->reset();
+}
+
 void Blob::reset() {
   this->pos_ = 0;
   this->chunk_size = 0;
@@ -23,6 +29,16 @@ bool Blob::next_chunk(size_t max_chunk_size) {
   return true;
 }
 
+bool Blob::seek(size_t position) {
+  if (position > this->size) {
+    return false;
+  }
+  this->pos_ = position;
+  this->chunk_size = 0;
+  this->chunk_start = this->data + position;
+  return true;
+}
+
 }  // namespace blob
 }  // namespace esphome
 
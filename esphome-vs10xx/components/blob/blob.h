@@ -9,15 +9,24 @@ namespace blob {
 /// Blob data are added to the firmware at compile time and one instance
 /// of the Blob is created. Other code can make use of a BlobAccess object
 /// to access the data in the Blob.
+/// Blobs that are stored in a separate data partition are created without
+/// data. Their data are set by the BlobBundle, when it maps the partition.
+/// The chunk methods are virtual, so derived classes (e.g. ClipPhrase) can
+/// hand out chunks that are spread over other data.
 class Blob {
  public:
   explicit Blob(const uint8_t* data, size_t size) : data(data), size(size) {}
+  explicit Blob() : data(nullptr), size(0) {}
+  virtual ~Blob() = default;
 
   /// A pointer to the data that are stored in the Blob object.
   const uint8_t* data;
 
   /// The size of the data (in bytes) that are stored in the Blob object.
-  const size_t size;
+  size_t size;
+
+  /// Point the Blob at new data, and reset the read position.
+  void set_data(const uint8_t* data, size_t size);
 
   /// A pointer to the start of the data of the current chunk.
   const uint8_t* chunk_start{nullptr};
@@ -25,12 +34,35 @@ class Blob {
   /// The size of the current chunk.
   size_t chunk_size{0};
 
-  void reset();
+  virtual void reset();
+
+  virtual bool next_chunk(size_t max_chunk_size);
+
+  /// Move the read position to the provided offset in the data.
+  /// Returns false when the offset lies beyond the end of the data.
+  virtual bool seek(size_t position);
+
+  /// The read position in the data, i.e. the number of bytes that have
+  /// been handed out as chunks since the last reset().
+  size_t position() const { return this->pos_; }
+
+  /// Whether or not all data have been handed out as chunks.
+  bool at_end() const { return this->pos_ >= this->size; }
 
-  bool next_chunk(size_t max_chunk_size);
+  /// Mark the Blob as being read by a user (e.g. an audio source that is
+  /// playing it), or as no longer being read by that user. A BlobBundle
+  /// does not overwrite the data of a Blob that is in use.
+  void acquire() { this->users_++; }
+  void release() {
+    if (this->users_ > 0) {
+      this->users_--;
+    }
+  }
+  virtual bool in_use() const { return this->users_ > 0; }
 
  protected:
   size_t pos_{0}; 
+  uint8_t users_{0};
 };
 
 }  // namespace blob
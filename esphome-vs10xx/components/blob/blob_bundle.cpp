@@ -0,0 +1,296 @@
+#include "blob_bundle.h"
+
+#ifdef USE_BLOB_BUNDLE
+
+#include "esphome/core/application.h"
+#include "esphome/core/log.h"
+#include <esp_http_client.h>
+#include <esp_rom_crc.h>
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace blob {
+
+static const char *const TAG = "blob";
+
+// The timeout for connecting and for every read during an update.
+static const int UPDATE_TIMEOUT_MS = 10000;
+
+// Partitions are erased in whole sectors.
+static const size_t FLASH_SECTOR_SIZE = 4096;
+
+void BlobBundle::add_blob(Blob *blob, const char *name) {
+  if (this->blob_count_ >= this->blobs_.size()) {
+    ESP_LOGE(TAG, "Cannot add blob %s: maximum number of blobs reached", name);
+    return;
+  }
+  this->blobs_[this->blob_count_++] = {blob, name};
+}
+
+void BlobBundle::setup() { this->reload(); }
+
+void BlobBundle::loop() {
+  switch (this->update_state_) {
+    case BUNDLE_UPDATE_IDLE:
+      break;
+    case BUNDLE_UPDATE_WAITING:
+      if (!this->blobs_in_use_()) {
+        this->start_update_();
+      }
+      break;
+    case BUNDLE_UPDATE_ERASING:
+      this->erase_update_();
+      break;
+    case BUNDLE_UPDATE_WRITING:
+      this->write_update_();
+      break;
+  }
+}
+
+void BlobBundle::dump_config() {
+  ESP_LOGCONFIG(TAG, "Blob bundle:");
+  ESP_LOGCONFIG(TAG, "  Partition: %s", this->partition_label_);
+  ESP_LOGCONFIG(TAG, "  Blobs resolved: %zu of %zu", this->resolved_, this->blob_count_);
+}
+
+bool BlobBundle::reload() {
+  this->unmap_();
+  this->clear_blobs_();
+
+  auto *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                             this->partition_label_);
+  if (partition == nullptr) {
+    ESP_LOGE(TAG, "Blob bundle partition '%s' not found", this->partition_label_);
+    return false;
+  }
+  const void *mapped;
+  auto err = esp_partition_mmap(partition, 0, partition->size, SPI_FLASH_MMAP_DATA, &mapped, &this->mmap_handle_);
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Could not map blob bundle partition '%s': %s", this->partition_label_, esp_err_to_name(err));
+    return false;
+  }
+  this->mapped_ = static_cast<const uint8_t *>(mapped);
+
+  // Validate the header and the index, before trusting any of the offsets.
+  auto *header = reinterpret_cast<const BundleHeader *>(this->mapped_);
+  size_t index_size = header->count * sizeof(BundleEntry);
+  if (header->magic != BUNDLE_MAGIC || header->version != BUNDLE_VERSION || header->size > partition->size ||
+      sizeof(BundleHeader) + index_size > header->size) {
+    ESP_LOGE(TAG, "No valid blob bundle found in partition '%s'", this->partition_label_);
+    this->unmap_();
+    return false;
+  }
+  if (esp_rom_crc32_le(0, this->mapped_ + sizeof(BundleHeader), index_size) != header->index_crc) {
+    ESP_LOGE(TAG, "Blob bundle index in partition '%s' is corrupt", this->partition_label_);
+    this->unmap_();
+    return false;
+  }
+
+  for (size_t i = 0; i < this->blob_count_; i++) {
+    auto &entry = this->blobs_[i];
+    auto *index_entry = this->find_(header, entry.name);
+    if (index_entry == nullptr) {
+      ESP_LOGW(TAG, "Blob '%s' not found in bundle", entry.name);
+      continue;
+    }
+    if (index_entry->offset > header->size || index_entry->size > header->size - index_entry->offset) {
+      ESP_LOGW(TAG, "Blob '%s' lies outside the bundle", entry.name);
+      continue;
+    }
+    const uint8_t *data = this->mapped_ + index_entry->offset;
+    if (esp_rom_crc32_le(0, data, index_entry->size) != index_entry->crc) {
+      ESP_LOGW(TAG, "Blob '%s' has a checksum mismatch", entry.name);
+      continue;
+    }
+    entry.blob->set_data(data, index_entry->size);
+    this->resolved_++;
+  }
+  ESP_LOGD(TAG, "Resolved %zu of %zu blobs from partition '%s'", this->resolved_, this->blob_count_,
+           this->partition_label_);
+  return true;
+}
+
+bool BlobBundle::update_from_url(const std::string &url) {
+  if (this->update_state_ != BUNDLE_UPDATE_IDLE) {
+    ESP_LOGW(TAG, "Blob bundle partition '%s' is already being updated", this->partition_label_);
+    return false;
+  }
+  this->update_partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                     this->partition_label_);
+  if (this->update_partition_ == nullptr) {
+    ESP_LOGE(TAG, "Blob bundle partition '%s' not found", this->partition_label_);
+    return false;
+  }
+  this->update_url_ = url;
+  this->update_state_ = BUNDLE_UPDATE_WAITING;
+  this->high_freq_.start();
+  if (this->blobs_in_use_()) {
+    ESP_LOGI(TAG, "Blob bundle update: waiting until the blobs are no longer in use");
+  }
+  return true;
+}
+
+void BlobBundle::start_update_() {
+  ESP_LOGI(TAG, "Updating blob bundle partition '%s' from %s", this->partition_label_, this->update_url_.c_str());
+
+  esp_http_client_config_t config{};
+  config.url = this->update_url_.c_str();
+  config.timeout_ms = UPDATE_TIMEOUT_MS;
+  this->update_client_ = esp_http_client_init(&config);
+  if (this->update_client_ == nullptr || esp_http_client_open(this->update_client_, 0) != ESP_OK) {
+    ESP_LOGE(TAG, "Blob bundle update: cannot connect");
+    this->finish_update_(false);
+    return;
+  }
+  // The bundle size must be known up front (no chunked transfer encoding).
+  auto length = static_cast<int>(esp_http_client_fetch_headers(this->update_client_));
+  auto status = esp_http_client_get_status_code(this->update_client_);
+  if (status != 200) {
+    ESP_LOGE(TAG, "Blob bundle update: HTTP status %d", status);
+    this->finish_update_(false);
+    return;
+  }
+  if (length < static_cast<int>(sizeof(BundleHeader)) || static_cast<size_t>(length) > this->update_partition_->size) {
+    ESP_LOGE(TAG, "Blob bundle update: the bundle size (%d bytes) does not fit the partition (%zu bytes)", length,
+             static_cast<size_t>(this->update_partition_->size));
+    this->finish_update_(false);
+    return;
+  }
+
+  // The first block holds the header, which must describe a bundle of
+  // exactly the size that is downloaded, before the partition is erased.
+  size_t received = 0;
+  while (received < sizeof(BundleHeader)) {
+    auto size = esp_http_client_read(this->update_client_, reinterpret_cast<char *>(this->update_block_) + received,
+                                     sizeof(this->update_block_) - received);
+    if (size <= 0) {
+      break;
+    }
+    received += size;
+  }
+  memcpy(&this->update_header_, this->update_block_, std::min(received, sizeof(BundleHeader)));
+  if (received < sizeof(BundleHeader) || this->update_header_.magic != BUNDLE_MAGIC ||
+      this->update_header_.version != BUNDLE_VERSION || this->update_header_.size != static_cast<uint32_t>(length)) {
+    ESP_LOGE(TAG, "Blob bundle update: the download is not a valid blob bundle");
+    this->finish_update_(false);
+    return;
+  }
+
+  // The data after the header are written once the partition is erased.
+  this->update_pending_ = received - sizeof(BundleHeader);
+  memmove(this->update_block_, this->update_block_ + sizeof(BundleHeader), this->update_pending_);
+  this->update_length_ = length;
+  this->update_written_ = sizeof(BundleHeader);
+  this->update_erased_ = 0;
+
+  // From here on, the blobs point at data that are being overwritten.
+  this->unmap_();
+  this->clear_blobs_();
+  this->update_state_ = BUNDLE_UPDATE_ERASING;
+}
+
+void BlobBundle::erase_update_() {
+  // Erasing a sector blocks for tens of milliseconds, so a single sector is
+  // erased per loop.
+  auto err = esp_partition_erase_range(this->update_partition_, this->update_erased_, FLASH_SECTOR_SIZE);
+  App.feed_wdt();
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Blob bundle update: erasing the partition failed: %s", esp_err_to_name(err));
+    this->finish_update_(false);
+    return;
+  }
+  this->update_erased_ += FLASH_SECTOR_SIZE;
+  if (this->update_erased_ >= this->update_length_) {
+    this->update_state_ = BUNDLE_UPDATE_WRITING;
+  }
+}
+
+void BlobBundle::write_update_() {
+  if (this->update_pending_ > 0) {
+    auto err = esp_partition_write(this->update_partition_, this->update_written_, this->update_block_,
+                                   this->update_pending_);
+    if (err != ESP_OK) {
+      ESP_LOGE(TAG, "Blob bundle update: writing the partition failed: %s", esp_err_to_name(err));
+      this->finish_update_(false);
+      return;
+    }
+    this->update_written_ += this->update_pending_;
+    this->update_pending_ = 0;
+  }
+
+  if (this->update_written_ < this->update_length_) {
+    // A single block is downloaded per loop, to be written in the next one.
+    auto size = esp_http_client_read(this->update_client_, reinterpret_cast<char *>(this->update_block_),
+                                     std::min(BUNDLE_UPDATE_BLOCK_SIZE, this->update_length_ - this->update_written_));
+    if (size <= 0) {
+      ESP_LOGE(TAG, "Blob bundle update: the download ended after %zu of %zu bytes", this->update_written_,
+               this->update_length_);
+      this->finish_update_(false);
+      return;
+    }
+    this->update_pending_ = size;
+    return;
+  }
+
+  auto err = esp_partition_write(this->update_partition_, 0, &this->update_header_, sizeof(BundleHeader));
+  if (err != ESP_OK) {
+    ESP_LOGE(TAG, "Blob bundle update: writing the header failed: %s", esp_err_to_name(err));
+    this->finish_update_(false);
+    return;
+  }
+  ESP_LOGI(TAG, "Blob bundle update: wrote %zu bytes", this->update_length_);
+  this->finish_update_(true);
+}
+
+void BlobBundle::finish_update_(bool success) {
+  if (this->update_client_ != nullptr) {
+    esp_http_client_close(this->update_client_);
+    esp_http_client_cleanup(this->update_client_);
+    this->update_client_ = nullptr;
+  }
+  this->update_state_ = BUNDLE_UPDATE_IDLE;
+  this->update_url_.clear();
+  this->high_freq_.stop();
+  if (success) {
+    this->reload();
+  }
+}
+
+void BlobBundle::clear_blobs_() {
+  this->resolved_ = 0;
+  for (size_t i = 0; i < this->blob_count_; i++) {
+    this->blobs_[i].blob->set_data(nullptr, 0);
+  }
+}
+
+bool BlobBundle::blobs_in_use_() const {
+  for (size_t i = 0; i < this->blob_count_; i++) {
+    if (this->blobs_[i].blob->in_use()) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void BlobBundle::unmap_() {
+  if (this->mapped_ != nullptr) {
+    spi_flash_munmap(this->mmap_handle_);
+    this->mapped_ = nullptr;
+  }
+}
+
+const BundleEntry *BlobBundle::find_(const BundleHeader *header, const char *name) const {
+  auto *index = reinterpret_cast<const BundleEntry *>(this->mapped_ + sizeof(BundleHeader));
+  for (size_t i = 0; i < header->count; i++) {
+    if (strncmp(index[i].name, name, BUNDLE_NAME_SIZE) == 0) {
+      return &index[i];
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace blob
+}  // namespace esphome
+
+#endif
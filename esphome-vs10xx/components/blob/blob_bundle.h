@@ -0,0 +1,147 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// Blob bundles are only compiled in when a blob is configured to be stored
+// in a data partition.
+#ifdef USE_BLOB_BUNDLE
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "blob.h"
+#include <esp_http_client.h>
+#include <esp_partition.h>
+#include <array>
+#include <string>
+
+namespace esphome {
+namespace blob {
+
+/// The layout of a blob bundle. A bundle starts with a header, followed by
+/// an index with an entry for every blob, followed by the blob data.
+/// All numbers are little endian. Offsets are relative to the start of the
+/// bundle. Keep this in sync with the bundle packer in blob/__init__.py
+/// and tools/blob_pack.py.
+static const uint32_t BUNDLE_MAGIC = 0x4E424C42UL;  // "BLBN"
+static const uint16_t BUNDLE_VERSION = 1;
+static const size_t BUNDLE_NAME_SIZE = 32;
+static const size_t BUNDLE_TYPE_SIZE = 8;
+
+struct BundleHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  /// The total size of the bundle in bytes.
+  uint32_t size;
+  /// The CRC32 of the index.
+  uint32_t index_crc;
+} __attribute__((packed));
+
+struct BundleEntry {
+  /// The name of the blob (its ID in the configuration), zero padded.
+  char name[BUNDLE_NAME_SIZE];
+  uint32_t offset;
+  uint32_t size;
+  /// The CRC32 of the blob data.
+  uint32_t crc;
+  /// The type of the blob data (the file extension), zero padded.
+  char type[BUNDLE_TYPE_SIZE];
+} __attribute__((packed));
+
+/// The state of an update of a bundle from a URL.
+enum BundleUpdateState : uint8_t {
+  BUNDLE_UPDATE_IDLE,
+  /// Waiting until none of the blobs is in use.
+  BUNDLE_UPDATE_WAITING,
+  BUNDLE_UPDATE_ERASING,
+  BUNDLE_UPDATE_WRITING,
+};
+
+/// The bundle is downloaded and written to flash in blocks of this size.
+static const size_t BUNDLE_UPDATE_BLOCK_SIZE = 1024;
+
+/// A BlobBundle resolves blobs from a bundle in a data partition. The
+/// partition is memory mapped, so the blob data are read straight from
+/// flash, just like blobs that are stored in the firmware. Since the bundle
+/// lives outside the firmware, it can be updated on its own: over the air
+/// using update_from_url(), or using partition tools.
+class BlobBundle : public Component {
+ public:
+  explicit BlobBundle(const char *partition_label) : partition_label_(partition_label) {}
+
+  /// Register a blob, to be resolved by name from the bundle.
+  void add_blob(Blob *blob, const char *name);
+
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+  float get_setup_priority() const override { return setup_priority::HARDWARE; }
+
+  /// Map the partition and resolve all blobs from the bundle. This is done
+  /// at setup time, and can be called again after the partition was
+  /// updated, as long as none of the blobs is in use. Blobs that cannot
+  /// be resolved are left empty.
+  /// Returns false when the bundle could not be mapped.
+  bool reload();
+
+  /// Start downloading a bundle over HTTP, to write it to the partition,
+  /// after which the blobs are resolved from the new bundle.
+  ///
+  /// The update runs in steps from loop(), so the main loop keeps running:
+  /// every loop erases a single flash sector or writes a single downloaded
+  /// block. While any of the blobs is in use (e.g. a vs10xx device plays
+  /// it), the update waits until it is released.
+  ///
+  /// The bundle header is checked before the partition is erased, and it is
+  /// written last, so an interrupted update does not leave a bundle that
+  /// looks valid. The blobs are empty until a next update succeeds.
+  /// Returns false when the update could not be started.
+  bool update_from_url(const std::string &url);
+
+  BundleUpdateState get_update_state() const { return this->update_state_; }
+
+ protected:
+  struct Entry {
+    Blob *blob;
+    const char *name;
+  };
+
+  const char *partition_label_;
+  /// The blobs in the bundle. This is fixed size storage, sized by the
+  /// code generator, to prevent heap allocations.
+  std::array<Entry, BLOB_BUNDLE_MAX_BLOBS> blobs_{};
+  size_t blob_count_{0};
+  const uint8_t *mapped_{nullptr};
+  spi_flash_mmap_handle_t mmap_handle_{};
+  size_t resolved_{0};
+
+  void unmap_();
+  void clear_blobs_();
+  bool blobs_in_use_() const;
+  const BundleEntry *find_(const BundleHeader *header, const char *name) const;
+
+  // Members that handle an update from a URL.
+  BundleUpdateState update_state_{BUNDLE_UPDATE_IDLE};
+  std::string update_url_{};
+  const esp_partition_t *update_partition_{nullptr};
+  esp_http_client_handle_t update_client_{nullptr};
+  /// The header is kept back until all other data are written.
+  BundleHeader update_header_{};
+  size_t update_length_{0};
+  size_t update_erased_{0};
+  size_t update_written_{0};
+  /// The number of received bytes at the start of the block, that are not
+  /// written yet.
+  size_t update_pending_{0};
+  uint8_t update_block_[BUNDLE_UPDATE_BLOCK_SIZE];
+  HighFrequencyLoopRequester high_freq_;
+  void start_update_();
+  void erase_update_();
+  void write_update_();
+  void finish_update_(bool success);
+};
+
+}  // namespace blob
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,206 @@
+#include "blob_clip_bank.h"
+
+#ifdef USE_BLOB_CLIPS
+
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace blob {
+
+static const char *const TAG = "blob";
+
+static const char *const ONES[] = {"zero",    "one",     "two",       "three",    "four",
+                                   "five",    "six",     "seven",     "eight",    "nine",
+                                   "ten",     "eleven",  "twelve",    "thirteen", "fourteen",
+                                   "fifteen", "sixteen", "seventeen", "eighteen", "nineteen"};
+static const char *const TENS[] = {"twenty", "thirty", "forty", "fifty", "sixty", "seventy", "eighty", "ninety"};
+
+static void write_le16(uint8_t *data, uint16_t value) {
+  data[0] = value & 0xFF;
+  data[1] = value >> 8;
+}
+
+static void write_le32(uint8_t *data, uint32_t value) {
+  write_le16(data, value & 0xFFFF);
+  write_le16(data + 2, value >> 16);
+}
+
+const ClipBankHeader *ClipBank::get_header() const {
+  if (this->data == nullptr || this->size < sizeof(ClipBankHeader)) {
+    return nullptr;
+  }
+  auto *header = reinterpret_cast<const ClipBankHeader *>(this->data);
+  if (header->magic != CLIP_BANK_MAGIC || header->version != CLIP_BANK_VERSION ||
+      sizeof(ClipBankHeader) + header->count * sizeof(ClipBankEntry) > this->size) {
+    return nullptr;
+  }
+  return header;
+}
+
+bool ClipBank::find(const char *name, const uint8_t **data, size_t *size) const {
+  auto *header = this->get_header();
+  if (header == nullptr) {
+    return false;
+  }
+  auto *entries = reinterpret_cast<const ClipBankEntry *>(this->data + sizeof(ClipBankHeader));
+  for (size_t i = 0; i < header->count; i++) {
+    auto &entry = entries[i];
+    if (strncmp(entry.name, name, CLIP_NAME_SIZE) != 0) {
+      continue;
+    }
+    if (entry.offset > this->size || entry.size > this->size - entry.offset) {
+      return false;
+    }
+    *data = this->data + entry.offset;
+    *size = entry.size;
+    return true;
+  }
+  return false;
+}
+
+ClipPhrase *ClipBank::phrase() {
+  this->phrase_.clear();
+  return &this->phrase_;
+}
+
+ClipPhrase *ClipBank::say_time(uint8_t hour, uint8_t minute) {
+  auto *phrase = this->phrase();
+  phrase->add("it_is");
+  phrase->add_time(hour, minute);
+  return phrase;
+}
+
+void ClipPhrase::clear() {
+  this->count_ = 0;
+  this->size = CLIP_WAV_HEADER_SIZE;
+  this->write_header_();
+  this->reset();
+}
+
+bool ClipPhrase::add(const char *name) {
+  if (this->count_ >= CLIP_PHRASE_MAX_CLIPS) {
+    ESP_LOGW(TAG, "Phrase is full, clip '%s' dropped", name);
+    return false;
+  }
+  Slice slice{};
+  if (!this->bank_->find(name, &slice.data, &slice.size)) {
+    ESP_LOGW(TAG, "Clip '%s' not found in clip bank", name);
+    return false;
+  }
+  this->clips_[this->count_++] = slice;
+  this->size += slice.size;
+  this->write_header_();
+  return true;
+}
+
+bool ClipPhrase::add_number(uint8_t number) {
+  if (number < 20) {
+    return this->add(ONES[number]);
+  }
+  if (number >= 100) {
+    ESP_LOGW(TAG, "Number %u cannot be spoken", number);
+    return false;
+  }
+  bool ok = this->add(TENS[number / 10 - 2]);
+  if (number % 10 != 0) {
+    ok = this->add(ONES[number % 10]) && ok;
+  }
+  return ok;
+}
+
+bool ClipPhrase::add_time(uint8_t hour, uint8_t minute) {
+  if (hour > 23 || minute > 59) {
+    ESP_LOGW(TAG, "Invalid time %u:%02u", hour, minute);
+    return false;
+  }
+  // On a 12 hour clock, 0:00 and 12:00 are both spoken as "twelve".
+  uint8_t hour12 = hour % 12 == 0 ? 12 : hour % 12;
+  bool ok = this->add_number(hour12);
+  if (minute == 0) {
+    ok = this->add("oclock") && ok;
+  } else if (minute < 10) {
+    ok = this->add("oh") && ok;
+    ok = this->add_number(minute) && ok;
+  } else {
+    ok = this->add_number(minute) && ok;
+  }
+  return ok;
+}
+
+void ClipPhrase::write_header_() {
+  // The format of the clips comes from the clip bank. The data size is
+  // exact, so the decoder knows where the phrase ends.
+  auto *bank_header = this->bank_->get_header();
+  uint32_t sample_rate = bank_header != nullptr ? bank_header->sample_rate : 16000;
+  uint16_t channels = bank_header != nullptr ? bank_header->channels : 1;
+  uint32_t data_size = this->size - CLIP_WAV_HEADER_SIZE;
+  uint16_t block_align = channels * 2;
+  uint8_t *data = this->header_;
+  memcpy(data, "RIFF", 4);
+  write_le32(data + 4, data_size + CLIP_WAV_HEADER_SIZE - 8);
+  memcpy(data + 8, "WAVEfmt ", 8);
+  write_le32(data + 16, 16);
+  write_le16(data + 20, 1);  // WAVE_FORMAT_PCM
+  write_le16(data + 22, channels);
+  write_le32(data + 24, sample_rate);
+  write_le32(data + 28, sample_rate * block_align);
+  write_le16(data + 32, block_align);
+  write_le16(data + 34, 16);
+  memcpy(data + 36, "data", 4);
+  write_le32(data + 40, data_size);
+  this->data = this->header_;
+}
+
+ClipPhrase::Slice ClipPhrase::slice_at_(size_t index) const {
+  if (index == 0) {
+    return {this->header_, CLIP_WAV_HEADER_SIZE};
+  }
+  return this->clips_[index - 1];
+}
+
+void ClipPhrase::reset() {
+  Blob::reset();
+  this->slice_ = 0;
+  this->offset_ = 0;
+}
+
+bool ClipPhrase::next_chunk(size_t max_chunk_size) {
+  // Chunks never span two slices, so they can point straight into the
+  // clip bank. The slices are handed out back-to-back, without a gap.
+  while (this->slice_ <= this->count_) {
+    auto slice = this->slice_at_(this->slice_);
+    if (this->offset_ < slice.size) {
+      auto len = std::min(max_chunk_size, slice.size - this->offset_);
+      this->chunk_start = slice.data + this->offset_;
+      this->chunk_size = len;
+      this->offset_ += len;
+      this->pos_ += len;
+      return true;
+    }
+    this->slice_++;
+    this->offset_ = 0;
+  }
+  return false;
+}
+
+bool ClipPhrase::seek(size_t position) {
+  if (position > this->size) {
+    return false;
+  }
+  this->pos_ = position;
+  this->chunk_size = 0;
+  this->slice_ = 0;
+  this->offset_ = position;
+  while (this->slice_ <= this->count_ && this->offset_ >= this->slice_at_(this->slice_).size) {
+    this->offset_ -= this->slice_at_(this->slice_).size;
+    this->slice_++;
+  }
+  return true;
+}
+
+}  // namespace blob
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// Clip banks are only compiled in when a blob is configured with clips.
+#ifdef USE_BLOB_CLIPS
+
+#include "blob.h"
+
+namespace esphome {
+namespace blob {
+
+/// The layout of a clip bank. A clip bank starts with a header, followed by
+/// an offset table with an entry for every clip, followed by the clip data.
+/// All clips are 16 bit PCM (little endian), in the sample rate and number
+/// of channels from the header. All numbers are little endian. Offsets are
+/// relative to the start of the clip bank. Keep this in sync with the clip
+/// bank packer in blob/clip_bank.py.
+static const uint32_t CLIP_BANK_MAGIC = 0x42504C43UL;  // "CLPB"
+static const uint16_t CLIP_BANK_VERSION = 1;
+static const size_t CLIP_NAME_SIZE = 16;
+
+/// The maximum number of clips in a phrase.
+static const size_t CLIP_PHRASE_MAX_CLIPS = 16;
+
+/// The size of the WAV header that a phrase starts with.
+static const size_t CLIP_WAV_HEADER_SIZE = 44;
+
+struct ClipBankHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;
+  uint32_t sample_rate;
+  uint16_t channels;
+  uint16_t bits_per_sample;
+} __attribute__((packed));
+
+struct ClipBankEntry {
+  /// The name of the clip (its file name, without extension), zero padded.
+  char name[CLIP_NAME_SIZE];
+  uint32_t offset;
+  uint32_t size;
+} __attribute__((packed));
+
+class ClipBank;
+
+/// A phrase that is assembled from the clips in a clip bank, e.g. "it is
+/// seven fifteen". The phrase is a Blob, so it can be played like any
+/// other blob. It is played as a single WAV stream: a generated header,
+/// followed by the clips back-to-back. This way, the decoder plays the
+/// clips without a gap and without a reset between them.
+///
+/// The phrase does not copy the clips. Its chunks point straight into the
+/// clip bank, which is read from flash.
+class ClipPhrase : public Blob {
+ public:
+  explicit ClipPhrase(ClipBank *bank) : bank_(bank) {}
+
+  /// Remove all clips from the phrase.
+  void clear();
+
+  /// Add a clip to the phrase, by name. Returns false when the clip does
+  /// not exist in the clip bank, or when the phrase is full.
+  bool add(const char *name);
+
+  /// Add the English words for a number from 0 to 99 (e.g. "forty",
+  /// "two"), using the clips "zero" to "nineteen" and "twenty" to
+  /// "ninety".
+  bool add_number(uint8_t number);
+
+  /// Add the English words for a time of day, on a 12 hour clock (e.g.
+  /// "seven", "oh", "five"). Full hours use the clip "oclock".
+  bool add_time(uint8_t hour, uint8_t minute);
+
+  /// The number of clips in the phrase.
+  size_t clip_count() const { return this->count_; }
+
+  void reset() override;
+  bool next_chunk(size_t max_chunk_size) override;
+  bool seek(size_t position) override;
+
+ protected:
+  struct Slice {
+    const uint8_t *data;
+    size_t size;
+  };
+
+  ClipBank *bank_;
+  uint8_t header_[CLIP_WAV_HEADER_SIZE]{};
+  Slice clips_[CLIP_PHRASE_MAX_CLIPS]{};
+  size_t count_{0};
+
+  // The read position, as the slice and the offset within the slice. The
+  // WAV header is slice 0, the clips follow.
+  size_t slice_{0};
+  size_t offset_{0};
+  Slice slice_at_(size_t index) const;
+  void write_header_();
+};
+
+/// A Blob that holds a clip bank: a set of short recordings (e.g. words
+/// and digits), which are packed at build time into a single asset. The
+/// clips are normalized at build time, to the same format and loudness,
+/// with silence trimmed and edges faded, so they join seamlessly.
+///
+/// Phrases are assembled at runtime, e.g. to announce the time:
+///
+///   vs10xx.play: !lambda 'return id(words).say_time(7, 15);'
+class ClipBank : public Blob {
+ public:
+  explicit ClipBank(const uint8_t *data, size_t size) : Blob(data, size), phrase_(this) {}
+  explicit ClipBank() : Blob(), phrase_(this) {}
+
+  /// Find a clip by name. The data of the clip are returned without
+  /// copying. Returns false when the clip does not exist.
+  bool find(const char *name, const uint8_t **data, size_t *size) const;
+
+  /// The header of the clip bank, or nullptr when the data are not a valid
+  /// clip bank (e.g. a bundle partition that was not flashed).
+  const ClipBankHeader *get_header() const;
+
+  /// Start a new phrase. The clip bank holds a single phrase, which is
+  /// reused for every new phrase. Like with other blobs, the phrase must
+  /// not be changed while it is playing.
+  ClipPhrase *phrase();
+
+  /// Start a new phrase that tells the time: "it is" (the clip "it_is"),
+  /// followed by the time.
+  ClipPhrase *say_time(uint8_t hour, uint8_t minute);
+
+  /// The phrase plays the data of the clip bank.
+  bool in_use() const override { return Blob::in_use() || this->phrase_.in_use(); }
+
+ protected:
+  ClipPhrase phrase_;
+};
+
+}  // namespace blob
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,133 @@
+"""Packing of clip banks: sets of short recordings, which are normalized at
+build time, so they can be played back-to-back as a single phrase."""
+
+import array
+import math
+import os
+import struct
+import sys
+import wave
+
+# The layout of a clip bank. Keep this in sync with blob_clip_bank.h.
+CLIP_BANK_MAGIC = b"CLPB"
+CLIP_BANK_VERSION = 1
+CLIP_BANK_HEADER = struct.Struct("<4sHHIHH")
+CLIP_BANK_ENTRY = struct.Struct("<16sII")
+CLIP_NAME_SIZE = 16
+CLIP_ALIGNMENT = 4
+
+# The normalization that is applied to every clip.
+SILENCE_THRESHOLD = 0.02
+TARGET_RMS = 10 ** (-20 / 20)
+PEAK_LIMIT = 10 ** (-1 / 20)
+FADE_MS = 5
+
+
+def clip_name(path):
+    """The name of a clip is the name of its file, without extension."""
+    return os.path.splitext(os.path.basename(path))[0]
+
+
+def read_wav(path):
+    """Read a PCM WAV file, as mono samples in the range -1.0 to 1.0."""
+    with wave.open(path, "rb") as fh:
+        channels = fh.getnchannels()
+        width = fh.getsampwidth()
+        rate = fh.getframerate()
+        frames = fh.readframes(fh.getnframes())
+    if width == 1:
+        samples = [(b - 128) / 128 for b in frames]
+    elif width == 2:
+        pcm = array.array("h", frames)
+        if sys.byteorder == "big":
+            pcm.byteswap()
+        samples = [s / 32768 for s in pcm]
+    else:
+        raise ValueError("only 8 and 16 bit WAV files are supported")
+    if channels > 1:
+        samples = [
+            sum(samples[i : i + channels]) / channels
+            for i in range(0, len(samples), channels)
+        ]
+    return rate, samples
+
+
+def resample(samples, rate, target_rate):
+    """Resample using linear interpolation. Speech clips are band limited
+    well below the target rate, so this is good enough."""
+    if rate == target_rate or not samples:
+        return samples
+    count = max(1, int(len(samples) * target_rate / rate))
+    step = rate / target_rate
+    last = len(samples) - 1
+    result = []
+    for i in range(count):
+        position = i * step
+        index = int(position)
+        fraction = position - index
+        a = samples[min(index, last)]
+        b = samples[min(index + 1, last)]
+        result.append(a + (b - a) * fraction)
+    return result
+
+
+def normalize(samples, rate, gap_ms):
+    """Normalize a clip, so clips join seamlessly: remove the DC offset,
+    trim the silence on both ends, match the loudness, fade the edges (so
+    the joins do not click) and add a fixed gap of silence at the end."""
+    if samples:
+        dc = sum(samples) / len(samples)
+        samples = [s - dc for s in samples]
+    loud = [i for i, s in enumerate(samples) if abs(s) > SILENCE_THRESHOLD]
+    if not loud:
+        raise ValueError("clip is silent")
+    samples = samples[loud[0] : loud[-1] + 1]
+
+    rms = math.sqrt(sum(s * s for s in samples) / len(samples))
+    peak = max(abs(s) for s in samples)
+    gain = min(TARGET_RMS / rms, PEAK_LIMIT / peak)
+    samples = [s * gain for s in samples]
+
+    fade = min(len(samples) // 2, rate * FADE_MS // 1000)
+    for i in range(fade):
+        samples[i] *= i / fade
+        samples[-1 - i] *= i / fade
+    return samples + [0.0] * (rate * gap_ms // 1000)
+
+
+def load_clip(path, sample_rate, gap_ms):
+    """Load a clip, and convert it to normalized 16 bit PCM."""
+    rate, samples = read_wav(path)
+    samples = normalize(resample(samples, rate, sample_rate), sample_rate, gap_ms)
+    pcm = array.array("h", (max(-32768, min(32767, round(s * 32767))) for s in samples))
+    if sys.byteorder == "big":
+        pcm.byteswap()
+    return pcm.tobytes()
+
+
+def pack_clip_bank(clips, sample_rate):
+    """Pack a list of (name, data) tuples into a clip bank."""
+    index_size = CLIP_BANK_HEADER.size + CLIP_BANK_ENTRY.size * len(clips)
+    offset = index_size
+    index = b""
+    data = b""
+    for name, content in clips:
+        padding = -(offset + len(data)) % CLIP_ALIGNMENT
+        data += b"\0" * padding
+        index += CLIP_BANK_ENTRY.pack(name.encode(), offset + len(data), len(content))
+        data += content
+    header = CLIP_BANK_HEADER.pack(
+        CLIP_BANK_MAGIC, CLIP_BANK_VERSION, len(clips), sample_rate, 1, 16
+    )
+    return header + index + data
+
+
+def build_clip_bank(paths, sample_rate, gap_ms):
+    """Build a clip bank from a list of WAV files."""
+    clips = []
+    for path in paths:
+        try:
+            clips.append((clip_name(path), load_clip(path, sample_rate, gap_ms)))
+        except (ValueError, wave.Error, EOFError) as err:
+            raise ValueError(f"{path}: {err}") from err
+    return pack_clip_bank(clips, sample_rate)
@@ -1,12 +1,19 @@
+import logging
 import esphome.codegen as cg
 import esphome.config_validation as cv
 from esphome import automation
 from esphome import pins
 from esphome.components import spi
 from esphome.components import blob
-from esphome.const import CONF_ID, CONF_RESET_PIN, CONF_TYPE, CONF_DELTA, CONF_DIRECTION
+from esphome.const import CONF_PLATFORM, CONF_UPDATE_INTERVAL, CONF_ID, CONF_RESET_PIN, CONF_TYPE, CONF_DELTA, CONF_DIRECTION, CONF_TRIGGER_ID, CONF_PRIORITY, CONF_URL, CONF_TIMEOUT, CONF_PORT, CONF_ADDRESS
+from esphome.core import CORE
+import esphome.final_validate as fv
 
+_LOGGER = logging.getLogger(__name__)
+
+CONF_VS10XX_ID = "vs10xx_id"
 CONF_HAL_ID = "hal_id"
+CONF_TRANSPORT_ID = "transport_id"
 CONF_SPI_FAST_ID = "spi_fast_id"
 CONF_SPI_SLOW_ID = "spi_slow_id"
 CONF_DREQ_PIN = "dreq_pin"
@@ -17,9 +24,70 @@ CONF_VOLUME = "volume"
 CONF_LEFT = "left"
 CONF_RIGHT = "right"
 CONF_BLOB_ID = "blob_id"
+CONF_FAST_BOOT = "fast_boot"
+CONF_PREFERENCES_QUIET_PERIOD = "preferences_quiet_period"
+CONF_BUFFER_SIZE = "buffer_size"
+CONF_FLASH_WRITE_MIN_FILL = "flash_write_min_fill"
+CONF_FLASH_WRITE_MAX_DEFERRAL = "flash_write_max_deferral"
+CONF_TRACE_SIZE = "trace_size"
+CONF_CAPTURE_SIZE = "capture_size"
+CONF_BENCHMARK = "benchmark"
+CONF_WATCHDOG_TIMEOUT = "watchdog_timeout"
+CONF_RECOVERY_INTERVAL = "recovery_interval"
+CONF_POWER_DOWN_IDLE_TIME = "power_down_idle_time"
+CONF_POWER_DOWN_MODE = "power_down_mode"
+CONF_CLOCK_SCALING = "clock_scaling"
+CONF_FEED_LOOP_TIME = "feed_loop_time"
+CONF_BUS_GRANT_TIMEOUT = "bus_grant_timeout"
+CONF_FILESYSTEM = "filesystem"
+CONF_FILE_CACHE_SIZE = "file_cache_size"
+CONF_FILE = "file"
+CONF_HTTP_STREAM = "http_stream"
+CONF_PREFILL = "prefill"
+CONF_RECONNECT_DELAY = "reconnect_delay"
+CONF_MAX_RECONNECT_DELAY = "max_reconnect_delay"
+CONF_STALL_TIMEOUT = "stall_timeout"
+CONF_UDP_STREAM = "udp_stream"
+CONF_FORMAT = "format"
+CONF_SAMPLE_RATE = "sample_rate"
+CONF_CHANNELS = "channels"
+CONF_MIN_DELAY = "min_delay"
+CONF_MAX_DELAY = "max_delay"
+CONF_IDLE_TIMEOUT = "idle_timeout"
+CONF_SYNC = "sync"
+CONF_ROLE = "role"
+CONF_TOLERANCE = "tolerance"
+CONF_FAILOVER = "failover"
+CONF_BLOB = "blob"
+CONF_RETURN_TO_SOURCE = "return_to_source"
+CONF_TONES = "tones"
+CONF_TONE_ID = "tone_id"
+CONF_REPEAT = "repeat"
+CONF_PATTERN = "pattern"
+CONF_WAVEFORM = "waveform"
+CONF_FREQUENCY = "frequency"
+CONF_END_FREQUENCY = "end_frequency"
+CONF_DURATION = "duration"
+CONF_PAUSE = "pause"
+CONF_ATTACK = "attack"
+CONF_RELEASE = "release"
+CONF_ON_PLAY_START = "on_play_start"
+CONF_ON_PLAY_END = "on_play_end"
+CONF_ON_UNDERRUN = "on_underrun"
+CONF_ON_DEVICE_READY = "on_device_ready"
+CONF_ON_DEVICE_FAILED = "on_device_failed"
 
 CODEOWNERS = ["@mmakaay"]
 DEPENDENCIES = ["spi"]
+MULTI_CONF = True
+
+DOMAIN = "vs10xx"
+
+# The key under which the feed scheduler, that is shared by all devices, is
+# stored in the code generation data.
+DATA_SCHEDULER = "vs10xx_scheduler"
+# The device options that actions rely on, as (device ID, option, action).
+DATA_REQUIRED_OPTIONS = "vs10xx_required_options"
 
 vs10xx_ns = cg.esphome_ns.namespace("vs10xx")
 
@@ -27,11 +95,16 @@ vs10xx_ns = cg.esphome_ns.namespace("vs10xx")
 VS10XX = vs10xx_ns.class_("VS10XX", cg.Component)
 VS10XXSlowSPI = vs10xx_ns.class_("VS10XXSlowSPI", cg.Component, spi.SPIDevice)
 VS10XXFastSPI = vs10xx_ns.class_("VS10XXFastSPI", cg.Component, spi.SPIDevice)
+VS10XXTransport = vs10xx_ns.class_("VS10XXTransport")
+VS10XXSPITransport = vs10xx_ns.class_("VS10XXSPITransport", VS10XXTransport)
 VS10XXHAL = vs10xx_ns.class_("VS10XXHAL", cg.Component)
 VS10XXHALChipset = vs10xx_ns.class_("VS10XXHALChipset")
 VS1003Chipset = vs10xx_ns.class_("VS1003Chipset", VS10XXHALChipset)
 VS1053Chipset = vs10xx_ns.class_("VS1053Chipset", VS10XXHALChipset)
 VS10XXPlugin = vs10xx_ns.class_("VS10XXPlugin")
+VS10XXScheduler = vs10xx_ns.class_("VS10XXScheduler", cg.Component)
+ToneSource = vs10xx_ns.class_("ToneSource")
+ToneStep = vs10xx_ns.struct("ToneStep")
 
 # Actions
 ChangeVolumeAction = vs10xx_ns.class_(
@@ -46,6 +119,55 @@ PlayAction = vs10xx_ns.class_(
 TurnOffOutputAction = vs10xx_ns.class_(
     "TurnOffOutputAction", automation.Action, cg.Parented.template(VS10XX)
 )
+DumpTraceAction = vs10xx_ns.class_(
+    "DumpTraceAction", automation.Action, cg.Parented.template(VS10XX)
+)
+StartCaptureAction = vs10xx_ns.class_(
+    "StartCaptureAction", automation.Action, cg.Parented.template(VS10XX)
+)
+StopCaptureAction = vs10xx_ns.class_(
+    "StopCaptureAction", automation.Action, cg.Parented.template(VS10XX)
+)
+DumpCaptureAction = vs10xx_ns.class_(
+    "DumpCaptureAction", automation.Action, cg.Parented.template(VS10XX)
+)
+BenchmarkAction = vs10xx_ns.class_(
+    "BenchmarkAction", automation.Action, cg.Parented.template(VS10XX)
+)
+RequestBusAction = vs10xx_ns.class_(
+    "RequestBusAction", automation.Action, cg.Parented.template(VS10XX)
+)
+ReleaseBusAction = vs10xx_ns.class_(
+    "ReleaseBusAction", automation.Action, cg.Parented.template(VS10XX)
+)
+PlayFileAction = vs10xx_ns.class_(
+    "PlayFileAction", automation.Action, cg.Parented.template(VS10XX)
+)
+PlayUrlAction = vs10xx_ns.class_(
+    "PlayUrlAction", automation.Action, cg.Parented.template(VS10XX)
+)
+PlayToneAction = vs10xx_ns.class_(
+    "PlayToneAction", automation.Action, cg.Parented.template(VS10XX)
+)
+StopAction = vs10xx_ns.class_(
+    "StopAction", automation.Action, cg.Parented.template(VS10XX)
+)
+
+# Triggers
+PlayStartTrigger = vs10xx_ns.class_("PlayStartTrigger", automation.Trigger.template())
+PlayEndTrigger = vs10xx_ns.class_("PlayEndTrigger", automation.Trigger.template())
+UnderrunTrigger = vs10xx_ns.class_("UnderrunTrigger", automation.Trigger.template())
+DeviceReadyTrigger = vs10xx_ns.class_("DeviceReadyTrigger", automation.Trigger.template())
+DeviceFailedTrigger = vs10xx_ns.class_("DeviceFailedTrigger", automation.Trigger.template())
+
+# A mapping of the trigger options and their trigger classes.
+TRIGGERS = {
+    CONF_ON_PLAY_START: PlayStartTrigger,
+    CONF_ON_PLAY_END: PlayEndTrigger,
+    CONF_ON_UNDERRUN: UnderrunTrigger,
+    CONF_ON_DEVICE_READY: DeviceReadyTrigger,
+    CONF_ON_DEVICE_FAILED: DeviceFailedTrigger,
+}
 
 
 # A mapping of known device types and their HAL ipmlementation classes.
@@ -61,13 +183,150 @@ PLUGINS = {
     "VS1003": {
         "DACMONO": _plugin("PluginVS1003DacMono"),
         "WAVFIX": _plugin("PluginVS1003WavFix"),
-        "8KHZMP3fix": _plugin("PluginVS10038kHzMp3Fix"),
+        "8KHZMP3FIX": _plugin("VS1003Plugin8kHzMp3Fix"),
         "WMAREW4": _plugin("PluginVS1003WMAWebcastRewind"),
     },
     "VS1053": {},
 }
 
 
+def validate_power_of_two(value):
+    if value & (value - 1):
+        raise cv.Invalid(f"Value must be a power of two, got {value}")
+    return value
+
+
+# The supported power down modes. In SOFTWARE mode, the device is put in a
+# low power state (SM_PDOWN, or a low clock for chipsets that do not support
+# this), from which it can wake up quickly. In RESET mode, the device is held
+# in reset using the reset pin. This saves the most power, but requires a
+# full initialization on wake up.
+POWER_DOWN_MODES = ["SOFTWARE", "RESET"]
+
+
+# The filesystems that audio files can be played from: the Arduino filesystem
+# object, the header that declares it, and the libraries that it requires.
+# LittleFS is mounted by the component. An SD card must be mounted by the
+# configuration (e.g. using SD.begin() from an on_boot lambda), since that
+# requires bus and pin settings.
+FILESYSTEMS = {
+    "LITTLEFS": ("LittleFS", "LittleFS.h", ["FS", "LittleFS"]),
+    "SD": ("SD", "SD.h", ["FS", "SPI", "SD"]),
+    "SD_MMC": ("SD_MMC", "SD_MMC.h", ["FS", "SD_MMC"]),
+}
+
+# The RTP payload formats that can be played from a UDP stream. All formats
+# are decoded into 16 bit PCM by the component.
+UdpPayloadFormat = vs10xx_ns.enum("UdpPayloadFormat")
+UDP_FORMATS = {
+    "L16": UdpPayloadFormat.UDP_FORMAT_L16,
+    "PCMU": UdpPayloadFormat.UDP_FORMAT_PCMU,
+    "DVI4": UdpPayloadFormat.UDP_FORMAT_DVI4,
+}
+
+
+# The roles in synchronized playback. The leader relays the UDP stream to the
+# sync address, which the followers play from, and sends clock messages.
+SyncRole = vs10xx_ns.enum("SyncRole")
+SYNC_ROLES = {
+    "LEADER": SyncRole.SYNC_LEADER,
+    "FOLLOWER": SyncRole.SYNC_FOLLOWER,
+}
+
+
+def validate_udp_stream(config):
+    if config[CONF_FORMAT] == "DVI4" and config[CONF_CHANNELS] != 1:
+        raise cv.Invalid("The DVI4 format only supports a single channel")
+    if config[CONF_MIN_DELAY] > config[CONF_MAX_DELAY]:
+        raise cv.Invalid(f"{CONF_MIN_DELAY} must not be larger than {CONF_MAX_DELAY}")
+    return config
+
+
+# The waveforms of the tone generator. A sweep is a sine that glides from
+# the frequency to the end frequency.
+ToneWaveform = vs10xx_ns.enum("ToneWaveform")
+TONE_WAVEFORMS = {
+    "SINE": ToneWaveform.TONE_SINE,
+    "SQUARE": ToneWaveform.TONE_SQUARE,
+    "SWEEP": ToneWaveform.TONE_SWEEP,
+}
+
+
+def _tone_time(max_ms):
+    return cv.All(
+        cv.positive_time_period_milliseconds,
+        cv.Range(max=cv.TimePeriod(milliseconds=max_ms)),
+    )
+
+
+def validate_tone_step(config):
+    if config[CONF_WAVEFORM] == "SWEEP" and CONF_END_FREQUENCY not in config:
+        raise cv.Invalid(f"A SWEEP requires an {CONF_END_FREQUENCY}")
+    if config[CONF_WAVEFORM] != "SWEEP" and CONF_END_FREQUENCY in config:
+        raise cv.Invalid(f"{CONF_END_FREQUENCY} can only be used for a SWEEP")
+    return config
+
+
+def validate_tone(config):
+    # Frequencies must stay below the Nyquist frequency, or they fold back
+    # into audible lower tones.
+    nyquist = config[CONF_SAMPLE_RATE] // 2
+    for step in config[CONF_PATTERN]:
+        for key in (CONF_FREQUENCY, CONF_END_FREQUENCY):
+            if step.get(key, 0) >= nyquist:
+                raise cv.Invalid(
+                    f"The {key} must be lower than half the {CONF_SAMPLE_RATE} ({nyquist} Hz)"
+                )
+    return config
+
+
+TONE_STEP_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_WAVEFORM, default="SINE"): cv.one_of(*TONE_WAVEFORMS, upper=True),
+            cv.Required(CONF_FREQUENCY): cv.int_range(min=20, max=20000),
+            cv.Optional(CONF_END_FREQUENCY): cv.int_range(min=20, max=20000),
+            cv.Required(CONF_DURATION): _tone_time(60000),
+            cv.Optional(CONF_PAUSE, default="0ms"): _tone_time(60000),
+            cv.Optional(CONF_ATTACK, default="5ms"): _tone_time(10000),
+            cv.Optional(CONF_RELEASE, default="5ms"): _tone_time(10000),
+            cv.Optional(CONF_VOLUME, default="100%"): cv.percentage,
+        }
+    ),
+    validate_tone_step,
+)
+
+
+TONE_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Required(CONF_ID): cv.declare_id(ToneSource),
+            cv.Optional(CONF_SAMPLE_RATE, default=22050): cv.int_range(min=8000, max=48000),
+            cv.Optional(CONF_CHANNELS, default=1): cv.int_range(min=1, max=2),
+            cv.Optional(CONF_REPEAT, default=1): cv.Any(
+                cv.one_of("FOREVER", upper=True), cv.int_range(min=1, max=65535)
+            ),
+            cv.Required(CONF_PATTERN): cv.All(
+                cv.ensure_list(TONE_STEP_SCHEMA), cv.Length(min=1)
+            ),
+        }
+    ),
+    validate_tone,
+)
+
+
+# The key under which it is stored that LittleFS is mounted.
+DATA_LITTLEFS_MOUNTED = "vs10xx_littlefs_mounted"
+
+
+def validate_watchdog_timeout(value):
+    # The decode time has a resolution of one second, so shorter timeouts
+    # would make the watchdog see a hang during normal playback.
+    if 0 < value.total_milliseconds < 2000:
+        raise cv.Invalid("The watchdog timeout must be 0s (disabled) or at least 2s")
+    return value
+
+
 CONFIG_SCHEMA = (
     cv.Schema(
         {
@@ -75,21 +334,157 @@ CONFIG_SCHEMA = (
             cv.Required(CONF_TYPE): cv.one_of(*TYPES, upper=True),
             cv.GenerateID(CONF_SPI_SLOW_ID): cv.declare_id(VS10XXSlowSPI),
             cv.GenerateID(CONF_SPI_FAST_ID): cv.declare_id(VS10XXFastSPI),
+            cv.GenerateID(CONF_TRANSPORT_ID): cv.declare_id(VS10XXSPITransport),
             cv.GenerateID(CONF_HAL_ID): cv.declare_id(VS10XXHAL),
             cv.Required(CONF_DREQ_PIN): pins.gpio_input_pin_schema,
             cv.Required(CONF_XDCS_PIN): pins.gpio_output_pin_schema,
             cv.Required(CONF_XCS_PIN): pins.gpio_output_pin_schema,
             cv.Optional(CONF_RESET_PIN): pins.gpio_output_pin_schema,
             cv.Optional(CONF_PLUGINS): cv.ensure_list(cv.string),
+            cv.Optional(CONF_FAST_BOOT, default=False): cv.boolean,
+            cv.Optional(
+                CONF_PREFERENCES_QUIET_PERIOD, default="5s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_BUFFER_SIZE, default=8192): cv.int_range(min=512, max=262144),
+            cv.Optional(CONF_FLASH_WRITE_MIN_FILL, default="75%"): cv.percentage,
+            cv.Optional(
+                CONF_FLASH_WRITE_MAX_DEFERRAL, default="30s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_TRACE_SIZE): cv.All(
+                cv.int_range(min=16, max=8192), validate_power_of_two
+            ),
+            cv.Optional(CONF_CAPTURE_SIZE): cv.int_range(min=256, max=262144),
+            cv.Optional(CONF_BENCHMARK, default=False): cv.boolean,
+            cv.Optional(CONF_WATCHDOG_TIMEOUT, default="5s"): cv.All(
+                cv.positive_time_period_milliseconds, validate_watchdog_timeout
+            ),
+            cv.Optional(
+                CONF_RECOVERY_INTERVAL, default="60s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(
+                CONF_POWER_DOWN_IDLE_TIME, default="0s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_POWER_DOWN_MODE): cv.one_of(*POWER_DOWN_MODES, upper=True),
+            cv.Optional(CONF_CLOCK_SCALING, default=True): cv.boolean,
+            cv.Optional(CONF_PRIORITY, default=0): cv.int_,
+            cv.Optional(CONF_FEED_LOOP_TIME, default="30ms"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(milliseconds=1), max=cv.TimePeriod(milliseconds=100)),
+            ),
+            # The devices play through a grant from their own input buffer,
+            # which lasts from about 50 ms at 320 kbit/s to a few hundred ms
+            # at low bit rates. Longer grants would always starve the audio.
+            cv.Optional(CONF_BUS_GRANT_TIMEOUT, default="50ms"): cv.All(
+                cv.positive_time_period_milliseconds,
+                cv.Range(min=cv.TimePeriod(milliseconds=1), max=cv.TimePeriod(milliseconds=200)),
+            ),
+            cv.Optional(CONF_FILESYSTEM): cv.All(
+                cv.only_with_arduino, cv.one_of(*FILESYSTEMS, upper=True)
+            ),
+            cv.Optional(CONF_FILE_CACHE_SIZE, default=4096): cv.All(
+                cv.int_range(min=512, max=65536), validate_power_of_two
+            ),
+            cv.Optional(CONF_HTTP_STREAM): cv.All(
+                cv.only_on_esp32,
+                cv.only_with_arduino,
+                cv.Schema(
+                    {
+                        cv.Optional(CONF_PREFILL, default="50%"): cv.percentage,
+                        cv.Optional(
+                            CONF_RECONNECT_DELAY, default="1s"
+                        ): cv.positive_time_period_milliseconds,
+                        cv.Optional(
+                            CONF_MAX_RECONNECT_DELAY, default="60s"
+                        ): cv.positive_time_period_milliseconds,
+                        cv.Optional(
+                            CONF_STALL_TIMEOUT, default="10s"
+                        ): cv.positive_time_period_milliseconds,
+                    }
+                ),
+            ),
+            cv.Optional(CONF_UDP_STREAM): cv.All(
+                cv.only_with_arduino,
+                cv.Schema(
+                    {
+                        cv.Optional(CONF_PORT, default=5004): cv.port,
+                        cv.Optional(CONF_FORMAT, default="L16"): cv.one_of(
+                            *UDP_FORMATS, upper=True
+                        ),
+                        cv.Optional(CONF_SAMPLE_RATE, default=16000): cv.int_range(
+                            min=8000, max=48000
+                        ),
+                        cv.Optional(CONF_CHANNELS, default=1): cv.int_range(min=1, max=2),
+                        cv.Optional(
+                            CONF_MIN_DELAY, default="20ms"
+                        ): cv.positive_time_period_milliseconds,
+                        cv.Optional(
+                            CONF_MAX_DELAY, default="100ms"
+                        ): cv.positive_time_period_milliseconds,
+                        cv.Optional(
+                            CONF_IDLE_TIMEOUT, default="1s"
+                        ): cv.positive_time_period_milliseconds,
+                    }
+                ),
+                validate_udp_stream,
+            ),
+            cv.Optional(CONF_SYNC): cv.Schema(
+                {
+                    cv.Required(CONF_ROLE): cv.one_of(*SYNC_ROLES, upper=True),
+                    cv.Optional(CONF_ADDRESS, default="239.255.77.77"): cv.ipv4,
+                    cv.Optional(CONF_PORT, default=5005): cv.port,
+                    cv.Optional(CONF_TOLERANCE, default="2ms"): cv.All(
+                        cv.positive_time_period_microseconds,
+                        cv.Range(max=cv.TimePeriod(milliseconds=100)),
+                    ),
+                }
+            ),
+            cv.Optional(CONF_TONES): cv.ensure_list(TONE_SCHEMA),
+            cv.Optional(CONF_FAILOVER): cv.Schema(
+                {
+                    cv.Required(CONF_BLOB): cv.use_id(blob.Blob),
+                    cv.Optional(CONF_TIMEOUT, default="3s"): cv.All(
+                        cv.positive_time_period_milliseconds,
+                        cv.Range(min=cv.TimePeriod(milliseconds=100)),
+                    ),
+                    cv.Optional(CONF_RETURN_TO_SOURCE, default=False): cv.boolean,
+                }
+            ),
+        }
+    )
+    .extend(
+        {
+            cv.Optional(key): automation.validate_automation(
+                {cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(trigger_class)}
+            )
+            for key, trigger_class in TRIGGERS.items()
         }
     )
     .extend(cv.COMPONENT_SCHEMA)
     .extend(spi.spi_device_schema(False))
 )
 
+# The shortest flash_write_interval (ms) that does not warn, see final_validate.
+MIN_FLASH_WRITE_INTERVAL = 60000
+
+
 def final_validate(config):
+    if config.get(CONF_POWER_DOWN_MODE) == "RESET" and CONF_RESET_PIN not in config:
+        raise cv.Invalid(f"{CONF_POWER_DOWN_MODE} RESET requires a {CONF_RESET_PIN}")
+    if CONF_SYNC in config and CONF_UDP_STREAM not in config:
+        raise cv.Invalid(f"{CONF_SYNC} requires a {CONF_UDP_STREAM}")
+    for device_id, option, action in CORE.data.get(DATA_REQUIRED_OPTIONS, []):
+        if device_id.id == config[CONF_ID].id and option not in config:
+            raise cv.Invalid(f"{action} requires the device '{device_id.id}' to have a {option}")
+    # The preferences component writes to flash on its interval, also during
+    # playback. The device writes at safe moments, so that must be rare.
+    flash_write_interval = fv.full_config.get().get("preferences", {}).get("flash_write_interval")
+    if flash_write_interval is not None and flash_write_interval.total_milliseconds < MIN_FLASH_WRITE_INTERVAL:
+        _LOGGER.warning(
+            "preferences flash_write_interval is shorter than %s s, flash writes may interrupt audio playback",
+            MIN_FLASH_WRITE_INTERVAL // 1000,
+        )
     valid_plugins = PLUGINS[config[CONF_TYPE]]
-    for plugin in config[CONF_PLUGINS]:
+    for plugin in config.get(CONF_PLUGINS, []):
         if plugin.upper() not in valid_plugins:
             raise cv.Invalid(f"Invalid plugin for type '{config[CONF_TYPE]}': {plugin} (valid plugins are: {', '.join(valid_plugins)})")
 
@@ -97,6 +492,82 @@ def final_validate(config):
 FINAL_VALIDATE_SCHEMA = final_validate
 
 
+def requires_device_option(option, action):
+    """Actions are validated before the device is final-validated, so an
+    action records the device option that it relies on, and final_validate
+    checks that the device has it."""
+
+    def validator(config):
+        CORE.data.setdefault(DATA_REQUIRED_OPTIONS, []).append((config[CONF_ID], option, action))
+        return config
+
+    return validator
+
+
+def final_validate_platform_update_interval(domain):
+    """Each platform (sensor, text_sensor) updates at its own interval. When
+    a platform is configured more than once for the same device, then the
+    update intervals must match, because there is only one per platform."""
+
+    def validator(config):
+        full_config = fv.full_config.get()
+        for other in full_config.get(domain, []):
+            if other.get(CONF_PLATFORM) != "vs10xx" or other is config:
+                continue
+            if other[CONF_VS10XX_ID] != config[CONF_VS10XX_ID]:
+                continue
+            if other[CONF_UPDATE_INTERVAL] != config[CONF_UPDATE_INTERVAL]:
+                raise cv.Invalid(
+                    f"All vs10xx {domain} platforms of the same device must use the same {CONF_UPDATE_INTERVAL}",
+                    path=[CONF_UPDATE_INTERVAL],
+                )
+        return config
+
+    return validator
+
+
+async def shared_to_code():
+    """Generate the code that is shared by all configured devices."""
+    configs = CORE.config[DOMAIN]
+
+    # Device and plugin storage is statically sized, based on the configured
+    # devices and plugins.
+    cg.add_define("VS10XX_MAX_DEVICES", len(configs))
+    cg.add_define(
+        "VS10XX_MAX_PLUGINS", max(len(c.get(CONF_PLUGINS, [])) for c in configs)
+    )
+
+    # The event trace is compiled in only when it is configured. The trace is
+    # shared by all devices.
+    trace_sizes = [c[CONF_TRACE_SIZE] for c in configs if CONF_TRACE_SIZE in c]
+    if trace_sizes:
+        cg.add_define("USE_VS10XX_TRACE")
+        cg.add_define("VS10XX_TRACE_SIZE", max(trace_sizes))
+
+    # The SPI transaction capture is compiled in only when it is configured.
+    capture_sizes = [c[CONF_CAPTURE_SIZE] for c in configs if CONF_CAPTURE_SIZE in c]
+    if capture_sizes:
+        cg.add_define("USE_VS10XX_CAPTURE")
+        cg.add_define("VS10XX_CAPTURE_SIZE", max(capture_sizes))
+
+    # The benchmarks are compiled in only when they are enabled.
+    if any(c[CONF_BENCHMARK] for c in configs):
+        cg.add_define("USE_VS10XX_BENCHMARK")
+
+    # A single feed scheduler serves all devices that share the SPI bus.
+    scheduler_id = cv.declare_id(VS10XXScheduler)(DATA_SCHEDULER)
+    scheduler = cg.new_Pvariable(scheduler_id)
+    await cg.register_component(scheduler, {})
+    # The scheduler serves all devices, so the strictest timing is used.
+    def shortest(key):
+        return min((c[key] for c in configs), key=lambda t: t.total_milliseconds)
+
+    cg.add(scheduler.set_feed_loop_time(shortest(CONF_FEED_LOOP_TIME)))
+    cg.add(scheduler.set_bus_grant_timeout(shortest(CONF_BUS_GRANT_TIMEOUT)))
+    CORE.data[DATA_SCHEDULER] = scheduler
+    return scheduler
+
+
 async def to_code(config):
     type_ = config[CONF_TYPE]
     plugins = PLUGINS[type_];
@@ -104,40 +575,161 @@ async def to_code(config):
 
     var = cg.new_Pvariable(config[CONF_ID])
     await cg.register_component(var, config)
+    # The name is used to tell the devices apart in the logs, and to derive
+    # the hash under which the preferences of the device are stored.
+    cg.add(var.set_name(str(config[CONF_ID])))
+    cg.add(var.set_fast_boot(config[CONF_FAST_BOOT]))
+    cg.add(var.set_preferences_quiet_period(config[CONF_PREFERENCES_QUIET_PERIOD]))
+    # Before the devices had a name, a single device stored its preferences
+    # under the hash of the empty name. The first device takes these over.
+    if config[CONF_ID] == CORE.config[DOMAIN][0][CONF_ID]:
+        cg.add(var.set_migrate_legacy_preferences(True))
+    cg.add(var.set_buffer_size(config[CONF_BUFFER_SIZE]))
+    cg.add(var.set_flash_write_min_fill(config[CONF_FLASH_WRITE_MIN_FILL]))
+    cg.add(var.set_flash_write_max_deferral(config[CONF_FLASH_WRITE_MAX_DEFERRAL]))
+    cg.add(var.set_watchdog_timeout(config[CONF_WATCHDOG_TIMEOUT]))
+    cg.add(var.set_recovery_interval(config[CONF_RECOVERY_INTERVAL]))
+    cg.add(var.set_power_down_idle_time(config[CONF_POWER_DOWN_IDLE_TIME]))
+    # Holding the device in reset is the default when a reset pin is available.
+    power_down_mode = config.get(
+        CONF_POWER_DOWN_MODE, "RESET" if CONF_RESET_PIN in config else "SOFTWARE"
+    )
+    cg.add(var.set_power_down_hold_reset(power_down_mode == "RESET"))
+    cg.add(var.set_clock_scaling(config[CONF_CLOCK_SCALING]))
+
+    scheduler = CORE.data.get(DATA_SCHEDULER)
+    if scheduler is None:
+        scheduler = await shared_to_code()
+    cg.add(scheduler.add_device(var, config[CONF_PRIORITY]))
+
+    # Playing audio files is compiled in only when a filesystem is configured.
+    if CONF_FILESYSTEM in config:
+        fs_object, fs_header, fs_libraries = FILESYSTEMS[config[CONF_FILESYSTEM]]
+        cg.add_define("USE_VS10XX_FILES")
+        cg.add_global(cg.RawStatement(f"#include <{fs_header}>"))
+        for library in fs_libraries:
+            cg.add_library(library, None)
+        cg.add(var.set_filesystem(cg.RawExpression(f"&{fs_object}")))
+        cg.add(var.set_file_cache_size(config[CONF_FILE_CACHE_SIZE]))
+        if config[CONF_FILESYSTEM] == "LITTLEFS" and DATA_LITTLEFS_MOUNTED not in CORE.data:
+            cg.add(cg.RawExpression("LittleFS.begin()"))
+            CORE.data[DATA_LITTLEFS_MOUNTED] = True
+
+    # Playing HTTP streams is compiled in only when it is configured.
+    if CONF_HTTP_STREAM in config:
+        stream = config[CONF_HTTP_STREAM]
+        cg.add_define("USE_VS10XX_HTTP")
+        cg.add(var.set_http_stream_enabled(True))
+        cg.add_library("WiFi", None)
+        cg.add_library("WiFiClientSecure", None)
+        cg.add(var.set_stream_prefill(stream[CONF_PREFILL]))
+        cg.add(var.set_stream_reconnect_delay(stream[CONF_RECONNECT_DELAY]))
+        cg.add(var.set_stream_max_reconnect_delay(stream[CONF_MAX_RECONNECT_DELAY]))
+        cg.add(var.set_stream_stall_timeout(stream[CONF_STALL_TIMEOUT]))
+
+    # Playing UDP streams is compiled in only when it is configured.
+    if CONF_UDP_STREAM in config:
+        udp = config[CONF_UDP_STREAM]
+        cg.add_define("USE_VS10XX_UDP")
+        cg.add(var.set_udp_stream_enabled(True))
+        cg.add_library("WiFi", None)
+        cg.add(var.set_udp_port(udp[CONF_PORT]))
+        cg.add(var.set_udp_format(UDP_FORMATS[udp[CONF_FORMAT]]))
+        cg.add(var.set_udp_sample_rate(udp[CONF_SAMPLE_RATE]))
+        cg.add(var.set_udp_channels(udp[CONF_CHANNELS]))
+        cg.add(var.set_udp_min_delay(udp[CONF_MIN_DELAY]))
+        cg.add(var.set_udp_max_delay(udp[CONF_MAX_DELAY]))
+        cg.add(var.set_udp_idle_timeout(udp[CONF_IDLE_TIMEOUT]))
+
+    # Synchronized playback is compiled in only when it is configured. The
+    # leader relays the UDP stream to the multicast group of the followers.
+    if CONF_SYNC in config:
+        sync = config[CONF_SYNC]
+        address = str(sync[CONF_ADDRESS])
+        cg.add_define("USE_VS10XX_SYNC")
+        cg.add(var.set_sync_enabled(True))
+        cg.add(var.set_sync_role(SYNC_ROLES[sync[CONF_ROLE]]))
+        cg.add(var.set_sync_address(address))
+        cg.add(var.set_sync_port(sync[CONF_PORT]))
+        cg.add(var.set_sync_tolerance(sync[CONF_TOLERANCE]))
+        if sync[CONF_ROLE] == "LEADER":
+            cg.add(var.set_udp_relay_address(address))
+        else:
+            cg.add(var.set_udp_multicast_address(address))
+
+    # Tone generators are compiled in only when they are configured.
+    if CONF_TONES in config:
+        cg.add_define("USE_VS10XX_TONES")
+        for tone in config[CONF_TONES]:
+            source = cg.new_Pvariable(tone[CONF_ID])
+            cg.add(source.set_sample_rate(tone[CONF_SAMPLE_RATE]))
+            cg.add(source.set_channels(tone[CONF_CHANNELS]))
+            cg.add(source.set_repeat(0 if tone[CONF_REPEAT] == "FOREVER" else tone[CONF_REPEAT]))
+            for step in tone[CONF_PATTERN]:
+                cg.add(
+                    source.add_step(
+                        cg.StructInitializer(
+                            ToneStep,
+                            ("waveform", TONE_WAVEFORMS[step[CONF_WAVEFORM]]),
+                            ("frequency", step[CONF_FREQUENCY]),
+                            ("end_frequency", step.get(CONF_END_FREQUENCY, step[CONF_FREQUENCY])),
+                            ("duration", step[CONF_DURATION].total_milliseconds),
+                            ("pause", step[CONF_PAUSE].total_milliseconds),
+                            ("attack", step[CONF_ATTACK].total_milliseconds),
+                            ("release", step[CONF_RELEASE].total_milliseconds),
+                            ("volume", step[CONF_VOLUME]),
+                        )
+                    )
+                )
+
+    if CONF_FAILOVER in config:
+        failover = config[CONF_FAILOVER]
+        fallback = await cg.get_variable(failover[CONF_BLOB])
+        cg.add(var.set_fallback_blob(fallback))
+        cg.add(var.set_failover_timeout(failover[CONF_TIMEOUT]))
+        cg.add(var.set_failover_return(failover[CONF_RETURN_TO_SOURCE]))
+
+    for key in TRIGGERS:
+        for conf in config.get(key, []):
+            trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID], var)
+            await automation.build_automation(trigger, [], conf)
 
     chipset_class = TYPES[type_]
-    chipset_id = cv.declare_id(chipset_class)(f"chipset_{type_}")
+    chipset_id = cv.declare_id(chipset_class)(f"{config[CONF_ID]}_chipset_{type_}")
     chipset = cg.new_Pvariable(chipset_id)
 
     hal = cg.new_Pvariable(config[CONF_HAL_ID], chipset)
     await cg.register_component(hal, config)
     cg.add(var.set_hal(hal))
 
+    transport = cg.new_Pvariable(config[CONF_TRANSPORT_ID])
+    cg.add(hal.set_transport(transport))
+
     spi_slow = cg.new_Pvariable(config[CONF_SPI_SLOW_ID])
     await spi.register_spi_device(spi_slow, config)
-    cg.add(hal.set_slow_spi(spi_slow))
+    cg.add(transport.set_slow_spi(spi_slow))
 
     spi_fast = cg.new_Pvariable(config[CONF_SPI_FAST_ID])
     await spi.register_spi_device(spi_fast, config)
-    cg.add(hal.set_fast_spi(spi_fast))
+    cg.add(transport.set_fast_spi(spi_fast))
 
     dreq_pin = await cg.gpio_pin_expression(config[CONF_DREQ_PIN])
-    cg.add(hal.set_dreq_pin(dreq_pin))
+    cg.add(transport.set_dreq_pin(dreq_pin))
 
     xcs_pin = await cg.gpio_pin_expression(config[CONF_XCS_PIN])
-    cg.add(hal.set_xcs_pin(xcs_pin))
+    cg.add(transport.set_xcs_pin(xcs_pin))
 
     xdcs_pin = await cg.gpio_pin_expression(config[CONF_XDCS_PIN])
-    cg.add(hal.set_xdcs_pin(xdcs_pin))
+    cg.add(transport.set_xdcs_pin(xdcs_pin))
 
     if CONF_RESET_PIN in config:
         reset_pin = await cg.gpio_pin_expression(config[CONF_RESET_PIN])
-        cg.add(hal.set_reset_pin(reset_pin))
+        cg.add(transport.set_reset_pin(reset_pin))
 
     if CONF_PLUGINS in config:
         for name in map(str.upper, config[CONF_PLUGINS]):
             plugin_class = plugins[name]
-            plugin_id = cv.declare_id(plugin_class)(f"plugin_{name}")
+            plugin_id = cv.declare_id(plugin_class)(f"{config[CONF_ID]}_plugin_{name}")
             plugin = cg.new_Pvariable(plugin_id)
             cg.add(var.add_plugin(plugin))
 
@@ -161,6 +753,69 @@ async def vs10xx_play_to_code(config, action_id, template_arg, args):
     return var
 
 
+@automation.register_action(
+    "vs10xx.play_file",
+    PlayFileAction,
+    cv.All(
+        cv.maybe_simple_value(
+            {
+                cv.GenerateID(): cv.use_id(VS10XX),
+                cv.Required(CONF_FILE): cv.templatable(cv.string),
+            },
+            key=CONF_FILE,
+        ),
+        requires_device_option(CONF_FILESYSTEM, "vs10xx.play_file"),
+    ),
+)
+async def vs10xx_play_file_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    template_ = await cg.templatable(config[CONF_FILE], args, cg.std_string)
+    cg.add(var.set_file(template_))
+    return var
+
+
+@automation.register_action(
+    "vs10xx.play_url",
+    PlayUrlAction,
+    cv.All(
+        cv.maybe_simple_value(
+            {
+                cv.GenerateID(): cv.use_id(VS10XX),
+                cv.Required(CONF_URL): cv.templatable(cv.string),
+            },
+            key=CONF_URL,
+        ),
+        requires_device_option(CONF_HTTP_STREAM, "vs10xx.play_url"),
+    ),
+)
+async def vs10xx_play_url_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    template_ = await cg.templatable(config[CONF_URL], args, cg.std_string)
+    cg.add(var.set_url(template_))
+    return var
+
+
+@automation.register_action(
+    "vs10xx.play_tone",
+    PlayToneAction,
+    cv.maybe_simple_value(
+        {
+            cv.GenerateID(): cv.use_id(VS10XX),
+            cv.Required(CONF_TONE_ID): cv.use_id(ToneSource),
+        },
+        key=CONF_TONE_ID,
+    ),
+)
+async def vs10xx_play_tone_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    tone_var = await cg.get_variable(config[CONF_TONE_ID])
+    cg.add(var.set_tone(tone_var))
+    return var
+
+
 @automation.register_action(
     "vs10xx.volume_up",
     ChangeVolumeAction,
@@ -240,3 +895,15 @@ async def vs10xx_set_volume_to_code(config, action_id, template_arg, args):
     return var
 
 
+@automation.register_action("vs10xx.stop", StopAction, SIMPLE_SCHEMA)
+@automation.register_action("vs10xx.dump_trace", DumpTraceAction, SIMPLE_SCHEMA)
+@automation.register_action("vs10xx.capture_start", StartCaptureAction, SIMPLE_SCHEMA)
+@automation.register_action("vs10xx.capture_stop", StopCaptureAction, SIMPLE_SCHEMA)
+@automation.register_action("vs10xx.capture_dump", DumpCaptureAction, SIMPLE_SCHEMA)
+@automation.register_action("vs10xx.benchmark", BenchmarkAction, SIMPLE_SCHEMA)
+@automation.register_action("vs10xx.request_bus", RequestBusAction, SIMPLE_SCHEMA)
+@automation.register_action("vs10xx.release_bus", ReleaseBusAction, SIMPLE_SCHEMA)
+async def vs10xx_simple_action_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
@@ -16,7 +16,37 @@ namespace vs10xx {
     void play(Ts... x) override { this->parent_->hal->ACTION_METHOD(); } \
   };
 
+#define VS10XX_COMPONENT_ACTION(ACTION_CLASS, ACTION_METHOD) \
+  template<typename... Ts> \
+  class ACTION_CLASS : /* NOLINT */ \
+                       public Action<Ts...>, \
+                       public Parented<VS10XX> { \
+    void play(Ts... x) override { this->parent_->ACTION_METHOD(); } \
+  };
+
 VS10XX_SIMPLE_ACTION(TurnOffOutputAction, turn_off_output)
+VS10XX_COMPONENT_ACTION(StopAction, stop)
+VS10XX_COMPONENT_ACTION(DumpTraceAction, dump_trace)
+VS10XX_COMPONENT_ACTION(StartCaptureAction, start_capture)
+VS10XX_COMPONENT_ACTION(StopCaptureAction, stop_capture)
+VS10XX_COMPONENT_ACTION(DumpCaptureAction, dump_capture)
+VS10XX_COMPONENT_ACTION(BenchmarkAction, benchmark)
+VS10XX_COMPONENT_ACTION(RequestBusAction, request_bus)
+VS10XX_COMPONENT_ACTION(ReleaseBusAction, release_bus)
+
+#define VS10XX_TRIGGER(TRIGGER_CLASS, CALLBACK) \
+  class TRIGGER_CLASS : public Trigger<> { /* NOLINT */ \
+   public: \
+    explicit TRIGGER_CLASS(VS10XX *parent) { \
+      parent->CALLBACK([this]() { this->trigger(); }); \
+    } \
+  };
+
+VS10XX_TRIGGER(PlayStartTrigger, add_on_play_start_callback)
+VS10XX_TRIGGER(PlayEndTrigger, add_on_play_end_callback)
+VS10XX_TRIGGER(UnderrunTrigger, add_on_underrun_callback)
+VS10XX_TRIGGER(DeviceReadyTrigger, add_on_device_ready_callback)
+VS10XX_TRIGGER(DeviceFailedTrigger, add_on_device_failed_callback)
 
 template<typename... Ts> class SetVolumeAction : public Action<Ts...>, public Parented<VS10XX> {
  public:
@@ -50,5 +80,41 @@ template<typename... Ts> class PlayAction : public Action<Ts...>, public Parente
   }
 };
 
+#ifdef USE_VS10XX_FILES
+template<typename... Ts> class PlayFileAction : public Action<Ts...>, public Parented<VS10XX> {
+ public:
+  TEMPLATABLE_VALUE(std::string, file)
+
+  void play(Ts... x) override {
+    auto file = this->file_.value(x...);
+    this->parent_->play_file(file);
+  }
+};
+#endif
+
+#ifdef USE_VS10XX_HTTP
+template<typename... Ts> class PlayUrlAction : public Action<Ts...>, public Parented<VS10XX> {
+ public:
+  TEMPLATABLE_VALUE(std::string, url)
+
+  void play(Ts... x) override {
+    auto url = this->url_.value(x...);
+    this->parent_->play_url(url);
+  }
+};
+#endif
+
+#ifdef USE_VS10XX_TONES
+template<typename... Ts> class PlayToneAction : public Action<Ts...>, public Parented<VS10XX> {
+ public:
+  TEMPLATABLE_VALUE(ToneSource*, tone)
+
+  void play(Ts... x) override {
+    auto *tone = this->tone_.value(x...);
+    this->parent_->play(tone);
+  }
+};
+#endif
+
 }  // namespace vs10xx
 }  // namespace esphome
@@ -0,0 +1,45 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import media_player
+from esphome.const import CONF_ID
+from . import VS10XX, CONF_VS10XX_ID, vs10xx_ns
+
+DEPENDENCIES = ["vs10xx"]
+
+CONF_DUCK_LEVEL = "duck_level"
+CONF_DUCK_TIME = "duck_time"
+CONF_VOLUME_INCREMENT = "volume_increment"
+
+VS10XXMediaPlayer = vs10xx_ns.class_(
+    "VS10XXMediaPlayer", cg.Component, media_player.MediaPlayer, cg.Parented.template(VS10XX)
+)
+
+CONFIG_SCHEMA = media_player.MEDIA_PLAYER_SCHEMA.extend(
+    {
+        cv.GenerateID(): cv.declare_id(VS10XXMediaPlayer),
+        cv.GenerateID(CONF_VS10XX_ID): cv.use_id(VS10XX),
+        # The volume of the active audio (relative to the configured volume)
+        # while an announcement is buffered, and the time it takes to fade
+        # to that volume.
+        cv.Optional(CONF_DUCK_LEVEL, default="25%"): cv.percentage,
+        cv.Optional(CONF_DUCK_TIME, default="300ms"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(max=cv.TimePeriod(seconds=5)),
+        ),
+        cv.Optional(CONF_VOLUME_INCREMENT, default="5%"): cv.percentage,
+    }
+).extend(cv.COMPONENT_SCHEMA)
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_VS10XX_ID])
+    var = cg.new_Pvariable(config[CONF_ID])
+    await cg.register_component(var, config)
+    await media_player.register_media_player(var, config)
+    await cg.register_parented(var, parent)
+
+    # Announcements are compiled in only when the media player is used.
+    cg.add_define("USE_VS10XX_ANNOUNCE")
+    cg.add(var.set_volume_increment(config[CONF_VOLUME_INCREMENT]))
+    cg.add(parent.set_duck_level(config[CONF_DUCK_LEVEL]))
+    cg.add(parent.set_duck_time(config[CONF_DUCK_TIME]))
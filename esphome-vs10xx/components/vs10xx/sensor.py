@@ -0,0 +1,124 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import sensor
+from esphome.const import (
+    CONF_UPDATE_INTERVAL,
+    ENTITY_CATEGORY_DIAGNOSTIC,
+    STATE_CLASS_MEASUREMENT,
+    STATE_CLASS_TOTAL_INCREASING,
+    UNIT_HERTZ,
+    UNIT_MILLISECOND,
+    UNIT_PERCENT,
+    UNIT_SECOND,
+)
+from . import VS10XX, CONF_VS10XX_ID, final_validate_platform_update_interval, vs10xx_ns
+
+DEPENDENCIES = ["vs10xx"]
+
+CONF_BYTES_PER_SECOND = "bytes_per_second"
+CONF_DREQ_LOW = "dreq_low"
+CONF_DREQ_WAIT = "dreq_wait"
+CONF_UNDERRUNS = "underruns"
+CONF_DECODE_TIME = "decode_time"
+CONF_SAMPLE_RATE = "sample_rate"
+CONF_BITRATE = "bitrate"
+CONF_BUFFER_FILL = "buffer_fill"
+CONF_INIT_TIME = "init_time"
+CONF_WAKE_TIME = "wake_time"
+CONF_BUS_AUDIO_LOAD = "bus_audio_load"
+CONF_BUS_OTHER_LOAD = "bus_other_load"
+CONF_STREAM_ERRORS = "stream_errors"
+CONF_FAILOVERS = "failovers"
+CONF_UDP_BUFFER_DELAY = "udp_buffer_delay"
+CONF_UDP_LOSS = "udp_loss"
+CONF_SYNC_OFFSET = "sync_offset"
+CONF_ANNOUNCE_LATENCY = "announce_latency"
+CONF_SCI_WRITES_ISSUED = "sci_writes_issued"
+CONF_SCI_WRITES_SKIPPED = "sci_writes_skipped"
+CONF_SCI_READS_ISSUED = "sci_reads_issued"
+CONF_SCI_READS_SKIPPED = "sci_reads_skipped"
+CONF_FLASH_WRITES_ISSUED = "flash_writes_issued"
+CONF_FLASH_WRITES_COALESCED = "flash_writes_coalesced"
+CONF_INIT_RESET_TIME = "init_reset_time"
+CONF_INIT_VERIFY_CHIPSET_TIME = "init_verify_chipset_time"
+CONF_INIT_SOFT_RESET_TIME = "init_soft_reset_time"
+CONF_INIT_TO_FAST_SPI_TIME = "init_to_fast_spi_time"
+CONF_INIT_LOAD_PLUGINS_TIME = "init_load_plugins_time"
+CONF_INIT_AUDIO_TIME = "init_audio_time"
+
+UNIT_BYTES_PER_SECOND = "B/s"
+UNIT_KILOBITS_PER_SECOND = "kbit/s"
+
+DeviceState = vs10xx_ns.enum("DeviceState")
+
+
+def _diagnostic(unit, decimals, state_class=STATE_CLASS_MEASUREMENT):
+    kwargs = {"unit_of_measurement": unit} if unit else {}
+    return sensor.sensor_schema(
+        accuracy_decimals=decimals,
+        state_class=state_class,
+        entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        **kwargs,
+    )
+
+
+SENSORS = {
+    CONF_BYTES_PER_SECOND: _diagnostic(UNIT_BYTES_PER_SECOND, 0),
+    CONF_DREQ_LOW: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_DREQ_WAIT: _diagnostic(UNIT_PERCENT, 1),
+    CONF_UNDERRUNS: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_DECODE_TIME: _diagnostic(UNIT_SECOND, 0),
+    CONF_SAMPLE_RATE: _diagnostic(UNIT_HERTZ, 0),
+    CONF_BITRATE: _diagnostic(UNIT_KILOBITS_PER_SECOND, 0),
+    CONF_BUFFER_FILL: _diagnostic(UNIT_PERCENT, 0),
+    CONF_INIT_TIME: _diagnostic(UNIT_MILLISECOND, 1),
+    CONF_WAKE_TIME: _diagnostic(UNIT_MILLISECOND, 1),
+    CONF_BUS_AUDIO_LOAD: _diagnostic(UNIT_PERCENT, 1),
+    CONF_BUS_OTHER_LOAD: _diagnostic(UNIT_PERCENT, 1),
+    CONF_STREAM_ERRORS: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_FAILOVERS: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_UDP_BUFFER_DELAY: _diagnostic(UNIT_MILLISECOND, 1),
+    CONF_UDP_LOSS: _diagnostic(UNIT_PERCENT, 1),
+    CONF_SYNC_OFFSET: _diagnostic(UNIT_MILLISECOND, 1),
+    CONF_ANNOUNCE_LATENCY: _diagnostic(UNIT_MILLISECOND, 1),
+    CONF_SCI_WRITES_ISSUED: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_SCI_WRITES_SKIPPED: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_SCI_READS_ISSUED: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_SCI_READS_SKIPPED: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_FLASH_WRITES_ISSUED: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+    CONF_FLASH_WRITES_COALESCED: _diagnostic(None, 0, STATE_CLASS_TOTAL_INCREASING),
+}
+
+# The time spent in each phase of the last device initialization.
+PHASE_SENSORS = {
+    CONF_INIT_RESET_TIME: DeviceState.DEVICE_RESET,
+    CONF_INIT_VERIFY_CHIPSET_TIME: DeviceState.DEVICE_VERIFY_CHIPSET,
+    CONF_INIT_SOFT_RESET_TIME: DeviceState.DEVICE_SOFT_RESET,
+    CONF_INIT_TO_FAST_SPI_TIME: DeviceState.DEVICE_TO_FAST_SPI,
+    CONF_INIT_LOAD_PLUGINS_TIME: DeviceState.DEVICE_LOAD_PLUGINS,
+    CONF_INIT_AUDIO_TIME: DeviceState.DEVICE_INIT_AUDIO,
+}
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_VS10XX_ID): cv.use_id(VS10XX),
+        cv.Optional(CONF_UPDATE_INTERVAL, default="5s"): cv.positive_time_period_milliseconds,
+        **{cv.Optional(key): schema for key, schema in SENSORS.items()},
+        **{cv.Optional(key): _diagnostic(UNIT_MILLISECOND, 1) for key in PHASE_SENSORS},
+    }
+)
+
+FINAL_VALIDATE_SCHEMA = final_validate_platform_update_interval("sensor")
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_VS10XX_ID])
+    cg.add(parent.set_sensor_update_interval(config[CONF_UPDATE_INTERVAL]))
+    for key in SENSORS:
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(getattr(parent, f"set_{key}_sensor")(sens))
+    for key, state in PHASE_SENSORS.items():
+        if key in config:
+            sens = await sensor.new_sensor(config[key])
+            cg.add(parent.set_phase_time_sensor(state, sens))
@@ -0,0 +1,40 @@
+import esphome.codegen as cg
+import esphome.config_validation as cv
+from esphome.components import text_sensor
+from esphome.const import CONF_FORMAT, CONF_UPDATE_INTERVAL, ENTITY_CATEGORY_DIAGNOSTIC
+from . import VS10XX, CONF_VS10XX_ID, final_validate_platform_update_interval
+
+DEPENDENCIES = ["vs10xx"]
+
+CONF_CLOCK_PROFILE = "clock_profile"
+CONF_STREAM_TITLE = "stream_title"
+
+CONFIG_SCHEMA = cv.Schema(
+    {
+        cv.GenerateID(CONF_VS10XX_ID): cv.use_id(VS10XX),
+        cv.Optional(CONF_UPDATE_INTERVAL, default="5s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_FORMAT): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_CLOCK_PROFILE): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+        cv.Optional(CONF_STREAM_TITLE): text_sensor.text_sensor_schema(),
+    }
+)
+
+FINAL_VALIDATE_SCHEMA = final_validate_platform_update_interval("text_sensor")
+
+
+async def to_code(config):
+    parent = await cg.get_variable(config[CONF_VS10XX_ID])
+    cg.add(parent.set_text_sensor_update_interval(config[CONF_UPDATE_INTERVAL]))
+    if CONF_FORMAT in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_FORMAT])
+        cg.add(parent.set_format_text_sensor(sens))
+    if CONF_CLOCK_PROFILE in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_CLOCK_PROFILE])
+        cg.add(parent.set_clock_profile_text_sensor(sens))
+    if CONF_STREAM_TITLE in config:
+        sens = await text_sensor.new_text_sensor(config[CONF_STREAM_TITLE])
+        cg.add(parent.set_stream_title_text_sensor(sens))
@@ -42,8 +42,8 @@ class VS1003Plugin8kHzMp3Fix: public VS10XXPlugin {
     return "8khzmp3fix: MP3 fix for 8kHz stereo MPEG 2.5";
   }
 
-  const std::vector<uint16_t> plugin_data_() override {
-    return {
+  const uint16_t *plugin_data_(size_t *size) const override {
+    static const uint16_t DATA[] = {
       0x0007, 0x0001, 0x8030, 0x0006, 0x0001, 0x3e12, 0x0006, 0x0001, 0xb817, 
       0x0006, 0x0001, 0x3e00, 0x0006, 0x0001, 0x3802, 0x0006, 0x0001, 0x0005, 
       0x0006, 0x0001, 0x5097, 0x0006, 0x0001, 0x3009, 0x0006, 0x0001, 0x1c00, 
@@ -66,6 +66,8 @@ class VS1003Plugin8kHzMp3Fix: public VS10XXPlugin {
       0x0006, 0x0001, 0x0800, 0x0006, 0x0001, 0x0000, 0x0007, 0x0001, 0xc031, 
       0x0006, 0x0001, 0x0001, 0x0007, 0x0001, 0xc01a, 0x0006, 0x0001, 0x0047
     };
+    *size = sizeof(DATA) / sizeof(DATA[0]);
+    return DATA;
   }
 };
 
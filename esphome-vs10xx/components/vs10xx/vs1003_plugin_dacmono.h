@@ -27,8 +27,8 @@ class PluginVS1003DacMono: public VS10XXPlugin {
     return "dacmono: play all DAC output as mono";
   }
 
-  const std::vector<uint16_t> plugin_data_() override {
-    return {
+  const uint16_t *plugin_data_(size_t *size) const override {
+    static const uint16_t DATA[] = {
       0x0007,0x0001, /*copy 1*/
       0x84e0,
       0x0006,0x0024, /*copy 36*/
@@ -42,6 +42,8 @@ class PluginVS1003DacMono: public VS10XXPlugin {
       0x0006,0x0002, /*copy 2*/
       0x2a01,0x380e,
     };
+    *size = sizeof(DATA) / sizeof(DATA[0]);
+    return DATA;
   }
 };
 
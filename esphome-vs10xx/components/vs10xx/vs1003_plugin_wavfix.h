@@ -37,8 +37,8 @@ class PluginVS1003WavFix: public VS10XXPlugin {
     return "wavfix: allow WAV parser to skip unknown chunks";
   }
 
-  const std::vector<uint16_t> plugin_data_() override {
-    return {
+  const uint16_t *plugin_data_(size_t *size) const override {
+    static const uint16_t DATA[] = {
 	  0x0007,0x0001, /*copy 1*/
 	  0x8030,
 	  0x0006,0x0038, /*copy 56*/
@@ -52,6 +52,8 @@ class PluginVS1003WavFix: public VS10XXPlugin {
 	  0x000a,0x0001, /*copy 1*/
 	  0x0030,
     };
+    *size = sizeof(DATA) / sizeof(DATA[0]);
+    return DATA;
   }
 };
 
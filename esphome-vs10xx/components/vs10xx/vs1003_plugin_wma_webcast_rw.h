@@ -30,8 +30,8 @@ class PluginVS1003WMAWebcastRewind: public VS10XXPlugin {
     return "wmarew4: make WMA Rewind/Fast forward easier";
   }
 
-  const std::vector<uint16_t> plugin_data_() override {
-    return {
+  const uint16_t *plugin_data_(size_t *size) const override {
+    static const uint16_t DATA[] = {
       0x0007, 0x0001, 0x8030, 0x0006, 0x010c, 0x0030, 0x0717, 0xb080,
       0x3c17, 0x0006, 0x5017, 0x3f00, 0x0024, 0x0006, 0x2016, 0x0012,
       0x678f, 0x0000, 0x10ce, 0x2912, 0x9900, 0x0000, 0x004d, 0x4080,
@@ -227,6 +227,8 @@ class PluginVS1003WMAWebcastRewind: public VS10XXPlugin {
       0x0001, 0x8020, 0x0006, 0x0002, 0x2a00, 0x2d8e, 0x0007, 0x0001,
       0x8028, 0x0006, 0x0002, 0x2800, 0x2ac0, 0x000a, 0x0001, 0x0030,
     };
+    *size = sizeof(DATA) / sizeof(DATA[0]);
+    return DATA;
   }
 };
 
@@ -1,11 +1,49 @@
 #include "vs10xx.h"
+#include "vs10xx_benchmark.h"
+#include "vs10xx_format.h"
+#include "vs10xx_scheduler.h"
+#include "vs10xx_trace.h"
 #include "esphome/core/log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
 
 namespace esphome {
 namespace vs10xx {
 
 static const char *const TAG = "vs10xx";
 
+// The minimum number of bytes that must be accepted by the device between two
+// watchdog checks, before a decode time that does not advance is considered
+// to be a hang. This is twice the size of the device's input buffer.
+static const size_t WATCHDOG_MIN_PROGRESS = 4096;
+
+// The minimum number of bytes that the original audio source must deliver
+// during a failover, before it is considered to be recovered. Sources that
+// require a prefill must deliver at least their prefill size.
+static const size_t FAILOVER_MIN_PROBE = 4096;
+
+// The interval (in microseconds) at which SCI_DECODE_TIME is polled for
+// synchronized playback. This determines how accurate the moment of a tick
+// is known. When two polls are further apart than the maximum poll gap
+// (e.g. because the feed loop was busy), then a tick is not used.
+static const uint32_t SYNC_POLL_INTERVAL_US = 2000;
+static const uint32_t SYNC_MAX_POLL_GAP_US = 10000;
+
+// The targets of a device status poll: the sensors and the text sensors are
+// updated at their own interval, each from their own platform.
+static const uint8_t STATUS_FOR_SENSORS = 1 << 0;
+static const uint8_t STATUS_FOR_TEXT_SENSORS = 1 << 1;
+
+// Used to derive the preferences hash for the boot record from the component
+// hash, so it does not collide with the hash for the user preferences.
+static const uint32_t BOOT_RECORD_HASH_SALT = 0x56534252UL;  // "VSBR"
+
+// Before the devices had a name, the preferences were stored under the
+// object ID hash of the empty name, which is fnv1_hash("").
+static const uint32_t LEGACY_PREFERENCES_HASH = 2166136261UL;
+
 const char* device_state_to_text(DeviceState state) {
   switch (state) {
     case DEVICE_RESET:
@@ -26,6 +64,8 @@ const char* device_state_to_text(DeviceState state) {
       return "Device has failed";
     case DEVICE_READY:
       return "Ready for use";
+    case DEVICE_POWER_DOWN:
+      return "Powered down";
     default:
       return "Unknown state";
   }
@@ -41,28 +81,156 @@ const char* media_state_to_text(MediaState state) {
       return "Playing audio file";
     case MEDIA_STOPPING:
       return "Stopping playback";
+    case MEDIA_RECOVERING:
+      return "Recovering from a decoder hang";
     default:
       return "Unknown state";
   }
 }
 
+const char* recovery_stage_to_text(RecoveryStage stage) {
+  switch (stage) {
+    case RECOVERY_NONE:
+      return "none";
+    case RECOVERY_CANCEL:
+      return "cancel";
+    case RECOVERY_SOFT_RESET:
+      return "soft reset";
+    case RECOVERY_HARD_RESET:
+      return "hard reset";
+    default:
+      return "unknown";
+  }
+}
+
 void VS10XX::dump_config() {
   ESP_LOGCONFIG(TAG, "VS10XX:");
+  ESP_LOGCONFIG(TAG, "  Name: %s", this->get_name().c_str());
   this->hal->log_config();
-  if (this->plugins_.size() > 0) {
+  if (this->plugin_count_ > 0) {
     ESP_LOGCONFIG(TAG, "  Plugins:");
-    for (auto *plugin : this->plugins_) {
-      ESP_LOGCONFIG(TAG, "    - %s", plugin->description());
+    for (size_t i = 0; i < this->plugin_count_; i++) {
+      ESP_LOGCONFIG(TAG, "    - %s", this->plugins_[i]->description());
     }
   }
+  if (this->has_fallback_) {
+    ESP_LOGCONFIG(TAG, "  Failover timeout: %u ms", this->failover_timeout_);
+    ESP_LOGCONFIG(TAG, "  Failover return: %s", YESNO(this->failover_return_));
+  }
+}
+
+void VS10XX::add_plugin(VS10XXPlugin *plugin) {
+  if (this->plugin_count_ >= this->plugins_.size()) {
+    ESP_LOGE(TAG, "Cannot add plugin %s: maximum number of plugins reached", plugin->description());
+    return;
+  }
+  this->plugins_[this->plugin_count_++] = plugin;
 }
 
 void VS10XX::setup() {
   ESP_LOGCONFIG(TAG, "Setting up device");
+  this->init_started_at_ = micros();
+  this->phase_started_at_ = this->init_started_at_;
   this->preferences_store_ = global_preferences->make_preference<VS10XXPreferences>(this->get_object_id_hash());
+  this->boot_record_store_ = global_preferences->make_preference<VS10XXBootRecord>(
+      this->get_object_id_hash() ^ BOOT_RECORD_HASH_SALT);
+
+  if (!this->buffer_.allocate(this->buffer_size_)) {
+    this->set_device_state_(DEVICE_REPORT_FAILED);
+    return;
+  }
+
+#ifdef USE_VS10XX_FILES
+  // Without a file cache, playing files is not possible. Playing blobs
+  // still is, so this does not make the device fail.
+  this->file_source_.allocate(this->file_cache_size_);
+#endif
+
+#ifdef USE_VS10XX_HTTP
+  if (this->http_stream_enabled_) {
+    this->http_source_.set_prefill_size(this->buffer_size_ * this->stream_prefill_);
+#ifdef USE_TEXT_SENSOR
+    this->http_source_.add_on_title_callback([this](const std::string &title) {
+      if (this->stream_title_text_sensor_ != nullptr) {
+        this->stream_title_text_sensor_->publish_state(title);
+      }
+    });
+#endif
+  }
+#endif
+
+#ifdef USE_VS10XX_UDP
+  if (this->udp_stream_enabled_) {
+    this->udp_source_.allocate();
+  }
+#endif
+#ifdef USE_VS10XX_SYNC
+  if (this->sync_enabled_) {
+    this->sync_.set_source(&this->udp_source_);
+  }
+#endif
+
+#ifdef USE_VS10XX_ANNOUNCE
+  // Without the announcement buffer, announcements still play, but they
+  // only start buffering when they cut in.
+  this->announcement_source_.allocate(this->buffer_size_);
+#ifdef USE_VS10XX_HTTP
+  if (this->http_stream_enabled_) {
+    this->announcement_http_source_.set_prefill_size(this->buffer_size_ * this->stream_prefill_);
+  }
+#endif
+#endif
+
+  if (this->sensor_update_interval_ > 0) {
+    this->set_interval("sensors", this->sensor_update_interval_, [this]() { this->update_sensors_(); });
+  }
+  if (this->text_sensor_update_interval_ > 0) {
+    this->set_interval("text_sensors", this->text_sensor_update_interval_,
+                       [this]() { this->update_text_sensors_(); });
+  }
+
+  // Restoring the preferences does not involve the device, so this is done
+  // right away instead of as part of the device initialization.
+  this->restore_preferences_();
+
+  if (this->fast_boot_) {
+    this->fast_boot_active_ = this->boot_record_store_.load(&this->boot_record_) &&
+                              this->boot_record_.verified &&
+                              this->boot_record_.config_hash == this->config_hash_();
+    if (this->fast_boot_active_) {
+      ESP_LOGD(TAG, "Fast boot: using device configuration verified during a previous boot");
+    } else {
+      ESP_LOGD(TAG, "Fast boot: no matching verified configuration, performing full initialization");
+    }
+  }
 }
 
 void VS10XX::loop() {
+  this->fire_events_();
+  this->flush_preferences_();
+
+#ifdef USE_VS10XX_UDP
+  // Packets are received on every loop, so they are timestamped on
+  // arrival. A new incoming stream is played right away.
+  if (this->udp_stream_enabled_ && this->udp_source_.poll() && this->audio_ != &this->udp_source_) {
+    ESP_LOGD(TAG, "Incoming UDP audio stream");
+    this->play(&this->udp_source_);
+  }
+#endif
+#ifdef USE_VS10XX_SYNC
+  if (this->sync_enabled_) {
+    this->sync_.loop();
+  }
+#endif
+
+  // While the SPI bus is granted to another device, nothing may be sent to
+  // the device. The work below waits for the bus to be released.
+  if (this->scheduler_ != nullptr && this->scheduler_->is_bus_granted()) {
+    return;
+  }
+
+  // Cases fall through to the next initialization step on success. This way,
+  // the full initialization is completed within a single loop iteration.
   switch (this->device_state_) {
     case DEVICE_READY:
       this->handle_media_operations_();
@@ -71,54 +239,140 @@ void VS10XX::loop() {
       if (this->hal->reset()) {
         this->set_device_state_(DEVICE_VERIFY_CHIPSET);
       } else {
-        this->set_device_state_(DEVICE_REPORT_FAILED);
+        this->handle_init_failure_();
       }
       break;
     case DEVICE_VERIFY_CHIPSET:
+      // With a verified configuration from a previous boot, the chipset check
+      // is still done (it's a single register read), but the slow SPI
+      // communication sweep is skipped.
       if (this->hal->go_slow() &&
-          this->hal->test_communication() &&
+          (this->fast_boot_active_ || this->hal->test_communication()) &&
           this->hal->verify_chipset()) {
         this->set_device_state_(DEVICE_SOFT_RESET);
       } else {
-        this->set_device_state_(DEVICE_REPORT_FAILED);
+        this->handle_init_failure_();
       }
       break;
     case DEVICE_SOFT_RESET:
       if (this->hal->go_slow() && this->hal->soft_reset()) {
         this->set_device_state_(DEVICE_TO_FAST_SPI);
       } else {
-        this->set_device_state_(DEVICE_REPORT_FAILED);
+        this->handle_init_failure_();
+        break;
       }
+      // fall through
     case DEVICE_TO_FAST_SPI:
-      if (this->hal->go_fast() && this->hal->test_communication()) {
+      if (this->hal->go_fast() && this->hal->test_communication(this->fast_boot_active_)) {
         this->set_device_state_(DEVICE_LOAD_PLUGINS);
       } else {
-        this->set_device_state_(DEVICE_REPORT_FAILED);
+        this->handle_init_failure_();
+        break;
       }
+      // fall through
     case DEVICE_LOAD_PLUGINS:
-      for (auto *plugin : this->plugins_) {
+      for (size_t i = 0; i < this->plugin_count_; i++) {
+        auto *plugin = this->plugins_[i];
         ESP_LOGD(TAG, "Loading plugin: %s", plugin->description());
         if (!plugin->load(this->hal)) {
-          this->set_device_state_(DEVICE_REPORT_FAILED);
+          this->handle_init_failure_();
           return;
         }
       }
       this->set_device_state_(DEVICE_INIT_AUDIO);
+      // fall through
     case DEVICE_INIT_AUDIO:
       this->hal->turn_on_output();
-      this->restore_preferences_();
+      this->changed_preferences_ = CHANGE_ALL;
       this->sync_preferences_to_device_();
       this->set_device_state_(DEVICE_READY); 
-      ESP_LOGI(TAG, "Device initialized successfully");
+      this->store_boot_record_();
+      // The shortcuts of a fast boot or a wake up only apply to this
+      // initialization. Later ones (e.g. after a stop or for a recovery)
+      // must do the full communication checks again.
+      this->fast_boot_active_ = false;
+      ESP_LOGI(TAG, "Device initialized successfully in %0.1f ms", this->init_duration_us_ / 1000.0f);
+      this->log_phase_durations_();
       break;
     case DEVICE_REPORT_FAILED:
       ESP_LOGE(TAG, "Device failed");
       this->set_device_state_(DEVICE_FAILED);
       break;
     case DEVICE_FAILED:
-      // NOOP
+      // Retry the initialization on an interval, since the failure might
+      // have been caused by a transient problem, like a brown-out of the
+      // device. When the audio buffer could not be allocated, retrying
+      // makes no sense.
+      if (this->recovery_interval_ > 0 && this->buffer_.capacity() > 0 &&
+          millis() - this->failed_at_ >= this->recovery_interval_) {
+        ESP_LOGI(TAG, "Retrying the device initialization");
+        this->set_device_state_(DEVICE_RESET);
+      }
+      break;
+    case DEVICE_POWER_DOWN:
+      // NOOP, the device is woken up by play()
       break;
   }
+#ifdef USE_TEXT_SENSOR
+  this->publish_clock_profile_();
+#endif
+}
+
+void VS10XX::handle_init_failure_() {
+  if (this->media_state_ == MEDIA_RECOVERING) {
+    // The recovery stage did not bring the device back. Try the next one.
+    ESP_LOGW(TAG, "Recovery using %s failed", recovery_stage_to_text(this->recovery_stage_));
+    this->escalate_recovery_();
+  } else if (this->fast_boot_active_) {
+    // The configuration from the previous boot could not be trusted after
+    // all. Forget about it and retry using the full initialization.
+    ESP_LOGW(TAG, "Fast boot failed, retrying with full device initialization");
+    this->fast_boot_active_ = false;
+    if (this->fast_boot_) {
+      this->boot_record_.verified = false;
+      this->boot_record_store_.save(&this->boot_record_);
+    }
+    this->set_device_state_(DEVICE_RESET);
+  } else {
+    this->set_device_state_(DEVICE_REPORT_FAILED);
+  }
+}
+
+uint32_t VS10XX::config_hash_() const {
+  // FNV-1 hash over the chipset version and the loaded plugins. When any of
+  // these change, a fresh full initialization is required.
+  uint32_t hash = 2166136261UL;
+  hash = (hash * 16777619UL) ^ this->hal->get_chipset_version();
+  for (size_t i = 0; i < this->plugin_count_; i++) {
+    for (const char *c = this->plugins_[i]->description(); *c != '\0'; c++) {
+      hash = (hash * 16777619UL) ^ static_cast<uint8_t>(*c);
+    }
+  }
+  return hash;
+}
+
+void VS10XX::store_boot_record_() {
+  // Only a full initialization can vouch for the device configuration.
+  if (!this->fast_boot_ || this->fast_boot_active_) {
+    return;
+  }
+  auto hash = this->config_hash_();
+  if (this->boot_record_.verified && this->boot_record_.config_hash == hash) {
+    return;
+  }
+  this->boot_record_.config_hash = hash;
+  this->boot_record_.verified = true;
+  this->boot_record_store_.save(&this->boot_record_);
+  ESP_LOGD(TAG, "Fast boot: stored verified device configuration");
+}
+
+void VS10XX::log_phase_durations_() {
+  for (int state = DEVICE_RESET; state <= DEVICE_INIT_AUDIO; state++) {
+    if (this->phase_durations_us_[state] > 0) {
+      ESP_LOGD(TAG, "  - %-26s: %0.1f ms", device_state_to_text(static_cast<DeviceState>(state)),
+               this->phase_durations_us_[state] / 1000.0f);
+    }
+  }
 }
 
 void VS10XX::handle_media_operations_() {
@@ -127,63 +381,894 @@ void VS10XX::handle_media_operations_() {
   this->sync_preferences_to_device_();
 
   // Secondly, handle playing media.
-  auto start = millis();
-  size_t sent = 0;
   switch (this->media_state_) {
     case MEDIA_STOPPED:
       if (this->next_audio_ != nullptr) {
         this->audio_ = this->next_audio_;
         this->next_audio_ = nullptr;
-        this->media_state_ = MEDIA_STARTING;
+        this->set_media_state_(MEDIA_STARTING);
+      } else if (this->power_down_idle_time_ > 0 && this->changed_preferences_ == CHANGE_NONE &&
+                 millis() - this->idle_since_ >= this->power_down_idle_time_) {
+        this->power_down_();
       }
       break;
     case MEDIA_STARTING:
       this->audio_->reset();
+      this->recovery_stage_ = RECOVERY_NONE;
+      this->playback_stats_.max_poll_gap_us = 0;
+      this->begin_stream_();
+      this->min_buffer_fill_ = this->buffer_.fill_level();
       this->high_freq_.start();
-      this->hal->reset_decode_time();
-      this->media_state_ = MEDIA_PLAYING;
+      this->set_media_state_(MEDIA_PLAYING);
       break;
     case MEDIA_PLAYING:
-      // Send chunks of data to the device. Limit the time during which
-      // this is done, to not block the main loop for too long.
-      // Also, when a change in the settings is detected, then stop feeding
-      // audio, to allow the change to be propagated to the device.
-      while ((millis() - start) < 30 && this->changed_preferences_ == CHANGE_NONE) {
-        if (this->hal->is_ready()) {
-          if (this->audio_->next_chunk(VS10XX_CHUNK_SIZE)) {
-            if (this->audio_->chunk_size > 0) {
-              this->hal->begin_data_transaction();
-              for (size_t i = 0; i < this->audio_->chunk_size; i++) {
-                  this->hal->write_byte(*(this->audio_->chunk_start + i));
-                  sent++;
-              }
-              this->hal->end_transaction();
-            }
-          } else {
-            // Out of audio
-            ESP_LOGD(TAG, "Reached end of media input");
-            this->media_state_ = MEDIA_STOPPING;
-            return;
-          }
+      // Audio data are sent to the device by the feed scheduler, which
+      // serves all devices that share the SPI bus. What remains here, is
+      // the bookkeeping that is done once per loop.
+      this->min_buffer_fill_ = std::min(this->min_buffer_fill_, this->buffer_.fill_level());
+#ifdef USE_VS10XX_ANNOUNCE
+      // Once the announcement is buffered, it cuts in. The watchdog has
+      // nothing to check yet for the new stream.
+      if (this->announcement_state_ == ANNOUNCEMENT_BUFFERING && this->buffer_announcement_()) {
+        break;
+      }
+#endif
+      if (this->paused_) {
+        // The device is not fed while paused, so there is nothing to watch.
+        break;
+      }
+      if (this->watchdog_timeout_ > 0) {
+        if (this->waiting_for_dreq_ && micros() - this->dreq_wait_started_at_ > this->watchdog_timeout_ * 1000) {
+          ESP_LOGW(TAG, "Watchdog: DREQ stuck LOW for more than %u ms", this->watchdog_timeout_);
+          this->start_recovery_();
+          return;
+        }
+        // The decoder checks involve register reads, which are done from
+        // the feed loop at a moment that DREQ is high.
+        if (millis() - this->watchdog_checked_at_ >= this->watchdog_timeout_) {
+          this->watchdog_check_pending_ = true;
         }
       }
+      if (this->has_fallback_) {
+        this->check_failover_();
+      }
       break;
-    case MEDIA_STOPPING:
+    case MEDIA_RECOVERING:
+      // The device is ready again, after a soft or hard reset. For the cancel
+      // stage, the cancel procedure still has to be performed.
+      if (this->recovery_stage_ == RECOVERY_CANCEL && !this->hal->cancel_playback()) {
+        ESP_LOGW(TAG, "Recovery using %s failed", recovery_stage_to_text(this->recovery_stage_));
+        this->escalate_recovery_();
+        break;
+      }
+      this->resume_playback_();
+      break;
+    case MEDIA_STOPPING: {
       this->high_freq_.stop();
-      this->device_state_ = DEVICE_SOFT_RESET;
-      this->media_state_ = MEDIA_STOPPED;
+      ESP_LOGD(TAG, "Lowest audio buffer fill level: %0.0f%%", this->min_buffer_fill_ * 100.0f);
+      ESP_LOGD(TAG, "Feed: %u bursts, %0.1f ms bus time, longest poll gap %0.1f ms, %u underruns",
+               this->playback_stats_.bursts, this->playback_stats_.bus_time_us / 1000.0f,
+               this->playback_stats_.max_poll_gap_us / 1000.0f, this->playback_stats_.underruns);
+      auto &stats = this->hal->get_sci_stats();
+      ESP_LOGD(TAG, "SCI writes: %u issued, %u skipped; SCI reads: %u issued, %u skipped",
+               stats.writes_issued, stats.writes_skipped, stats.reads_issued, stats.reads_skipped);
+      if (this->audio_ != nullptr) {
+        this->audio_->close();
+      }
+      this->end_failover_();
+      this->set_device_state_(DEVICE_SOFT_RESET);
+      this->set_media_state_(MEDIA_STOPPED);
+      // Now that no audio is being read from flash, it's a good moment
+      // to write pending preference changes, including those that other
+      // components staged during playback.
+      this->flush_preferences_(true);
+      global_preferences->sync();
+      break;
+    }
+  }
+}
+
+void VS10XX::power_down_() {
+  ESP_LOGI(TAG, "Powering down the device after %u s of inactivity", this->power_down_idle_time_ / 1000);
+  if (this->hal->power_down(this->power_down_hold_reset_)) {
+    this->set_device_state_(DEVICE_POWER_DOWN);
+  } else {
+    // Try again after another idle period.
+    ESP_LOGW(TAG, "Powering down the device failed");
+    this->idle_since_ = millis();
+  }
+}
+
+void VS10XX::wake_up_() {
+  this->wake_requested_at_ = micros();
+  this->wake_pending_ = true;
+
+  // After a software power down, the device only needs its volume back.
+  if (!this->power_down_hold_reset_) {
+    if (this->hal->power_up()) {
+      this->changed_preferences_ = CHANGE_ALL;
+      this->set_device_state_(DEVICE_READY);
+      return;
+    }
+    ESP_LOGW(TAG, "Waking up the device failed, performing a full initialization");
+  }
+
+  // After being held in reset, the device must be initialized. The device
+  // configuration was verified before powering down, so the communication
+  // sweeps are skipped, like for a fast boot.
+  this->fast_boot_active_ = true;
+  this->set_device_state_(DEVICE_RESET);
+}
+
+void VS10XX::select_clock_profile_() {
+  this->clock_profile_pending_ = false;
+  size_t size;
+  const uint8_t *header = this->buffer_.peek(this->buffer_.available(), &size);
+  this->playback_clock_profile_ = select_clock_profile(header, size);
+  this->apply_clock_profile_();
+}
+
+void VS10XX::apply_clock_profile_() {
+  if (this->hal->set_clock_profile(this->playback_clock_profile_)) {
+    return;
+  }
+  ESP_LOGW(TAG, "Switching to the %s clock profile failed", clock_profile_to_text(this->playback_clock_profile_));
+  this->hal->go_fast();
+}
+
+void VS10XX::begin_stream_(size_t position) {
+  this->playback_position_ = position;
+  this->watchdog_format_ = FORMAT_UNKNOWN;
+  this->begin_feeding_();
+  // The clock profile is selected from the stream header. When the
+  // source requires a prefill, then this waits until the prefill is done.
+  this->clock_profile_pending_ = this->clock_scaling_;
+  if (this->clock_profile_pending_ && !this->prefilling_) {
+    this->select_clock_profile_();
+  }
+}
+
+void VS10XX::begin_feeding_() {
+#ifdef USE_VS10XX_SYNC
+  // The start of a UDP stream is held or scheduled, before the first audio
+  // data are read from it.
+  this->sync_.reset();
+  this->sync_decode_time_ = 0;
+  this->sync_polled_at_ = 0;
+  if (this->sync_enabled_ && this->audio_ == &this->udp_source_) {
+    this->sync_.start_stream();
+  }
+#endif
+  this->buffer_.clear();
+  this->fill_buffer_();
+  this->waiting_for_dreq_ = false;
+  this->underrun_ = false;
+  this->starved_ = false;
+  this->fed_at_ = 0;
+  this->prefilling_ = this->audio_->prefill_size() > 0;
+  this->prefill_started_at_ = millis();
+  this->hal->reset_decode_time();
+  this->watchdog_decode_time_ = 0;
+  this->watchdog_position_ = this->playback_position_;
+  this->watchdog_checked_at_ = millis();
+  this->watchdog_check_pending_ = false;
+}
+
+bool VS10XX::check_decoder_() {
+  this->watchdog_check_pending_ = false;
+  this->watchdog_checked_at_ = millis();
+
+  // During playback, SCI_MODE must hold the value that was written during
+  // initialization. When it does not, the device has reset itself (e.g. due
+  // to a brown-out), or the SPI communication is broken. Reading 0xFFFF
+  // (SM_RESET set) is typical for a device that does not respond at all.
+  auto mode = this->hal->read_register(SCI_MODE);
+  if ((mode & (SM_SDINEW | SM_RESET)) != SM_SDINEW) {
+    ESP_LOGW(TAG, "Watchdog: unexpected SCI_MODE value 0x%04X", mode);
+    return false;
+  }
+
+  // When the device accepts audio data, but the decode time does not
+  // advance, then the decoder is stuck.
+  auto &status = this->hal->get_status();
+  auto accepted = this->playback_position_ - this->watchdog_position_;
+  auto frozen = status.decode_time == this->watchdog_decode_time_ && accepted >= WATCHDOG_MIN_PROGRESS;
+  auto advanced = status.decode_time != this->watchdog_decode_time_;
+  this->watchdog_decode_time_ = status.decode_time;
+  this->watchdog_position_ = this->playback_position_;
+  if (frozen) {
+    ESP_LOGW(TAG, "Watchdog: decode time stuck at %u s, while %zu bytes were accepted", status.decode_time, accepted);
+    return false;
+  }
+
+  if (status.playing) {
+    this->watchdog_format_ = status.format;
+  }
+  if (advanced) {
+    // Playback is making progress, so a next hang starts a fresh recovery.
+    this->recovery_stage_ = RECOVERY_NONE;
+  }
+  return true;
+}
+
+void VS10XX::start_recovery_() {
+  this->recovery_stats_.hangs++;
+  this->recovery_started_at_ = micros();
+
+  // Formats that consist of self-contained frames can be resumed from the
+  // current position, since the decoder will sync to the next frame.
+  // Other formats need their header, so these are restarted.
+  if (this->watchdog_format_ == FORMAT_MP3 || this->watchdog_format_ == FORMAT_AAC_ADTS) {
+    this->resume_position_ = this->playback_position_;
+  } else {
+    this->resume_position_ = 0;
+  }
+
+  this->set_media_state_(MEDIA_RECOVERING);
+  this->escalate_recovery_();
+}
+
+void VS10XX::escalate_recovery_() {
+  auto stage = static_cast<RecoveryStage>(this->recovery_stage_ + 1);
+  if (stage == RECOVERY_CANCEL && !this->hal->can_cancel_playback()) {
+    stage = RECOVERY_SOFT_RESET;
+  }
+  if (stage > RECOVERY_HARD_RESET || (stage == RECOVERY_HARD_RESET && !this->hal->has_reset())) {
+    ESP_LOGE(TAG, "Unable to recover from the decoder hang");
+    this->recovery_stats_.failures++;
+    this->recovery_stage_ = RECOVERY_NONE;
+    this->high_freq_.stop();
+    // The playback is given up, so the source is released like at the end
+    // of a normal stop.
+    if (this->audio_ != nullptr) {
+      this->audio_->close();
+      this->audio_ = nullptr;
+    }
+    this->end_failover_();
+    this->set_media_state_(MEDIA_STOPPED);
+    this->set_device_state_(DEVICE_REPORT_FAILED);
+    return;
+  }
+
+  ESP_LOGW(TAG, "Recovering from the decoder hang using %s", recovery_stage_to_text(stage));
+  VS10XX_TRACE(TRACE_RECOVERY, stage, 0);
+  this->recovery_stage_ = stage;
+  if (stage == RECOVERY_SOFT_RESET) {
+    this->set_device_state_(DEVICE_SOFT_RESET);
+  } else if (stage == RECOVERY_HARD_RESET) {
+    this->set_device_state_(DEVICE_RESET);
+  }
+}
+
+void VS10XX::resume_playback_() {
+  auto duration_us = micros() - this->recovery_started_at_;
+  this->recovery_stats_.recoveries++;
+  this->recovery_stats_.stage_duration_us[this->recovery_stage_] = duration_us;
+  ESP_LOGI(TAG, "Recovered using %s in %0.1f ms, resuming at byte %zu", recovery_stage_to_text(this->recovery_stage_),
+           duration_us / 1000.0f, this->resume_position_);
+
+  this->audio_->reset();
+  if (this->resume_position_ > 0 && !this->audio_->seek(this->resume_position_)) {
+    ESP_LOGW(TAG, "The audio source does not support seeking, restarting from the start");
+    this->audio_->reset();
+    this->resume_position_ = 0;
+  }
+  this->playback_position_ = this->resume_position_;
+  this->begin_feeding_();
+  // The device was reset, which brought back the normal clock profile.
+  if (this->clock_scaling_) {
+    this->apply_clock_profile_();
+  }
+  this->set_media_state_(MEDIA_PLAYING);
+}
+
+void VS10XX::mark_starved_() {
+  if (!this->starved_) {
+    this->starved_ = true;
+    this->starved_since_ = millis();
+  }
+}
+
+void VS10XX::check_failover_() {
+#ifdef USE_VS10XX_ANNOUNCE
+  // An announcement is never replaced by the fallback audio.
+  if (this->announcement_state_ == ANNOUNCEMENT_PLAYING) {
+    return;
+  }
+#endif
+  if (this->failed_over_) {
+    if (this->failover_origin_ != nullptr) {
+      this->probe_failover_origin_();
+    }
+  } else if (this->starved_ && millis() - this->starved_since_ >= this->failover_timeout_) {
+    ESP_LOGW(TAG, "Audio source starved for %u ms", millis() - this->starved_since_);
+    this->failover_();
+  }
+}
+
+void VS10XX::failover_() {
+  auto started_at = micros();
+  this->failover_stats_.failovers++;
+  this->failed_over_ = true;
+  this->failover_probed_ = 0;
+  if (this->failover_return_) {
+    this->failover_origin_ = this->audio_;
+  } else {
+    this->audio_->close();
+  }
+  this->fallback_source_.reset();
+  if (this->switch_source_(&this->fallback_source_)) {
+    this->failover_stats_.switch_us = micros() - started_at;
+    ESP_LOGI(TAG, "Switched to the fallback audio in %0.1f ms", this->failover_stats_.switch_us / 1000.0f);
+  }
+}
+
+void VS10XX::probe_failover_origin_() {
+  auto *origin = this->failover_origin_;
+  if (origin->at_end()) {
+    ESP_LOGW(TAG, "The original audio source has ended, staying on the fallback audio");
+    origin->close();
+    this->failover_origin_ = nullptr;
+    return;
+  }
+  // Reading keeps the source going (e.g. reconnecting to a stream). The
+  // data are discarded; the source only has to prove that it delivers.
+  uint8_t probe[VS10XX_CHUNK_SIZE * 4];
+  for (size_t probed = 0; probed < VS10XX_MAX_BURST_SIZE;) {
+    auto size = origin->read(probe, sizeof(probe));
+    if (size == 0) {
+      break;
+    }
+    probed += size;
+    this->failover_probed_ += size;
+  }
+}
+
+void VS10XX::repeat_fallback_() {
+  // The return to the original source is done at the end of the fallback
+  // audio, so the fallback audio is never cut off halfway.
+  auto *origin = this->failover_origin_;
+  if (origin != nullptr && this->failover_probed_ >= std::max(origin->prefill_size(), FAILOVER_MIN_PROBE)) {
+    ESP_LOGI(TAG, "The original audio source has recovered, returning to it");
+    this->failover_stats_.returns++;
+    this->failover_origin_ = nullptr;
+    this->failed_over_ = false;
+    this->fallback_source_.close();
+    this->switch_source_(origin);
+    return;
+  }
+  this->fallback_source_.reset();
+  this->switch_source_(&this->fallback_source_);
+}
+
+void VS10XX::end_failover_() {
+  if (this->failover_origin_ != nullptr) {
+    this->failover_origin_->close();
+    this->failover_origin_ = nullptr;
+  }
+  this->failed_over_ = false;
+}
+
+bool VS10XX::switch_source_(AudioSource *source, size_t position) {
+  this->audio_ = source;
+  if (this->hal->end_stream()) {
+    this->begin_stream_(position);
+    return true;
+  }
+  // The decoder did not take the end of the stream. This is handled like a
+  // decoder hang, after which the recovery starts the new source.
+  ESP_LOGW(TAG, "Ending the audio stream failed");
+  this->watchdog_format_ = FORMAT_UNKNOWN;
+  this->start_recovery_();
+  return false;
+}
+
+void VS10XX::fill_buffer_() {
+  // Reading from the source is done in larger blocks, to keep the source
+  // overhead low. When the buffer runs empty, any amount of data will do.
+  auto free = this->buffer_.free();
+  if (free >= VS10XX_READ_AHEAD_SIZE || this->buffer_.available() == 0) {
+    this->buffer_.fill_from(this->audio_, free);
+  }
+}
+
+bool VS10XX::is_feeding() const {
+  // When a change in the settings is detected, then feeding audio stops,
+  // to allow the change to be propagated to the device.
+  return this->device_state_ == DEVICE_READY && this->media_state_ == MEDIA_PLAYING && !this->paused_ &&
+         this->changed_preferences_ == CHANGE_NONE;
+}
+
+bool VS10XX::feed() {
+  auto now = micros();
+  if (this->fed_at_ != 0) {
+    this->playback_stats_.max_poll_gap_us = std::max(this->playback_stats_.max_poll_gap_us, now - this->fed_at_);
+  }
+  this->fed_at_ = now;
+
+  this->fill_buffer_();
+  if (this->prefilling_) {
+    auto target = std::min(this->audio_->prefill_size(), this->buffer_.capacity());
+    if (this->buffer_.available() < target && !this->audio_->at_end()) {
+      this->mark_starved_();
+      return false;
+    }
+    this->prefilling_ = false;
+    ESP_LOGD(TAG, "Buffered %zu bytes in %u ms", this->buffer_.available(), millis() - this->prefill_started_at_);
+    if (this->clock_profile_pending_) {
+      this->select_clock_profile_();
+    }
+  }
+  if (!this->hal->is_ready()) {
+    this->playback_stats_.dreq_low_iterations++;
+    if (!this->waiting_for_dreq_) {
+      VS10XX_TRACE(TRACE_DREQ_LOW, 0, 0);
+      this->waiting_for_dreq_ = true;
+      this->dreq_wait_started_at_ = now;
+    }
+    return false;
+  }
+  if (this->waiting_for_dreq_) {
+    VS10XX_TRACE(TRACE_DREQ_HIGH, 0, 0);
+    this->waiting_for_dreq_ = false;
+    this->playback_stats_.dreq_wait_us += now - this->dreq_wait_started_at_;
+  }
+  if (this->status_poll_pending_ != 0) {
+    this->poll_status_();
+  }
+#ifdef USE_VS10XX_ANNOUNCE
+  if (this->duck_pending_) {
+    this->apply_duck_();
+  }
+#endif
+#ifdef USE_VS10XX_SYNC
+  if (this->sync_enabled_ && this->audio_ == &this->udp_source_ &&
+      now - this->sync_polled_at_ >= SYNC_POLL_INTERVAL_US) {
+    this->poll_sync_(now);
+  }
+#endif
+  if (this->watchdog_check_pending_ && !this->check_decoder_()) {
+    this->start_recovery_();
+    return false;
+  }
+  if (this->send_burst_() > 0) {
+    this->underrun_ = false;
+    this->starved_ = false;
+    return true;
+  }
+#ifdef USE_VS10XX_ANNOUNCE
+  if (this->announcement_state_ == ANNOUNCEMENT_PLAYING && this->audio_->at_end()) {
+    this->end_announcement_();
+    return false;
+  }
+#endif
+  if (this->failed_over_ && this->audio_->at_end()) {
+    this->repeat_fallback_();
+  } else if (this->has_fallback_ && this->playback_position_ == 0 && this->audio_->at_end()) {
+    // The audio source failed before delivering any audio data (e.g. a
+    // stream that could not be found), which is a reason for failover too.
+    ESP_LOGW(TAG, "Audio source ended without audio data");
+    this->failover_();
+  } else if (this->audio_->at_end()) {
+    // Out of audio
+    ESP_LOGD(TAG, "Reached end of media input");
+    this->set_media_state_(MEDIA_STOPPING);
+  } else {
+    this->mark_starved_();
+    if (!this->underrun_) {
+      // The device wants data, but the audio source can't keep up.
+      VS10XX_TRACE(TRACE_UNDERRUN, 0, 0);
+      this->underrun_ = true;
+      this->playback_stats_.underruns++;
+      this->pending_underruns_++;
+      // Build up a new margin, before feeding the device again.
+      if (this->audio_->prefill_size() > 0) {
+        ESP_LOGD(TAG, "Audio source could not keep up, rebuffering");
+        this->prefilling_ = true;
+        this->prefill_started_at_ = millis();
+      }
+    }
+  }
+  return false;
+}
+
+#ifdef USE_VS10XX_SYNC
+void VS10XX::poll_sync_(uint32_t now) {
+  auto previous = this->sync_polled_at_;
+  this->sync_polled_at_ = now;
+  auto seconds = this->hal->read_register(SCI_DECODE_TIME);
+  if (seconds == this->sync_decode_time_) {
+    return;
+  }
+  this->sync_decode_time_ = seconds;
+  // The tick happened somewhere between the previous poll and this one.
+  if (previous == 0 || now - previous > SYNC_MAX_POLL_GAP_US) {
+    return;
+  }
+  // SCI_AUDATA holds the sample rate (rounded down to an even value) when
+  // the decoder is decoding the stream. Only then, the decode time counts
+  // the frames of the stream.
+  auto rate = this->udp_source_.get_sample_rate();
+  if ((this->hal->read_register(SCI_AUDATA) & 0xFFFE) != (rate & 0xFFFE)) {
+    return;
+  }
+  this->sync_.add_anchor(previous + (now - previous) / 2, seconds * rate);
+}
+#endif
+
+bool VS10XX::request_bus() {
+  return this->scheduler_ != nullptr && this->scheduler_->request_bus();
+}
+
+void VS10XX::release_bus() {
+  if (this->scheduler_ != nullptr) {
+    this->scheduler_->release_bus();
+  }
+}
+
+size_t VS10XX::send_burst_() {
+  size_t sent = 0;
+  size_t size;
+  const uint8_t *data = this->buffer_.peek(VS10XX_CHUNK_SIZE, &size);
+  if (size == 0) {
+    return sent;
+  }
+  auto started_at = micros();
+  this->hal->begin_data_transaction();
+  // DREQ high guarantees room for at least one chunk. Further chunks are
+  // sent for as long as DREQ stays high. A chunk can wrap around the end of
+  // the ring buffer, in which case it is sent in two parts.
+  while (true) {
+    size_t chunk = 0;
+    while (size > 0) {
+      this->hal->write_data(data, size);
+      this->buffer_.consume(size);
+      chunk += size;
+      data = this->buffer_.peek(VS10XX_CHUNK_SIZE - chunk, &size);
+    }
+    sent += chunk;
+    if (sent + VS10XX_CHUNK_SIZE > VS10XX_MAX_BURST_SIZE || !this->hal->is_ready()) {
       break;
+    }
+    data = this->buffer_.peek(VS10XX_CHUNK_SIZE, &size);
+    if (size == 0) {
+      break;
+    }
+  }
+  this->hal->end_transaction();
+  this->playback_stats_.sdi_bytes += sent;
+  this->playback_stats_.bursts++;
+  this->playback_stats_.bus_time_us += micros() - started_at;
+  this->playback_position_ += sent;
+  VS10XX_TRACE(TRACE_CHUNK_SENT, 0, sent);
+  if (this->wake_pending_) {
+    this->wake_pending_ = false;
+    this->wake_latency_us_ = micros() - this->wake_requested_at_;
+    ESP_LOGI(TAG, "Woke up the device and sent the first audio data in %0.1f ms", this->wake_latency_us_ / 1000.0f);
+  }
+#ifdef USE_VS10XX_ANNOUNCE
+  if (this->announce_latency_pending_) {
+    this->announce_latency_pending_ = false;
+    this->announce_latency_us_ = micros() - this->announce_requested_at_;
+    ESP_LOGI(TAG, "Sent the first audio data of the announcement in %0.1f ms", this->announce_latency_us_ / 1000.0f);
+  }
+#endif
+  return sent;
+}
+
+void VS10XX::update_sensors_() {
+  auto now = millis();
+  auto elapsed = now - this->sensors_updated_at_;
+  this->sensors_updated_at_ = now;
+  auto &stats = this->playback_stats_;
+
+#ifdef USE_SENSOR
+  if (this->bytes_per_second_sensor_ != nullptr && elapsed > 0) {
+    auto bytes = stats.sdi_bytes - this->published_sdi_bytes_;
+    this->bytes_per_second_sensor_->publish_state(bytes * 1000.0f / elapsed);
+  }
+  if (this->dreq_wait_sensor_ != nullptr && elapsed > 0) {
+    auto wait_us = stats.dreq_wait_us - this->published_dreq_wait_us_;
+    this->dreq_wait_sensor_->publish_state(std::min(100.0f, wait_us / 10.0f / elapsed));
+  }
+  if (this->dreq_low_sensor_ != nullptr) {
+    this->dreq_low_sensor_->publish_state(stats.dreq_low_iterations);
+  }
+  if (this->underruns_sensor_ != nullptr) {
+    this->underruns_sensor_->publish_state(stats.underruns);
+  }
+  if (this->buffer_fill_sensor_ != nullptr) {
+    this->buffer_fill_sensor_->publish_state(this->buffer_.fill_level() * 100.0f);
+  }
+  if (this->init_time_sensor_ != nullptr && this->device_state_ == DEVICE_READY) {
+    this->init_time_sensor_->publish_state(this->init_duration_us_ / 1000.0f);
+  }
+  if (this->device_state_ == DEVICE_READY) {
+    for (int state = DEVICE_RESET; state <= DEVICE_INIT_AUDIO; state++) {
+      if (this->phase_time_sensors_[state] != nullptr) {
+        this->phase_time_sensors_[state]->publish_state(this->phase_durations_us_[state] / 1000.0f);
+      }
+    }
+  }
+  if (this->wake_time_sensor_ != nullptr && this->wake_latency_us_ > 0) {
+    this->wake_time_sensor_->publish_state(this->wake_latency_us_ / 1000.0f);
+  }
+  // The bus load is the share of the elapsed time during which the bus was
+  // busy sending audio to this device, or granted to other devices.
+  if (this->bus_audio_load_sensor_ != nullptr && elapsed > 0) {
+    auto busy_us = stats.bus_time_us - this->published_bus_time_us_;
+    this->bus_audio_load_sensor_->publish_state(std::min(100.0f, busy_us / 10.0f / elapsed));
+  }
+  if (this->bus_other_load_sensor_ != nullptr && this->scheduler_ != nullptr && elapsed > 0) {
+    auto busy_us = this->scheduler_->get_bus_stats().other_us - this->published_bus_other_us_;
+    this->bus_other_load_sensor_->publish_state(std::min(100.0f, busy_us / 10.0f / elapsed));
+  }
+#ifdef USE_VS10XX_HTTP
+  if (this->stream_errors_sensor_ != nullptr) {
+    this->stream_errors_sensor_->publish_state(this->http_source_.get_stats().connection_errors);
+  }
+#endif
+  if (this->failovers_sensor_ != nullptr) {
+    this->failovers_sensor_->publish_state(this->failover_stats_.failovers);
+  }
+#ifdef USE_VS10XX_UDP
+  auto &udp_stats = this->udp_source_.get_stats();
+  // The buffer delay is the time that audio spends buffered on this device:
+  // the dwell time of the most recent packet in the jitter buffer, plus the
+  // time needed to play the audio data in the audio buffer. The network and
+  // the decoder FIFO add to that, so this is not the end to end latency.
+  if (this->udp_buffer_delay_sensor_ != nullptr && this->audio_ == &this->udp_source_ &&
+      this->media_state_ == MEDIA_PLAYING) {
+    auto buffered_us = this->buffer_.available() * 1000000ULL / this->udp_source_.get_byte_rate();
+    this->udp_buffer_delay_sensor_->publish_state((udp_stats.delay_us + buffered_us) / 1000.0f);
+  }
+  if (this->udp_loss_sensor_ != nullptr && udp_stats.packets > 0) {
+    this->udp_loss_sensor_->publish_state(udp_stats.lost * 100.0f / (udp_stats.packets + udp_stats.lost));
+  }
+#endif
+#ifdef USE_VS10XX_SYNC
+  if (this->sync_offset_sensor_ != nullptr && this->sync_.has_offset()) {
+    this->sync_offset_sensor_->publish_state(this->sync_.get_stats().offset_us / 1000.0f);
+  }
+#endif
+#ifdef USE_VS10XX_ANNOUNCE
+  if (this->announce_latency_sensor_ != nullptr && this->announce_latency_us_ > 0) {
+    this->announce_latency_sensor_->publish_state(this->announce_latency_us_ / 1000.0f);
+  }
+#endif
+  // The SCI counters show how much bus traffic the register shadow saves.
+  auto &sci_stats = this->hal->get_sci_stats();
+  if (this->sci_writes_issued_sensor_ != nullptr) {
+    this->sci_writes_issued_sensor_->publish_state(sci_stats.writes_issued);
+  }
+  if (this->sci_writes_skipped_sensor_ != nullptr) {
+    this->sci_writes_skipped_sensor_->publish_state(sci_stats.writes_skipped);
+  }
+  if (this->sci_reads_issued_sensor_ != nullptr) {
+    this->sci_reads_issued_sensor_->publish_state(sci_stats.reads_issued);
   }
+  if (this->sci_reads_skipped_sensor_ != nullptr) {
+    this->sci_reads_skipped_sensor_->publish_state(sci_stats.reads_skipped);
+  }
+  if (this->flash_writes_issued_sensor_ != nullptr) {
+    this->flash_writes_issued_sensor_->publish_state(this->flash_writes_issued_);
+  }
+  if (this->flash_writes_coalesced_sensor_ != nullptr) {
+    this->flash_writes_coalesced_sensor_->publish_state(this->flash_writes_coalesced_);
+  }
+#endif
+  this->published_sdi_bytes_ = stats.sdi_bytes;
+  this->published_dreq_wait_us_ = stats.dreq_wait_us;
+  this->published_bus_time_us_ = stats.bus_time_us;
+  if (this->scheduler_ != nullptr) {
+    this->published_bus_other_us_ = this->scheduler_->get_bus_stats().other_us;
+  }
+
+  this->request_status_(STATUS_FOR_SENSORS);
+}
+
+void VS10XX::update_text_sensors_() { this->request_status_(STATUS_FOR_TEXT_SENSORS); }
+
+void VS10XX::request_status_(uint8_t targets) {
+  // The device status is polled from the feed loop during playback.
+  if (this->device_state_ == DEVICE_READY && this->media_state_ == MEDIA_PLAYING) {
+    this->status_poll_pending_ |= targets;
+  } else {
+    this->publish_status_(VS10XXStatus(), targets);
+  }
+}
+
+void VS10XX::poll_status_() {
+  auto targets = this->status_poll_pending_;
+  this->status_poll_pending_ = 0;
+  this->publish_status_(this->hal->get_status(), targets);
+}
+
+void VS10XX::publish_status_(const VS10XXStatus &status, uint8_t targets) {
+#ifdef USE_SENSOR
+  if ((targets & STATUS_FOR_SENSORS) != 0) {
+    if (this->decode_time_sensor_ != nullptr) {
+      this->decode_time_sensor_->publish_state(status.decode_time);
+    }
+    if (this->sample_rate_sensor_ != nullptr) {
+      this->sample_rate_sensor_->publish_state(status.playing ? status.sample_rate : NAN);
+    }
+    if (this->bitrate_sensor_ != nullptr) {
+      this->bitrate_sensor_->publish_state(status.bitrate > 0 ? status.bitrate : NAN);
+    }
+  }
+#endif
+#ifdef USE_TEXT_SENSOR
+  if ((targets & STATUS_FOR_TEXT_SENSORS) != 0) {
+    if (this->format_text_sensor_ != nullptr) {
+      const char *format = status.playing ? audio_format_to_text(status.format) : "None";
+      if (this->format_text_sensor_->state != format) {
+        this->format_text_sensor_->publish_state(format);
+      }
+    }
+  }
+#endif
+}
+
+#ifdef USE_TEXT_SENSOR
+void VS10XX::publish_clock_profile_() {
+  if (this->clock_profile_text_sensor_ == nullptr || this->device_state_ != DEVICE_READY) {
+    return;
+  }
+  auto profile = this->hal->get_clock_profile();
+  if (this->clock_profile_published_ && profile == this->published_clock_profile_) {
+    return;
+  }
+  this->clock_profile_text_sensor_->publish_state(clock_profile_to_text(profile));
+  this->published_clock_profile_ = profile;
+  this->clock_profile_published_ = true;
+}
+#endif
+
+void VS10XX::dump_trace() {
+#ifdef USE_VS10XX_TRACE
+  global_vs10xx_trace.dump();
+#else
+  ESP_LOGW(TAG, "Tracing is not enabled, use the trace_size option to enable it");
+#endif
+}
+
+void VS10XX::start_capture() {
+#ifdef USE_VS10XX_CAPTURE
+  this->hal->get_capture().start();
+#else
+  ESP_LOGW(TAG, "SPI capture is not enabled, use the capture_size option to enable it");
+#endif
+}
+
+void VS10XX::stop_capture() {
+#ifdef USE_VS10XX_CAPTURE
+  this->hal->get_capture().stop();
+#endif
+}
+
+void VS10XX::dump_capture() {
+#ifdef USE_VS10XX_CAPTURE
+  this->hal->get_capture().dump();
+#else
+  ESP_LOGW(TAG, "SPI capture is not enabled, use the capture_size option to enable it");
+#endif
+}
+
+void VS10XX::benchmark() {
+#ifdef USE_VS10XX_BENCHMARK
+  if (this->media_state_ != MEDIA_STOPPED) {
+    ESP_LOGW(TAG, "Benchmarks cannot be run while audio is playing");
+    return;
+  }
+  VS10XXBenchmark benchmark(this->hal->get_chipset(), this->plugins_.data(), this->plugin_count_);
+  benchmark.run();
+#else
+  ESP_LOGW(TAG, "Benchmarks are not enabled, use the benchmark option to enable them");
+#endif
+}
+
+bool VS10XX::is_flash_write_safe() const {
+  if (this->media_state_ != MEDIA_PLAYING) {
+    return true;
+  }
+  // The buffer must hold enough audio data, and the device's own input
+  // buffer must be full (DREQ low), to ride through the flash cache stall.
+  if (this->hal->is_ready()) {
+    return false;
+  }
+  if (this->buffer_.fill_level() >= this->flash_write_min_fill_) {
+    return true;
+  }
+  // After the maximum deferral, the input buffer of the device has to do.
+  return this->flash_write_deferred_ && millis() - this->flash_write_deferred_at_ >= this->flash_write_max_deferral_;
 }
 
 void VS10XX::set_device_state_(DeviceState state) {
+  auto now = micros();
+  auto previous = this->device_state_;
+  // Going from ready to powered down and back is not an initialization.
+  auto idle = previous == DEVICE_READY || previous == DEVICE_POWER_DOWN;
+  if (idle && state != DEVICE_READY && state != DEVICE_POWER_DOWN) {
+    // A new (re)initialization of the device starts.
+    this->init_started_at_ = now;
+    std::fill(std::begin(this->phase_durations_us_), std::end(this->phase_durations_us_), 0);
+  } else if (!idle) {
+    this->phase_durations_us_[previous] += now - this->phase_started_at_;
+  }
+  if (state == DEVICE_READY && !idle) {
+    this->init_duration_us_ = now - this->init_started_at_;
+  }
+  if (state == DEVICE_READY) {
+    this->idle_since_ = millis();
+  }
+  this->phase_started_at_ = now;
   this->device_state_ = state;
+  VS10XX_TRACE(TRACE_DEVICE_STATE, state, 0);
   ESP_LOGD(TAG, "Device state: [%d] %s", state, device_state_to_text(state));
+
+  if (state == DEVICE_FAILED) {
+    this->failed_at_ = millis();
+  }
+  // Waking up from power down or recovering from a decoder hang does not
+  // announce the device as ready again.
+  if ((state == DEVICE_RESET || state == DEVICE_FAILED) && this->media_state_ != MEDIA_RECOVERING &&
+      previous != DEVICE_POWER_DOWN) {
+    this->device_ready_announced_ = false;
+  }
+  if (state == DEVICE_READY && !this->device_ready_announced_) {
+    this->device_ready_announced_ = true;
+    this->pending_events_ |= EVENT_DEVICE_READY;
+  } else if (state == DEVICE_FAILED) {
+    this->pending_events_ |= EVENT_DEVICE_FAILED;
+  }
+}
+
+void VS10XX::fire_events_() {
+  if (this->pending_events_ == 0 && this->pending_underruns_ == 0) {
+    return;
+  }
+  // The automations can change the state (e.g. play something else at the
+  // end of playback), which latches new events for the next loop.
+  auto events = this->pending_events_;
+  auto underruns = this->pending_underruns_;
+  this->pending_events_ = 0;
+  this->pending_underruns_ = 0;
+  if (events & EVENT_DEVICE_READY) {
+    this->device_ready_callback_.call();
+  }
+  if (events & EVENT_PLAY_START) {
+    this->play_start_callback_.call();
+  }
+  for (uint32_t i = 0; i < underruns; i++) {
+    this->underrun_callback_.call();
+  }
+  if (events & EVENT_PLAY_END) {
+    this->play_end_callback_.call();
+  }
+  if (events & EVENT_DEVICE_FAILED) {
+    this->device_failed_callback_.call();
+  }
 }
 
 void VS10XX::set_media_state_(MediaState state) {
+  auto previous = this->media_state_;
   this->media_state_ = state;
+  VS10XX_TRACE(TRACE_MEDIA_STATE, state, 0);
   ESP_LOGD(TAG, "Media state: [%d] %s", state, media_state_to_text(state));
+
+  if (state == MEDIA_PLAYING && previous != MEDIA_PLAYING && previous != MEDIA_RECOVERING) {
+    this->pending_events_ |= EVENT_PLAY_START;
+  } else if (state == MEDIA_STOPPED && previous != MEDIA_STOPPED) {
+    this->pending_events_ |= EVENT_PLAY_END;
+  }
+  if (state == MEDIA_STOPPED) {
+    this->idle_since_ = millis();
+    this->paused_ = false;
+#ifdef USE_VS10XX_ANNOUNCE
+    this->close_announcement_();
+#endif
+  }
 }
 
 void VS10XX::set_volume(float left, float right, bool publish) {
@@ -206,15 +1291,47 @@ void VS10XX::change_volume(float delta) {
 }
 
 void VS10XX::play(blob::Blob *blob) {
-  if (this->device_state_ != DEVICE_READY) {
+  // The blob source is reused for every blob. This is safe, because
+  // the active audio source is not read anymore after a play() call.
+  this->blob_source_.set_blob(blob);
+  this->play(&this->blob_source_);
+}
+
+#ifdef USE_VS10XX_FILES
+void VS10XX::play_file(const std::string &path) {
+  // Like the blob source, the file source is reused for every file. The
+  // file is only opened when playback starts.
+  this->file_source_.set_file(this->filesystem_, path);
+  this->play(&this->file_source_);
+}
+#endif
+
+#ifdef USE_VS10XX_HTTP
+void VS10XX::play_url(const std::string &url) {
+  if (!this->http_stream_enabled_) {
+    ESP_LOGE(TAG, "play_url(): The http_stream option is not configured");
+    return;
+  }
+  // The connection is only made when playback starts.
+  this->http_source_.set_url(url);
+  this->play(&this->http_source_);
+}
+#endif
+
+void VS10XX::play(AudioSource *source) {
+  if (this->device_state_ == DEVICE_POWER_DOWN) {
+    ESP_LOGD(TAG, "play(): waking up the device");
+    this->next_audio_ = source;
+    this->wake_up_();
+  } else if (this->device_state_ != DEVICE_READY) {
     ESP_LOGE(TAG, "play(): Device not ready (current state: %s)", device_state_to_text(this->device_state_));
   } else if (this->media_state_ == MEDIA_STOPPED) {
     ESP_LOGD(TAG, "play(): starting playback");
     this->set_media_state_(MEDIA_STARTING);
-    this->audio_ = blob;
+    this->audio_ = source;
   } else if (this->media_state_ == MEDIA_PLAYING) {
     ESP_LOGD(TAG, "play(): Already playing, first stopping active playback");
-    this->next_audio_ = blob;
+    this->next_audio_ = source;
     this->set_media_state_(MEDIA_STOPPING);
   } else {
     ESP_LOGE(TAG, "play(): Current media state (%s) not supported play command", media_state_to_text(this->media_state_));
@@ -222,7 +1339,9 @@ void VS10XX::play(blob::Blob *blob) {
 }
 
 void VS10XX::stop() {
-  if (this->device_state_ != DEVICE_READY) {
+  if (this->device_state_ == DEVICE_POWER_DOWN) {
+    ESP_LOGD(TAG, "stop(): Device powered down, OK");
+  } else if (this->device_state_ != DEVICE_READY) {
     ESP_LOGE(TAG, "stop(): Device not ready (current state: %s)", device_state_to_text(this->device_state_));
   } else if (this->media_state_ == MEDIA_STOPPED) {
     ESP_LOGD(TAG, "stop(): Media already stopped, OK");
@@ -230,22 +1349,277 @@ void VS10XX::stop() {
     ESP_LOGD(TAG, "stop(): Media already stopping, OK");
   } else {
     ESP_LOGD(TAG, "stop(): Stopping media playback");
-    this->media_state_ = MEDIA_STOPPING;
+    this->set_media_state_(MEDIA_STOPPING);
+  }
+}
+
+void VS10XX::pause() {
+  if (this->media_state_ != MEDIA_PLAYING) {
+    ESP_LOGD(TAG, "pause(): No media playing, OK");
+  } else if (this->paused_) {
+    ESP_LOGD(TAG, "pause(): Media already paused, OK");
+  } else {
+    ESP_LOGD(TAG, "pause(): Pausing media playback");
+    this->paused_ = true;
+  }
+}
+
+void VS10XX::resume() {
+  if (!this->paused_) {
+    ESP_LOGD(TAG, "resume(): Media not paused, OK");
+    return;
   }
+  ESP_LOGD(TAG, "resume(): Resuming media playback");
+  this->paused_ = false;
+  // The buffered audio data are kept. The feed and watchdog state start
+  // over, since the device was not fed for a while.
+  this->waiting_for_dreq_ = false;
+  this->underrun_ = false;
+  this->starved_ = false;
+  this->fed_at_ = 0;
+  this->watchdog_position_ = this->playback_position_;
+  this->watchdog_checked_at_ = millis();
+  this->watchdog_check_pending_ = false;
 }
 
+#ifdef USE_VS10XX_ANNOUNCE
+void VS10XX::announce(blob::Blob *blob) {
+  // Announcements have a blob source of their own, so the audio that is
+  // interrupted by the announcement can be a blob too.
+  this->announcement_blob_source_.set_blob(blob);
+  this->announce(&this->announcement_blob_source_);
+}
+
+#ifdef USE_VS10XX_HTTP
+void VS10XX::announce_url(const std::string &url) {
+  if (!this->http_stream_enabled_) {
+    ESP_LOGE(TAG, "announce_url(): The http_stream option is not configured");
+    return;
+  }
+  this->announcement_http_source_.set_url(url);
+  this->announce(&this->announcement_http_source_);
+}
+#endif
+
+void VS10XX::announce(AudioSource *source) {
+  this->announce_requested_at_ = micros();
+  if (this->device_state_ == DEVICE_READY && this->media_state_ == MEDIA_PLAYING) {
+    if (this->announcement_state_ == ANNOUNCEMENT_PLAYING) {
+      // The new announcement replaces the active one right away.
+      ESP_LOGD(TAG, "announce(): Replacing the active announcement");
+      this->announcement_source_.close();
+      this->announcement_source_.set_source(source);
+      source->reset();
+      this->announce_latency_pending_ = true;
+      this->switch_source_(&this->announcement_source_);
+      return;
+    }
+    if (this->announcement_state_ == ANNOUNCEMENT_BUFFERING) {
+      ESP_LOGD(TAG, "announce(): Replacing the buffering announcement");
+      this->announcement_source_.close();
+    } else {
+      ESP_LOGD(TAG, "announce(): Ducking the active playback, buffering the announcement");
+      // While paused, nothing is audible, so there is nothing to duck.
+      this->start_duck_(this->duck_gain_, this->paused_ ? this->duck_gain_ : this->duck_level_);
+    }
+    this->announcement_source_.set_source(source);
+    source->reset();
+    this->announcement_state_ = ANNOUNCEMENT_BUFFERING;
+    return;
+  }
+
+  if (this->device_state_ != DEVICE_READY && this->device_state_ != DEVICE_POWER_DOWN) {
+    ESP_LOGE(TAG, "announce(): Device not ready (current state: %s)", device_state_to_text(this->device_state_));
+  } else if (this->media_state_ != MEDIA_STOPPED) {
+    ESP_LOGE(TAG, "announce(): Current media state (%s) not supported announce command",
+             media_state_to_text(this->media_state_));
+  } else {
+    // Without active playback, the announcement is played like any other
+    // audio. There is nothing to return to afterwards.
+    this->announcement_source_.set_source(source);
+    this->announcement_origin_ = nullptr;
+    this->announcement_state_ = ANNOUNCEMENT_PLAYING;
+    this->announce_latency_pending_ = true;
+    this->play(&this->announcement_source_);
+  }
+}
+
+bool VS10XX::buffer_announcement_() {
+  this->announcement_source_.prebuffer();
+  if (this->announcement_source_.at_end()) {
+    ESP_LOGW(TAG, "The announcement has no audio data, not interrupting playback");
+    this->announcement_source_.close();
+    this->announcement_state_ = ANNOUNCEMENT_NONE;
+    this->start_duck_(this->duck_gain_, 1.0f);
+    return false;
+  }
+  if (!this->announcement_source_.is_prebuffered() || !this->is_duck_done_()) {
+    return false;
+  }
+  this->cut_in_announcement_();
+  return true;
+}
+
+void VS10XX::cut_in_announcement_() {
+  ESP_LOGD(TAG, "Buffered %zu bytes of the announcement in %0.1f ms, cutting in",
+           this->announcement_source_.buffered(), (micros() - this->announce_requested_at_) / 1000.0f);
+  this->announcement_origin_ = this->audio_;
+  this->announcement_origin_position_ = this->playback_position_;
+  this->announcement_origin_format_ = this->watchdog_format_;
+  this->announcement_origin_paused_ = this->paused_;
+  this->announcement_state_ = ANNOUNCEMENT_PLAYING;
+  this->announce_latency_pending_ = true;
+  this->paused_ = false;
+  // The announcement plays at the full volume. The feed loop sets the
+  // volume, right before it sends the first audio data.
+  this->start_duck_(1.0f, 1.0f);
+  this->switch_source_(&this->announcement_source_);
+}
+
+void VS10XX::end_announcement_() {
+  auto *origin = this->announcement_origin_;
+  this->announcement_source_.close();
+  this->announcement_origin_ = nullptr;
+  this->announcement_state_ = ANNOUNCEMENT_NONE;
+  if (origin == nullptr) {
+    ESP_LOGD(TAG, "Reached end of the announcement");
+    this->set_media_state_(MEDIA_STOPPING);
+    return;
+  }
+
+  // Like after a recovery, formats that consist of self-contained frames
+  // continue where they were interrupted. Other formats need their header,
+  // so these restart. Live streams simply reconnect.
+  origin->reset();
+  size_t position = 0;
+  auto format = this->announcement_origin_format_;
+  if ((format == FORMAT_MP3 || format == FORMAT_AAC_ADTS) && this->announcement_origin_position_ > 0) {
+    if (origin->seek(this->announcement_origin_position_)) {
+      position = this->announcement_origin_position_;
+    } else {
+      origin->reset();
+    }
+  }
+  ESP_LOGD(TAG, "Reached end of the announcement, returning to the interrupted audio at byte %zu", position);
+  // The interrupted audio comes back at the ducked volume, and fades in.
+  this->paused_ = this->announcement_origin_paused_;
+  this->start_duck_(this->paused_ ? 1.0f : this->duck_level_, 1.0f);
+  this->switch_source_(origin, position);
+}
+
+void VS10XX::close_announcement_() {
+  if (this->announcement_state_ != ANNOUNCEMENT_NONE) {
+    this->announcement_source_.close();
+    this->announcement_state_ = ANNOUNCEMENT_NONE;
+  }
+  if (this->announcement_origin_ != nullptr) {
+    this->announcement_origin_->close();
+    this->announcement_origin_ = nullptr;
+  }
+  // After stopping, the device is reset, after which the volume from the
+  // preferences is restored without ducking.
+  this->duck_from_ = 1.0f;
+  this->duck_to_ = 1.0f;
+  this->duck_gain_ = 1.0f;
+  this->duck_pending_ = false;
+}
+
+void VS10XX::start_duck_(float from, float to) {
+  this->duck_from_ = from;
+  this->duck_to_ = to;
+  this->duck_started_at_ = millis();
+  this->duck_pending_ = true;
+}
+
+bool VS10XX::is_duck_done_() const {
+  return !this->duck_pending_ || millis() - this->duck_started_at_ >= this->duck_time_;
+}
+
+void VS10XX::apply_duck_() {
+  auto elapsed = millis() - this->duck_started_at_;
+  if (elapsed >= this->duck_time_) {
+    this->duck_gain_ = this->duck_to_;
+    this->duck_pending_ = false;
+  } else {
+    this->duck_gain_ = this->duck_from_ + (this->duck_to_ - this->duck_from_) * elapsed / this->duck_time_;
+  }
+  // The HAL skips writing a volume that the device already has, so most
+  // steps of the ramp do not involve the device.
+  this->hal->set_volume(this->preferences_.volume_left * this->duck_gain_,
+                        this->preferences_.volume_right * this->duck_gain_);
+}
+#endif
+
 void VS10XX::store_preferences_() {
-  this->preferences_store_.save(&this->preferences_); 
-  ESP_LOGD(TAG, "Preferences stored");
+  // Storing is deferred, so a burst of changes (e.g. from turning a rotary
+  // encoder) results in a single write.
+  if (this->preferences_pending_) {
+    this->flash_writes_coalesced_++;
+  }
+  this->preferences_pending_ = true;
+  this->preferences_changed_at_ = millis();
+}
+
+void VS10XX::flush_preferences_(bool force) {
+  if (!this->preferences_pending_) {
+    return;
+  }
+  // Wait for a quiet period without changes. Writing to flash can stall
+  // reading audio data from flash, so the end of playback forces the write
+  // instead of having it happen in the middle of the next playback.
+  if (!force && millis() - this->preferences_changed_at_ < this->preferences_quiet_period_) {
+    return;
+  }
+  if (!force && !this->is_flash_write_safe()) {
+    if (!this->flash_write_deferred_) {
+      this->flash_write_deferred_ = true;
+      this->flash_write_deferred_at_ = millis();
+    }
+    return;
+  }
+  if (this->flash_write_deferred_) {
+    ESP_LOGD(TAG, "Preferences write was deferred for %u ms", millis() - this->flash_write_deferred_at_);
+    this->flash_write_deferred_ = false;
+  }
+  this->preferences_pending_ = false;
+  if (memcmp(&this->preferences_, &this->stored_preferences_, sizeof(VS10XXPreferences)) == 0) {
+    this->flash_writes_coalesced_++;
+    VS10XX_TRACE(TRACE_PREFS_STORE, 0, 0);
+    ESP_LOGD(TAG, "Preferences unchanged, not storing");
+    return;
+  }
+  // A save only stages the preferences. The flash write is done by a sync,
+  // which the preferences component would otherwise do on its own interval,
+  // at any moment during playback. Therefore, sync right away, now that it
+  // is safe. This also writes what other components have staged.
+  this->preferences_store_.save(&this->preferences_);
+  if (global_preferences->sync()) {
+    this->flash_writes_issued_++;
+  }
+  this->stored_preferences_ = this->preferences_;
+  VS10XX_TRACE(TRACE_PREFS_STORE, 0, 1);
+  ESP_LOGD(TAG, "Preferences stored (%u writes issued, %u coalesced)",
+           this->flash_writes_issued_, this->flash_writes_coalesced_);
 }
 
 void VS10XX::restore_preferences_() {
-  if (!this->preferences_store_.load(&this->preferences_)) {
+  auto restored = this->preferences_store_.load(&this->preferences_);
+  if (!restored && this->migrate_legacy_preferences_) {
+    // Move the preferences to the hash of the name, so this is done once.
+    auto legacy_store = global_preferences->make_preference<VS10XXPreferences>(LEGACY_PREFERENCES_HASH);
+    if (legacy_store.load(&this->preferences_)) {
+      ESP_LOGI(TAG, "Migrating preferences that were stored before the device had a name");
+      this->preferences_store_.save(&this->preferences_);
+      restored = true;
+    }
+  }
+  if (!restored) {
     ESP_LOGW(TAG, "Restoring preferences failed, using defaults");
     this->set_default_preferences_();
   } else {
     ESP_LOGD(TAG, "Preferences restored");
   }
+  this->stored_preferences_ = this->preferences_;
   this->changed_preferences_ = CHANGE_ALL;
 
   ESP_LOGD(TAG, "  - Volume left  : %0.2f", this->preferences_.volume_left);
@@ -257,9 +1631,14 @@ void VS10XX::sync_preferences_to_device_() {
   if (this->changed_preferences_ == CHANGE_NONE) {
     return;
   }
+  VS10XX_TRACE(TRACE_PREFS_SYNC, this->changed_preferences_, 0);
   if (this->changed_preferences_ & CHANGE_VOLUME) {
     auto left = this->preferences_.volume_left;
     auto right = this->preferences_.volume_right;
+#ifdef USE_VS10XX_ANNOUNCE
+    left *= this->duck_gain_;
+    right *= this->duck_gain_;
+#endif
     if (this->hal->set_volume(left, right)) {
       this->changed_preferences_ &= ~CHANGE_VOLUME;
     }
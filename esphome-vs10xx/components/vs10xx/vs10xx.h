@@ -1,18 +1,34 @@
 #pragma once
 
 #include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/entity_base.h"
 #include "esphome/core/preferences.h"
 #include "esphome/components/spi/spi.h"
 #include "esphome/components/blob/blob.h"
+#ifdef USE_SENSOR
+#include "esphome/components/sensor/sensor.h"
+#endif
+#ifdef USE_TEXT_SENSOR
+#include "esphome/components/text_sensor/text_sensor.h"
+#endif
+#include "vs10xx_buffer.h"
 #include "vs10xx_constants.h"
+#include "vs10xx_file_source.h"
+#include "vs10xx_http_source.h"
 #include "vs10xx_hal.h"
 #include "vs10xx_plugin.h"
-#include <vector>
+#include "vs10xx_source.h"
+#include "vs10xx_sync.h"
+#include "vs10xx_tone_source.h"
+#include "vs10xx_udp_source.h"
+#include <array>
 
 namespace esphome {
 namespace vs10xx {
 
+class VS10XXScheduler;
+
 /// States used by the VS10XX code to implement its state machine. 
 enum DeviceState {
   DEVICE_RESET,
@@ -24,6 +40,7 @@ enum DeviceState {
   DEVICE_REPORT_FAILED,
   DEVICE_FAILED,
   DEVICE_READY,
+  DEVICE_POWER_DOWN,
 };
 
 /// Translates a DeviceState into a human readable text.
@@ -34,6 +51,7 @@ enum MediaState {
   MEDIA_STARTING,
   MEDIA_PLAYING,
   MEDIA_STOPPING,
+  MEDIA_RECOVERING,
 };
 
 /// Translates a MediaState into a human readable text.
@@ -47,6 +65,74 @@ struct VS10XXPreferences {
   bool muted{false};
 } __attribute__((packed));
 
+/// This struct holds the outcome of a successful full device initialization.
+/// When fast boot is enabled, it is stored in flash memory and used on the
+/// next boot to decide whether the slow verification steps can be skipped.
+struct VS10XXBootRecord {
+  uint32_t config_hash{0};
+  bool verified{false};
+} __attribute__((packed));
+
+/// Counters that describe how feeding audio data to the device went.
+struct VS10XXPlaybackStats {
+  /// The number of bytes that were sent to the device over SDI.
+  uint32_t sdi_bytes{0};
+  /// The number of feed loop iterations that found DREQ low.
+  uint32_t dreq_low_iterations{0};
+  /// The time (in microseconds) spent waiting for DREQ to go high.
+  uint32_t dreq_wait_us{0};
+  /// The number of times that the device asked for data (DREQ high),
+  /// while no audio data were available to send.
+  uint32_t underruns{0};
+  /// The number of bursts of audio data that were sent to the device.
+  uint32_t bursts{0};
+  /// The time (in microseconds) spent sending bursts to the device. This is
+  /// the time during which the SPI bus was held by this device.
+  uint32_t bus_time_us{0};
+  /// The longest time (in microseconds) between two DREQ checks, during the
+  /// current or the most recent playback. When multiple devices share the
+  /// SPI bus, this shows how long a device had to wait for its turn.
+  uint32_t max_poll_gap_us{0};
+};
+
+/// The stages of the recovery from a decoder hang. Every next stage is more
+/// intrusive (and slower) than the previous one. When a hang is detected
+/// again before playback has made progress, then the next stage is used.
+enum RecoveryStage : uint8_t {
+  RECOVERY_NONE,
+  RECOVERY_CANCEL,
+  RECOVERY_SOFT_RESET,
+  RECOVERY_HARD_RESET,
+};
+
+/// Translates a RecoveryStage into a human readable text.
+const char* recovery_stage_to_text(RecoveryStage stage);
+
+/// Counters that describe the decoder hang detection and recovery.
+struct VS10XXRecoveryStats {
+  /// The number of detected decoder hangs.
+  uint32_t hangs{0};
+  /// The number of successful recoveries.
+  uint32_t recoveries{0};
+  /// The number of times that all recovery stages failed.
+  uint32_t failures{0};
+  /// The time (in microseconds) that the most recent successful recovery
+  /// took for each stage, from the detection until playback resumed.
+  uint32_t stage_duration_us[RECOVERY_HARD_RESET + 1]{};
+};
+
+/// Counters that describe the failover to the fallback audio.
+struct VS10XXFailoverStats {
+  /// The number of times that playback switched to the fallback audio.
+  uint32_t failovers{0};
+  /// The number of times that playback returned to the original source.
+  uint32_t returns{0};
+  /// The time (in microseconds) that the most recent switch to the fallback
+  /// audio took, from detecting the starved source until the decoder was
+  /// ready for the fallback audio.
+  uint32_t switch_us{0};
+};
+
 /// Bitmask values that are used to keep track of what preferences need to be
 /// sent to the device.
 enum PreferencesChangeBits {
@@ -57,6 +143,15 @@ enum PreferencesChangeBits {
   CHANGE_ALL = CHANGE_VOLUME  // TODO, update when mute and eq are added
 };
 
+/// The events of the triggers, other than underruns. These are latched
+/// where they happen, and fired from loop(), in the order of the bits.
+enum EventBits : uint8_t {
+  EVENT_DEVICE_READY = 0x01,
+  EVENT_PLAY_START = 0x02,
+  EVENT_PLAY_END = 0x04,
+  EVENT_DEVICE_FAILED = 0x08,
+};
+
 class VS10XX : public EntityBase, public Component {
  public:
   /// The hardware abstraction layer, used to talk to the hardware.
@@ -65,7 +160,103 @@ class VS10XX : public EntityBase, public Component {
   // Object construction and configuration.
   explicit VS10XX() = default;
   void set_hal(VS10XXHAL *hal) { this->hal = hal; }
-  void add_plugin(VS10XXPlugin *plugin) { this->plugins_.push_back(plugin); }
+  void add_plugin(VS10XXPlugin *plugin);
+  void set_fast_boot(bool fast_boot) { this->fast_boot_ = fast_boot; }
+  void set_preferences_quiet_period(uint32_t ms) { this->preferences_quiet_period_ = ms; }
+  /// Take over the preferences that were stored before the devices had a
+  /// name. Only one device (the first configured one) can do this.
+  void set_migrate_legacy_preferences(bool migrate) { this->migrate_legacy_preferences_ = migrate; }
+  void set_buffer_size(size_t size) { this->buffer_size_ = size; }
+  void set_flash_write_min_fill(float fill) { this->flash_write_min_fill_ = fill; }
+  void set_flash_write_max_deferral(uint32_t ms) { this->flash_write_max_deferral_ = ms; }
+  void set_sensor_update_interval(uint32_t ms) { this->sensor_update_interval_ = ms; }
+  void set_text_sensor_update_interval(uint32_t ms) { this->text_sensor_update_interval_ = ms; }
+  void set_watchdog_timeout(uint32_t ms) { this->watchdog_timeout_ = ms; }
+  void set_recovery_interval(uint32_t ms) { this->recovery_interval_ = ms; }
+  void set_power_down_idle_time(uint32_t ms) { this->power_down_idle_time_ = ms; }
+  void set_power_down_hold_reset(bool hold_reset) { this->power_down_hold_reset_ = hold_reset; }
+  void set_clock_scaling(bool clock_scaling) { this->clock_scaling_ = clock_scaling; }
+  void set_scheduler(VS10XXScheduler *scheduler) { this->scheduler_ = scheduler; }
+  void set_fallback_blob(blob::Blob *blob) {
+    this->fallback_source_.set_blob(blob);
+    this->has_fallback_ = true;
+  }
+  void set_failover_timeout(uint32_t ms) { this->failover_timeout_ = ms; }
+  void set_failover_return(bool failover_return) { this->failover_return_ = failover_return; }
+#ifdef USE_VS10XX_FILES
+  void set_filesystem(fs::FS *filesystem) { this->filesystem_ = filesystem; }
+  void set_file_cache_size(size_t size) { this->file_cache_size_ = size; }
+#endif
+#ifdef USE_VS10XX_HTTP
+  /// Play HTTP streams on this device. The option is compiled in when any
+  /// device has it, so the devices without it skip it at runtime.
+  void set_http_stream_enabled(bool enabled) { this->http_stream_enabled_ = enabled; }
+  void set_stream_prefill(float fill) { this->stream_prefill_ = fill; }
+  void set_stream_reconnect_delay(uint32_t ms) { this->http_source_.set_reconnect_delay(ms); }
+  void set_stream_max_reconnect_delay(uint32_t ms) { this->http_source_.set_max_reconnect_delay(ms); }
+  void set_stream_stall_timeout(uint32_t ms) { this->http_source_.set_stall_timeout(ms); }
+#endif
+#ifdef USE_VS10XX_UDP
+  /// Play UDP streams on this device. Like the HTTP streams, the devices
+  /// without the option do not allocate the jitter buffer, nor listen.
+  void set_udp_stream_enabled(bool enabled) { this->udp_stream_enabled_ = enabled; }
+  void set_udp_port(uint16_t port) { this->udp_source_.set_port(port); }
+  void set_udp_format(UdpPayloadFormat format) { this->udp_source_.set_format(format); }
+  void set_udp_sample_rate(uint32_t sample_rate) { this->udp_source_.set_sample_rate(sample_rate); }
+  void set_udp_channels(uint8_t channels) { this->udp_source_.set_channels(channels); }
+  void set_udp_min_delay(uint32_t ms) { this->udp_source_.set_min_delay(ms); }
+  void set_udp_max_delay(uint32_t ms) { this->udp_source_.set_max_delay(ms); }
+  void set_udp_idle_timeout(uint32_t ms) { this->udp_source_.set_idle_timeout(ms); }
+  void set_udp_multicast_address(const std::string &address) { this->udp_source_.set_multicast_address(address); }
+  void set_udp_relay_address(const std::string &address) { this->udp_source_.set_relay_address(address); }
+#endif
+#ifdef USE_VS10XX_ANNOUNCE
+  void set_duck_level(float level) { this->duck_level_ = level; }
+  void set_duck_time(uint32_t ms) { this->duck_time_ = ms; }
+#endif
+#ifdef USE_VS10XX_SYNC
+  /// Synchronize the UDP streams of this device with other devices. Like
+  /// the UDP streams, the devices without the option skip it at runtime.
+  void set_sync_enabled(bool enabled) { this->sync_enabled_ = enabled; }
+  void set_sync_role(SyncRole role) { this->sync_.set_role(role); }
+  void set_sync_address(const std::string &address) { this->sync_.set_address(address); }
+  void set_sync_port(uint16_t port) { this->sync_.set_port(port); }
+  void set_sync_tolerance(uint32_t us) { this->sync_.set_tolerance(us); }
+#endif
+#ifdef USE_SENSOR
+  void set_bytes_per_second_sensor(sensor::Sensor *sensor) { this->bytes_per_second_sensor_ = sensor; }
+  void set_dreq_low_sensor(sensor::Sensor *sensor) { this->dreq_low_sensor_ = sensor; }
+  void set_dreq_wait_sensor(sensor::Sensor *sensor) { this->dreq_wait_sensor_ = sensor; }
+  void set_underruns_sensor(sensor::Sensor *sensor) { this->underruns_sensor_ = sensor; }
+  void set_decode_time_sensor(sensor::Sensor *sensor) { this->decode_time_sensor_ = sensor; }
+  void set_sample_rate_sensor(sensor::Sensor *sensor) { this->sample_rate_sensor_ = sensor; }
+  void set_bitrate_sensor(sensor::Sensor *sensor) { this->bitrate_sensor_ = sensor; }
+  void set_buffer_fill_sensor(sensor::Sensor *sensor) { this->buffer_fill_sensor_ = sensor; }
+  void set_init_time_sensor(sensor::Sensor *sensor) { this->init_time_sensor_ = sensor; }
+  void set_wake_time_sensor(sensor::Sensor *sensor) { this->wake_time_sensor_ = sensor; }
+  void set_bus_audio_load_sensor(sensor::Sensor *sensor) { this->bus_audio_load_sensor_ = sensor; }
+  void set_bus_other_load_sensor(sensor::Sensor *sensor) { this->bus_other_load_sensor_ = sensor; }
+  void set_stream_errors_sensor(sensor::Sensor *sensor) { this->stream_errors_sensor_ = sensor; }
+  void set_failovers_sensor(sensor::Sensor *sensor) { this->failovers_sensor_ = sensor; }
+  void set_udp_buffer_delay_sensor(sensor::Sensor *sensor) { this->udp_buffer_delay_sensor_ = sensor; }
+  void set_udp_loss_sensor(sensor::Sensor *sensor) { this->udp_loss_sensor_ = sensor; }
+  void set_sync_offset_sensor(sensor::Sensor *sensor) { this->sync_offset_sensor_ = sensor; }
+  void set_announce_latency_sensor(sensor::Sensor *sensor) { this->announce_latency_sensor_ = sensor; }
+  void set_sci_writes_issued_sensor(sensor::Sensor *sensor) { this->sci_writes_issued_sensor_ = sensor; }
+  void set_sci_writes_skipped_sensor(sensor::Sensor *sensor) { this->sci_writes_skipped_sensor_ = sensor; }
+  void set_sci_reads_issued_sensor(sensor::Sensor *sensor) { this->sci_reads_issued_sensor_ = sensor; }
+  void set_sci_reads_skipped_sensor(sensor::Sensor *sensor) { this->sci_reads_skipped_sensor_ = sensor; }
+  void set_flash_writes_issued_sensor(sensor::Sensor *sensor) { this->flash_writes_issued_sensor_ = sensor; }
+  void set_flash_writes_coalesced_sensor(sensor::Sensor *sensor) { this->flash_writes_coalesced_sensor_ = sensor; }
+  /// Publish the time spent in an initialization phase (DEVICE_RESET up to
+  /// DEVICE_INIT_AUDIO) during the last device initialization.
+  void set_phase_time_sensor(DeviceState state, sensor::Sensor *sensor) { this->phase_time_sensors_[state] = sensor; }
+#endif
+#ifdef USE_TEXT_SENSOR
+  void set_format_text_sensor(text_sensor::TextSensor *sensor) { this->format_text_sensor_ = sensor; }
+  void set_clock_profile_text_sensor(text_sensor::TextSensor *sensor) { this->clock_profile_text_sensor_ = sensor; }
+  void set_stream_title_text_sensor(text_sensor::TextSensor *sensor) { this->stream_title_text_sensor_ = sensor; }
+#endif
 
   // These must be called by derived classes from their respective methods
   // when those are overridden.
@@ -80,12 +271,179 @@ class VS10XX : public EntityBase, public Component {
   /// Change the output volume with a provided delta amount (-1.0 - 1.0).
   void change_volume(float delta);
 
-  /// Play some audio.
+  /// Play some audio from a Blob.
   void play(blob::Blob *blob);
 
+  /// Play some audio from an AudioSource.
+  void play(AudioSource *source);
+
+#ifdef USE_VS10XX_FILES
+  /// Play some audio from a file on the configured filesystem.
+  void play_file(const std::string &path);
+#endif
+
+#ifdef USE_VS10XX_HTTP
+  /// Play an HTTP audio stream, e.g. an internet radio station.
+  void play_url(const std::string &url);
+#endif
+
   /// Stop playing audio.
   void stop();
 
+  /// Pause playing audio. While paused, the device is not fed, so it goes
+  /// silent once it played the audio data that it already received.
+  void pause();
+
+  /// Resume playing audio after pause(), from where it was paused.
+  void resume();
+
+  /// Check if playback is paused.
+  bool is_paused() const { return this->paused_; }
+
+  /// The current state of the playback.
+  MediaState get_media_state() const { return this->media_state_; }
+
+  /// The current state of the device initialization.
+  DeviceState get_device_state() const { return this->device_state_; }
+
+  /// The output volume (0.0 - 1.0), averaged over both channels.
+  float get_volume() const { return (this->preferences_.volume_left + this->preferences_.volume_right) / 2.0f; }
+
+#ifdef USE_VS10XX_ANNOUNCE
+  /// Play an announcement. When other audio is playing, then its volume is
+  /// ducked, while the announcement is buffered. Once it is buffered, the
+  /// announcement cuts in. After the announcement, the interrupted audio
+  /// returns and its volume is restored.
+  void announce(AudioSource *source);
+
+  /// Play an announcement from a Blob.
+  void announce(blob::Blob *blob);
+
+#ifdef USE_VS10XX_HTTP
+  /// Play an announcement from an HTTP URL, e.g. a text to speech file.
+  void announce_url(const std::string &url);
+#endif
+
+  /// Check if an announcement is being buffered or played.
+  bool is_announcing() const { return this->announcement_state_ != ANNOUNCEMENT_NONE; }
+
+  /// The time (in microseconds) that the most recent announcement took,
+  /// from the announce() call until the first audio data of the
+  /// announcement were sent to the device.
+  uint32_t get_announce_latency_us() const { return this->announce_latency_us_; }
+#endif
+
+  /// The time (in microseconds) spent in a device state during the most
+  /// recent device initialization.
+  uint32_t get_phase_duration_us(DeviceState state) const { return this->phase_durations_us_[state]; }
+
+  /// The time (in microseconds) that the most recent device initialization
+  /// took, from the start of the initialization until the device was ready.
+  uint32_t get_init_duration_us() const { return this->init_duration_us_; }
+
+  /// The time (in microseconds) that the most recent wake up from power
+  /// down took, from the play() call until the first audio data were sent.
+  uint32_t get_wake_latency_us() const { return this->wake_latency_us_; }
+
+  /// The number of preference writes to flash, i.e. the syncs that
+  /// committed the saved preferences.
+  uint32_t get_flash_writes_issued() const { return this->flash_writes_issued_; }
+
+  /// The number of preference writes that were avoided, because they were
+  /// merged with a later write, or because the preferences were unchanged.
+  uint32_t get_flash_writes_coalesced() const { return this->flash_writes_coalesced_; }
+
+  /// The fill level of the audio buffer, from 0.0 (empty) to 1.0 (full).
+  float get_buffer_fill() const { return this->buffer_.fill_level(); }
+
+  /// The lowest fill level of the audio buffer during the current or the
+  /// most recent playback.
+  float get_min_buffer_fill() const { return this->min_buffer_fill_; }
+
+  /// Write the recorded event trace to the log. This requires the trace to
+  /// be enabled using the trace_size option.
+  void dump_trace();
+
+  /// Start, stop and dump the capture of SPI transactions. This requires
+  /// the capture to be enabled using the capture_size option.
+  void start_capture();
+  void stop_capture();
+  void dump_capture();
+
+  /// Time the hot code paths of the component and log the results. This
+  /// requires the benchmark to be enabled using the benchmark option.
+  /// Benchmarks are only run when no audio is playing.
+  void benchmark();
+
+  // Callbacks for playback and device events. These are called from the
+  // state transitions of the component, and are used by the triggers that
+  // can be configured in YAML (e.g. on_play_start).
+  void add_on_play_start_callback(std::function<void()> &&callback) {
+    this->play_start_callback_.add(std::move(callback));
+  }
+  void add_on_play_end_callback(std::function<void()> &&callback) {
+    this->play_end_callback_.add(std::move(callback));
+  }
+  void add_on_underrun_callback(std::function<void()> &&callback) {
+    this->underrun_callback_.add(std::move(callback));
+  }
+  void add_on_device_ready_callback(std::function<void()> &&callback) {
+    this->device_ready_callback_.add(std::move(callback));
+  }
+  void add_on_device_failed_callback(std::function<void()> &&callback) {
+    this->device_failed_callback_.add(std::move(callback));
+  }
+
+  /// Counters that describe how feeding audio data to the device went.
+  const VS10XXPlaybackStats &get_playback_stats() const { return this->playback_stats_; }
+
+  /// Check if the device is playing audio and wants to be fed audio data.
+  /// This is used by the feed scheduler.
+  bool is_feeding() const;
+
+  /// Top up the audio buffer and, when DREQ is high, send a burst of audio
+  /// data to the device. This is used by the feed scheduler, which calls it
+  /// for all devices that share the SPI bus, in order of priority.
+  /// Returns true when audio data were sent.
+  bool feed();
+
+  /// Request the SPI bus for a transfer by another device (e.g. a display
+  /// or an SD card) that shares the bus. All devices that are playing audio
+  /// are topped up first, so they can play through the transfer. Call
+  /// release_bus() when the transfer is done. Returns false when the bus
+  /// is already granted.
+  bool request_bus();
+
+  /// Release the SPI bus, after a transfer by another device.
+  void release_bus();
+
+  /// Counters that describe the decoder hang detection and recovery.
+  const VS10XXRecoveryStats &get_recovery_stats() const { return this->recovery_stats_; }
+
+  /// Counters that describe the failover to the fallback audio.
+  const VS10XXFailoverStats &get_failover_stats() const { return this->failover_stats_; }
+
+#ifdef USE_VS10XX_SYNC
+  /// The synchronization of UDP streams with other devices.
+  const VS10XXSync &get_sync() const { return this->sync_; }
+#endif
+
+  /// Check if the fallback audio is playing, because the original audio
+  /// source left the device starved.
+  bool is_failed_over() const { return this->failed_over_; }
+
+  /// Check if it is safe to write to flash memory. When audio is playing,
+  /// then a flash write (which disables the flash cache for a while) must
+  /// wait until enough audio is buffered to play through the stall. A
+  /// write that was deferred for longer than the maximum deferral only
+  /// waits for the input buffer of the device to be full.
+  ///
+  /// The preferences are written to flash by syncing them, once this allows
+  /// it. The preferences component also syncs on its flash_write_interval,
+  /// regardless of playback. Keep that interval long, so the writes that
+  /// other components stage are mostly done by the syncs of this component.
+  bool is_flash_write_safe() const;
+
 //  uint32_t hash_base() override;
 
  protected:
@@ -96,41 +454,347 @@ class VS10XX : public EntityBase, public Component {
   // The reason or the async behavior, is that it is never sure if the device
   // is ready to receive a command at any given time.
   ESPPreferenceObject preferences_store_;
+  bool migrate_legacy_preferences_{false};
   VS10XXPreferences preferences_{};
+  // Storing preferences is debounced. Changes are written after a quiet
+  // period, or when playback stops, whichever comes first. Writes are only
+  // done when the preferences differ from what was last stored.
+  VS10XXPreferences stored_preferences_{};
+  bool preferences_pending_{false};
+  uint32_t preferences_changed_at_{0};
+  uint32_t preferences_quiet_period_{5000};
+  uint32_t flash_writes_issued_{0};
+  uint32_t flash_writes_coalesced_{0};
+  void flush_preferences_(bool force = false);
   void store_preferences_();
   void restore_preferences_();
   void set_default_preferences_();
   void sync_preferences_to_device_();
   uint8_t changed_preferences_{CHANGE_NONE};
 
-  /// Plugins to load for this device.
-  std::vector<VS10XXPlugin*> plugins_{};
+  /// Plugins to load for this device. This is fixed size storage, sized by
+  /// the code generator, to prevent heap allocations.
+  std::array<VS10XXPlugin*, VS10XX_MAX_PLUGINS> plugins_{};
+  size_t plugin_count_{0};
 
   DeviceState device_state_{DEVICE_RESET};
   void set_device_state_(DeviceState state);
+  void handle_init_failure_();
+
+  // Members that handle fast boot. When enabled, the outcome of a full device
+  // initialization is stored. On the next boot, when the configuration is
+  // still the same, the communication sweeps are skipped or shortened.
+  bool fast_boot_{false};
+  bool fast_boot_active_{false};
+  ESPPreferenceObject boot_record_store_;
+  VS10XXBootRecord boot_record_{};
+  uint32_t config_hash_() const;
+  void store_boot_record_();
+
+  // Members that keep track of the time spent in the device states.
+  uint32_t init_started_at_{0};
+  uint32_t phase_started_at_{0};
+  uint32_t phase_durations_us_[DEVICE_POWER_DOWN + 1]{};
+  uint32_t init_duration_us_{0};
+  void log_phase_durations_();
 
   MediaState media_state_{MEDIA_STOPPED};
   void set_media_state_(MediaState state);
 
+  // Callback managers for the playback and device events.
+  // The device ready event is only announced when the device becomes ready
+  // after a hard reset or a failure, and not after the soft reset that is
+  // done when playback stops.
+  CallbackManager<void()> play_start_callback_{};
+  CallbackManager<void()> play_end_callback_{};
+  CallbackManager<void()> underrun_callback_{};
+  CallbackManager<void()> device_ready_callback_{};
+  CallbackManager<void()> device_failed_callback_{};
+  bool device_ready_announced_{false};
+  // The events are not fired where they happen, because that may be in the
+  // middle of feeding the device, where an automation would hold up the
+  // feed. Underruns are counted, so each one fires the trigger.
+  uint8_t pending_events_{0};
+  uint32_t pending_underruns_{0};
+  void fire_events_();
+
   /// When the device is ready for use, then this method is responsible for
   /// handling media oparations.
   void handle_media_operations_();
 
-  /// The Blob object from which audio must be played.
-  blob::Blob *audio_{nullptr};
+  /// The source from which audio must be played.
+  AudioSource *audio_{nullptr};
 
-  /// The next Blob object from which to play audio.
+  /// The next source from which to play audio.
   /// This is used in case play() is called while another
   /// audio file is being played.
-  blob::Blob *next_audio_{nullptr};
+  AudioSource *next_audio_{nullptr};
+
+  /// The source that is used for playing audio from a Blob.
+  BlobSource blob_source_{};
+
+#ifdef USE_VS10XX_FILES
+  /// The source that is used for playing audio from a file.
+  fs::FS *filesystem_{nullptr};
+  FileSource file_source_{};
+  size_t file_cache_size_{4096};
+#endif
+
+#ifdef USE_VS10XX_HTTP
+  /// The source that is used for playing HTTP audio streams. The fill level
+  /// of the audio buffer that is required before feeding starts is set by
+  /// the stream prefill option.
+  HttpSource http_source_{};
+  bool http_stream_enabled_{false};
+  float stream_prefill_{0.5f};
+#endif
+
+#ifdef USE_VS10XX_UDP
+  /// The source that is used for playing RTP audio streams from UDP. An
+  /// incoming stream is played right away, interrupting other audio.
+  UdpSource udp_source_{};
+  bool udp_stream_enabled_{false};
+#endif
+
+#ifdef USE_VS10XX_SYNC
+  /// Synchronizes the playback of UDP streams with other devices. While a
+  /// UDP stream is playing, SCI_DECODE_TIME is polled from the feed loop,
+  /// to find the moments at which it ticks (see VS10XXSync).
+  VS10XXSync sync_{};
+  bool sync_enabled_{false};
+  uint16_t sync_decode_time_{0};
+  uint32_t sync_polled_at_{0};
+  void poll_sync_(uint32_t now);
+#endif
 
-  /// A buffer to store data that must be sent to the device.
-  uint8_t buffer_[VS10XX_CHUNK_SIZE]{};
+  /// A buffer that stages audio data in RAM, ahead of the device.
+  VS10XXBuffer buffer_{};
+  size_t buffer_size_{8192};
+  float min_buffer_fill_{0.0f};
 
-  /// The number of bytes in the buffer that must be sent to the device.
-  size_t buffer_size_{0};
+  /// The minimum fill level of the audio buffer that is required during
+  /// playback, before preferences can be written to flash. A source that
+  /// never fills the buffer this far (e.g. a stream that barely keeps up)
+  /// would hold off the write forever, so after the maximum deferral, the
+  /// write is done at the next moment that DREQ is low.
+  float flash_write_min_fill_{0.75f};
+  uint32_t flash_write_max_deferral_{30000};
+  bool flash_write_deferred_{false};
+  uint32_t flash_write_deferred_at_{0};
+
+  /// Top up the audio buffer from the active audio source.
+  void fill_buffer_();
+
+  /// Send a burst of chunks from the audio buffer to the device, using a
+  /// single SDI transaction. The burst ends when DREQ goes low, when the
+  /// buffer runs empty, or when VS10XX_MAX_BURST_SIZE bytes were sent.
+  /// Returns the number of bytes sent.
+  size_t send_burst_();
+
+  /// Start feeding audio data from the current position of the source.
+  void begin_feeding_();
+
+  /// Start feeding a new stream from the current position of the source.
+  /// Compared to begin_feeding_(), this also resets the stream related
+  /// state, like the playback position and the clock profile. The position
+  /// is the byte offset in the source at which the stream starts.
+  void begin_stream_(size_t position = 0);
+
+  /// While paused, the device is not fed. The buffered audio data are kept,
+  /// so playback continues seamlessly on resume.
+  bool paused_{false};
+
+  /// When the audio source requires a prefill, then feeding the device
+  /// waits until the audio buffer holds the prefill size. This is done at
+  /// the start of playback, and again after an underrun.
+  bool prefilling_{false};
+  uint32_t prefill_started_at_{0};
+  bool clock_profile_pending_{false};
+
+  // Members that implement the decoder clock scaling. At the start of
+  // playback, a clock profile is selected based on the stream header.
+  bool clock_scaling_{false};
+  ClockProfile playback_clock_profile_{CLOCK_PROFILE_NORMAL};
+  void apply_clock_profile_();
+  void select_clock_profile_();
+
+  // Members that keep track of playback statistics.
+  VS10XXPlaybackStats playback_stats_{};
+  bool waiting_for_dreq_{false};
+  uint32_t dreq_wait_started_at_{0};
+  bool underrun_{false};
+  uint32_t fed_at_{0};
+
+  /// The number of bytes from the audio source that were sent to the
+  /// device during the current playback.
+  size_t playback_position_{0};
+
+  // Members that implement the watchdog. During playback, the watchdog
+  // detects a DREQ that is stuck low, a decode time that does not advance
+  // while audio data are accepted, and a device that lost its SCI_MODE
+  // configuration. A hang is handled by a staged recovery, after which
+  // playback resumes from where it was.
+  uint32_t watchdog_timeout_{0};
+  uint32_t watchdog_checked_at_{0};
+  bool watchdog_check_pending_{false};
+  uint16_t watchdog_decode_time_{0};
+  size_t watchdog_position_{0};
+  AudioFormat watchdog_format_{FORMAT_UNKNOWN};
+  bool check_decoder_();
+
+  // Members that implement the recovery.
+  RecoveryStage recovery_stage_{RECOVERY_NONE};
+  uint32_t recovery_started_at_{0};
+  size_t resume_position_{0};
+  VS10XXRecoveryStats recovery_stats_{};
+  void start_recovery_();
+  void escalate_recovery_();
+  void resume_playback_();
+
+  // Members that implement the failover. When the audio source leaves the
+  // device starved for longer than the failover timeout, then playback
+  // switches to the fallback blob, without resetting the device. The
+  // fallback audio repeats until playback is stopped. Optionally, the
+  // original source is probed in the background, and playback returns to
+  // it once it delivers audio data again.
+  BlobSource fallback_source_{};
+  bool has_fallback_{false};
+  uint32_t failover_timeout_{3000};
+  bool failover_return_{false};
+  bool starved_{false};
+  uint32_t starved_since_{0};
+  bool failed_over_{false};
+  AudioSource *failover_origin_{nullptr};
+  size_t failover_probed_{0};
+  VS10XXFailoverStats failover_stats_{};
+  void mark_starved_();
+  void check_failover_();
+  void failover_();
+  void probe_failover_origin_();
+  void end_failover_();
+  bool switch_source_(AudioSource *source, size_t position = 0);
+  void repeat_fallback_();
+
+#ifdef USE_VS10XX_ANNOUNCE
+  // Members that implement the announcements. While the announcement is
+  // buffering, the interrupted audio keeps playing at a ducked volume. The
+  // announcement source reads ahead into a buffer of its own, so it can
+  // start playing the moment that it cuts in.
+  enum AnnouncementState : uint8_t {
+    ANNOUNCEMENT_NONE,
+    ANNOUNCEMENT_BUFFERING,
+    ANNOUNCEMENT_PLAYING,
+  };
+  AnnouncementState announcement_state_{ANNOUNCEMENT_NONE};
+  PrebufferedSource announcement_source_{};
+  BlobSource announcement_blob_source_{};
+#ifdef USE_VS10XX_HTTP
+  HttpSource announcement_http_source_{};
+#endif
+  AudioSource *announcement_origin_{nullptr};
+  size_t announcement_origin_position_{0};
+  AudioFormat announcement_origin_format_{FORMAT_UNKNOWN};
+  bool announcement_origin_paused_{false};
+  uint32_t announce_requested_at_{0};
+  bool announce_latency_pending_{false};
+  uint32_t announce_latency_us_{0};
+  bool buffer_announcement_();
+  void cut_in_announcement_();
+  void end_announcement_();
+  void close_announcement_();
+
+  // Members that implement the ducking. The volume is ramped from the feed
+  // loop, at moments that DREQ is high, so ducking never holds up feeding.
+  // The ducking gain scales the volume from the preferences.
+  float duck_level_{0.25f};
+  uint32_t duck_time_{300};
+  float duck_from_{1.0f};
+  float duck_to_{1.0f};
+  float duck_gain_{1.0f};
+  uint32_t duck_started_at_{0};
+  bool duck_pending_{false};
+  void start_duck_(float from, float to);
+  bool is_duck_done_() const;
+  void apply_duck_();
+#endif
+
+  // Members that implement the power management. When the device has been
+  // idle for the configured time, then it is powered down. A play() call
+  // wakes up the device through the fastest path that is available.
+  uint32_t power_down_idle_time_{0};
+  bool power_down_hold_reset_{false};
+  uint32_t idle_since_{0};
+  uint32_t wake_requested_at_{0};
+  bool wake_pending_{false};
+  uint32_t wake_latency_us_{0};
+  void power_down_();
+  void wake_up_();
+
+  // Members that implement retrying the initialization of a failed device.
+  uint32_t recovery_interval_{0};
+  uint32_t failed_at_{0};
+
+  // Members that handle the sensors. Sensors and text sensors are each
+  // updated at their own fixed interval. The device status registers are
+  // only read during playback, from the feed loop in a single batch at a
+  // moment that DREQ is high, so polling the device does not disturb
+  // feeding audio data.
+  uint32_t sensor_update_interval_{0};
+  uint32_t text_sensor_update_interval_{0};
+  uint32_t sensors_updated_at_{0};
+  uint32_t published_sdi_bytes_{0};
+  uint32_t published_dreq_wait_us_{0};
+  uint32_t published_bus_time_us_{0};
+  uint32_t published_bus_other_us_{0};
+  uint8_t status_poll_pending_{0};
+  void update_sensors_();
+  void update_text_sensors_();
+  void request_status_(uint8_t targets);
+  void poll_status_();
+  void publish_status_(const VS10XXStatus &status, uint8_t targets);
+#ifdef USE_SENSOR
+  sensor::Sensor *bytes_per_second_sensor_{nullptr};
+  sensor::Sensor *dreq_low_sensor_{nullptr};
+  sensor::Sensor *dreq_wait_sensor_{nullptr};
+  sensor::Sensor *underruns_sensor_{nullptr};
+  sensor::Sensor *decode_time_sensor_{nullptr};
+  sensor::Sensor *sample_rate_sensor_{nullptr};
+  sensor::Sensor *bitrate_sensor_{nullptr};
+  sensor::Sensor *buffer_fill_sensor_{nullptr};
+  sensor::Sensor *init_time_sensor_{nullptr};
+  sensor::Sensor *wake_time_sensor_{nullptr};
+  sensor::Sensor *bus_audio_load_sensor_{nullptr};
+  sensor::Sensor *bus_other_load_sensor_{nullptr};
+  sensor::Sensor *stream_errors_sensor_{nullptr};
+  sensor::Sensor *failovers_sensor_{nullptr};
+  sensor::Sensor *udp_buffer_delay_sensor_{nullptr};
+  sensor::Sensor *udp_loss_sensor_{nullptr};
+  sensor::Sensor *sync_offset_sensor_{nullptr};
+  sensor::Sensor *announce_latency_sensor_{nullptr};
+  sensor::Sensor *sci_writes_issued_sensor_{nullptr};
+  sensor::Sensor *sci_writes_skipped_sensor_{nullptr};
+  sensor::Sensor *sci_reads_issued_sensor_{nullptr};
+  sensor::Sensor *sci_reads_skipped_sensor_{nullptr};
+  sensor::Sensor *flash_writes_issued_sensor_{nullptr};
+  sensor::Sensor *flash_writes_coalesced_sensor_{nullptr};
+  sensor::Sensor *phase_time_sensors_[DEVICE_INIT_AUDIO + 1]{};
+#endif
+#ifdef USE_TEXT_SENSOR
+  text_sensor::TextSensor *format_text_sensor_{nullptr};
+  text_sensor::TextSensor *clock_profile_text_sensor_{nullptr};
+  text_sensor::TextSensor *stream_title_text_sensor_{nullptr};
+  // The clock profile is published when it changes, independent of the
+  // text sensor update interval, because the profile only changes at the
+  // start of a stream and on a device reset.
+  ClockProfile published_clock_profile_{CLOCK_PROFILE_NORMAL};
+  bool clock_profile_published_{false};
+  void publish_clock_profile_();
+#endif
 
   HighFrequencyLoopRequester high_freq_;
+
+  /// The feed scheduler that serves this device.
+  VS10XXScheduler *scheduler_{nullptr};
 };
 
 }  // namespace vs10xx
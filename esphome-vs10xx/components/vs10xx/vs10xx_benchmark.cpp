@@ -0,0 +1,160 @@
+#include "vs10xx_benchmark.h"
+
+#ifdef USE_VS10XX_BENCHMARK
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include "esphome/components/blob/blob.h"
+#include "vs10xx_tone_source.h"
+#include <cstdio>
+#include <memory>
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+// The number of iterations per benchmark. The numbers are chosen such that
+// every benchmark takes in the order of 10 to 100 ms on an ESP32, which is
+// long enough for a stable result, and short enough to not trigger the
+// task watchdog.
+static const uint32_t BLOB_ITERATIONS = 1000;
+static const uint32_t PLUGIN_ITERATIONS = 10;
+static const uint32_t REGISTER_ITERATIONS = 5000;
+static const uint32_t STATUS_ITERATIONS = 1000;
+
+// The tone benchmark generates this much audio, at 44.1 kHz stereo.
+static const uint32_t TONE_SAMPLE_RATE = 44100;
+static const uint16_t TONE_DURATION_MS = 1000;
+
+// The data for the blob benchmark. Only the chunk administration is
+// measured, so the contents do not matter.
+static const uint8_t BLOB_DATA[1024] = {};
+
+// SCI_HDAT1 values that cover all branches of the format classification.
+static const uint16_t HDAT1_VALUES[] = {
+    0x7665, 0x4154, 0x4144, 0x4D34, 0x574D, 0x4D54, 0x4f67, 0xFFFB, 0x1234,
+};
+
+uint8_t VS10XXNullTransport::read_byte() {
+  uint8_t value = this->read_high_ ? this->read_value_ >> 8 : this->read_value_ & 0xFF;
+  this->read_high_ = !this->read_high_;
+  return value;
+}
+
+void VS10XXBenchmark::run() {
+  ESP_LOGI(TAG, "Running benchmarks");
+
+  VS10XXNullTransport transport;
+  auto hal = make_unique<VS10XXHAL>(this->chipset_);
+  hal->set_transport(&transport);
+
+  this->bench_blob_next_chunk_();
+#ifdef USE_VS10XX_TONES
+  this->bench_tone_source_();
+#endif
+  this->bench_plugin_load_(hal.get());
+  this->bench_write_register_(hal.get());
+  this->bench_read_register_(hal.get());
+  this->bench_get_status_(hal.get(), &transport);
+
+  ESP_LOGI(TAG, "Benchmarks done (%u bytes written to the null transport)", transport.get_bytes_written());
+}
+
+void VS10XXBenchmark::bench_blob_next_chunk_() {
+  blob::Blob blob(BLOB_DATA, sizeof(BLOB_DATA));
+  uint32_t chunks = 0;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < BLOB_ITERATIONS * this->scale_; i++) {
+    blob.reset();
+    while (blob.next_chunk(VS10XX_CHUNK_SIZE)) {
+      chunks++;
+    }
+  }
+  this->report_("blob_next_chunk", chunks, micros() - start);
+}
+
+#ifdef USE_VS10XX_TONES
+void VS10XXBenchmark::bench_tone_source_() {
+  // A sweep with an envelope takes the longest path through the sample
+  // loop. One operation is one generated stereo frame.
+  ToneSource tone;
+  tone.set_sample_rate(TONE_SAMPLE_RATE);
+  tone.set_channels(2);
+  tone.add_step({TONE_SWEEP, 200, 4000, TONE_DURATION_MS, 0, 10, 10, 0.8f});
+  uint8_t buffer[VS10XX_MAX_BURST_SIZE];
+  size_t bytes = 0;
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < this->scale_; i++) {
+    tone.reset();
+    while (!tone.at_end()) {
+      bytes += tone.read(buffer, sizeof(buffer));
+    }
+    bytes -= WAV_HEADER_SIZE;
+  }
+  uint32_t total_us = micros() - start;
+  this->report_("tone_source_read", bytes / 4, total_us);
+  // Generating one second of audio must take a small fraction of a second.
+  ESP_LOGI(TAG, "Tone generation uses %.2f%% of a core at %u Hz stereo",
+           total_us / (TONE_DURATION_MS * 10.0f * this->scale_), TONE_SAMPLE_RATE);
+}
+#endif
+
+void VS10XXBenchmark::bench_plugin_load_(VS10XXHAL *hal) {
+  for (size_t p = 0; p < this->plugin_count_; p++) {
+    auto *plugin = this->plugins_[p];
+    uint32_t start = micros();
+    for (uint32_t i = 0; i < PLUGIN_ITERATIONS * this->scale_; i++) {
+      plugin->load(hal);
+    }
+    uint32_t total_us = micros() - start;
+    char name[64];
+    snprintf(name, sizeof(name), "plugin_load:%s", plugin->description());
+    this->report_(name, PLUGIN_ITERATIONS * this->scale_, total_us);
+  }
+}
+
+void VS10XXBenchmark::bench_write_register_(VS10XXHAL *hal) {
+  // Forced writes, so the register shadow does not skip the SPI framing.
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < REGISTER_ITERATIONS * this->scale_; i++) {
+    hal->write_register(SCI_VOL, i, true);
+  }
+  this->report_("write_register", REGISTER_ITERATIONS * this->scale_, micros() - start);
+
+  // Writes that are answered by the register shadow.
+  start = micros();
+  for (uint32_t i = 0; i < REGISTER_ITERATIONS * this->scale_; i++) {
+    hal->write_register(SCI_VOL, 0);
+  }
+  this->report_("write_register_shadowed", REGISTER_ITERATIONS * this->scale_, micros() - start);
+}
+
+void VS10XXBenchmark::bench_read_register_(VS10XXHAL *hal) {
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < REGISTER_ITERATIONS * this->scale_; i++) {
+    hal->read_register(SCI_HDAT0);
+  }
+  this->report_("read_register", REGISTER_ITERATIONS * this->scale_, micros() - start);
+}
+
+void VS10XXBenchmark::bench_get_status_(VS10XXHAL *hal, VS10XXNullTransport *transport) {
+  const size_t formats = sizeof(HDAT1_VALUES) / sizeof(HDAT1_VALUES[0]);
+  uint32_t start = micros();
+  for (uint32_t i = 0; i < STATUS_ITERATIONS * this->scale_; i++) {
+    transport->set_read_value(HDAT1_VALUES[i % formats]);
+    hal->get_status();
+  }
+  this->report_("get_status", STATUS_ITERATIONS * this->scale_, micros() - start);
+}
+
+void VS10XXBenchmark::report_(const char *name, uint32_t iterations, uint32_t total_us) {
+  uint32_t ns_per_op = iterations == 0 ? 0 : static_cast<uint32_t>(uint64_t(total_us) * 1000 / iterations);
+  ESP_LOGI(TAG, "bench: {\"name\":\"%s\",\"iterations\":%u,\"total_us\":%u,\"ns_per_op\":%u}", name, iterations,
+           total_us, ns_per_op);
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
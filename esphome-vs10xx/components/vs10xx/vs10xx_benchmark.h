@@ -0,0 +1,89 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// The benchmark facility times the hot code paths of the component in
+// isolation, and logs the results in a machine-readable format. It is only
+// compiled in when the "benchmark" option is enabled.
+#ifdef USE_VS10XX_BENCHMARK
+
+#include "vs10xx_hal.h"
+#include "vs10xx_plugin.h"
+#include "vs10xx_transport.h"
+
+namespace esphome {
+namespace vs10xx {
+
+/// A transport that does not talk to any hardware. DREQ is always high,
+/// writes are only counted, and reads return a configurable register value.
+/// This makes it possible to time the HAL code, without measuring the SPI
+/// bus and without disturbing the actual device.
+class VS10XXNullTransport : public VS10XXTransport {
+ public:
+  void setup() override {}
+  void log_config() override {}
+  void set_fast_mode(bool fast) override {}
+  void begin_command() override { this->read_high_ = true; }
+  void begin_data() override {}
+  void end() override {}
+  void write_byte(uint8_t value) override { this->bytes_written_++; }
+  void write_byte16(uint16_t value) override { this->bytes_written_ += 2; }
+  void write_array(const uint8_t *data, size_t size) override { this->bytes_written_ += size; }
+  uint8_t read_byte() override;
+  bool read_dreq() override { return true; }
+  bool has_reset() const override { return false; }
+  void set_reset(bool reset) override {}
+
+  /// Set the value that is returned for register reads.
+  void set_read_value(uint16_t value) { this->read_value_ = value; }
+
+  uint32_t get_bytes_written() const { return this->bytes_written_; }
+
+ protected:
+  uint16_t read_value_{0};
+  bool read_high_{true};
+  uint32_t bytes_written_{0};
+};
+
+/// Runs the benchmarks and logs one line per benchmark, in the format:
+///
+///   bench: {"name":"...","iterations":N,"total_us":N,"ns_per_op":N}
+///
+/// The log lines can be collected and compared against a baseline using
+/// tools/vs10xx_bench.py.
+///
+/// The HAL benchmarks run against a separate HAL instance that uses the
+/// null transport, so the device is not touched. Note that SCI events from
+/// the benchmark do end up in the event trace, when tracing is enabled.
+class VS10XXBenchmark {
+ public:
+  VS10XXBenchmark(VS10XXHALChipset *chipset, VS10XXPlugin *const *plugins, size_t plugin_count)
+      : chipset_(chipset), plugins_(plugins), plugin_count_(plugin_count) {}
+
+  /// Multiply the number of iterations of every benchmark, for a stable
+  /// result on a machine that is much faster than an ESP32 (e.g. the host).
+  void set_iterations_scale(uint32_t scale) { this->scale_ = scale; }
+
+  void run();
+
+ protected:
+  VS10XXHALChipset *chipset_;
+  VS10XXPlugin *const *plugins_;
+  size_t plugin_count_;
+  uint32_t scale_{1};
+
+  void bench_blob_next_chunk_();
+#ifdef USE_VS10XX_TONES
+  void bench_tone_source_();
+#endif
+  void bench_plugin_load_(VS10XXHAL *hal);
+  void bench_write_register_(VS10XXHAL *hal);
+  void bench_read_register_(VS10XXHAL *hal);
+  void bench_get_status_(VS10XXHAL *hal, VS10XXNullTransport *transport);
+  void report_(const char *name, uint32_t iterations, uint32_t total_us);
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,109 @@
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "vs10xx_buffer.h"
+#include "vs10xx_constants.h"
+#include <cstring>
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+bool VS10XXBuffer::allocate(size_t size) {
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  this->data_ = allocator.allocate(size);
+  if (this->data_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate %zu bytes for the audio buffer", size);
+    this->capacity_ = 0;
+    return false;
+  }
+  this->capacity_ = size;
+  this->clear();
+  return true;
+}
+
+void VS10XXBuffer::clear() {
+  this->head_ = 0;
+  this->count_ = 0;
+}
+
+float VS10XXBuffer::fill_level() const {
+  if (this->capacity_ == 0) {
+    return 0.0f;
+  }
+  return static_cast<float>(this->count_) / this->capacity_;
+}
+
+size_t VS10XXBuffer::fill_from(AudioSource *source, size_t max_size) {
+  size_t total = 0;
+  if (this->capacity_ == 0) {
+    return total;
+  }
+  while (total < max_size && this->free() > 0) {
+    // Write into the contiguous space after the stored data. When that
+    // space wraps around the end of the buffer, a second pass fills the
+    // space at the start of the buffer.
+    size_t tail = (this->head_ + this->count_) % this->capacity_;
+    size_t space = std::min(this->free(), this->capacity_ - tail);
+    space = std::min(space, max_size - total);
+    size_t read = source->read(this->data_ + tail, space);
+    if (read == 0) {
+      break;
+    }
+    this->count_ += read;
+    total += read;
+  }
+  return total;
+}
+
+const uint8_t *VS10XXBuffer::peek(size_t max_size, size_t *size) const {
+  *size = std::min(std::min(max_size, this->count_), this->capacity_ - this->head_);
+  return this->data_ + this->head_;
+}
+
+void VS10XXBuffer::consume(size_t size) {
+  size = std::min(size, this->count_);
+  this->head_ = (this->head_ + size) % this->capacity_;
+  this->count_ -= size;
+}
+
+void PrebufferedSource::set_source(AudioSource *source) {
+  this->source_ = source;
+  this->buffer_.clear();
+}
+
+bool PrebufferedSource::is_prebuffered() const {
+  auto target = std::max(this->source_->prefill_size(), VS10XX_READ_AHEAD_SIZE);
+  return this->buffer_.available() >= std::min(target, this->buffer_.capacity()) || this->source_->at_end();
+}
+
+void PrebufferedSource::reset() {
+  this->buffer_.clear();
+  this->source_->reset();
+}
+
+size_t PrebufferedSource::read(uint8_t *buffer, size_t max_size) {
+  size_t total = 0;
+  while (total < max_size) {
+    size_t size;
+    const uint8_t *data = this->buffer_.peek(max_size - total, &size);
+    if (size == 0) {
+      break;
+    }
+    memcpy(buffer + total, data, size);
+    this->buffer_.consume(size);
+    total += size;
+  }
+  if (total < max_size) {
+    total += this->source_->read(buffer + total, max_size - total);
+  }
+  return total;
+}
+
+bool PrebufferedSource::seek(size_t position) {
+  this->buffer_.clear();
+  return this->source_->seek(position);
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
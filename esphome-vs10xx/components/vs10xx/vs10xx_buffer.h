@@ -0,0 +1,100 @@
+#pragma once
+
+#include "vs10xx_source.h"
+
+namespace esphome {
+namespace vs10xx {
+
+/// A ring buffer that stages audio data in RAM, ahead of the decoder.
+///
+/// Reading audio data from the source and sending it to the device are
+/// decoupled by this buffer. The source is read in large blocks, while the
+/// device is fed in small chunks from RAM. When reading from the source
+/// stalls (e.g. flash-mapped data while the flash cache is disabled), then
+/// playback can continue from the data in the buffer.
+class VS10XXBuffer {
+ public:
+  explicit VS10XXBuffer() = default;
+
+  /// Allocate the buffer memory. PSRAM is used when available.
+  /// This must be called once, at setup time.
+  bool allocate(size_t size);
+
+  /// Drop all data from the buffer.
+  void clear();
+
+  /// The total number of bytes that the buffer can hold.
+  size_t capacity() const { return this->capacity_; }
+
+  /// The number of bytes that are stored in the buffer.
+  size_t available() const { return this->count_; }
+
+  /// The number of bytes that can still be added to the buffer.
+  size_t free() const { return this->capacity_ - this->count_; }
+
+  /// The fill level of the buffer, from 0.0 (empty) to 1.0 (full).
+  float fill_level() const;
+
+  /// Read data from the source into the buffer, until the buffer is full,
+  /// the source has no more data available or max_size bytes were read.
+  /// Returns the number of bytes that were read.
+  size_t fill_from(AudioSource *source, size_t max_size);
+
+  /// Get a pointer to the next contiguous block of stored data. The size of
+  /// the block (at most max_size) is stored in size.
+  const uint8_t *peek(size_t max_size, size_t *size) const;
+
+  /// Remove size bytes of data from the start of the buffer.
+  void consume(size_t size);
+
+ protected:
+  uint8_t *data_{nullptr};
+  size_t capacity_{0};
+  size_t head_{0};
+  size_t count_{0};
+};
+
+/// An AudioSource that reads audio data ahead from another source into a
+/// buffer of its own, before it is played. Reading from it returns the
+/// buffered data first, and then continues with the other source.
+///
+/// This is used to buffer an announcement while other audio is still
+/// playing, so the switch to the announcement does not have to wait for
+/// the announcement source (e.g. a network connection).
+class PrebufferedSource : public AudioSource {
+ public:
+  explicit PrebufferedSource() = default;
+
+  /// Allocate the buffer memory. PSRAM is used when available.
+  /// This must be called once, at setup time.
+  bool allocate(size_t size) { return this->buffer_.allocate(size); }
+
+  /// Set the source to read from, and drop the buffered data.
+  void set_source(AudioSource *source);
+  AudioSource *get_source() const { return this->source_; }
+
+  /// Read ahead from the source into the buffer, without blocking.
+  void prebuffer() { this->buffer_.fill_from(this->source_, this->buffer_.free()); }
+
+  /// Check if enough audio data are buffered to start playing without
+  /// delay: the prefill size of the source (or a minimum amount of data,
+  /// for sources without a prefill), or all data when the source ended.
+  bool is_prebuffered() const;
+
+  /// The number of bytes that are buffered.
+  size_t buffered() const { return this->buffer_.available(); }
+
+  void reset() override;
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override { return this->buffer_.available() == 0 && this->source_->at_end(); }
+  bool seek(size_t position) override;
+  size_t prefill_size() const override { return this->source_->prefill_size(); }
+  void close() override { this->source_->close(); }
+
+ protected:
+  AudioSource *source_{nullptr};
+  VS10XXBuffer buffer_{};
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
@@ -0,0 +1,98 @@
+#include "vs10xx_capture.h"
+
+#ifdef USE_VS10XX_CAPTURE
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+// The number of captured bytes per log line. Log lines must stay well within
+// the logger's buffer size.
+static const size_t BYTES_PER_LINE = 64;
+
+// The maximum size of a record header: type byte + 5 byte LEB128 time delta.
+static const size_t MAX_HEADER_SIZE = 6;
+
+void VS10XXCapture::start() {
+  ESP_LOGI(TAG, "Starting SPI capture (%u bytes available)", VS10XX_CAPTURE_SIZE);
+  this->size_ = 0;
+  this->overflow_ = false;
+  this->last_record_at_ = micros();
+  this->active_ = true;
+}
+
+void VS10XXCapture::stop() {
+  if (this->active_) {
+    ESP_LOGI(TAG, "Stopped SPI capture (%zu bytes captured)", this->size_);
+  }
+  this->active_ = false;
+}
+
+bool VS10XXCapture::begin_record_(CaptureRecordType type, bool dreq, size_t size) {
+  if (this->size_ + MAX_HEADER_SIZE + size > VS10XX_CAPTURE_SIZE) {
+    this->active_ = false;
+    this->overflow_ = true;
+    return false;
+  }
+  auto now = micros();
+  uint32_t delta = now - this->last_record_at_;
+  this->last_record_at_ = now;
+
+  this->put_(type | (dreq ? CAPTURE_DREQ_BIT : 0));
+  do {
+    uint8_t byte = delta & 0x7F;
+    delta >>= 7;
+    this->put_(delta ? (byte | 0x80) : byte);
+  } while (delta);
+  return true;
+}
+
+void VS10XXCapture::record_sci(CaptureRecordType type, bool dreq, uint8_t reg, uint16_t value) {
+  if (this->begin_record_(type, dreq, 3)) {
+    this->put_(reg);
+    this->put_(value >> 8);
+    this->put_(value & 0xFF);
+  }
+}
+
+void VS10XXCapture::record_sdi(bool dreq, const uint8_t *data, size_t size) {
+  size = std::min<size_t>(size, 255);
+  if (this->begin_record_(CAPTURE_SDI, dreq, size + 1)) {
+    this->put_(size);
+    memcpy(this->data_ + this->size_, data, size);
+    this->size_ += size;
+  }
+}
+
+void VS10XXCapture::record_event(CaptureRecordType type, bool dreq) { this->begin_record_(type, dreq, 0); }
+
+void VS10XXCapture::record_spi_speed(bool dreq, bool fast) {
+  if (this->begin_record_(CAPTURE_SPI_SPEED, dreq, 1)) {
+    this->put_(fast ? 1 : 0);
+  }
+}
+
+void VS10XXCapture::dump() {
+  ESP_LOGI(TAG, "capture-begin bytes=%zu overflow=%s", this->size_, YESNO(this->overflow_));
+  char line[BYTES_PER_LINE * 2 + 1];
+  for (size_t offset = 0; offset < this->size_; offset += BYTES_PER_LINE) {
+    size_t count = std::min(BYTES_PER_LINE, this->size_ - offset);
+    for (size_t i = 0; i < count; i++) {
+      snprintf(line + i * 2, 3, "%02x", this->data_[offset + i]);
+    }
+    ESP_LOGI(TAG, "capture: %s", line);
+  }
+  ESP_LOGI(TAG, "capture-end");
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
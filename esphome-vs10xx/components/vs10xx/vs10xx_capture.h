@@ -0,0 +1,71 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// The capture facility records all SCI and SDI transactions, including the
+// transferred data and the DREQ state, into a compact binary log. It is only
+// compiled in when the "capture_size" option is configured.
+#ifdef USE_VS10XX_CAPTURE
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace vs10xx {
+
+/// Record types that are used in the capture log.
+/// Keep these in sync with the capture decoder in tools/vs10xx_capture.py.
+enum CaptureRecordType : uint8_t {
+  CAPTURE_SCI_WRITE = 1,   // register (1 byte), value (2 bytes, big endian)
+  CAPTURE_SCI_READ = 2,    // register (1 byte), value (2 bytes, big endian)
+  CAPTURE_SDI = 3,         // length (1 byte), data (length bytes)
+  CAPTURE_HARD_RESET = 4,  // no payload
+  CAPTURE_SPI_SPEED = 5,   // 0 = slow, 1 = fast (1 byte)
+};
+
+/// Every record starts with a byte that holds the record type in the low
+/// bits, and the DREQ state at the start of the transaction in the high bit.
+static const uint8_t CAPTURE_DREQ_BIT = 0x80;
+
+/// Records SPI transactions into a fixed size buffer. The capture stops
+/// when the buffer is full, so the start of a problem is never overwritten.
+class VS10XXCapture {
+ public:
+  void start();
+  void stop();
+  bool is_active() const { return this->active_; }
+
+  /// The captured data, in the record format that is described above.
+  const uint8_t *get_data() const { return this->data_; }
+  size_t get_size() const { return this->size_; }
+  /// Check if recording stopped because the buffer was full.
+  bool has_overflow() const { return this->overflow_; }
+
+  void record_sci(CaptureRecordType type, bool dreq, uint8_t reg, uint16_t value);
+  void record_sdi(bool dreq, const uint8_t *data, size_t size);
+  void record_event(CaptureRecordType type, bool dreq);
+  void record_spi_speed(bool dreq, bool fast);
+
+  /// Write the captured data to the log, hex encoded.
+  /// Use tools/vs10xx_capture.py to turn the log output into a binary
+  /// capture file and a readable transaction log.
+  void dump();
+
+ protected:
+  /// Start a new record, when size bytes of payload fit in the buffer.
+  /// The record header holds the type, DREQ state and the time since the
+  /// previous record as an unsigned LEB128 number of microseconds.
+  bool begin_record_(CaptureRecordType type, bool dreq, size_t size);
+  void put_(uint8_t value) { this->data_[this->size_++] = value; }
+
+  uint8_t data_[VS10XX_CAPTURE_SIZE]{};
+  size_t size_{0};
+  bool active_{false};
+  bool overflow_{false};
+  uint32_t last_record_at_{0};
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
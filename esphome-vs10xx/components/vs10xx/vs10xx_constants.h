@@ -1,8 +1,24 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include "esphome/core/defines.h"
+
 // This include contains definitions as provided by the VS10XX manufacturer.
 #include "vs10xx_uc.h"
 
+// The maximum number of plugins that can be loaded. The code generator
+// defines this based on the number of plugins in the configuration.
+#ifndef VS10XX_MAX_PLUGINS
+#define VS10XX_MAX_PLUGINS 4
+#endif
+
+// The maximum number of devices that can share the feed scheduler. The code
+// generator defines this based on the number of configured devices.
+#ifndef VS10XX_MAX_DEVICES
+#define VS10XX_MAX_DEVICES 1
+#endif
+
 namespace esphome {
 namespace vs10xx {
 
@@ -10,6 +26,16 @@ namespace vs10xx {
 /// to the device, we must not send more than this in one go.
 const uint8_t VS10XX_CHUNK_SIZE = 32;
 
+/// The maximum amount of data (in bytes) to send to a device in a single
+/// burst. This bounds the time that the SPI bus is held for one device, so
+/// other devices on the same bus get their turn in time.
+const size_t VS10XX_MAX_BURST_SIZE = 16 * VS10XX_CHUNK_SIZE;
+
+/// The minimum amount of data (in bytes) to read from an audio source in one
+/// go, when topping up the audio buffer. Reading in larger blocks keeps the
+/// overhead of the audio source out of the device feed path.
+const size_t VS10XX_READ_AHEAD_SIZE = 512;
+
 enum AudioFormat {
   FORMAT_UNKNOWN,
   FORMAT_WAV,
@@ -22,5 +48,14 @@ enum AudioFormat {
   FORMAT_OGG,
 };
 
+/// Decoder clock profiles. Every chipset maps these onto an SCI_CLOCKF value.
+/// A lower clock saves power for formats that are cheap to decode, a higher
+/// clock gives headroom for formats that are expensive to decode.
+enum ClockProfile : uint8_t {
+  CLOCK_PROFILE_LOW,
+  CLOCK_PROFILE_NORMAL,
+  CLOCK_PROFILE_FULL,
+};
+
 }  // namespace vs10xx
 }  // namespace esphome
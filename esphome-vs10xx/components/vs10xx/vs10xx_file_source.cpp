@@ -0,0 +1,109 @@
+#include "vs10xx_file_source.h"
+
+#ifdef USE_VS10XX_FILES
+
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+bool FileSource::allocate(size_t cache_size) {
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  this->cache_ = allocator.allocate(cache_size);
+  if (this->cache_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate %zu bytes for the file cache", cache_size);
+    this->cache_size_ = 0;
+    return false;
+  }
+  this->cache_size_ = cache_size;
+  return true;
+}
+
+void FileSource::set_file(fs::FS *fs, const std::string &path) {
+  this->fs_ = fs;
+  this->path_ = path;
+}
+
+void FileSource::reset() {
+  this->close();
+  this->position_ = 0;
+  this->file_size_ = 0;
+  this->cache_start_ = 0;
+  this->cache_fill_ = 0;
+  if (this->fs_ == nullptr || this->cache_size_ == 0) {
+    return;
+  }
+  this->file_ = this->fs_->open(this->path_.c_str(), "r");
+  if (!this->file_) {
+    ESP_LOGE(TAG, "Could not open audio file %s", this->path_.c_str());
+    return;
+  }
+  this->file_size_ = this->file_.size();
+  ESP_LOGD(TAG, "Opened audio file %s (%zu bytes)", this->path_.c_str(), this->file_size_);
+}
+
+void FileSource::close() {
+  if (this->file_) {
+    this->file_.close();
+  }
+}
+
+size_t FileSource::read(uint8_t *buffer, size_t max_size) {
+  // At most one cache block is read from the file per call, to keep the
+  // time spent in the filesystem per call bounded.
+  size_t total = 0;
+  bool loaded = false;
+  while (total < max_size && !this->at_end()) {
+    if (this->position_ < this->cache_start_ || this->position_ >= this->cache_start_ + this->cache_fill_) {
+      if (loaded || !this->load_block_()) {
+        break;
+      }
+      loaded = true;
+    }
+    size_t offset = this->position_ - this->cache_start_;
+    size_t size = std::min(max_size - total, this->cache_fill_ - offset);
+    memcpy(buffer + total, this->cache_ + offset, size);
+    this->position_ += size;
+    total += size;
+  }
+  return total;
+}
+
+bool FileSource::seek(size_t position) {
+  if (!this->file_ || position > this->file_size_) {
+    return false;
+  }
+  // The cache block is loaded on the next read.
+  this->position_ = position;
+  return true;
+}
+
+bool FileSource::load_block_() {
+  // On errors, the file is considered to end at the current position, so
+  // playback stops instead of waiting for data that will never arrive.
+  size_t start = this->position_ - this->position_ % this->cache_size_;
+  if (this->file_.position() != start && !this->file_.seek(start)) {
+    ESP_LOGE(TAG, "Could not seek to offset %zu in audio file %s", start, this->path_.c_str());
+    this->file_size_ = this->position_;
+    return false;
+  }
+  size_t fill = this->file_.read(this->cache_, this->cache_size_);
+  if (fill == 0) {
+    ESP_LOGE(TAG, "Could not read from audio file %s at offset %zu", this->path_.c_str(), start);
+    this->file_size_ = this->position_;
+    return false;
+  }
+  this->cache_start_ = start;
+  this->cache_fill_ = fill;
+  return this->position_ < start + fill;
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// Playing audio from files is only compiled in when a filesystem is
+// configured using the "filesystem" option.
+#ifdef USE_VS10XX_FILES
+
+#include "vs10xx_source.h"
+#include <FS.h>
+#include <string>
+
+namespace esphome {
+namespace vs10xx {
+
+/// An AudioSource that streams audio data from a file on a filesystem
+/// (e.g. LittleFS on flash, or FAT on an SD card).
+///
+/// The file is read through a block-aligned read-ahead cache. The file is
+/// always read a full cache block at a time, at an offset that is a multiple
+/// of the cache size. This way, the filesystem only sees large sequential
+/// reads that line up with its own blocks, and the overhead of the
+/// filesystem stays out of the device feed path.
+class FileSource : public AudioSource {
+ public:
+  explicit FileSource() = default;
+
+  /// Allocate the read-ahead cache. PSRAM is used when available.
+  /// This must be called once, at setup time.
+  bool allocate(size_t cache_size);
+
+  /// Set the file to read the audio data from.
+  void set_file(fs::FS *fs, const std::string &path);
+
+  void reset() override;
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override { return this->position_ >= this->file_size_; }
+  bool seek(size_t position) override;
+  void close() override;
+
+ protected:
+  fs::FS *fs_{nullptr};
+  std::string path_{};
+  fs::File file_{};
+  size_t file_size_{0};
+  size_t position_{0};
+
+  // The read-ahead cache, holding cache_fill_ bytes from the file,
+  // starting at offset cache_start_.
+  uint8_t *cache_{nullptr};
+  size_t cache_size_{0};
+  size_t cache_start_{0};
+  size_t cache_fill_{0};
+
+  /// Read the cache block that holds the current position.
+  bool load_block_();
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,111 @@
+#include "vs10xx_format.h"
+#include <cstring>
+
+namespace esphome {
+namespace vs10xx {
+
+// The first bytes of the ASF header object GUID, as used by WMA files.
+static const uint8_t ASF_HEADER_GUID[] = {0x30, 0x26, 0xB2, 0x75, 0x8E, 0x66, 0xCF, 0x11};
+
+// WAV streams up to this data rate (in bytes per second) are decoded using
+// the low clock profile. This covers for example 16 kHz 16 bit stereo PCM.
+static const uint32_t WAV_LOW_CLOCK_MAX_BYTE_RATE = 64000;
+
+// The WAVE_FORMAT_IMA_ADPCM format code.
+static const uint16_t WAV_FORMAT_IMA_ADPCM = 0x0011;
+
+static bool starts_with(const uint8_t *data, size_t size, const void *prefix, size_t prefix_size) {
+  return size >= prefix_size && memcmp(data, prefix, prefix_size) == 0;
+}
+
+static uint16_t read_le16(const uint8_t *data) { return data[0] | (data[1] << 8); }
+
+static uint32_t read_le32(const uint8_t *data) {
+  return read_le16(data) | (static_cast<uint32_t>(read_le16(data + 2)) << 16);
+}
+
+static void write_le16(uint8_t *data, uint16_t value) {
+  data[0] = value & 0xFF;
+  data[1] = value >> 8;
+}
+
+static void write_le32(uint8_t *data, uint32_t value) {
+  write_le16(data, value & 0xFFFF);
+  write_le16(data + 2, value >> 16);
+}
+
+AudioFormat detect_audio_format(const uint8_t *data, size_t size) {
+  if (size >= 12 && starts_with(data, size, "RIFF", 4) && memcmp(data + 8, "WAVE", 4) == 0) {
+    return FORMAT_WAV;
+  }
+  if (starts_with(data, size, "MThd", 4)) {
+    return FORMAT_MIDI;
+  }
+  if (starts_with(data, size, "OggS", 4)) {
+    return FORMAT_OGG;
+  }
+  if (starts_with(data, size, "ADIF", 4)) {
+    return FORMAT_AAC_ADIF;
+  }
+  if (size >= 8 && memcmp(data + 4, "ftyp", 4) == 0) {
+    return FORMAT_AAC_MP4;
+  }
+  if (starts_with(data, size, ASF_HEADER_GUID, sizeof(ASF_HEADER_GUID))) {
+    return FORMAT_WMA;
+  }
+  if (starts_with(data, size, "ID3", 3)) {
+    return FORMAT_MP3;
+  }
+  if (size >= 2 && data[0] == 0xFF && (data[1] & 0xE0) == 0xE0) {
+    // A frame sync. MPEG audio uses layer bits 01, 10 or 11, while ADTS
+    // uses layer bits 00.
+    return (data[1] & 0x06) == 0 ? FORMAT_AAC_ADTS : FORMAT_MP3;
+  }
+  return FORMAT_UNKNOWN;
+}
+
+ClockProfile select_clock_profile(const uint8_t *data, size_t size) {
+  switch (detect_audio_format(data, size)) {
+    case FORMAT_MIDI:
+      return CLOCK_PROFILE_LOW;
+    case FORMAT_WAV:
+      // The "fmt " chunk directly follows the RIFF header in practically
+      // all WAV files. When it does not, the normal profile is used.
+      if (size >= 32 && memcmp(data + 12, "fmt ", 4) == 0) {
+        auto format = read_le16(data + 20);
+        auto byte_rate = read_le32(data + 28);
+        if (format == WAV_FORMAT_IMA_ADPCM || byte_rate <= WAV_LOW_CLOCK_MAX_BYTE_RATE) {
+          return CLOCK_PROFILE_LOW;
+        }
+      }
+      return CLOCK_PROFILE_NORMAL;
+    case FORMAT_WMA:
+    case FORMAT_AAC_ADTS:
+    case FORMAT_AAC_ADIF:
+    case FORMAT_AAC_MP4:
+    case FORMAT_OGG:
+      return CLOCK_PROFILE_FULL;
+    default:
+      return CLOCK_PROFILE_NORMAL;
+  }
+}
+
+void write_wav_header(uint8_t *data, uint32_t sample_rate, uint8_t channels, uint32_t data_size) {
+  const uint16_t block_align = channels * 2;
+  memcpy(data, "RIFF", 4);
+  // The RIFF size must not overflow for a streaming data size.
+  write_le32(data + 4, data_size == WAV_STREAMING_SIZE ? data_size : data_size + WAV_HEADER_SIZE - 8);
+  memcpy(data + 8, "WAVEfmt ", 8);
+  write_le32(data + 16, 16);
+  write_le16(data + 20, 1);  // WAVE_FORMAT_PCM
+  write_le16(data + 22, channels);
+  write_le32(data + 24, sample_rate);
+  write_le32(data + 28, sample_rate * block_align);
+  write_le16(data + 32, block_align);
+  write_le16(data + 34, 16);
+  memcpy(data + 36, "data", 4);
+  write_le32(data + 40, data_size);
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "vs10xx_constants.h"
+
+namespace esphome {
+namespace vs10xx {
+
+/// Detects the format of an audio stream from its first bytes. This makes it
+/// possible to prepare the device for a stream, before any audio data are
+/// sent to it. The header of the stream must be in the provided data.
+AudioFormat detect_audio_format(const uint8_t *data, size_t size);
+
+/// Selects the decoder clock profile for an audio stream, based on the
+/// format and (when available) the data rate from the header of the stream.
+ClockProfile select_clock_profile(const uint8_t *data, size_t size);
+
+/// The size of the header that is written by write_wav_header().
+static const size_t WAV_HEADER_SIZE = 44;
+
+/// The data size to use in a WAV header, when the size of the audio data
+/// is not known up front (e.g. for a generated or streamed audio source).
+/// The device keeps decoding until the stream is ended.
+static const uint32_t WAV_STREAMING_SIZE = 0xFFFFFFFF;
+
+/// Writes the header for a 16 bit PCM WAV stream, which must be followed by
+/// data_size bytes of little endian samples (interleaved for stereo).
+void write_wav_header(uint8_t *data, uint32_t sample_rate, uint8_t channels, uint32_t data_size);
+
+}  // namespace vs10xx
+}  // namespace esphome
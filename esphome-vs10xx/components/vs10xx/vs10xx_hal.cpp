@@ -2,38 +2,91 @@
 #include "esphome/core/log.h"
 #include "vs10xx_constants.h"
 #include "vs10xx_hal.h"
+#include "vs10xx_trace.h"
+#include <cstring>
 
 namespace esphome {
 namespace vs10xx {
 
 static const char *const TAG = "vs10xx";
 
-void VS10XXHAL::setup() {
-  this->xdcs_pin_->setup();
-  this->xcs_pin_->setup();
-  this->xdcs_pin_->digital_write(true);
-  this->xcs_pin_->digital_write(true);
-  this->dreq_pin_->setup();
-  if (this->reset_pin_ != nullptr) {
-    this->reset_pin_->setup();
-    this->reset_pin_->digital_write(false);
-  }
-  this->slow_spi_->spi_setup();
-  this->fast_spi_->spi_setup();
+// Registers for which a write is skipped when the shadow shows that the
+// register already holds the value to write.
+// SCI_AUDATA is only used for skipping writes. Its shadow is dropped as soon
+// as audio data are sent, since the decoder updates the register based on
+// the stream that it is decoding.
+static const uint16_t SHADOW_WRITE_MASK =
+    (1 << SCI_BASS) | (1 << SCI_CLOCKF) | (1 << SCI_AUDATA) | (1 << SCI_VOL);
+
+// Registers that are owned by the HAL and that are not modified by the device
+// itself. Reads from these registers can be answered from the shadow.
+static const uint16_t SHADOW_READ_MASK =
+    (1 << SCI_BASS) | (1 << SCI_CLOCKF) | (1 << SCI_VOL);
+
+const char *audio_format_to_text(AudioFormat format) {
+  switch (format) {
+    case FORMAT_WAV:
+      return "WAV";
+    case FORMAT_AAC_ADTS:
+      return "AAC ADTS";
+    case FORMAT_AAC_ADIF:
+      return "AAC ADIF";
+    case FORMAT_AAC_MP4:
+      return "AAC MP4";
+    case FORMAT_MP3:
+      return "MP3";
+    case FORMAT_WMA:
+      return "WMA";
+    case FORMAT_MIDI:
+      return "MIDI";
+    case FORMAT_OGG:
+      return "Ogg Vorbis";
+    default:
+      return "Unknown";
+  }
 }
 
-void VS10XXHAL::log_config() {
-  ESP_LOGCONFIG(TAG, "  XCS Pin: %s", this->xcs_pin_->dump_summary().c_str());
-  ESP_LOGCONFIG(TAG, "  XDCS Pin: %s", this->xdcs_pin_->dump_summary().c_str());
-  ESP_LOGCONFIG(TAG, "  DREQ Pin: %s", this->dreq_pin_->dump_summary().c_str());
-  if (this->reset_pin_ == nullptr) {
-    ESP_LOGCONFIG(TAG, "  RESET Pin: N/A");
-  } else {
-    ESP_LOGCONFIG(TAG, "  RESET Pin: %s", this->reset_pin_->dump_summary().c_str());
+const char *clock_profile_to_text(ClockProfile profile) {
+  switch (profile) {
+    case CLOCK_PROFILE_LOW:
+      return "Low";
+    case CLOCK_PROFILE_NORMAL:
+      return "Normal";
+    case CLOCK_PROFILE_FULL:
+      return "Full";
+    default:
+      return "Unknown";
+  }
+}
+
+// Bitrates (in kbit/s) for MPEG audio, indexed by the bitrate index from the
+// frame header, as exposed through SCI_HDAT0 bits 15:12.
+static const uint16_t MPEG1_L1_BITRATES[] = {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448};
+static const uint16_t MPEG1_L2_BITRATES[] = {0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384};
+static const uint16_t MPEG1_L3_BITRATES[] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320};
+static const uint16_t MPEG2_L1_BITRATES[] = {0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256};
+static const uint16_t MPEG2_L23_BITRATES[] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160};
+
+static uint16_t mpeg_bitrate(uint16_t hdat0, uint16_t hdat1) {
+  auto index = (hdat0 >> 12) & 0x0F;
+  auto id = (hdat1 >> 3) & 0x03;     // 3 = MPEG 1, 2 = MPEG 2, 0 = MPEG 2.5
+  auto layer = (hdat1 >> 1) & 0x03;  // 3 = layer I, 2 = layer II, 1 = layer III
+  if (index == 0x0F || layer == 0) {
+    return 0;
+  }
+  if (id == 3) {
+    return layer == 3 ? MPEG1_L1_BITRATES[index]
+         : layer == 2 ? MPEG1_L2_BITRATES[index]
+                      : MPEG1_L3_BITRATES[index];
   }
+  return layer == 3 ? MPEG2_L1_BITRATES[index] : MPEG2_L23_BITRATES[index];
 }
 
-bool VS10XXHAL::has_reset() const { return this->reset_pin_ != nullptr; }
+void VS10XXHAL::setup() { this->transport_->setup(); }
+
+void VS10XXHAL::log_config() { this->transport_->log_config(); }
+
+bool VS10XXHAL::has_reset() const { return this->transport_->has_reset(); }
 
 bool VS10XXHAL::reset() {
   // Sanity check: in case no reset pin has been defined, check if DREQ goes HIGH.
@@ -49,25 +102,42 @@ bool VS10XXHAL::reset() {
     ESP_LOGD(TAG, "Hard resetting the device");
 
     // By driving the XRESET-signal low, the device will reset.
-    this->reset_pin_->digital_write(false);
+    this->transport_->set_reset(true);
     delay(1); // 1 ms delay is enough according to the specs
-    this->reset_pin_->digital_write(true);
+    this->transport_->set_reset(false);
 
     // After initialization, the DREQ pin ought to be pulled HIGH.
     // The datasheets specifies max 50000 XTALI cycles for boot initialization.
     // At the default XTALI of 12.288 MHz, this takes about 4ms.
     // Therefore, 10ms ought to be way enough for the device to become ready.
+#ifdef USE_VS10XX_CAPTURE
+    if (this->capture_.is_active()) {
+      this->capture_.record_event(CAPTURE_HARD_RESET, this->is_ready());
+    }
+#endif
+
     if (!this->wait_for_ready(10)) {
+      this->invalidate_shadow_();
       return false;
     }
+
+    // After a hard reset, the registers are at their documented power-on
+    // values. Seed the shadow with these, so go_slow() and set_volume()
+    // don't have to rewrite registers that already hold the target value.
+    this->invalidate_shadow_();
+    this->shadow_[SCI_BASS] = 0x0000;
+    this->shadow_[SCI_CLOCKF] = 0x0000;
+    this->shadow_[SCI_VOL] = 0x0000;
+    this->shadow_valid_ = (1 << SCI_BASS) | (1 << SCI_CLOCKF) | (1 << SCI_VOL);
   } else {
     ESP_LOGW(TAG, "Not performing hard reset, no reset pin defined"); 
+    this->invalidate_shadow_();
   }
 
   // The device always starts in slow mode, so we'll have to follow pace.
   // When no reset pin is available, then it's still safe to talk slowly
   // to the SPI bus, since the device will follow our SPI clock signal.
-  this->fast_mode_ = false;
+  this->transport_->set_fast_mode(false);
 
   return true;
 }
@@ -88,6 +158,10 @@ bool VS10XXHAL::soft_reset() {
   // requires "SHARED MODE", then we can implement a config option for it.
   this->write_register(SCI_MODE, SM_SDINEW | SM_RESET);
 
+  // What register values survive a soft reset is not documented in detail,
+  // so all shadowed values are considered unknown from here on.
+  this->invalidate_shadow_();
+
   if (!this->wait_for_ready()) {
     return false;
   }
@@ -102,13 +176,106 @@ bool VS10XXHAL::soft_reset() {
   return true;
 }
 
+bool VS10XXHAL::power_down(bool hold_reset) {
+  if (hold_reset) {
+    ESP_LOGD(TAG, "Powering down the device by holding it in reset");
+    this->transport_->set_reset(true);
+    this->transport_->set_fast_mode(false);
+    this->invalidate_shadow_();
+    return true;
+  }
+
+  // The analog output is turned off first, to prevent a pop.
+  ESP_LOGD(TAG, "Powering down the device");
+  if (!this->turn_off_output()) {
+    return false;
+  }
+  if (this->chipset_->supports_pdown()) {
+    this->power_down_mode_ = this->read_register(SCI_MODE);
+    return this->write_register(SCI_MODE, this->power_down_mode_ | SM_PDOWN);
+  }
+  // Without SM_PDOWN, power consumption is reduced by lowering the
+  // internal clock multiplier.
+  return this->go_slow();
+}
+
+bool VS10XXHAL::power_up() {
+  ESP_LOGD(TAG, "Waking up the device");
+  if (this->chipset_->supports_pdown()) {
+    // The clock is stopped in power down, so SCI_MODE is not read back.
+    this->write_register(SCI_MODE, this->power_down_mode_ & ~SM_PDOWN);
+    return this->wait_for_ready(10);
+  }
+  return this->wait_for_ready() && this->go_fast() && this->wait_for_ready();
+}
+
+bool VS10XXHAL::cancel_playback() {
+  if (!this->can_cancel_playback() || !this->wait_for_ready()) {
+    return false;
+  }
+  ESP_LOGD(TAG, "Cancelling playback");
+
+  // The decoder must be fed with endFillByte while cancelling. This value
+  // is found in the parametric structure in X memory at address 0x1E06.
+  this->write_register(SCI_WRAMADDR, 0x1E06);
+  uint8_t end_fill[VS10XX_CHUNK_SIZE];
+  memset(end_fill, this->read_register(SCI_WRAM) & 0xFF, sizeof(end_fill));
+
+  // From the datasheet: set SM_CANCEL and keep sending endFillByte in chunks
+  // of 32 bytes, checking SM_CANCEL after every chunk. When it is not
+  // cleared after 2048 bytes, a software reset is required.
+  auto mode = this->read_register(SCI_MODE);
+  this->write_register(SCI_MODE, mode | SM_CANCEL);
+  for (size_t sent = 0; sent < 2048; sent += sizeof(end_fill)) {
+    if (!this->wait_for_ready(10)) {
+      return false;
+    }
+    this->begin_data_transaction();
+    this->write_data(end_fill, sizeof(end_fill));
+    this->end_transaction();
+    if ((this->read_register(SCI_MODE) & SM_CANCEL) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool VS10XXHAL::end_stream() {
+  if (this->can_cancel_playback()) {
+    return this->cancel_playback();
+  }
+  if (!this->wait_for_ready()) {
+    return false;
+  }
+  ESP_LOGD(TAG, "Ending the audio stream");
+
+  // Chipsets without SM_CANCEL have no endFillByte parameter. For these,
+  // the datasheet prescribes sending 2048 zeros after the end of a stream.
+  // After that, the next stream can be sent without a reset.
+  uint8_t end_fill[VS10XX_CHUNK_SIZE]{};
+  for (size_t sent = 0; sent < 2048; sent += sizeof(end_fill)) {
+    if (!this->wait_for_ready(10)) {
+      return false;
+    }
+    this->begin_data_transaction();
+    this->write_data(end_fill, sizeof(end_fill));
+    this->end_transaction();
+  }
+  return true;
+}
+
 bool VS10XXHAL::go_slow() {
   ESP_LOGD(TAG, "Configuring device for slow speed SPI communication");
 
   // Set device clock multiplier to the default of 1.0x. When using that setting,
   // the device can only use SPI on a low frequency setting.
   if (this->write_register(SCI_CLOCKF, 0x0000)) {
-    this->fast_mode_ = false;
+    this->transport_->set_fast_mode(false);
+#ifdef USE_VS10XX_CAPTURE
+    if (this->capture_.is_active()) {
+      this->capture_.record_spi_speed(this->is_ready(), false);
+    }
+#endif
     return true;
   } else {
     return false;
@@ -119,15 +286,55 @@ bool VS10XXHAL::go_fast() {
   ESP_LOGD(TAG, "Configuring device for high speed SPI communication");
 
   // Set device clock multiplier to the recommended value for typical use.
-  // After this, we can safely use a SPI speed of 4MHz.
-  if (this->write_register(SCI_CLOCKF, chipset_->get_fast_clockf())) {
-    this->fast_mode_ = true;
+  // After this, we can safely use a SPI speed of 4MHz, once DREQ is high
+  // again to tell that the device runs on the new clock.
+  if (this->write_register(SCI_CLOCKF, chipset_->get_fast_clockf()) && this->wait_for_ready()) {
+    this->transport_->set_fast_mode(true);
+    this->clock_profile_ = CLOCK_PROFILE_NORMAL;
+#ifdef USE_VS10XX_CAPTURE
+    if (this->capture_.is_active()) {
+      this->capture_.record_spi_speed(this->is_ready(), true);
+    }
+#endif
     return true;
   } else {
     return false;
   }
 }
 
+bool VS10XXHAL::set_clock_profile(ClockProfile profile) {
+  auto clockf = this->chipset_->get_clockf(profile);
+  if ((this->shadow_valid_ & (1 << SCI_CLOCKF)) && this->shadow_[SCI_CLOCKF] == clockf) {
+    this->clock_profile_ = profile;
+    return true;
+  }
+  if (!this->wait_for_ready()) {
+    return false;
+  }
+  ESP_LOGD(TAG, "Switching to the %s clock profile", clock_profile_to_text(profile));
+
+  // The device runs on an unknown clock until DREQ goes high again after
+  // the switch. Until then, the SPI clock is kept at the safe low speed.
+  this->transport_->set_fast_mode(false);
+#ifdef USE_VS10XX_CAPTURE
+  if (this->capture_.is_active()) {
+    this->capture_.record_spi_speed(this->is_ready(), false);
+  }
+#endif
+  this->write_register(SCI_CLOCKF, clockf);
+  if (!this->wait_for_ready(10)) {
+    return false;
+  }
+  this->transport_->set_fast_mode(true);
+#ifdef USE_VS10XX_CAPTURE
+  if (this->capture_.is_active()) {
+    this->capture_.record_spi_speed(this->is_ready(), true);
+  }
+#endif
+  this->clock_profile_ = profile;
+  return true;
+}
+
 bool VS10XXHAL::verify_chipset() {
   // From the datasheet:
   // SCI_STATUS register has SS_VER in bits 4:7
@@ -145,7 +352,7 @@ bool VS10XXHAL::verify_chipset() {
   return true;
 }
 
-bool VS10XXHAL::test_communication() {
+bool VS10XXHAL::test_communication(bool quick) {
   // Wait for the device to become ready (DREQ high).
   if (!this->wait_for_ready()) {
     return false;
@@ -153,12 +360,14 @@ bool VS10XXHAL::test_communication() {
 
   // Now test if we can write and read data over the
   // bus without errors.
-  auto step_size = 0x1010;
+  auto step_size = quick ? 0x5555 : 0x1010;
   auto cycles = 0;
   auto failures = 0;
   for (int value = 0x0000; value < 0xFFFF; value += step_size) {
     cycles++;
-    this->write_register(SCI_VOL, value);
+    // The shadow is bypassed here, since the point of this exercise is
+    // to have the data travel over the bus.
+    this->write_register(SCI_VOL, value, true);
 
     // Sanity check: DREQ should be LOW at this point. If not, then the
     // DREQ pin might not be connected correctly.
@@ -173,8 +382,8 @@ bool VS10XXHAL::test_communication() {
       }
     }
 
-    auto read1 = this->read_register(SCI_VOL);
-    auto read2 = this->read_register(SCI_VOL);
+    auto read1 = this->read_register(SCI_VOL, true);
+    auto read2 = this->read_register(SCI_VOL, true);
     if (value != read1 || value != read2) {
       failures++;
       ESP_LOGE(TAG, "SPI test failure after %d cycles; wrote %d, read back %d and %d",
@@ -232,7 +441,7 @@ bool VS10XXHAL::reset_decode_time() {
 }
 
 bool VS10XXHAL::is_ready() const {
-  return this->dreq_pin_->digital_read() == true;
+  return this->transport_->read_dreq();
 }
 
 bool VS10XXHAL::wait_for_ready(uint16_t timeout_ms) {
@@ -250,6 +459,8 @@ bool VS10XXHAL::wait_for_ready(uint16_t timeout_ms) {
 VS10XXStatus &VS10XXHAL::get_status() {
   auto hdat0 = this->read_register(SCI_HDAT0);
   auto hdat1 = this->read_register(SCI_HDAT1);
+  auto decode_time = this->read_register(SCI_DECODE_TIME);
+  auto audata = this->read_register(SCI_AUDATA);
 
   if (hdat0 == 0 && hdat1 == 0) {
     this->status_.clear();
@@ -275,88 +486,101 @@ VS10XXStatus &VS10XXHAL::get_status() {
     } else {
         this->status_.format = FORMAT_UNKNOWN;
     }
+
+    // SCI_AUDATA holds the sample rate, rounded down to an even value.
+    // Bit 0 tells whether or not the stream is stereo.
+    this->status_.decode_time = decode_time;
+    this->status_.sample_rate = audata & 0xFFFE;
+    this->status_.stereo = (audata & 0x0001) != 0;
+    this->status_.bitrate = this->status_.format == FORMAT_MP3 ? mpeg_bitrate(hdat0, hdat1) : 0;
   }
 
   return this->status_;
 }
 
-bool VS10XXHAL::write_register(uint8_t reg, uint16_t value) {
+bool VS10XXHAL::write_register(uint8_t reg, uint16_t value, bool force) {
+  const uint16_t bit = 1 << (reg & 0x0F);
+  const bool shadowed = (SHADOW_WRITE_MASK & bit) != 0;
+  if (!force && shadowed && (this->shadow_valid_ & bit) && this->shadow_[reg] == value) {
+    this->sci_stats_.writes_skipped++;
+    VS10XX_TRACE(TRACE_SCI_WRITE_SKIP, reg, value);
+    ESP_LOGVV(TAG, "write_register: 0x%02X: 0x%02X (skipped, unchanged)", reg, value);
+    return true;
+  }
+
+#ifdef USE_VS10XX_CAPTURE
+  if (this->capture_.is_active()) {
+    this->capture_.record_sci(CAPTURE_SCI_WRITE, this->is_ready(), reg, value);
+  }
+#endif
   this->begin_command_transaction();
   this->write_byte(2); // command: write
   this->write_byte(reg);
   this->write_byte16(value);
   this->end_transaction();
+  this->sci_stats_.writes_issued++;
+  VS10XX_TRACE(TRACE_SCI_WRITE, reg, value);
   ESP_LOGVV(TAG, "write_register: 0x%02X: 0x%02X", reg, value);
+
+  if (shadowed) {
+    this->shadow_[reg] = value;
+    this->shadow_valid_ |= bit;
+  }
   return true;
 }
 
-uint16_t VS10XXHAL::read_register(uint8_t reg) const {
+uint16_t VS10XXHAL::read_register(uint8_t reg, bool force) {
+  const uint16_t bit = 1 << (reg & 0x0F);
+  if (!force && (SHADOW_READ_MASK & bit) && (this->shadow_valid_ & bit)) {
+    this->sci_stats_.reads_skipped++;
+    VS10XX_TRACE(TRACE_SCI_READ_SHADOW, reg, this->shadow_[reg]);
+    ESP_LOGVV(TAG, "read_register: 0x%02X: 0x%02X (from shadow)", reg, this->shadow_[reg]);
+    return this->shadow_[reg];
+  }
+
+#ifdef USE_VS10XX_CAPTURE
+  bool dreq = this->capture_.is_active() && this->is_ready();
+#endif
   this->begin_command_transaction();
   this->write_byte(3); // command: read
   this->write_byte(reg);
   uint16_t value = this->read_byte() << 8 | this->read_byte();
   this->end_transaction();
+  this->sci_stats_.reads_issued++;
+#ifdef USE_VS10XX_CAPTURE
+  if (this->capture_.is_active()) {
+    this->capture_.record_sci(CAPTURE_SCI_READ, dreq, reg, value);
+  }
+#endif
+  VS10XX_TRACE(TRACE_SCI_READ, reg, value);
   ESP_LOGVV(TAG, "read_register: 0x%02X: 0x%02X", reg, value);
   return value;
 }
 
-void VS10XXHAL::begin_command_transaction() const {
-  this->enable();
-  this->xdcs_pin_->digital_write(true);
-  this->xcs_pin_->digital_write(false);
-}
-
-void VS10XXHAL::begin_data_transaction() const {
-  this->enable();
-  this->xcs_pin_->digital_write(true);
-  this->xdcs_pin_->digital_write(false);
-}
+void VS10XXHAL::begin_command_transaction() const { this->transport_->begin_command(); }
 
-void VS10XXHAL::end_transaction() const {
-  this->disable();
-  this->xdcs_pin_->digital_write(true);
-  this->xcs_pin_->digital_write(true);
+void VS10XXHAL::begin_data_transaction() {
+  // The decoder updates SCI_AUDATA to match the stream that is decoded.
+  this->shadow_valid_ &= ~(1 << SCI_AUDATA);
+  this->transport_->begin_data();
 }
 
-void VS10XXHAL::enable() const {
-  if (this->fast_mode_) {
-    this->fast_spi_->enable();
-  } else {
-    this->slow_spi_->enable();
+void VS10XXHAL::write_data(const uint8_t *data, size_t size) {
+#ifdef USE_VS10XX_CAPTURE
+  if (this->capture_.is_active()) {
+    this->capture_.record_sdi(this->is_ready(), data, size);
   }
+#endif
+  this->transport_->write_array(data, size);
 }
 
-void VS10XXHAL::disable() const {
-  if (this->fast_mode_) {
-    this->fast_spi_->disable();
-  } else {
-    this->slow_spi_->disable();
-  }
-}
+void VS10XXHAL::end_transaction() const { this->transport_->end(); }
 
-void VS10XXHAL::write_byte(uint8_t value) const {
-  if (this->fast_mode_) {
-    this->fast_spi_->write_byte(value);
-  } else {
-    this->slow_spi_->write_byte(value);
-  }
-}
+void VS10XXHAL::write_byte(uint8_t value) const { this->transport_->write_byte(value); }
 
-void VS10XXHAL::write_byte16(uint16_t value) const {
-  if (this->fast_mode_) {
-    this->fast_spi_->write_byte16(value);
-  } else {
-    this->slow_spi_->write_byte16(value);
-  }
-}
+void VS10XXHAL::write_byte16(uint16_t value) const { this->transport_->write_byte16(value); }
 
-uint8_t VS10XXHAL::read_byte() const {
-  if (this->fast_mode_) {
-    return this->fast_spi_->read_byte();
-  } else {
-    return this->slow_spi_->read_byte();
-  }
-}
+uint8_t VS10XXHAL::read_byte() const { return this->transport_->read_byte(); }
 
 }  // namespace vs10xx
 }  // namespace esphome
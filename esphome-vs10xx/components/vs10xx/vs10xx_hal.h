@@ -1,37 +1,55 @@
 #pragma once
 
 #include "esphome/core/component.h"
-#include "esphome/components/spi/spi.h"
+#include "vs10xx_capture.h"
 #include "vs10xx_constants.h"
+#include "vs10xx_transport.h"
 
 namespace esphome {
 namespace vs10xx {
 
-// To communicate using both 200KHz and 4MHz SPI frequencies, two SPIDevice
-// instances are used.
-//
-// The templated SPI structure in ESPHome does not allow for variable
-// frequencies. This wrapper contains two concrete SPI instances for the two
-// frequencies and delegates SPI requests to eiter one of these, depending
-// on the need for slow or fast communication.
-#define SPI_BASE spi::BIT_ORDER_MSB_FIRST, spi::CLOCK_POLARITY_LOW, spi::CLOCK_PHASE_LEADING
-class VS10XXSlowSPI : public spi::SPIDevice<SPI_BASE, spi::DATA_RATE_200KHZ> {};
-class VS10XXFastSPI : public spi::SPIDevice<SPI_BASE, spi::DATA_RATE_4MHZ> {};
+/// Translates an AudioFormat into a human readable text.
+const char *audio_format_to_text(AudioFormat format);
+
+/// Translates a ClockProfile into a human readable text.
+const char *clock_profile_to_text(ClockProfile profile);
 
 /// This class holds status information for the device.
 class VS10XXStatus {
  public:
   bool playing;
   AudioFormat format;
+  /// The decode time in seconds, from SCI_DECODE_TIME.
+  uint16_t decode_time;
+  /// The sample rate in Hz, from SCI_AUDATA.
+  uint16_t sample_rate;
+  bool stereo;
+  /// The bitrate in kbit/s. This is only known for MPEG audio streams,
+  /// for other formats the bitrate is 0.
+  uint16_t bitrate;
 
   explicit VS10XXStatus() { this->clear(); }
 
   void clear() {
     this->playing = false;
     this->format = FORMAT_UNKNOWN;
+    this->decode_time = 0;
+    this->sample_rate = 0;
+    this->stereo = false;
+    this->bitrate = 0;
   }
 };
 
+/// Counters for SCI register operations. These show how many register reads
+/// and writes actually went over the bus, and how many could be handled by
+/// the register shadow in the HAL.
+struct VS10XXSCIStats {
+  uint32_t writes_issued{0};
+  uint32_t writes_skipped{0};
+  uint32_t reads_issued{0};
+  uint32_t reads_skipped{0};
+};
+
 /// This class describes the interface that must be implemented for
 /// a HAL chipset. This interface contains all chipset-specific HAL code.
 class VS10XXHALChipset {
@@ -43,6 +61,19 @@ class VS10XXHALChipset {
 
   /// Get the SCI_CLOCKF value to use for fast (>4Mhz) communication.
   virtual uint16_t get_fast_clockf() = 0;
+
+  /// Get the SCI_CLOCKF value for a clock profile. All profiles must allow
+  /// for fast (4MHz) SPI communication. The normal profile uses the value
+  /// from get_fast_clockf().
+  virtual uint16_t get_clockf(ClockProfile profile) = 0;
+
+  /// Whether or not the chipset can cancel the playback of a stream
+  /// using SM_CANCEL.
+  virtual bool supports_cancel() { return false; }
+
+  /// Whether or not the chipset supports a software power down using
+  /// SM_PDOWN.
+  virtual bool supports_pdown() { return false; }
 };
 
 /// This component provides a hardware abstraction layer for VS10XX devices.
@@ -52,12 +83,8 @@ class VS10XXHAL : public Component {
  public:
   // Methods for initialization.
   explicit VS10XXHAL(VS10XXHALChipset *chipset) : chipset_(chipset) {}
-  void set_slow_spi(VS10XXSlowSPI *spi) { this->slow_spi_ = spi; }
-  void set_fast_spi(VS10XXFastSPI *spi) { this->fast_spi_ = spi; }
-  void set_xdcs_pin(GPIOPin *xdcs_pin) { this->xdcs_pin_ = xdcs_pin; }
-  void set_xcs_pin(GPIOPin *xcs_pin) { this->xcs_pin_ = xcs_pin; }
-  void set_dreq_pin(GPIOPin *dreq_pin) { this->dreq_pin_ = dreq_pin; }
-  void set_reset_pin(GPIOPin *reset_pin) { this->reset_pin_ = reset_pin; }
+  void set_transport(VS10XXTransport *transport) { this->transport_ = transport; }
+  VS10XXHALChipset *get_chipset() const { return this->chipset_; }
   void setup() override;
   void log_config();
 
@@ -65,6 +92,14 @@ class VS10XXHAL : public Component {
   bool go_slow();
   bool go_fast();
 
+  /// Switch the decoder clock to a clock profile. The SPI clock is lowered
+  /// while the device switches its internal clock. Requires the device to
+  /// be in fast mode (see go_fast()).
+  bool set_clock_profile(ClockProfile profile);
+
+  /// The active clock profile.
+  ClockProfile get_clock_profile() const { return this->clock_profile_; }
+
   /// Check if the device is ready for action.
   bool is_ready() const;
 
@@ -88,11 +123,40 @@ class VS10XXHAL : public Component {
   /// Soft reset the device.
   bool soft_reset();
 
+  /// Check if the chipset can cancel playback without a reset.
+  bool can_cancel_playback() const { return this->chipset_->supports_cancel(); }
+
+  /// Put the device in a low power state. When hold_reset is true, then the
+  /// device is held in reset. This offers the best power saving, but the
+  /// device must be fully initialized on wake up. Otherwise, the analog
+  /// output is turned off and the clock is stopped (SM_PDOWN) or slowed down.
+  bool power_down(bool hold_reset);
+
+  /// Wake the device from a software power down. Registers and loaded
+  /// plugins are retained, except for the volume, which must be restored.
+  bool power_up();
+
+  /// Cancel the playback of the current stream using SM_CANCEL, without
+  /// resetting the device. Returns false when the chipset does not support
+  /// this, or when the decoder did not acknowledge the cancel request.
+  bool cancel_playback();
+
+  /// End the stream that is being decoded, so the decoder is ready for the
+  /// next stream, without resetting the device. When supported, SM_CANCEL
+  /// is used. Otherwise, the decoder is flushed by sending it 2048 bytes of
+  /// endFillByte. Returns false when the decoder did not take the data.
+  bool end_stream();
+
   /// Check if the version of the VS10XX chipset matches the supported version.
   bool verify_chipset();
 
+  /// Get the chipset version that is supported by the configured chipset.
+  uint8_t get_chipset_version() const { return this->chipset_->get_chipset_version(); }
+
   /// Perform some communication tests to see if we can talk to the device.
-  bool test_communication();
+  /// The quick test only uses a few alternating bit patterns instead of the
+  /// full sweep, for when the setup has already been verified before.
+  bool test_communication(bool quick = false);
 
   /// Turn off the output.
   bool turn_off_output();
@@ -111,50 +175,63 @@ class VS10XXHAL : public Component {
   /// chip has been decoding audio.
   bool reset_decode_time();
 
-  /// Retrieve the device status.
+  /// Retrieve the device status. The status registers are read in one
+  /// batch, so make sure the device is ready (DREQ high) before calling this.
   VS10XXStatus& get_status();
 
+  /// Retrieve the counters for issued and skipped SCI operations.
+  const VS10XXSCIStats &get_sci_stats() const { return this->sci_stats_; }
+
   // High level SPI interaction methods.
-  bool write_register(uint8_t reg, uint16_t value);
-  uint16_t read_register(uint8_t reg) const;
+  // Writes to shadowed registers are skipped when the register is known to
+  // already hold the value, and reads from HAL-owned registers are answered
+  // from the shadow. Use force=true to always talk to the device.
+  bool write_register(uint8_t reg, uint16_t value, bool force = false);
+  uint16_t read_register(uint8_t reg, bool force = false);
   void begin_command_transaction() const;
-  void begin_data_transaction() const;
+  void begin_data_transaction();
+  /// Write audio data within a data transaction.
+  void write_data(const uint8_t *data, size_t size);
   void end_transaction() const;
 
   // Low level SPI interaction methods.
-  // These will switch between the slow and fast SPI instance, based on the
-  // current frequency mode.
-  void enable() const;
-  void disable() const;
+  // These are delegated to the transport.
   void write_byte(uint8_t value) const;
   void write_byte16(uint16_t value) const;
   uint8_t read_byte() const;
 
+#ifdef USE_VS10XX_CAPTURE
+  /// The capture of SPI transactions.
+  VS10XXCapture &get_capture() { return this->capture_; }
+#endif
+
  protected:
-  VS10XXSlowSPI *slow_spi_;
-  VS10XXFastSPI *fast_spi_;
-  bool fast_mode_{false};
+  /// The transport that is used to talk to the device.
+  VS10XXTransport *transport_;
+
+  /// The active clock profile.
+  ClockProfile clock_profile_{CLOCK_PROFILE_NORMAL};
+
+  /// The SCI_MODE value from before a software power down.
+  uint16_t power_down_mode_{SM_SDINEW};
 
   /// This object implements the chipset-specific code.
   VS10XXHALChipset *chipset_;
 
-  /// The XCS pin can be pulled low to lock the SPI bus for a command.
-  GPIOPin *xcs_pin_;
-
-  /// The XDCS pin can be pulled low to lock the SPI bus for a data transfer.
-  GPIOPin *xdcs_pin_;
+  VS10XXStatus status_{};
 
-  /// The DREQ pin, which is used by the device to tell the MCU that
-  /// it is open for business. This means: ready to process a command
-  /// or to receive some audio data.
-  GPIOPin *dreq_pin_;
+  /// Write-through shadow of the SCI registers. Only the registers in the
+  /// shadow masks (see vs10xx_hal.cpp) are tracked. The shadow_valid_ bitmask
+  /// tells for which registers the shadow holds a known device value.
+  uint16_t shadow_[16]{};
+  uint16_t shadow_valid_{0};
+  void invalidate_shadow_() { this->shadow_valid_ = 0; }
 
-  /// Optional reset pin. When this pin is linked to a GPIO (instead of the
-  /// EN pin or Vcc for example), then the device can be turned on and off.
-  /// Turning it off through the reset pin, offers the best power saving.
-  GPIOPin *reset_pin_{nullptr};
+  VS10XXSCIStats sci_stats_{};
 
-  VS10XXStatus status_{};
+#ifdef USE_VS10XX_CAPTURE
+  VS10XXCapture capture_{};
+#endif
 };
 
 }  // namespace vs10xx
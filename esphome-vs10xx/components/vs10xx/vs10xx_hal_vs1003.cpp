@@ -16,5 +16,21 @@ uint16_t VS1003Chipset::get_fast_clockf() {
   return 0x9800;
 }
 
+uint16_t VS1003Chipset::get_clockf(ClockProfile profile) {
+  switch (profile) {
+    case CLOCK_PROFILE_LOW:
+      // Clock multiplier: XTALI×2.5, no multiplier addition.
+      // This is the lowest clock at which SCI reads (max CLKI/7) still
+      // work at 4MHz SPI.
+      return 0x6000;
+    case CLOCK_PROFILE_FULL:
+      // Clock multiplier: XTALI×4.5, no multiplier addition.
+      // This is the maximum CLKI of 55.3 MHz from the datasheet.
+      return 0xE000;
+    default:
+      return this->get_fast_clockf();
+  }
+}
+
 }  // namespace vs10xx
 }  // namespace esphome
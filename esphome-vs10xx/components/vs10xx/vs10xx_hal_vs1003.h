@@ -8,6 +8,8 @@ namespace vs10xx {
 class VS1003Chipset : public VS10XXHALChipset {
   uint8_t get_chipset_version() override;
   uint16_t get_fast_clockf() override;
+  uint16_t get_clockf(ClockProfile profile) override;
+  bool supports_pdown() override { return true; }
 };
 
 }  // namespace vs10xx
@@ -0,0 +1,491 @@
+#include "vs10xx_http_source.h"
+
+#ifdef USE_VS10XX_HTTP
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifdef USE_ESP32
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+#endif
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+// The time (in milliseconds) that resolving the host name and connecting
+// to the server may take. The TLS handshake of an HTTPS stream blocks the
+// main loop, so this is kept short.
+static const int32_t HTTP_CONNECT_TIMEOUT = 3000;
+
+// The maximum number of redirects to follow for a single connection.
+static const uint8_t HTTP_MAX_REDIRECTS = 3;
+
+// The maximum length of a response header line. Longer lines are truncated.
+static const size_t HTTP_MAX_HEADER_LINE = 512;
+
+void HttpSource::reset() {
+  this->close();
+  this->target_url_ = this->url_;
+  this->redirects_ = 0;
+  this->title_.clear();
+  // The first connection is made right away.
+  this->backoff_delay_ = this->reconnect_delay_;
+  this->backoff_wait_ = 0;
+  this->backoff_started_at_ = millis();
+  this->state_ = HTTP_BACKOFF;
+}
+
+void HttpSource::close() {
+  this->close_socket_();
+  if (this->client_ != nullptr) {
+    this->client_->stop();
+    this->client_ = nullptr;
+  }
+  this->state_ = HTTP_CLOSED;
+}
+
+void HttpSource::close_socket_() {
+  if (this->socket_ >= 0) {
+    ::close(this->socket_);
+    this->socket_ = -1;
+  }
+  // A lookup that is still pending is ignored when it completes.
+  this->resolve_state_ = RESOLVE_IDLE;
+}
+
+size_t HttpSource::read(uint8_t *buffer, size_t max_size) {
+  auto now = millis();
+  switch (this->state_) {
+    case HTTP_CLOSED:
+    case HTTP_ENDED:
+    case HTTP_FAILED:
+      return 0;
+    case HTTP_BACKOFF:
+      if (now - this->backoff_started_at_ >= this->backoff_wait_) {
+        this->connect_();
+      }
+      return 0;
+    case HTTP_RESOLVING:
+    case HTTP_CONNECTING:
+      if (!this->poll_connect_()) {
+        this->schedule_reconnect_("connecting failed");
+      }
+      return 0;
+    case HTTP_HEADERS:
+      if (!this->read_headers_() && now - this->last_data_at_ > this->stall_timeout_) {
+        this->schedule_reconnect_("no response from server");
+      }
+      return 0;
+    case HTTP_STREAMING:
+      break;
+  }
+
+  // The audio data are read from the connection straight into the provided
+  // buffer, without intermediate copies.
+  size_t total = 0;
+  while (total < max_size) {
+    if (this->metaint_ > 0 && this->audio_until_metadata_ == 0) {
+      if (!this->read_metadata_()) {
+        break;
+      }
+      continue;
+    }
+    int available = this->client_->available();
+    if (available <= 0) {
+      break;
+    }
+    size_t size = std::min(max_size - total, static_cast<size_t>(available));
+    if (this->metaint_ > 0) {
+      size = std::min(size, this->audio_until_metadata_);
+    }
+    int got = this->client_->read(buffer + total, size);
+    if (got <= 0) {
+      break;
+    }
+    total += got;
+    if (this->metaint_ > 0) {
+      this->audio_until_metadata_ -= got;
+    }
+  }
+
+  if (total > 0) {
+    this->last_data_at_ = now;
+    this->backoff_delay_ = this->reconnect_delay_;
+  } else if (!this->client_->connected() && this->has_content_length_) {
+    ESP_LOGD(TAG, "HTTP stream: end of file");
+    this->close();
+    this->state_ = HTTP_ENDED;
+  } else if (!this->client_->connected()) {
+    this->schedule_reconnect_("connection closed");
+  } else if (now - this->last_data_at_ > this->stall_timeout_) {
+    this->stats_.stalls++;
+    this->schedule_reconnect_("stream stalled");
+  }
+  return total;
+}
+
+void HttpSource::connect_() {
+  // Split the URL into its parts: scheme://host[:port][/path]
+  size_t host_start;
+  if (this->target_url_.rfind("http://", 0) == 0) {
+    this->secure_ = false;
+    host_start = 7;
+  } else if (this->target_url_.rfind("https://", 0) == 0) {
+    this->secure_ = true;
+    host_start = 8;
+  } else {
+    ESP_LOGE(TAG, "Unsupported stream URL: %s", this->target_url_.c_str());
+    this->state_ = HTTP_FAILED;
+    return;
+  }
+  size_t path_start = this->target_url_.find('/', host_start);
+  this->host_ = this->target_url_.substr(host_start, path_start - host_start);
+  this->path_ = path_start == std::string::npos ? "/" : this->target_url_.substr(path_start);
+  this->port_ = this->secure_ ? 443 : 80;
+  size_t colon = this->host_.find(':');
+  if (colon != std::string::npos) {
+    this->port_ = atoi(this->host_.c_str() + colon + 1);
+    this->host_.resize(colon);
+  }
+
+  ESP_LOGD(TAG, "Connecting to stream %s", this->target_url_.c_str());
+  this->connect_started_at_ = millis();
+  this->start_resolve_();
+  this->state_ = HTTP_RESOLVING;
+}
+
+void HttpSource::start_resolve_() {
+  this->resolve_state_ = RESOLVE_PENDING;
+#ifdef USE_ESP32
+  // The lookup is answered right away for an IP address or a cached host
+  // name. Otherwise, dns_found_() is called once the DNS server answers.
+  ip_addr_t address;
+#if LWIP_TCPIP_CORE_LOCKING
+  LOCK_TCPIP_CORE();
+#endif
+  err_t err = dns_gethostbyname(this->host_.c_str(), &address, &HttpSource::dns_found_, this);
+#if LWIP_TCPIP_CORE_LOCKING
+  UNLOCK_TCPIP_CORE();
+#endif
+  if (err == ERR_OK) {
+    dns_found_(this->host_.c_str(), &address, this);
+  } else if (err != ERR_INPROGRESS) {
+    this->resolve_state_ = RESOLVE_FAILED;
+  }
+#else
+  // Elsewhere (i.e. the host tests), the lookup blocks.
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *result = nullptr;
+  if (getaddrinfo(this->host_.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+    this->resolve_state_ = RESOLVE_FAILED;
+    return;
+  }
+  this->address_ = reinterpret_cast<sockaddr_in *>(result->ai_addr)->sin_addr.s_addr;
+  freeaddrinfo(result);
+  this->resolve_state_ = RESOLVE_DONE;
+#endif
+}
+
+#ifdef USE_ESP32
+void HttpSource::dns_found_(const char *name, const ip_addr_t *address, void *arg) {
+  auto *source = static_cast<HttpSource *>(arg);
+  // The lookup of a connection that was given up in the meantime.
+  if (source->resolve_state_ != RESOLVE_PENDING) {
+    return;
+  }
+  if (address == nullptr || !IP_IS_V4(address)) {
+    source->resolve_state_ = RESOLVE_FAILED;
+    return;
+  }
+  source->address_ = ip_2_ip4(address)->addr;
+  source->resolve_state_ = RESOLVE_DONE;
+}
+#endif
+
+bool HttpSource::poll_connect_() {
+  if (millis() - this->connect_started_at_ > static_cast<uint32_t>(HTTP_CONNECT_TIMEOUT)) {
+    ESP_LOGW(TAG, "HTTP stream: connecting to %s timed out", this->host_.c_str());
+    this->close_socket_();
+    return false;
+  }
+
+  if (this->state_ == HTTP_RESOLVING) {
+    auto resolved = this->resolve_state_.load();
+    if (resolved == RESOLVE_PENDING) {
+      return true;
+    }
+    if (resolved != RESOLVE_DONE) {
+      ESP_LOGW(TAG, "HTTP stream: could not resolve %s", this->host_.c_str());
+      return false;
+    }
+    if (this->secure_) {
+      // WiFiClientSecure cannot take over a socket, so the TLS connection
+      // is made in one go. The host name is in the DNS cache by now.
+      this->secure_client_.setInsecure();
+      if (!this->secure_client_.connect(this->host_.c_str(), this->port_, HTTP_CONNECT_TIMEOUT)) {
+        return false;
+      }
+      this->client_ = &this->secure_client_;
+      this->send_request_();
+      return true;
+    }
+    return this->start_socket_();
+  }
+
+  // Poll the socket: it becomes writable once the connection is made, or
+  // once it failed.
+  fd_set writable;
+  FD_ZERO(&writable);
+  FD_SET(this->socket_, &writable);
+  timeval timeout{};
+  int ready = select(this->socket_ + 1, nullptr, &writable, nullptr, &timeout);
+  if (ready == 0) {
+    return true;
+  }
+  int error = 0;
+  socklen_t length = sizeof(error);
+  if (ready < 0 || getsockopt(this->socket_, SOL_SOCKET, SO_ERROR, &error, &length) < 0 || error != 0) {
+    ESP_LOGW(TAG, "HTTP stream: could not connect to %s: %s", this->host_.c_str(), strerror(error));
+    this->close_socket_();
+    return false;
+  }
+
+  // Like WiFiClient::connect() does, the connected socket is handed over in
+  // blocking mode. WiFiClient reads without blocking regardless.
+  fcntl(this->socket_, F_SETFL, fcntl(this->socket_, F_GETFL, 0) & ~O_NONBLOCK);
+  this->plain_client_ = WiFiClient(this->socket_);
+  this->socket_ = -1;
+  this->client_ = &this->plain_client_;
+  this->send_request_();
+  return true;
+}
+
+bool HttpSource::start_socket_() {
+  this->socket_ = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (this->socket_ < 0) {
+    ESP_LOGW(TAG, "HTTP stream: could not create a socket");
+    return false;
+  }
+  fcntl(this->socket_, F_SETFL, fcntl(this->socket_, F_GETFL, 0) | O_NONBLOCK);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(this->port_);
+  address.sin_addr.s_addr = this->address_;
+  if (::connect(this->socket_, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0 &&
+      errno != EINPROGRESS) {
+    ESP_LOGW(TAG, "HTTP stream: could not connect to %s: %s", this->host_.c_str(), strerror(errno));
+    this->close_socket_();
+    return false;
+  }
+  this->state_ = HTTP_CONNECTING;
+  return true;
+}
+
+void HttpSource::send_request_() {
+  std::string request = "GET " + this->path_ + " HTTP/1.0\r\n"
+                        "Host: " + this->host_ + "\r\n"
+                        "Icy-MetaData: 1\r\n"
+                        "User-Agent: ESPHome-VS10XX\r\n"
+                        "Connection: close\r\n\r\n";
+  this->client_->write(reinterpret_cast<const uint8_t *>(request.data()), request.size());
+
+  this->header_line_.clear();
+  this->status_code_ = 0;
+  this->has_content_length_ = false;
+  this->location_.clear();
+  this->metaint_ = 0;
+  this->last_data_at_ = millis();
+  this->state_ = HTTP_HEADERS;
+}
+
+std::string HttpSource::resolve_location_(const std::string &location) const {
+  // An absolute URL, or a URL relative to the scheme (//host/path).
+  size_t host_start = this->target_url_.find("://") + 3;
+  if (location.find("://") != std::string::npos) {
+    return location;
+  }
+  if (location.rfind("//", 0) == 0) {
+    return this->target_url_.substr(0, host_start - 2) + location;
+  }
+  // A path, relative to the host or to the directory of the current path.
+  size_t path_start = this->target_url_.find('/', host_start);
+  std::string origin = this->target_url_.substr(0, path_start);
+  if (location.rfind('/', 0) == 0) {
+    return origin + location;
+  }
+  std::string directory = "/";
+  if (path_start != std::string::npos) {
+    size_t path_end = this->target_url_.find_first_of("?#", path_start);
+    std::string path = this->target_url_.substr(path_start, path_end - path_start);
+    directory = path.substr(0, path.rfind('/') + 1);
+  }
+  return origin + directory + location;
+}
+
+void HttpSource::schedule_reconnect_(const char *reason) {
+  ESP_LOGW(TAG, "HTTP stream: %s, reconnecting in %u ms", reason, this->backoff_delay_);
+  this->close_socket_();
+  if (this->client_ != nullptr) {
+    this->client_->stop();
+  }
+  this->stats_.connection_errors++;
+  this->backoff_wait_ = this->backoff_delay_;
+  this->backoff_started_at_ = millis();
+  this->backoff_delay_ = std::min(this->backoff_delay_ * 2, this->max_reconnect_delay_);
+  this->state_ = HTTP_BACKOFF;
+}
+
+bool HttpSource::read_headers_() {
+  // The headers are small, so reading them byte by byte is fine.
+  while (this->client_->available() > 0) {
+    int c = this->client_->read();
+    if (c < 0) {
+      break;
+    }
+    this->last_data_at_ = millis();
+    if (c == '\r') {
+      continue;
+    }
+    if (c != '\n') {
+      if (this->header_line_.size() < HTTP_MAX_HEADER_LINE) {
+        this->header_line_ += static_cast<char>(c);
+      }
+      continue;
+    }
+    if (!this->header_line_.empty()) {
+      this->handle_header_(this->header_line_);
+      this->header_line_.clear();
+      continue;
+    }
+
+    // An empty line ends the headers.
+    if (this->status_code_ >= 300 && this->status_code_ < 400 && !this->location_.empty() &&
+        this->redirects_ >= HTTP_MAX_REDIRECTS) {
+      // A redirect loop will not go away by retrying either.
+      ESP_LOGE(TAG, "HTTP stream: too many redirects");
+      this->close();
+      this->state_ = HTTP_FAILED;
+    } else if (this->status_code_ >= 300 && this->status_code_ < 400 && !this->location_.empty()) {
+      this->target_url_ = this->resolve_location_(this->location_);
+      ESP_LOGD(TAG, "HTTP stream: redirected to %s", this->target_url_.c_str());
+      this->redirects_++;
+      this->client_->stop();
+      this->backoff_wait_ = 0;
+      this->state_ = HTTP_BACKOFF;
+    } else if (this->status_code_ >= 400 && this->status_code_ < 500) {
+      // Client errors (e.g. 404) will not go away by retrying.
+      ESP_LOGE(TAG, "HTTP stream: server responded with status %d", this->status_code_);
+      this->close();
+      this->state_ = HTTP_FAILED;
+    } else if (this->status_code_ != 200) {
+      ESP_LOGW(TAG, "HTTP stream: server responded with status %d", this->status_code_);
+      this->schedule_reconnect_("unexpected response");
+    } else {
+      ESP_LOGI(TAG, "HTTP stream: connected (metadata interval: %zu bytes)", this->metaint_);
+      this->stats_.connects++;
+      this->redirects_ = 0;
+      this->audio_until_metadata_ = this->metaint_;
+      this->reading_metadata_ = false;
+      this->state_ = HTTP_STREAMING;
+    }
+    return true;
+  }
+  return false;
+}
+
+void HttpSource::handle_header_(const std::string &line) {
+  // The status line looks like "HTTP/1.0 200 OK" or "ICY 200 OK".
+  if (this->status_code_ == 0) {
+    size_t space = line.find(' ');
+    this->status_code_ = space == std::string::npos ? -1 : atoi(line.c_str() + space + 1);
+    return;
+  }
+  size_t colon = line.find(':');
+  if (colon == std::string::npos) {
+    return;
+  }
+  std::string name = str_lower_case(line.substr(0, colon));
+  size_t value_start = line.find_first_not_of(' ', colon + 1);
+  std::string value = value_start == std::string::npos ? "" : line.substr(value_start);
+  if (name == "icy-metaint") {
+    this->metaint_ = atoi(value.c_str());
+  } else if (name == "content-length") {
+    this->has_content_length_ = true;
+  } else if (name == "location") {
+    this->location_ = value;
+  }
+}
+
+bool HttpSource::read_metadata_() {
+  // A metadata block starts with a length byte (the length in units of 16
+  // bytes), followed by the metadata text.
+  if (!this->reading_metadata_) {
+    if (this->client_->available() <= 0) {
+      return false;
+    }
+    int length = this->client_->read();
+    if (length < 0) {
+      return false;
+    }
+    this->metadata_size_ = length * 16;
+    this->metadata_fill_ = 0;
+    this->reading_metadata_ = true;
+  }
+  while (this->metadata_fill_ < this->metadata_size_) {
+    int available = this->client_->available();
+    if (available <= 0) {
+      return false;
+    }
+    size_t size = std::min(this->metadata_size_ - this->metadata_fill_, static_cast<size_t>(available));
+    int got = this->client_->read(reinterpret_cast<uint8_t *>(this->metadata_) + this->metadata_fill_, size);
+    if (got <= 0) {
+      return false;
+    }
+    this->metadata_fill_ += got;
+  }
+  this->reading_metadata_ = false;
+  this->audio_until_metadata_ = this->metaint_;
+  this->last_data_at_ = millis();
+  if (this->metadata_size_ > 0) {
+    this->handle_metadata_();
+  }
+  return true;
+}
+
+void HttpSource::handle_metadata_() {
+  // The metadata look like: StreamTitle='Artist - Title';StreamUrl='';
+  this->metadata_[this->metadata_size_] = '\0';
+  static const char *const TITLE_START = "StreamTitle='";
+  const char *start = strstr(this->metadata_, TITLE_START);
+  if (start == nullptr) {
+    return;
+  }
+  start += strlen(TITLE_START);
+  const char *end = strstr(start, "';");
+  std::string title = end == nullptr ? std::string(start) : std::string(start, end - start);
+  if (title != this->title_) {
+    this->title_ = title;
+    ESP_LOGD(TAG, "HTTP stream: title '%s'", this->title_.c_str());
+    this->title_callback_.call(this->title_);
+  }
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,170 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// Playing audio streams over HTTP is only compiled in when it is configured
+// using the "http_stream" option.
+#ifdef USE_VS10XX_HTTP
+
+#include "esphome/core/helpers.h"
+#include "vs10xx_source.h"
+#include <WiFiClient.h>
+#include <WiFiClientSecure.h>
+#include <atomic>
+#include <string>
+
+#ifdef USE_ESP32
+#include <lwip/ip_addr.h>
+#endif
+
+namespace esphome {
+namespace vs10xx {
+
+/// The maximum size of an ICY metadata block: the length byte times 16.
+static const size_t ICY_METADATA_MAX_SIZE = 255 * 16;
+
+enum HttpSourceState : uint8_t {
+  HTTP_CLOSED,
+  HTTP_BACKOFF,
+  HTTP_RESOLVING,
+  HTTP_CONNECTING,
+  HTTP_HEADERS,
+  HTTP_STREAMING,
+  HTTP_ENDED,
+  HTTP_FAILED,
+};
+
+/// Counters that describe how the HTTP stream went.
+struct HttpSourceStats {
+  /// The number of successful connections to the stream.
+  uint32_t connects{0};
+  /// The number of times that a connection failed or was lost.
+  uint32_t connection_errors{0};
+  /// The number of times that the stream stalled, i.e. no data were
+  /// received within the stall timeout.
+  uint32_t stalls{0};
+};
+
+/// An AudioSource that plays an HTTP audio stream, like an Icecast or
+/// Shoutcast internet radio station (MP3 or AAC).
+///
+/// The stream is read without blocking, from the main loop. Connecting does
+/// not block either: the host name is resolved and the socket connects while
+/// read() polls. The exception is the TLS handshake of an HTTPS stream,
+/// because WiFiClientSecure makes its own connection. Audio data are
+/// read from the network straight into the audio buffer of the component,
+/// which acts as the jitter buffer (see prefill_size()). ICY metadata are
+/// requested from the server and taken out of the audio data, so the
+/// decoder never sees them. The stream title is published through a
+/// callback. When the connection is lost or the stream stalls, then a new
+/// connection is made, with an exponential backoff between attempts. A
+/// redirect may use a relative location, and too many redirects fail the
+/// stream.
+///
+/// A response with a Content-Length header is a file (e.g. a text to speech
+/// announcement) rather than a live stream. For a file, the end of the
+/// connection is the end of the audio, instead of a reason to reconnect.
+///
+/// Unlike the other sources, this source uses the heap: making a connection
+/// handles the URL and the response headers as std::string. Reading the
+/// audio data does not allocate.
+class HttpSource : public AudioSource {
+ public:
+  explicit HttpSource() = default;
+  void set_url(const std::string &url) { this->url_ = url; }
+  void set_prefill_size(size_t size) { this->prefill_size_ = size; }
+  void set_reconnect_delay(uint32_t ms) { this->reconnect_delay_ = ms; }
+  void set_max_reconnect_delay(uint32_t ms) { this->max_reconnect_delay_ = ms; }
+  void set_stall_timeout(uint32_t ms) { this->stall_timeout_ = ms; }
+  void add_on_title_callback(std::function<void(const std::string &)> &&callback) {
+    this->title_callback_.add(std::move(callback));
+  }
+
+  void reset() override;
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override { return this->state_ == HTTP_ENDED || this->state_ == HTTP_FAILED; }
+  size_t prefill_size() const override { return this->prefill_size_; }
+  void close() override;
+
+  /// Counters that describe how the HTTP stream went.
+  const HttpSourceStats &get_stats() const { return this->stats_; }
+  HttpSourceState get_state() const { return this->state_; }
+
+ protected:
+  std::string url_{};
+  std::string target_url_{};
+  size_t prefill_size_{0};
+  HttpSourceState state_{HTTP_CLOSED};
+  HttpSourceStats stats_{};
+
+  // The connection. HTTPS streams are supported, but the server
+  // certificate is not verified.
+  WiFiClient plain_client_{};
+  WiFiClientSecure secure_client_{};
+  WiFiClient *client_{nullptr};
+  void connect_();
+  bool poll_connect_();
+  bool start_socket_();
+  void send_request_();
+  void close_socket_();
+  std::string resolve_location_(const std::string &location) const;
+
+  // The parts of target_url_, split by connect_().
+  bool secure_{false};
+  std::string host_{};
+  std::string path_{};
+  uint16_t port_{0};
+  uint32_t connect_started_at_{0};
+
+  // The host name is resolved asynchronously. On the ESP32, the callback of
+  // the lookup runs in the lwIP task, so the result is handed over through
+  // an atomic state. The address is an IPv4 address in network byte order.
+  enum ResolveState : uint8_t { RESOLVE_IDLE, RESOLVE_PENDING, RESOLVE_DONE, RESOLVE_FAILED };
+  std::atomic<uint8_t> resolve_state_{RESOLVE_IDLE};
+  uint32_t address_{0};
+  void start_resolve_();
+#ifdef USE_ESP32
+  static void dns_found_(const char *name, const ip_addr_t *address, void *arg);
+#endif
+
+  // The socket of a plain HTTP connection while it connects. Once it is
+  // connected, it is handed over to plain_client_.
+  int socket_{-1};
+
+  // Members that handle reconnecting.
+  uint32_t reconnect_delay_{1000};
+  uint32_t max_reconnect_delay_{60000};
+  uint32_t stall_timeout_{10000};
+  uint32_t backoff_delay_{0};
+  uint32_t backoff_started_at_{0};
+  uint32_t backoff_wait_{0};
+  uint32_t last_data_at_{0};
+  void schedule_reconnect_(const char *reason);
+
+  // Members that handle the HTTP response headers.
+  std::string header_line_{};
+  int status_code_{0};
+  bool has_content_length_{false};
+  std::string location_{};
+  uint8_t redirects_{0};
+  bool read_headers_();
+  void handle_header_(const std::string &line);
+
+  // Members that handle the ICY metadata, which are interleaved with the
+  // audio data, every metaint_ bytes.
+  size_t metaint_{0};
+  size_t audio_until_metadata_{0};
+  size_t metadata_size_{0};
+  size_t metadata_fill_{0};
+  bool reading_metadata_{false};
+  char metadata_[ICY_METADATA_MAX_SIZE + 1]{};
+  std::string title_{};
+  CallbackManager<void(const std::string &)> title_callback_{};
+  bool read_metadata_();
+  void handle_metadata_();
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,116 @@
+#include "vs10xx_media_player.h"
+
+#ifdef USE_VS10XX_ANNOUNCE
+
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+void VS10XXMediaPlayer::setup() {
+  this->state = this->device_state_();
+  this->volume = this->parent_->get_volume();
+  this->publish_state();
+}
+
+void VS10XXMediaPlayer::loop() {
+  // Playback can also change state on its own (e.g. at the end of a file),
+  // or through the actions of the component. Polling the device state is
+  // cheap, and catches all of these.
+  auto state = this->device_state_();
+  auto volume = this->parent_->get_volume();
+  if (state != this->state || volume != this->volume) {
+    this->state = state;
+    this->volume = volume;
+    this->publish_state();
+  }
+}
+
+void VS10XXMediaPlayer::dump_config() {
+  ESP_LOGCONFIG(TAG, "VS10XX media player:");
+  ESP_LOGCONFIG(TAG, "  Volume increment: %0.0f%%", this->volume_increment_ * 100.0f);
+}
+
+media_player::MediaPlayerTraits VS10XXMediaPlayer::get_traits() {
+  auto traits = media_player::MediaPlayerTraits();
+  traits.set_supports_pause(true);
+  return traits;
+}
+
+media_player::MediaPlayerState VS10XXMediaPlayer::device_state_() const {
+  if (this->parent_->is_announcing()) {
+    return media_player::MEDIA_PLAYER_STATE_ANNOUNCING;
+  }
+  if (this->parent_->is_paused()) {
+    return media_player::MEDIA_PLAYER_STATE_PAUSED;
+  }
+  switch (this->parent_->get_media_state()) {
+    case MEDIA_STARTING:
+    case MEDIA_PLAYING:
+    case MEDIA_RECOVERING:
+      return media_player::MEDIA_PLAYER_STATE_PLAYING;
+    default:
+      return media_player::MEDIA_PLAYER_STATE_IDLE;
+  }
+}
+
+void VS10XXMediaPlayer::control(const media_player::MediaPlayerCall &call) {
+  if (call.get_media_url().has_value()) {
+    auto url = call.get_media_url().value();
+    bool announcement = call.get_announcement().has_value() && call.get_announcement().value();
+#ifdef USE_VS10XX_HTTP
+    if (announcement) {
+      this->parent_->announce_url(url);
+    } else {
+      this->parent_->play_url(url);
+    }
+#else
+    ESP_LOGE(TAG, "Cannot play %s %s, this requires the http_stream option", announcement ? "announcement" : "URL",
+             url.c_str());
+#endif
+  }
+
+  if (call.get_volume().has_value()) {
+    auto volume = call.get_volume().value();
+    this->parent_->set_volume(volume, volume);
+  }
+
+  if (call.get_command().has_value()) {
+    switch (call.get_command().value()) {
+      case media_player::MEDIA_PLAYER_COMMAND_PLAY:
+        this->parent_->resume();
+        break;
+      case media_player::MEDIA_PLAYER_COMMAND_PAUSE:
+        this->parent_->pause();
+        break;
+      case media_player::MEDIA_PLAYER_COMMAND_TOGGLE:
+        if (this->parent_->is_paused()) {
+          this->parent_->resume();
+        } else {
+          this->parent_->pause();
+        }
+        break;
+      case media_player::MEDIA_PLAYER_COMMAND_STOP:
+        this->parent_->stop();
+        break;
+      case media_player::MEDIA_PLAYER_COMMAND_VOLUME_UP:
+        this->parent_->change_volume(this->volume_increment_);
+        break;
+      case media_player::MEDIA_PLAYER_COMMAND_VOLUME_DOWN:
+        this->parent_->change_volume(-this->volume_increment_);
+        break;
+      default:
+        ESP_LOGW(TAG, "Unsupported media player command");
+        break;
+    }
+  }
+
+  this->loop();
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// The media player is only compiled in when the media_player platform is
+// configured, which also enables the announcements.
+#ifdef USE_VS10XX_ANNOUNCE
+
+#include "esphome/core/component.h"
+#include "esphome/core/helpers.h"
+#include "esphome/components/media_player/media_player.h"
+#include "vs10xx.h"
+
+namespace esphome {
+namespace vs10xx {
+
+/// A media player that exposes a VS10XX device to Home Assistant.
+///
+/// Media URLs are played as HTTP streams. Announcements are played through
+/// VS10XX::announce(), which ducks and then interrupts the active audio.
+/// The state of the media player follows the state of the device, so it
+/// also reflects playback that was started in other ways (e.g. actions).
+class VS10XXMediaPlayer : public Component, public media_player::MediaPlayer, public Parented<VS10XX> {
+ public:
+  explicit VS10XXMediaPlayer() = default;
+  void set_volume_increment(float increment) { this->volume_increment_ = increment; }
+
+  void setup() override;
+  void loop() override;
+  void dump_config() override;
+
+  media_player::MediaPlayerTraits get_traits() override;
+
+ protected:
+  void control(const media_player::MediaPlayerCall &call) override;
+
+  /// Map the state of the device onto a media player state.
+  media_player::MediaPlayerState device_state_() const;
+
+  float volume_increment_{0.05f};
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -1,16 +1,29 @@
 #include "vs10xx_plugin.h"
+#include "esphome/core/hal.h"
 
 namespace esphome {
 namespace vs10xx {
 
+// DREQ goes low for a few microseconds after every SCI write. Like
+// WriteVS10xxRegister() in the example code, the next write waits for it.
+static bool write_when_ready(VS10XXHAL *hal, uint8_t addr, uint16_t value) {
+  for (int us = 0; !hal->is_ready(); us++) {
+    if (us == 1000) {
+      return false;
+    }
+    delayMicroseconds(1);
+  }
+  return hal->write_register(addr, value);
+}
+
 // Implementation based on example code provided by plugin manuals, e.g.
 // https://www.vlsi.fi/fileadmin/software/VS10XX/dacpatch.pdf
 // This code is able to translate the compressed plugin format
 // into SPI register writes.
 bool VS10XXPlugin::load(VS10XXHAL *hal) {
   size_t i = 0;
-  auto plugin = this->plugin_data_();
-  auto plugin_size = plugin.size();
+  size_t plugin_size = 0;
+  const uint16_t *plugin = this->plugin_data_(&plugin_size);
 
   while (i < plugin_size) {
     uint8_t addr = plugin[i++];
@@ -21,7 +34,7 @@ bool VS10XXPlugin::load(VS10XXHAL *hal) {
       n = n & 0x7FFF;
       uint16_t value = plugin[i++];
       while (n--) {
-        if (!hal->write_register(addr, value)) {
+        if (!write_when_ready(hal, addr, value)) {
           return false;
         }
       }
@@ -29,7 +42,7 @@ bool VS10XXPlugin::load(VS10XXHAL *hal) {
     } else {
       while (n--) {
         uint16_t value = plugin[i++];
-        if (!hal->write_register(addr, value)) {
+        if (!write_when_ready(hal, addr, value)) {
           return false;
         }
       }
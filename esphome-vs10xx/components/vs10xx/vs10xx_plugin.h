@@ -2,8 +2,6 @@
 
 #include "vs10xx_hal.h"
 
-#include <vector>
-
 namespace esphome {
 namespace vs10xx {
 
@@ -23,9 +21,11 @@ class VS10XXPlugin {
   bool load(VS10XXHAL *hal);
 
  protected:
-  /// Provide the plugin code, in compressed plugin format.
-  /// This code can be copied literally from a downloaded .plg file.
-  virtual const std::vector<uint16_t> plugin_data_() = 0;
+  /// Provide the plugin code, in compressed plugin format, and store the
+  /// number of 16 bit words in the code in size.
+  /// This code can be copied literally from a downloaded .plg file into a
+  /// static const array, so no copy of the plugin code is made at runtime.
+  virtual const uint16_t *plugin_data_(size_t *size) const = 0;
 };
 
 }  // namespace vs10xx
@@ -0,0 +1,98 @@
+#include "vs10xx_scheduler.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+void VS10XXScheduler::add_device(VS10XX *device, int priority) {
+  if (this->device_count_ >= this->devices_.size()) {
+    ESP_LOGE(TAG, "Cannot add device: maximum number of devices reached");
+    return;
+  }
+  // Insert the device after all devices with the same or a higher priority.
+  size_t pos = this->device_count_;
+  while (pos > 0 && this->devices_[pos - 1].priority < priority) {
+    this->devices_[pos] = this->devices_[pos - 1];
+    pos--;
+  }
+  this->devices_[pos] = {device, priority};
+  this->device_count_++;
+  device->set_scheduler(this);
+}
+
+void VS10XXScheduler::dump_config() {
+  ESP_LOGCONFIG(TAG, "VS10XX feed scheduler:");
+  ESP_LOGCONFIG(TAG, "  Feed loop time: %u ms", this->feed_loop_time_);
+  ESP_LOGCONFIG(TAG, "  Bus grant timeout: %u ms", this->bus_grant_timeout_);
+  for (size_t i = 0; i < this->device_count_; i++) {
+    auto &entry = this->devices_[i];
+    ESP_LOGCONFIG(TAG, "  - %s (priority %d)", entry.device->get_name().c_str(), entry.priority);
+  }
+}
+
+void VS10XXScheduler::loop() {
+  // While the bus is granted to another device, the devices play from their
+  // internal buffers.
+  if (this->is_bus_granted()) {
+    return;
+  }
+  this->feed_();
+}
+
+bool VS10XXScheduler::is_bus_granted() {
+  if (!this->granted_) {
+    return false;
+  }
+  // When the grant is held for too long, audio takes over. This is checked
+  // by whichever component asks first, so the hold time does not depend on
+  // the order of the components in the main loop.
+  if (micros() - this->granted_at_ < this->bus_grant_timeout_ * 1000) {
+    return true;
+  }
+  ESP_LOGW(TAG, "Bus grant not released within %u ms, resuming audio", this->bus_grant_timeout_);
+  this->bus_stats_.grant_timeouts++;
+  this->release_bus();
+  return false;
+}
+
+void VS10XXScheduler::feed_() {
+  // Every pass gives each device that is playing audio a turn. When a pass
+  // sends no data at all, then all devices have DREQ low (or are waiting
+  // for their audio source), and the main loop can move on.
+  auto start = millis();
+  bool sent = true;
+  while (sent && (millis() - start) < this->feed_loop_time_) {
+    sent = false;
+    for (size_t i = 0; i < this->device_count_; i++) {
+      auto *device = this->devices_[i].device;
+      if (device->is_feeding() && device->feed()) {
+        sent = true;
+      }
+    }
+  }
+}
+
+bool VS10XXScheduler::request_bus() {
+  if (this->is_bus_granted()) {
+    ESP_LOGW(TAG, "request_bus(): Bus already granted");
+    return false;
+  }
+  this->feed_();
+  this->granted_ = true;
+  this->granted_at_ = micros();
+  this->bus_stats_.grants++;
+  return true;
+}
+
+void VS10XXScheduler::release_bus() {
+  if (!this->granted_) {
+    return;
+  }
+  this->granted_ = false;
+  this->bus_stats_.other_us += micros() - this->granted_at_;
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "esphome/core/component.h"
+#include "vs10xx.h"
+#include <array>
+
+namespace esphome {
+namespace vs10xx {
+
+/// Counters that describe how the SPI bus was shared with other devices.
+struct VS10XXBusStats {
+  /// The time (in microseconds) during which the bus was granted to other
+  /// devices, using request_bus() and release_bus().
+  uint32_t other_us{0};
+  /// The number of times that the bus was granted to other devices.
+  uint32_t grants{0};
+  /// The number of grants that were not released within the grant timeout.
+  uint32_t grant_timeouts{0};
+};
+
+/// The feed scheduler sends audio data to all VS10XX devices that share the
+/// SPI bus. Instead of every device running its own busy loop (in which case
+/// the devices would starve each other), a single loop serves whichever
+/// device has DREQ high. Devices are visited in order of priority, and every
+/// visit sends at most one burst of audio data using a single SDI
+/// transaction, so no device can hold the bus for too long.
+///
+/// Other devices on the bus (e.g. a display or an SD card) can request the
+/// bus before doing a large transfer. Audio has priority: before the bus is
+/// handed over, all devices are topped up, so they can play through the
+/// transfer from their internal buffers. While the bus is granted, the
+/// devices send no SCI commands either. A grant that is not released within
+/// the grant timeout is taken back, to prevent audio from running dry.
+class VS10XXScheduler : public Component {
+ public:
+  explicit VS10XXScheduler() = default;
+  void set_feed_loop_time(uint32_t ms) { this->feed_loop_time_ = ms; }
+  void set_bus_grant_timeout(uint32_t ms) { this->bus_grant_timeout_ = ms; }
+
+  /// Add a device to the scheduler. Devices with a higher priority are
+  /// served first. Devices with the same priority are served in the order
+  /// in which they were added.
+  void add_device(VS10XX *device, int priority);
+
+  void dump_config() override;
+  void loop() override;
+
+  /// Request the bus for a transfer by another device. This tops up all
+  /// devices that are playing audio and then grants the bus. Returns false
+  /// when the bus is already granted.
+  bool request_bus();
+
+  /// Release the bus, after the transfer by the other device is done.
+  void release_bus();
+
+  /// Check if the bus is currently granted to another device. A grant that
+  /// was held for longer than the grant timeout is taken back here.
+  bool is_bus_granted();
+
+  /// Counters that describe how the bus was shared with other devices.
+  const VS10XXBusStats &get_bus_stats() const { return this->bus_stats_; }
+
+ protected:
+  struct Entry {
+    VS10XX *device;
+    int priority;
+  };
+
+  /// The devices to serve, ordered by priority. This is fixed size storage,
+  /// sized by the code generator, to prevent heap allocations.
+  std::array<Entry, VS10XX_MAX_DEVICES> devices_{};
+  size_t device_count_{0};
+
+  /// The maximum time (in milliseconds) that feeding may take, during a
+  /// single main loop iteration or a single bus request.
+  uint32_t feed_loop_time_{30};
+
+  /// Feed the devices until none of them accepts more audio data, or until
+  /// the feed loop time has passed.
+  void feed_();
+
+  // Members that keep track of bus grants to other devices.
+  uint32_t bus_grant_timeout_{50};
+  bool granted_{false};
+  uint32_t granted_at_{0};
+  VS10XXBusStats bus_stats_{};
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "esphome/components/blob/blob.h"
+#include <cstring>
+
+namespace esphome {
+namespace vs10xx {
+
+/// This interface describes a source of audio data that can be played by
+/// the VS10XX component. The audio data are pulled from the source in the
+/// main loop, so implementations must never block.
+class AudioSource {
+ public:
+  explicit AudioSource() = default;
+
+  /// Prepare the source for reading the audio data from the start.
+  virtual void reset() = 0;
+
+  /// Copy up to max_size bytes of audio data into the buffer.
+  /// Returns the number of bytes that were copied. This can be 0 when no
+  /// data are available at this time. Use at_end() to see if the end of
+  /// the audio data was reached.
+  virtual size_t read(uint8_t *buffer, size_t max_size) = 0;
+
+  /// Whether or not all audio data have been read.
+  virtual bool at_end() const = 0;
+
+  /// Move the read position to the provided byte offset from the start.
+  /// Returns false when the source does not support this.
+  virtual bool seek(size_t position) { return false; }
+
+  /// The number of bytes that must be buffered before feeding the device
+  /// starts, and again after the source could not keep up. Sources that
+  /// are subject to jitter (e.g. network streams) use this to build up a
+  /// margin. Other sources can start feeding right away.
+  virtual size_t prefill_size() const { return 0; }
+
+  /// Release the resources (e.g. a file or a connection) that are held
+  /// by the source. This is called when playback stops.
+  virtual void close() {}
+};
+
+/// An AudioSource that reads audio data from a Blob.
+class BlobSource : public AudioSource {
+ public:
+  explicit BlobSource() = default;
+  void set_blob(blob::Blob *blob) {
+    this->close();
+    this->blob_ = blob;
+  }
+
+  /// The blob is in use from the start of playback until the source is
+  /// closed, so a BlobBundle does not overwrite it while it plays.
+  void reset() override {
+    if (!this->acquired_) {
+      this->blob_->acquire();
+      this->acquired_ = true;
+    }
+    this->blob_->reset();
+  }
+
+  size_t read(uint8_t *buffer, size_t max_size) override {
+    if (!this->blob_->next_chunk(max_size)) {
+      return 0;
+    }
+    memcpy(buffer, this->blob_->chunk_start, this->blob_->chunk_size);
+    return this->blob_->chunk_size;
+  }
+
+  bool at_end() const override { return this->blob_->at_end(); }
+
+  bool seek(size_t position) override { return this->blob_->seek(position); }
+
+  void close() override {
+    if (this->acquired_) {
+      this->blob_->release();
+      this->acquired_ = false;
+    }
+  }
+
+ protected:
+  blob::Blob *blob_{nullptr};
+  bool acquired_{false};
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
@@ -0,0 +1,344 @@
+#include "vs10xx_sync.h"
+
+#ifdef USE_VS10XX_SYNC
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/components/network/util.h"
+#include <cstdlib>
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+// The marker and version at the start of every message.
+static const uint32_t SYNC_MAGIC = 0x4E595356;  // "VSYN"
+static const uint8_t SYNC_VERSION = 2;
+
+// The interval (in milliseconds) at which the leader sends clock messages,
+// and at which followers ping the leader.
+static const uint32_t SYNC_SEND_INTERVAL = 250;
+
+// The number of pings over which the shortest round trip is determined.
+static const uint8_t SYNC_CLOCK_WINDOW = 8;
+
+// The time (in microseconds) that a follower holds the start of a stream,
+// while it waits for the schedule of the leader. After that, it starts on
+// its own, and the anchors correct the offset.
+static const uint32_t SYNC_START_TIMEOUT_US = 500000;
+
+// The maximum distance (in seconds) between the scheduled start of the
+// leader and the first packet of a follower, for both to belong to the
+// same stream.
+static const uint32_t SYNC_MAX_START_DISTANCE = 5;
+
+// The time (in milliseconds) to wait after a large correction, before the
+// offset is measured again.
+static const uint32_t SYNC_SETTLE_TIME = 2000;
+
+// The maximum time (in microseconds) between the anchor of a follower and
+// the anchor of the leader that it is compared to.
+static const int32_t SYNC_MAX_ANCHOR_DISTANCE_US = 5000000;
+
+// The maximum number of messages that are received per loop.
+static const uint8_t SYNC_MAX_MESSAGES_PER_LOOP = 8;
+
+// The time (in milliseconds) to wait before retrying to open the socket.
+static const uint32_t SYNC_LISTEN_RETRY_INTERVAL = 5000;
+
+enum SyncMessageType : uint8_t {
+  /// The clock of the leader, its schedule and its most recent anchor. The
+  /// leader multicasts these to the followers.
+  SYNC_CLOCK,
+  /// A follower asks the leader for its clock.
+  SYNC_PING,
+  /// The answer of the leader to a ping, which is multicast too.
+  SYNC_PONG,
+};
+
+/// The message that is exchanged between the leader and the followers. All
+/// devices run the same firmware on the same architecture, so the fields
+/// are in host order.
+struct SyncMessage {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t type;
+  uint8_t has_anchor;
+  uint8_t has_start;
+  /// The clock of the sender at the time of sending.
+  uint32_t sent_at_us;
+  /// The most recent anchor of the leader.
+  uint32_t anchor_ssrc;
+  uint32_t anchor_rtp;
+  uint32_t anchor_at_us;
+  /// The scheduled start of the current stream of the leader.
+  uint32_t start_ssrc;
+  uint32_t start_rtp;
+  uint32_t start_at_us;
+  /// For a ping and its answer: the follower that sent the ping, the
+  /// clock of the follower when it sent the ping, and the clock of the
+  /// leader when it received the ping.
+  uint32_t follower_id;
+  uint32_t ping_sent_at_us;
+  uint32_t ping_received_at_us;
+} __attribute__((packed));
+
+void VS10XXSync::loop() {
+  if (!this->listening_) {
+    if (!network::is_connected() ||
+        (this->listen_failed_at_ != 0 && millis() - this->listen_failed_at_ < SYNC_LISTEN_RETRY_INTERVAL)) {
+      return;
+    }
+    if (this->is_leader()) {
+      this->listening_ = this->udp_.begin(this->port_);
+    } else {
+      this->listening_ = this->udp_.beginMulticast(this->address_, this->port_);
+      this->id_ = random_uint32();
+    }
+    if (!this->listening_) {
+      ESP_LOGW(TAG, "Could not open the socket for synchronized playback");
+      this->listen_failed_at_ = millis();
+      return;
+    }
+    ESP_LOGD(TAG, "Synchronizing playback as %s on UDP port %u", this->is_leader() ? "leader" : "follower",
+             this->port_);
+  }
+
+  this->receive_();
+  if (millis() - this->sent_at_ < SYNC_SEND_INTERVAL) {
+    return;
+  }
+  if (this->is_leader()) {
+    this->send_clock_();
+  } else if (this->has_leader_address_) {
+    this->send_ping_();
+  }
+}
+
+void VS10XXSync::reset() {
+  this->has_anchor_ = false;
+  this->has_offset_ = false;
+  this->settle_until_ = millis();
+  this->stats_.offset_us = 0;
+  // The schedule of a follower is the one of the leader, which does not
+  // depend on the local playback.
+  if (this->is_leader()) {
+    this->has_start_ = false;
+  }
+}
+
+void VS10XXSync::start_stream() {
+  if (this->source_ == nullptr) {
+    return;
+  }
+  if (this->is_leader()) {
+    this->has_start_ = true;
+    this->start_ssrc_ = this->source_->get_ssrc();
+    this->start_rtp_ = this->source_->get_first_timestamp();
+    // The largest playout delay leaves the followers the most time to
+    // receive the relayed stream and the schedule, while it still fits in
+    // the jitter buffer.
+    this->start_at_us_ = micros() + this->source_->get_max_delay_us();
+    this->source_->schedule_start(this->start_at_us_, this->start_rtp_);
+    this->stats_.scheduled_starts++;
+    // The followers need the schedule before the start.
+    if (this->listening_) {
+      this->send_clock_();
+    }
+    return;
+  }
+  this->start_applied_ = false;
+  this->source_->hold(micros() + SYNC_START_TIMEOUT_US);
+  this->apply_start_();
+}
+
+void VS10XXSync::apply_start_() {
+  if (this->source_ == nullptr || !this->has_start_ || !this->has_clock_ || !this->source_->is_start_pending() ||
+      this->start_ssrc_ != this->source_->get_ssrc()) {
+    return;
+  }
+  // A sender can start a new stream with the same SSRC, so the schedule
+  // must also be near the stream on the RTP timeline.
+  auto distance = static_cast<int32_t>(this->source_->get_first_timestamp() - this->start_rtp_);
+  if (static_cast<uint32_t>(std::abs(distance)) > SYNC_MAX_START_DISTANCE * this->source_->get_sample_rate()) {
+    return;
+  }
+  this->source_->schedule_start(this->start_at_us_ + this->clock_offset_us_, this->start_rtp_);
+  if (!this->start_applied_) {
+    this->start_applied_ = true;
+    this->stats_.scheduled_starts++;
+  }
+}
+
+void VS10XXSync::send_clock_() {
+  SyncMessage message{};
+  message.magic = SYNC_MAGIC;
+  message.version = SYNC_VERSION;
+  message.type = SYNC_CLOCK;
+  message.has_anchor = this->has_anchor_;
+  message.anchor_ssrc = this->anchor_ssrc_;
+  message.anchor_rtp = this->anchor_rtp_;
+  message.anchor_at_us = this->anchor_at_us_;
+  message.has_start = this->has_start_;
+  message.start_ssrc = this->start_ssrc_;
+  message.start_rtp = this->start_rtp_;
+  message.start_at_us = this->start_at_us_;
+  message.sent_at_us = micros();
+  this->udp_.beginPacket(this->address_, this->port_);
+  this->udp_.write(reinterpret_cast<const uint8_t *>(&message), sizeof(message));
+  this->udp_.endPacket();
+  this->sent_at_ = millis();
+  this->stats_.messages++;
+}
+
+void VS10XXSync::send_ping_() {
+  SyncMessage message{};
+  message.magic = SYNC_MAGIC;
+  message.version = SYNC_VERSION;
+  message.type = SYNC_PING;
+  message.follower_id = this->id_;
+  message.sent_at_us = micros();
+  this->udp_.beginPacket(this->leader_address_, this->port_);
+  this->udp_.write(reinterpret_cast<const uint8_t *>(&message), sizeof(message));
+  this->udp_.endPacket();
+  this->sent_at_ = millis();
+  this->stats_.pings++;
+}
+
+void VS10XXSync::receive_() {
+  for (uint8_t i = 0; i < SYNC_MAX_MESSAGES_PER_LOOP; i++) {
+    if (this->udp_.parsePacket() <= 0) {
+      break;
+    }
+    auto received_at = micros();
+    SyncMessage message;
+    if (this->udp_.read(reinterpret_cast<uint8_t *>(&message), sizeof(message)) != sizeof(message) ||
+        message.magic != SYNC_MAGIC || message.version != SYNC_VERSION) {
+      continue;
+    }
+
+    if (this->is_leader()) {
+      if (message.type != SYNC_PING) {
+        continue;
+      }
+      // The answer is multicast, so the follower needs no port of its own.
+      message.type = SYNC_PONG;
+      message.ping_sent_at_us = message.sent_at_us;
+      message.ping_received_at_us = received_at;
+      message.sent_at_us = micros();
+      this->udp_.beginPacket(this->address_, this->port_);
+      this->udp_.write(reinterpret_cast<const uint8_t *>(&message), sizeof(message));
+      this->udp_.endPacket();
+      this->stats_.pings++;
+      continue;
+    }
+
+    if (message.type == SYNC_PONG) {
+      if (message.follower_id == this->id_) {
+        this->measure_clock_(message.ping_sent_at_us, message.ping_received_at_us, message.sent_at_us, received_at);
+      }
+      continue;
+    }
+    if (message.type != SYNC_CLOCK) {
+      continue;
+    }
+    this->stats_.messages++;
+    this->has_leader_address_ = true;
+    this->leader_address_ = this->udp_.remoteIP();
+    if (message.has_anchor) {
+      this->has_leader_anchor_ = true;
+      this->leader_ssrc_ = message.anchor_ssrc;
+      this->leader_rtp_ = message.anchor_rtp;
+      this->leader_at_us_ = message.anchor_at_us;
+    }
+    if (message.has_start) {
+      this->has_start_ = true;
+      this->start_ssrc_ = message.start_ssrc;
+      this->start_rtp_ = message.start_rtp;
+      this->start_at_us_ = message.start_at_us;
+      this->apply_start_();
+    }
+  }
+}
+
+void VS10XXSync::measure_clock_(uint32_t sent_at, uint32_t leader_received_at, uint32_t leader_sent_at,
+                                uint32_t received_at) {
+  // The time that the ping and its answer spent on the network. The time
+  // that the leader took to answer does not count.
+  auto round_trip = (received_at - sent_at) - (leader_sent_at - leader_received_at);
+  if (static_cast<int32_t>(round_trip) < 0) {
+    return;
+  }
+  // Both ways are assumed to take equally long, like NTP does. The offset
+  // is the local clock minus the clock of the leader.
+  auto to_leader = sent_at - leader_received_at;
+  auto from_leader = received_at - leader_sent_at;
+  uint32_t offset = to_leader + static_cast<int32_t>(from_leader - to_leader) / 2;
+
+  // The shortest round trip has the least delay in it, so it gives the
+  // most accurate offset.
+  if (this->window_count_ == 0 || round_trip < this->window_round_trip_us_) {
+    this->window_round_trip_us_ = round_trip;
+    this->window_offset_us_ = offset;
+  }
+  this->window_count_++;
+  // The first measurement is used right away, so a schedule can be applied
+  // soon after startup.
+  if (this->window_count_ < SYNC_CLOCK_WINDOW && this->has_clock_) {
+    return;
+  }
+  this->clock_offset_us_ = this->window_offset_us_;
+  this->stats_.round_trip_us = this->window_round_trip_us_;
+  this->has_clock_ = true;
+  if (this->window_count_ >= SYNC_CLOCK_WINDOW) {
+    this->window_count_ = 0;
+  }
+  this->apply_start_();
+}
+
+void VS10XXSync::add_anchor(uint32_t at_us, uint32_t frame) {
+  auto *source = this->source_;
+  if (source == nullptr) {
+    return;
+  }
+  this->has_anchor_ = true;
+  this->anchor_ssrc_ = source->get_ssrc();
+  this->anchor_rtp_ = source->get_rtp_timestamp(frame);
+  this->anchor_at_us_ = at_us;
+  if (this->is_leader() || !this->has_clock_ || !this->has_leader_anchor_ ||
+      this->leader_ssrc_ != this->anchor_ssrc_ || static_cast<int32_t>(millis() - this->settle_until_) < 0) {
+    return;
+  }
+
+  // Compute what the leader played at the time of this anchor.
+  auto elapsed_us = static_cast<int32_t>(at_us - (this->leader_at_us_ + this->clock_offset_us_));
+  if (std::abs(elapsed_us) > SYNC_MAX_ANCHOR_DISTANCE_US) {
+    return;
+  }
+  auto rate = source->get_sample_rate();
+  auto leader_rtp = this->leader_rtp_ + static_cast<int32_t>(static_cast<int64_t>(elapsed_us) * rate / 1000000);
+  auto offset = static_cast<int32_t>(this->anchor_rtp_ - leader_rtp);
+  this->stats_.offset_us = static_cast<int64_t>(offset) * 1000000 / rate;
+  this->stats_.measurements++;
+  this->has_offset_ = true;
+  ESP_LOGV(TAG, "Offset from the leader: %0.1f ms", this->stats_.offset_us / 1000.0f);
+
+  if (static_cast<uint32_t>(std::abs(this->stats_.offset_us)) <= this->tolerance_us_) {
+    source->set_correction(0);
+    return;
+  }
+  // Playing ahead of the leader is corrected by delaying, and vice versa.
+  source->set_correction(-offset);
+  if (static_cast<uint32_t>(std::abs(offset)) > source->get_packet_samples()) {
+    ESP_LOGD(TAG, "Correcting an offset of %0.1f ms from the leader", this->stats_.offset_us / 1000.0f);
+    this->stats_.jumps++;
+    this->settle_until_ = millis() + SYNC_SETTLE_TIME;
+  }
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
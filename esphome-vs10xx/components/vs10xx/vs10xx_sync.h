@@ -0,0 +1,174 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// Synchronized playback is only compiled in when it is configured using
+// the "sync" option.
+#ifdef USE_VS10XX_SYNC
+
+#include "vs10xx_udp_source.h"
+#include <WiFiUdp.h>
+#include <string>
+
+namespace esphome {
+namespace vs10xx {
+
+enum SyncRole : uint8_t {
+  SYNC_LEADER,
+  SYNC_FOLLOWER,
+};
+
+/// Counters that describe the synchronization with the leader.
+struct VS10XXSyncStats {
+  /// The number of clock messages that were sent (leader) or received
+  /// (follower).
+  uint32_t messages{0};
+  /// The number of pings that were answered (leader) or sent (follower).
+  uint32_t pings{0};
+  /// The number of times that the offset from the leader was measured.
+  uint32_t measurements{0};
+  /// The number of times that the offset was too large to be corrected
+  /// gradually, and was corrected at once.
+  uint32_t jumps{0};
+  /// The number of streams of which the start was scheduled (leader), or
+  /// that started on the schedule of the leader (follower).
+  uint32_t scheduled_starts{0};
+  /// The most recently measured offset (in microseconds) from the leader.
+  /// This is positive when this device plays ahead of the leader.
+  int32_t offset_us{0};
+  /// The round trip time (in microseconds) of the ping that the clock
+  /// offset is based on.
+  uint32_t round_trip_us{0};
+};
+
+/// Synchronizes the playback of a UDP stream over multiple devices.
+///
+/// All devices play the same RTP stream, which the leader relays to a
+/// multicast group (see UdpSource). The leader multicasts clock messages
+/// a few times per second.
+///
+/// Followers measure the offset between their clock and the clock of the
+/// leader by pinging it. The leader answers with the time at which it
+/// received the ping, and the time of its answer. Like NTP does, half of
+/// the round trip time is taken as the delay of the answer. The ping with
+/// the shortest round trip over a window is used, since that one has the
+/// least network and scheduling delay in it. The answers are multicast, so
+/// followers need no port of their own; a follower recognizes its own
+/// answers by a random identifier.
+///
+/// The leader schedules the start of every stream: the first frame plays
+/// out the maximum playout delay after the stream arrived. The schedule is part of the
+/// clock messages. Followers hold the start of the stream until they know
+/// the schedule, and then start in their own clock. The start is the moment
+/// at which the first frame is read from the jitter buffer. The devices
+/// buffer the same amount of audio after that, so they start playing
+/// within a few milliseconds of each other.
+///
+/// After that, every device records anchors: the moment at which
+/// SCI_DECODE_TIME ticks to the next second. At that moment, the decoder
+/// has played exactly that many seconds of audio, which maps onto the RTP
+/// timeline of the stream. The leader sends its most recent anchor with
+/// its clock messages. Followers compare their own anchors to the anchors
+/// of the leader, and correct the offset by inserting or dropping frames.
+class VS10XXSync {
+ public:
+  explicit VS10XXSync() = default;
+  void set_role(SyncRole role) { this->role_ = role; }
+  void set_address(const std::string &address) { this->address_.fromString(address.c_str()); }
+  void set_port(uint16_t port) { this->port_ = port; }
+  void set_tolerance(uint32_t us) { this->tolerance_us_ = us; }
+  /// The source that plays the synchronized stream.
+  void set_source(UdpSource *source) { this->source_ = source; }
+
+  bool is_leader() const { return this->role_ == SYNC_LEADER; }
+
+  /// Send and receive clock messages and pings. This must be called from
+  /// the main loop.
+  void loop();
+
+  /// Forget the anchors. This must be called when new audio starts.
+  void reset();
+
+  /// Schedule (leader) or hold (follower) the start of the stream of the
+  /// source. This must be called after reset(), when the stream starts to
+  /// play, before audio data are read from the source.
+  void start_stream();
+
+  /// Record an anchor: at the local time at_us, the decoder finished
+  /// playing the provided frame of the stream of the source. For a
+  /// follower, this measures and corrects the offset from the leader.
+  void add_anchor(uint32_t at_us, uint32_t frame);
+
+  /// Check if the offset from the leader has been measured for the
+  /// current stream.
+  bool has_offset() const { return this->has_offset_; }
+
+  /// Check if the offset between the clock of the leader and the local
+  /// clock is known, and get it: the local time minus the time of the
+  /// leader, in microseconds.
+  bool has_clock() const { return this->has_clock_; }
+  uint32_t get_clock_offset_us() const { return this->clock_offset_us_; }
+
+  /// Counters that describe the synchronization with the leader.
+  const VS10XXSyncStats &get_stats() const { return this->stats_; }
+
+ protected:
+  SyncRole role_{SYNC_FOLLOWER};
+  IPAddress address_{};
+  uint16_t port_{5005};
+  uint32_t tolerance_us_{2000};
+  UdpSource *source_{nullptr};
+  WiFiUDP udp_{};
+  bool listening_{false};
+  uint32_t listen_failed_at_{0};
+  uint32_t sent_at_{0};
+  VS10XXSyncStats stats_{};
+  bool has_offset_{false};
+  void send_clock_();
+  void send_ping_();
+  void receive_();
+
+  // The most recent anchor of this device, as an RTP timestamp and the
+  // local time at which it was played.
+  bool has_anchor_{false};
+  uint32_t anchor_ssrc_{0};
+  uint32_t anchor_rtp_{0};
+  uint32_t anchor_at_us_{0};
+
+  // The scheduled start of the current stream. For a follower, this is
+  // the schedule of the leader, in the clock of the leader.
+  bool has_start_{false};
+  uint32_t start_ssrc_{0};
+  uint32_t start_rtp_{0};
+  uint32_t start_at_us_{0};
+  bool start_applied_{false};
+  void apply_start_();
+
+  // The most recent anchor of the leader, with the time in the clock of
+  // the leader.
+  bool has_leader_anchor_{false};
+  uint32_t leader_ssrc_{0};
+  uint32_t leader_rtp_{0};
+  uint32_t leader_at_us_{0};
+
+  // Members that track the offset between the clock of the leader and the
+  // local clock, from the pings with the shortest round trip.
+  uint32_t id_{0};
+  bool has_leader_address_{false};
+  IPAddress leader_address_{};
+  bool has_clock_{false};
+  uint32_t clock_offset_us_{0};
+  uint32_t window_offset_us_{0};
+  uint32_t window_round_trip_us_{0};
+  uint8_t window_count_{0};
+  void measure_clock_(uint32_t sent_at, uint32_t leader_received_at, uint32_t leader_sent_at, uint32_t received_at);
+
+  // After a large correction, the audio that was already buffered before
+  // the correction must play out, before the offset is measured again.
+  uint32_t settle_until_{0};
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
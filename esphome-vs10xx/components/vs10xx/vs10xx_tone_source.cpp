@@ -0,0 +1,165 @@
+#include "vs10xx_tone_source.h"
+
+#ifdef USE_VS10XX_TONES
+
+#include "esphome/core/helpers.h"
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace vs10xx {
+
+// A full period of a sine, in 256 steps. Values in between are linearly
+// interpolated, which keeps the error within a few LSB (about -80 dB).
+static const int16_t SINE_TABLE[256] = {
+    0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179,
+    7962, 8739, 9512, 10278, 11039, 11793, 12539, 13279, 14010, 14732,
+    15446, 16151, 16846, 17530, 18204, 18868, 19519, 20159, 20787, 21403,
+    22005, 22594, 23170, 23731, 24279, 24811, 25329, 25832, 26319, 26790,
+    27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956, 30273, 30571,
+    30852, 31113, 31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521,
+    32609, 32678, 32728, 32757, 32767, 32757, 32728, 32678, 32609, 32521,
+    32412, 32285, 32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571,
+    30273, 29956, 29621, 29268, 28898, 28510, 28105, 27683, 27245, 26790,
+    26319, 25832, 25329, 24811, 24279, 23731, 23170, 22594, 22005, 21403,
+    20787, 20159, 19519, 18868, 18204, 17530, 16846, 16151, 15446, 14732,
+    14010, 13279, 12539, 11793, 11039, 10278, 9512, 8739, 7962, 7179,
+    6393, 5602, 4808, 4011, 3212, 2410, 1608, 804, 0, -804,
+    -1608, -2410, -3212, -4011, -4808, -5602, -6393, -7179, -7962, -8739,
+    -9512, -10278, -11039, -11793, -12539, -13279, -14010, -14732, -15446, -16151,
+    -16846, -17530, -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+    -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790, -27245, -27683,
+    -28105, -28510, -28898, -29268, -29621, -29956, -30273, -30571, -30852, -31113,
+    -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678,
+    -32728, -32757, -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+    -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571, -30273, -29956,
+    -29621, -29268, -28898, -28510, -28105, -27683, -27245, -26790, -26319, -25832,
+    -25329, -24811, -24279, -23731, -23170, -22594, -22005, -21403, -20787, -20159,
+    -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+    -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179, -6393, -5602,
+    -4808, -4011, -3212, -2410, -1608, -804,
+};
+
+// The scale of the envelope gain (Q15) in the reciprocals of the attack
+// and release durations, which are Q16 fractions.
+static const uint32_t ENVELOPE_ONE = 1 << 15;
+
+static inline int32_t sine_at(uint32_t phase) {
+  uint8_t index = phase >> 24;
+  int32_t fraction = (phase >> 8) & 0xFFFF;
+  int32_t a = SINE_TABLE[index];
+  int32_t b = SINE_TABLE[static_cast<uint8_t>(index + 1)];
+  return a + (((b - a) * fraction) >> 16);
+}
+
+void ToneSource::reset() {
+  write_wav_header(this->header_, this->sample_rate_, this->channels_, WAV_STREAMING_SIZE);
+  this->header_offset_ = 0;
+  this->played_ = 0;
+  this->finished_ = this->steps_.empty();
+  if (!this->finished_) {
+    this->start_step_(0);
+  }
+}
+
+bool ToneSource::at_end() const { return this->finished_ && this->header_offset_ >= WAV_HEADER_SIZE; }
+
+size_t ToneSource::read(uint8_t *buffer, size_t max_size) {
+  size_t size = 0;
+  if (this->header_offset_ < WAV_HEADER_SIZE) {
+    size = std::min(max_size, WAV_HEADER_SIZE - this->header_offset_);
+    memcpy(buffer, this->header_ + this->header_offset_, size);
+    this->header_offset_ += size;
+  }
+
+  // Only whole frames are produced, so the channels never get swapped.
+  const size_t frame_size = this->channels_ * 2;
+  while (!this->finished_ && max_size - size >= frame_size) {
+    if (this->frame_ >= this->step_frames_) {
+      this->next_step_();
+      continue;
+    }
+    uint32_t frames = std::min<uint32_t>((max_size - size) / frame_size, this->step_frames_ - this->frame_);
+    this->render_(buffer + size, frames);
+    size += frames * frame_size;
+  }
+  return size;
+}
+
+uint32_t ToneSource::phase_step_for_(uint16_t frequency) const {
+  return static_cast<uint32_t>((uint64_t(frequency) << 32) / this->sample_rate_);
+}
+
+void ToneSource::start_step_(size_t index) {
+  const auto &step = this->steps_[index];
+  this->step_index_ = index;
+  this->frame_ = 0;
+  this->tone_frames_ = uint64_t(step.duration) * this->sample_rate_ / 1000;
+  this->step_frames_ = this->tone_frames_ + uint64_t(step.pause) * this->sample_rate_ / 1000;
+
+  // Every tone starts at phase 0, so every repeat sounds exactly the same.
+  this->waveform_ = step.waveform;
+  this->phase_ = 0;
+  this->phase_step_ = this->phase_step_for_(step.frequency);
+  this->phase_step_delta_ = 0;
+  if (step.waveform == TONE_SWEEP && this->tone_frames_ > 0) {
+    int64_t distance = int64_t(this->phase_step_for_(step.end_frequency)) - this->phase_step_;
+    this->phase_step_delta_ = distance / int64_t(this->tone_frames_);
+  }
+  this->volume_q15_ = static_cast<int32_t>(clamp(step.volume, 0.0f, 1.0f) * (ENVELOPE_ONE - 1));
+
+  // The fades are at most half of the tone each, so they never overlap.
+  this->attack_frames_ = std::min<uint32_t>(uint64_t(step.attack) * this->sample_rate_ / 1000, this->tone_frames_ / 2);
+  this->release_frames_ = std::min<uint32_t>(uint64_t(step.release) * this->sample_rate_ / 1000, this->tone_frames_ / 2);
+  this->attack_scale_ = this->attack_frames_ == 0 ? 0 : (ENVELOPE_ONE << 16) / this->attack_frames_;
+  this->release_scale_ = this->release_frames_ == 0 ? 0 : (ENVELOPE_ONE << 16) / this->release_frames_;
+}
+
+void ToneSource::next_step_() {
+  size_t index = this->step_index_ + 1;
+  if (index >= this->steps_.size()) {
+    this->played_++;
+    if (this->repeat_ != 0 && this->played_ >= this->repeat_) {
+      this->finished_ = true;
+      return;
+    }
+    index = 0;
+  }
+  this->start_step_(index);
+}
+
+void ToneSource::render_(uint8_t *buffer, uint32_t frames) {
+  for (uint32_t i = 0; i < frames; i++, this->frame_++) {
+    int32_t sample = 0;
+    if (this->frame_ < this->tone_frames_) {
+      int32_t value;
+      if (this->waveform_ == TONE_SQUARE) {
+        value = (this->phase_ & 0x80000000UL) ? -32767 : 32767;
+      } else {
+        value = sine_at(this->phase_);
+      }
+      this->phase_ += this->phase_step_;
+      this->phase_step_ += this->phase_step_delta_;
+
+      uint32_t envelope = ENVELOPE_ONE;
+      if (this->frame_ < this->attack_frames_) {
+        envelope = (this->frame_ * this->attack_scale_) >> 16;
+      }
+      uint32_t remaining = this->tone_frames_ - this->frame_;
+      if (remaining < this->release_frames_) {
+        envelope = std::min(envelope, (remaining * this->release_scale_) >> 16);
+      }
+      int32_t gain = (this->volume_q15_ * static_cast<int32_t>(envelope)) >> 15;
+      sample = (value * gain) >> 15;
+    }
+    for (uint8_t c = 0; c < this->channels_; c++) {
+      *buffer++ = sample & 0xFF;
+      *buffer++ = (sample >> 8) & 0xFF;
+    }
+  }
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// Tone generators are only compiled in when they are configured using the
+// "tones" option.
+#ifdef USE_VS10XX_TONES
+
+#include "vs10xx_format.h"
+#include "vs10xx_source.h"
+#include <vector>
+
+namespace esphome {
+namespace vs10xx {
+
+enum ToneWaveform : uint8_t {
+  TONE_SINE,
+  TONE_SQUARE,
+  /// A sine that glides linearly from the frequency to the end frequency.
+  TONE_SWEEP,
+};
+
+/// A step in a tone pattern: a tone, followed by a pause.
+struct ToneStep {
+  ToneWaveform waveform;
+  /// The frequency (in Hz) of the tone.
+  uint16_t frequency;
+  /// The frequency (in Hz) at the end of the tone, for TONE_SWEEP.
+  uint16_t end_frequency;
+  /// The duration (in ms) of the tone, including the envelope.
+  uint16_t duration;
+  /// The duration (in ms) of the silence after the tone.
+  uint16_t pause;
+  /// The durations (in ms) of the linear fade in and fade out.
+  uint16_t attack;
+  uint16_t release;
+  /// The volume of the tone, from 0.0 to 1.0.
+  float volume;
+};
+
+/// An AudioSource that synthesizes a pattern of tones (e.g. an alarm or a
+/// doorbell chime), so no audio has to be stored in flash.
+///
+/// The tones are generated on the fly, chunk by chunk as the device is
+/// fed, as a 16 bit PCM WAV stream. The oscillator is a fixed-point phase
+/// accumulator, which looks up the waveform in a sine table with linear
+/// interpolation. The envelope and volume are applied in fixed-point as
+/// well, so there is no floating point math in the sample loop.
+///
+/// The pattern can be repeated a number of times, or until playback is
+/// stopped.
+class ToneSource : public AudioSource {
+ public:
+  explicit ToneSource() = default;
+  void set_sample_rate(uint32_t sample_rate) { this->sample_rate_ = sample_rate; }
+  void set_channels(uint8_t channels) { this->channels_ = channels; }
+  /// The number of times to play the pattern, or 0 to play it until
+  /// playback is stopped.
+  void set_repeat(uint16_t repeat) { this->repeat_ = repeat; }
+  void add_step(ToneStep step) { this->steps_.push_back(step); }
+
+  void reset() override;
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override;
+
+ protected:
+  uint32_t sample_rate_{22050};
+  uint8_t channels_{1};
+  uint16_t repeat_{1};
+  std::vector<ToneStep> steps_;
+
+  uint8_t header_[WAV_HEADER_SIZE]{};
+  size_t header_offset_{WAV_HEADER_SIZE};
+  bool finished_{true};
+  uint16_t played_{0};
+
+  // The step that is being played, with its length in frames. The frames
+  // of the tone are followed by the frames of the pause.
+  size_t step_index_{0};
+  uint32_t frame_{0};
+  uint32_t tone_frames_{0};
+  uint32_t step_frames_{0};
+  void start_step_(size_t index);
+  void next_step_();
+
+  // The oscillator and the envelope, in fixed-point. The phase wraps at
+  // 2^32 for a full period. Gains are Q15.
+  ToneWaveform waveform_{TONE_SINE};
+  uint32_t phase_{0};
+  uint32_t phase_step_{0};
+  int32_t phase_step_delta_{0};
+  int32_t volume_q15_{0};
+  uint32_t attack_frames_{0};
+  uint32_t release_frames_{0};
+  uint32_t attack_scale_{0};
+  uint32_t release_scale_{0};
+  void render_(uint8_t *buffer, uint32_t frames);
+  uint32_t phase_step_for_(uint16_t frequency) const;
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
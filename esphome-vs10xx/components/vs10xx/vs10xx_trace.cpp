@@ -0,0 +1,57 @@
+#include "vs10xx_trace.h"
+
+#ifdef USE_VS10XX_TRACE
+
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+#include <cstdio>
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+// The number of records per log line. Log lines must stay well within the
+// logger's buffer size.
+static const size_t RECORDS_PER_LINE = 8;
+
+VS10XXTrace global_vs10xx_trace;  // NOLINT
+
+void VS10XXTrace::record(TraceEvent event, uint8_t arg8, uint16_t arg16) {
+  auto head = this->head_.load(std::memory_order_relaxed);
+  auto &record = this->records_[head % VS10XX_TRACE_SIZE];
+  record.cycles = arch_get_cpu_cycle_count();
+  record.event = event;
+  record.arg8 = arg8;
+  record.arg16 = arg16;
+  this->head_.store(head + 1, std::memory_order_release);
+}
+
+void VS10XXTrace::dump() {
+  auto head = this->head_.load(std::memory_order_acquire);
+  auto count = head < VS10XX_TRACE_SIZE ? head : VS10XX_TRACE_SIZE;
+
+  ESP_LOGI(TAG, "trace-begin freq=%u records=%u", arch_get_cpu_freq_hz(), count);
+  char line[RECORDS_PER_LINE * sizeof(VS10XXTraceRecord) * 2 + 1];
+  size_t pos = 0;
+  for (uint32_t i = head - count; i != head; i++) {
+    auto *bytes = reinterpret_cast<const uint8_t *>(&this->records_[i % VS10XX_TRACE_SIZE]);
+    for (size_t b = 0; b < sizeof(VS10XXTraceRecord); b++) {
+      snprintf(line + pos, 3, "%02x", bytes[b]);
+      pos += 2;
+    }
+    if (pos == sizeof(line) - 1) {
+      ESP_LOGI(TAG, "trace: %s", line);
+      pos = 0;
+    }
+  }
+  if (pos > 0) {
+    ESP_LOGI(TAG, "trace: %s", line);
+  }
+  ESP_LOGI(TAG, "trace-end");
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// The trace facility records binary events from the audio hot path into a
+// fixed size ring buffer. It is only compiled in when the "trace_size"
+// option is configured. Otherwise, VS10XX_TRACE() expands to nothing.
+#ifdef USE_VS10XX_TRACE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace vs10xx {
+
+/// Event types that are recorded in the trace.
+/// Keep these in sync with the trace decoder in tools/vs10xx_trace.py.
+enum TraceEvent : uint8_t {
+  TRACE_DEVICE_STATE = 1,    // arg8 = DeviceState
+  TRACE_MEDIA_STATE = 2,     // arg8 = MediaState
+  TRACE_CHUNK_SENT = 3,      // arg16 = number of bytes
+  TRACE_DREQ_LOW = 4,        // start waiting for DREQ
+  TRACE_DREQ_HIGH = 5,       // done waiting for DREQ
+  TRACE_UNDERRUN = 6,        // no data available while DREQ is high
+  TRACE_SCI_WRITE = 7,       // arg8 = register, arg16 = value
+  TRACE_SCI_WRITE_SKIP = 8,  // arg8 = register, arg16 = value
+  TRACE_SCI_READ = 9,        // arg8 = register, arg16 = value
+  TRACE_SCI_READ_SHADOW = 10,  // arg8 = register, arg16 = value
+  TRACE_PREFS_SYNC = 11,     // arg8 = PreferencesChangeBits
+  TRACE_PREFS_STORE = 12,    // arg16 = 1 when written, 0 when coalesced
+  TRACE_RECOVERY = 13,       // arg8 = RecoveryStage
+};
+
+/// A single trace record. The timestamp is the CPU cycle counter.
+struct VS10XXTraceRecord {
+  uint32_t cycles;
+  uint8_t event;
+  uint8_t arg8;
+  uint16_t arg16;
+} __attribute__((packed));
+
+/// A lock-free ring buffer of trace records. There is a single producer
+/// (the main loop). The oldest records are overwritten when the ring is full.
+class VS10XXTrace {
+ public:
+  void record(TraceEvent event, uint8_t arg8, uint16_t arg16);
+
+  /// Write the recorded trace to the log, as hex encoded binary records.
+  /// Use tools/vs10xx_trace.py to turn the log output into a timeline.
+  void dump();
+
+ protected:
+  VS10XXTraceRecord records_[VS10XX_TRACE_SIZE]{};
+  std::atomic<uint32_t> head_{0};
+};
+
+extern VS10XXTrace global_vs10xx_trace;  // NOLINT
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#define VS10XX_TRACE(event, arg8, arg16) \
+  ::esphome::vs10xx::global_vs10xx_trace.record(::esphome::vs10xx::event, (arg8), (arg16))
+
+#else
+
+#define VS10XX_TRACE(event, arg8, arg16)
+
+#endif
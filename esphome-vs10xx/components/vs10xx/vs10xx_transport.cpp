@@ -0,0 +1,101 @@
+#include "esphome/core/log.h"
+#include "vs10xx_transport.h"
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+void VS10XXSPITransport::setup() {
+  this->xdcs_pin_->setup();
+  this->xcs_pin_->setup();
+  this->xdcs_pin_->digital_write(true);
+  this->xcs_pin_->digital_write(true);
+  this->dreq_pin_->setup();
+  if (this->reset_pin_ != nullptr) {
+    this->reset_pin_->setup();
+    this->reset_pin_->digital_write(false);
+  }
+  this->slow_spi_->spi_setup();
+  this->fast_spi_->spi_setup();
+}
+
+void VS10XXSPITransport::log_config() {
+  ESP_LOGCONFIG(TAG, "  XCS Pin: %s", this->xcs_pin_->dump_summary().c_str());
+  ESP_LOGCONFIG(TAG, "  XDCS Pin: %s", this->xdcs_pin_->dump_summary().c_str());
+  ESP_LOGCONFIG(TAG, "  DREQ Pin: %s", this->dreq_pin_->dump_summary().c_str());
+  if (this->reset_pin_ == nullptr) {
+    ESP_LOGCONFIG(TAG, "  RESET Pin: N/A");
+  } else {
+    ESP_LOGCONFIG(TAG, "  RESET Pin: %s", this->reset_pin_->dump_summary().c_str());
+  }
+}
+
+void VS10XXSPITransport::begin_command() {
+  this->enable_();
+  this->xdcs_pin_->digital_write(true);
+  this->xcs_pin_->digital_write(false);
+}
+
+void VS10XXSPITransport::begin_data() {
+  this->enable_();
+  this->xcs_pin_->digital_write(true);
+  this->xdcs_pin_->digital_write(false);
+}
+
+void VS10XXSPITransport::end() {
+  this->disable_();
+  this->xdcs_pin_->digital_write(true);
+  this->xcs_pin_->digital_write(true);
+}
+
+void VS10XXSPITransport::enable_() {
+  if (this->fast_mode_) {
+    this->fast_spi_->enable();
+  } else {
+    this->slow_spi_->enable();
+  }
+}
+
+void VS10XXSPITransport::disable_() {
+  if (this->fast_mode_) {
+    this->fast_spi_->disable();
+  } else {
+    this->slow_spi_->disable();
+  }
+}
+
+void VS10XXSPITransport::write_byte(uint8_t value) {
+  if (this->fast_mode_) {
+    this->fast_spi_->write_byte(value);
+  } else {
+    this->slow_spi_->write_byte(value);
+  }
+}
+
+void VS10XXSPITransport::write_byte16(uint16_t value) {
+  if (this->fast_mode_) {
+    this->fast_spi_->write_byte16(value);
+  } else {
+    this->slow_spi_->write_byte16(value);
+  }
+}
+
+void VS10XXSPITransport::write_array(const uint8_t *data, size_t size) {
+  if (this->fast_mode_) {
+    this->fast_spi_->write_array(data, size);
+  } else {
+    this->slow_spi_->write_array(data, size);
+  }
+}
+
+uint8_t VS10XXSPITransport::read_byte() {
+  if (this->fast_mode_) {
+    return this->fast_spi_->read_byte();
+  } else {
+    return this->slow_spi_->read_byte();
+  }
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "esphome/core/hal.h"
+#include "esphome/components/spi/spi.h"
+
+namespace esphome {
+namespace vs10xx {
+
+/// This interface describes the transport that the HAL uses to talk to the
+/// device: the SPI bus, the chip select pins, DREQ and the reset pin.
+/// It is the seam between the device logic in the HAL and the hardware,
+/// which makes it possible to run the HAL on top of a different transport.
+class VS10XXTransport {
+ public:
+  explicit VS10XXTransport() = default;
+
+  virtual void setup() = 0;
+  virtual void log_config() = 0;
+
+  /// Switch between slow (before the clock multiplier is set) and fast SPI.
+  virtual void set_fast_mode(bool fast) = 0;
+
+  /// Start a transaction on the serial command interface (SCI).
+  virtual void begin_command() = 0;
+
+  /// Start a transaction on the serial data interface (SDI).
+  virtual void begin_data() = 0;
+
+  /// End the active SCI or SDI transaction.
+  virtual void end() = 0;
+
+  virtual void write_byte(uint8_t value) = 0;
+  virtual void write_byte16(uint16_t value) = 0;
+  virtual void write_array(const uint8_t *data, size_t size) = 0;
+  virtual uint8_t read_byte() = 0;
+
+  /// Read the state of the DREQ line.
+  virtual bool read_dreq() = 0;
+
+  /// Check if the transport can control the reset line of the device.
+  virtual bool has_reset() const = 0;
+
+  /// Drive the reset line of the device (true = hold in reset).
+  virtual void set_reset(bool reset) = 0;
+};
+
+// To communicate using both 200KHz and 4MHz SPI frequencies, two SPIDevice
+// instances are used.
+//
+// The templated SPI structure in ESPHome does not allow for variable
+// frequencies. This wrapper contains two concrete SPI instances for the two
+// frequencies and delegates SPI requests to eiter one of these, depending
+// on the need for slow or fast communication.
+#define SPI_BASE spi::BIT_ORDER_MSB_FIRST, spi::CLOCK_POLARITY_LOW, spi::CLOCK_PHASE_LEADING
+class VS10XXSlowSPI : public spi::SPIDevice<SPI_BASE, spi::DATA_RATE_200KHZ> {};
+class VS10XXFastSPI : public spi::SPIDevice<SPI_BASE, spi::DATA_RATE_4MHZ> {};
+
+/// The transport for a device that is connected to an SPI bus and GPIO pins.
+class VS10XXSPITransport : public VS10XXTransport {
+ public:
+  void set_slow_spi(VS10XXSlowSPI *spi) { this->slow_spi_ = spi; }
+  void set_fast_spi(VS10XXFastSPI *spi) { this->fast_spi_ = spi; }
+  void set_xdcs_pin(GPIOPin *xdcs_pin) { this->xdcs_pin_ = xdcs_pin; }
+  void set_xcs_pin(GPIOPin *xcs_pin) { this->xcs_pin_ = xcs_pin; }
+  void set_dreq_pin(GPIOPin *dreq_pin) { this->dreq_pin_ = dreq_pin; }
+  void set_reset_pin(GPIOPin *reset_pin) { this->reset_pin_ = reset_pin; }
+
+  void setup() override;
+  void log_config() override;
+  void set_fast_mode(bool fast) override { this->fast_mode_ = fast; }
+  void begin_command() override;
+  void begin_data() override;
+  void end() override;
+  void write_byte(uint8_t value) override;
+  void write_byte16(uint16_t value) override;
+  void write_array(const uint8_t *data, size_t size) override;
+  uint8_t read_byte() override;
+  bool read_dreq() override { return this->dreq_pin_->digital_read(); }
+  bool has_reset() const override { return this->reset_pin_ != nullptr; }
+  void set_reset(bool reset) override { this->reset_pin_->digital_write(!reset); }
+
+ protected:
+  VS10XXSlowSPI *slow_spi_;
+  VS10XXFastSPI *fast_spi_;
+  bool fast_mode_{false};
+
+  /// The XCS pin can be pulled low to lock the SPI bus for a command.
+  GPIOPin *xcs_pin_;
+
+  /// The XDCS pin can be pulled low to lock the SPI bus for a data transfer.
+  GPIOPin *xdcs_pin_;
+
+  /// The DREQ pin, which is used by the device to tell the MCU that
+  /// it is open for business. This means: ready to process a command
+  /// or to receive some audio data.
+  GPIOPin *dreq_pin_;
+
+  /// Optional reset pin. When this pin is linked to a GPIO (instead of the
+  /// EN pin or Vcc for example), then the device can be turned on and off.
+  /// Turning it off through the reset pin, offers the best power saving.
+  GPIOPin *reset_pin_{nullptr};
+
+  void enable_();
+  void disable_();
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
@@ -0,0 +1,504 @@
+#include "vs10xx_udp_source.h"
+
+#ifdef USE_VS10XX_UDP
+
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/components/network/util.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace esphome {
+namespace vs10xx {
+
+static const char *const TAG = "vs10xx";
+
+// The size of the fixed part of the RTP header.
+static const size_t RTP_HEADER_SIZE = 12;
+
+// The largest packet that is received. Larger packets are truncated, and
+// then dropped because their payload is incomplete.
+static const size_t UDP_MAX_PACKET_SIZE = 1500;
+
+// The maximum number of packets that are received per poll() call, which
+// keeps the time spent in poll() bounded when packets are flooding in.
+static const uint8_t UDP_MAX_PACKETS_PER_POLL = UDP_JITTER_SLOTS;
+
+// The time (in milliseconds) to wait before retrying to open the socket.
+static const uint32_t UDP_LISTEN_RETRY_INTERVAL = 5000;
+
+// The size of the DVI4 packet header: the predicted value (16 bits, big
+// endian), the step index and a reserved byte.
+static const size_t DVI4_HEADER_SIZE = 4;
+
+// The IMA ADPCM step index adjustments and quantizer step sizes.
+static const int8_t IMA_INDEX_TABLE[16] = {-1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8};
+static const int16_t IMA_STEP_TABLE[89] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,    19,    21,    23,    25,    28,
+    31,    34,    37,    41,    45,    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,   337,   371,   408,   449,   494,
+    544,   598,   658,   724,   796,   876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,  5894,  6484,  7132,  7845,  8630,
+    9493,  10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+static uint16_t read_be16(const uint8_t *data) { return (data[0] << 8) | data[1]; }
+
+static uint32_t read_be32(const uint8_t *data) {
+  return (static_cast<uint32_t>(read_be16(data)) << 16) | read_be16(data + 2);
+}
+
+static void write_le16(uint8_t *data, int16_t value) {
+  data[0] = value & 0xFF;
+  data[1] = (value >> 8) & 0xFF;
+}
+
+static int16_t decode_mulaw(uint8_t value) {
+  value = ~value;
+  int16_t magnitude = (((value & 0x0F) << 3) + 0x84) << ((value & 0x70) >> 4);
+  return (value & 0x80) ? 0x84 - magnitude : magnitude - 0x84;
+}
+
+static int16_t decode_ima(uint8_t nibble, int32_t &predictor, int32_t &index) {
+  int32_t step = IMA_STEP_TABLE[index];
+  int32_t diff = step >> 3;
+  if (nibble & 4)
+    diff += step;
+  if (nibble & 2)
+    diff += step >> 1;
+  if (nibble & 1)
+    diff += step >> 2;
+  predictor += (nibble & 8) ? -diff : diff;
+  predictor = clamp<int32_t>(predictor, -32768, 32767);
+  index = clamp<int32_t>(index + IMA_INDEX_TABLE[nibble], 0, 88);
+  return predictor;
+}
+
+bool UdpSource::allocate() {
+  ExternalRAMAllocator<uint8_t> allocator(ExternalRAMAllocator<uint8_t>::ALLOW_FAILURE);
+  // Decoding at most quadruples the size of the payload (DVI4). One extra
+  // frame is needed for repeating a frame when correcting the position.
+  const size_t pcm_size = UDP_MAX_PAYLOAD_SIZE * 4 + 4;
+  const size_t size = sizeof(Slot) * UDP_JITTER_SLOTS + pcm_size + UDP_MAX_PACKET_SIZE;
+  uint8_t *memory = allocator.allocate(size);
+  if (memory == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate %zu bytes for the UDP jitter buffer", size);
+    return false;
+  }
+  this->slots_ = reinterpret_cast<Slot *>(memory);
+  this->pcm_ = memory + sizeof(Slot) * UDP_JITTER_SLOTS;
+  this->packet_ = this->pcm_ + pcm_size;
+  this->clear_slots_();
+  return true;
+}
+
+bool UdpSource::poll() {
+  if (this->slots_ == nullptr) {
+    return false;
+  }
+  if (!this->listening_) {
+    if (!network::is_connected() ||
+        (this->listen_failed_at_ != 0 && millis() - this->listen_failed_at_ < UDP_LISTEN_RETRY_INTERVAL)) {
+      return false;
+    }
+    // Multicast is used when the stream is relayed by another device.
+    bool listening;
+    if (this->multicast_) {
+      listening = this->udp_.beginMulticast(this->multicast_address_, this->port_);
+    } else {
+      listening = this->udp_.begin(this->port_);
+    }
+    if (!listening) {
+      ESP_LOGW(TAG, "Could not listen for audio streams on UDP port %u", this->port_);
+      this->listen_failed_at_ = millis();
+      return false;
+    }
+    ESP_LOGD(TAG, "Listening for audio streams on UDP port %u", this->port_);
+    this->listening_ = true;
+  }
+
+  bool started = false;
+  for (uint8_t i = 0; i < UDP_MAX_PACKETS_PER_POLL; i++) {
+    if (this->udp_.parsePacket() <= 0) {
+      break;
+    }
+    int size = this->udp_.read(this->packet_, UDP_MAX_PACKET_SIZE);
+    if (size <= 0) {
+      continue;
+    }
+    if (this->relay_) {
+      this->udp_.beginPacket(this->relay_address_, this->port_);
+      this->udp_.write(this->packet_, size);
+      this->udp_.endPacket();
+    }
+    if (this->receive_(this->packet_, size)) {
+      started = true;
+    }
+  }
+  return started;
+}
+
+bool UdpSource::receive_(uint8_t *packet, size_t size) {
+  // Only RTP version 2 is supported. The CSRC list, the header extension
+  // and the padding are skipped.
+  if (size < RTP_HEADER_SIZE || (packet[0] >> 6) != 2) {
+    return false;
+  }
+  size_t offset = RTP_HEADER_SIZE + (packet[0] & 0x0F) * 4;
+  if ((packet[0] & 0x10) && offset + 4 <= size) {
+    offset += 4 + read_be16(packet + offset + 2) * 4;
+  }
+  if ((packet[0] & 0x20) && size > offset) {
+    size -= std::min<size_t>(packet[size - 1], size - offset);
+  }
+  if (offset >= size || size - offset > UDP_MAX_PAYLOAD_SIZE) {
+    return false;
+  }
+  auto seq = read_be16(packet + 2);
+  auto timestamp = read_be32(packet + 4);
+  auto ssrc = read_be32(packet + 8);
+  auto now = millis();
+
+  // A packet from another sender, or a packet after the stream was idle,
+  // starts a new stream.
+  bool started = false;
+  if (!this->synced_ || ssrc != this->ssrc_ || now - this->last_packet_at_ > this->idle_timeout_) {
+    started = !this->active_;
+    this->clear_slots_();
+    this->synced_ = true;
+    this->ssrc_ = ssrc;
+    this->first_timestamp_ = timestamp;
+    this->next_seq_ = seq;
+    this->end_seq_ = seq;
+    this->playing_ = false;
+    this->has_transit_ = false;
+    this->jitter_q4_ = 0;
+    this->stats_ = UdpSourceStats();
+    this->update_target_delay_();
+  }
+  this->last_packet_at_ = now;
+  this->stats_.packets++;
+  this->update_jitter_(timestamp, micros());
+  this->store_(seq, timestamp, packet + offset, size - offset);
+  return started;
+}
+
+void UdpSource::store_(uint16_t seq, uint32_t timestamp, const uint8_t *payload, size_t size) {
+  auto ahead = static_cast<int16_t>(seq - this->next_seq_);
+  if (ahead < 0) {
+    this->stats_.late++;
+    return;
+  }
+  if (ahead >= UDP_JITTER_SLOTS) {
+    // The sender is further ahead than the jitter buffer can hold (e.g.
+    // because packets were not read for a while). Continue from here.
+    this->stats_.resyncs++;
+    this->clear_slots_();
+    this->next_seq_ = seq;
+    this->end_seq_ = seq;
+  }
+  auto &slot = this->slots_[seq % UDP_JITTER_SLOTS];
+  if (slot.used && slot.seq == seq) {
+    this->stats_.late++;
+    return;
+  }
+  slot.seq = seq;
+  slot.size = size;
+  slot.timestamp = timestamp;
+  slot.arrived_at_us = micros();
+  slot.used = true;
+  memcpy(slot.payload, payload, size);
+  if (static_cast<int16_t>(seq - this->end_seq_) >= 0) {
+    this->end_seq_ = seq + 1;
+  }
+  auto samples = this->samples_in_(size);
+  if (samples != this->packet_samples_) {
+    this->packet_samples_ = samples;
+    this->packet_duration_us_ = static_cast<uint64_t>(samples) * 1000000 / this->sample_rate_;
+    this->update_target_delay_();
+  }
+}
+
+void UdpSource::clear_slots_() {
+  for (uint8_t i = 0; i < UDP_JITTER_SLOTS; i++) {
+    this->slots_[i].used = false;
+  }
+}
+
+void UdpSource::update_jitter_(uint32_t rtp_timestamp, uint32_t arrived_at_us) {
+  // The RTP timestamps run at the sample rate. The arrival time is
+  // converted to the same units, to compute the transit time.
+  auto arrival = static_cast<uint32_t>(static_cast<uint64_t>(arrived_at_us) * this->sample_rate_ / 1000000);
+  auto transit = arrival - rtp_timestamp;
+  if (this->has_transit_) {
+    auto d = std::abs(static_cast<int32_t>(transit - this->previous_transit_));
+    // J += (|D| - J) / 16, using the fixed point form from RFC 3550.
+    this->jitter_q4_ += static_cast<uint32_t>(d) - ((this->jitter_q4_ + 8) >> 4);
+    this->stats_.jitter_us = static_cast<uint64_t>(this->jitter_q4_ >> 4) * 1000000 / this->sample_rate_;
+    this->update_target_delay_();
+  }
+  this->previous_transit_ = transit;
+  this->has_transit_ = true;
+}
+
+void UdpSource::update_target_delay_() {
+  // One packet, plus a margin of a few times the jitter.
+  auto target = this->packet_duration_us_ + 3 * this->stats_.jitter_us;
+  this->stats_.target_delay_us = clamp(target, this->min_delay_us_, this->max_delay_us_);
+}
+
+uint32_t UdpSource::buffered_us_() const {
+  return static_cast<uint16_t>(this->end_seq_ - this->next_seq_) * this->packet_duration_us_;
+}
+
+void UdpSource::reset() {
+  // The packets that are in the jitter buffer are kept, since these are
+  // the start of the stream that is about to be played.
+  this->active_ = true;
+  this->playing_ = false;
+  this->pcm_size_ = 0;
+  this->pcm_offset_ = 0;
+  this->pcm_bytes_out_ = 0;
+  this->correction_ = 0;
+  this->started_ = false;
+  this->start_pending_ = false;
+  this->start_skip_ = false;
+  write_wav_header(this->header_, this->sample_rate_, this->channels_, WAV_STREAMING_SIZE);
+  this->header_offset_ = 0;
+}
+
+void UdpSource::hold(uint32_t at_us) {
+  if (this->started_) {
+    return;
+  }
+  this->start_pending_ = true;
+  this->start_scheduled_ = false;
+  this->start_at_us_ = at_us;
+}
+
+void UdpSource::schedule_start(uint32_t at_us, uint32_t rtp_timestamp) {
+  if (this->started_) {
+    return;
+  }
+  this->start_pending_ = true;
+  this->start_scheduled_ = true;
+  this->start_at_us_ = at_us;
+  this->start_rtp_ = rtp_timestamp;
+}
+
+void UdpSource::skip_to_start_() {
+  // The frame that belongs to the current time, which is the scheduled
+  // frame unless the schedule was missed.
+  auto late_us = micros() - this->start_at_us_;
+  this->start_rtp_ += static_cast<uint64_t>(late_us) * this->sample_rate_ / 1000000;
+  // The packets before that frame are dropped. The packet that holds the
+  // frame is played from that frame on (see next_packet_()).
+  while (this->next_seq_ != this->end_seq_) {
+    auto &slot = this->slots_[this->next_seq_ % UDP_JITTER_SLOTS];
+    if (!slot.used || slot.seq != this->next_seq_ ||
+        static_cast<int32_t>(slot.timestamp + this->packet_samples_ - this->start_rtp_) > 0) {
+      break;
+    }
+    slot.used = false;
+    this->next_seq_++;
+  }
+  this->start_skip_ = true;
+}
+
+void UdpSource::close() {
+  if (this->active_) {
+    ESP_LOGD(TAG, "UDP stream: %u packets, %u lost, %u late, %u resyncs, jitter %0.1f ms, delay %0.1f ms",
+             this->stats_.packets, this->stats_.lost, this->stats_.late, this->stats_.resyncs,
+             this->stats_.jitter_us / 1000.0f, this->stats_.delay_us / 1000.0f);
+  }
+  this->active_ = false;
+  this->playing_ = false;
+  this->pcm_size_ = 0;
+  this->pcm_offset_ = 0;
+}
+
+bool UdpSource::at_end() const {
+  if (this->pcm_offset_ < this->pcm_size_ || this->buffered_us_() > 0) {
+    return false;
+  }
+  return !this->synced_ || millis() - this->last_packet_at_ > this->idle_timeout_;
+}
+
+size_t UdpSource::read(uint8_t *buffer, size_t max_size) {
+  this->poll();
+  size_t total = 0;
+  if (this->header_offset_ < WAV_HEADER_SIZE) {
+    auto size = std::min(max_size, WAV_HEADER_SIZE - this->header_offset_);
+    memcpy(buffer, this->header_ + this->header_offset_, size);
+    this->header_offset_ += size;
+    total += size;
+  }
+  while (total < max_size) {
+    if (this->pcm_offset_ >= this->pcm_size_ && !this->next_packet_()) {
+      break;
+    }
+    auto size = std::min(max_size - total, this->pcm_size_ - this->pcm_offset_);
+    memcpy(buffer + total, this->pcm_ + this->pcm_offset_, size);
+    this->pcm_offset_ += size;
+    this->pcm_bytes_out_ += size;
+    total += size;
+  }
+  return total;
+}
+
+bool UdpSource::next_packet_() {
+  auto buffered_us = this->buffered_us_();
+  if (buffered_us == 0) {
+    // The jitter buffer ran dry. The playout delay is built up again,
+    // before playing out more packets.
+    this->playing_ = false;
+    return false;
+  }
+  if (!this->playing_) {
+    if (this->start_pending_) {
+      // A held start ignores the target delay: the time of the start was
+      // chosen with a margin for the jitter.
+      if (static_cast<int32_t>(micros() - this->start_at_us_) < 0) {
+        return false;
+      }
+      this->start_pending_ = false;
+      if (this->start_scheduled_) {
+        this->skip_to_start_();
+      }
+    } else if (buffered_us < this->stats_.target_delay_us) {
+      return false;
+    }
+    this->playing_ = true;
+    this->started_ = true;
+  }
+
+  const size_t frame_size = this->channels_ * 2;
+  if (this->correction_ < -static_cast<int32_t>(this->packet_samples_)) {
+    // A large delay is inserted as silence, before the next packet.
+    auto frames = std::min<int32_t>(-this->correction_, UDP_MAX_PAYLOAD_SIZE * 4 / frame_size);
+    this->pcm_size_ = frames * frame_size;
+    this->pcm_offset_ = 0;
+    memset(this->pcm_, 0, this->pcm_size_);
+    this->correction_ += frames;
+    this->rtp_base_ -= frames;
+    this->stats_.inserted += frames;
+    return true;
+  }
+
+  auto now_us = micros();
+  auto &slot = this->slots_[this->next_seq_ % UDP_JITTER_SLOTS];
+  size_t skip = 0;
+  if (slot.used && slot.seq == this->next_seq_) {
+    this->pcm_size_ = this->decode_(slot);
+    this->stats_.delay_us = now_us - slot.arrived_at_us;
+    // A scheduled start can be in the middle of the packet.
+    if (this->start_skip_) {
+      auto behind = static_cast<int32_t>(this->start_rtp_ - slot.timestamp);
+      skip = clamp<int32_t>(behind, 0, this->pcm_size_ / frame_size);
+    }
+    // The first frame that is played of the packet is the next frame to be
+    // read.
+    this->rtp_base_ = slot.timestamp + skip - this->pcm_bytes_out_ / frame_size;
+    slot.used = false;
+  } else {
+    // The packet is missing. Until a later packet has waited for the
+    // target delay, it might still arrive out of order. After that, it is
+    // considered lost and replaced with silence.
+    for (uint16_t seq = this->next_seq_ + 1; seq != this->end_seq_; seq++) {
+      auto &later = this->slots_[seq % UDP_JITTER_SLOTS];
+      if (later.used && later.seq == seq) {
+        if (now_us - later.arrived_at_us < this->stats_.target_delay_us) {
+          return false;
+        }
+        break;
+      }
+    }
+    this->stats_.lost++;
+    this->pcm_size_ = this->packet_samples_ * this->channels_ * 2;
+    memset(this->pcm_, 0, this->pcm_size_);
+  }
+  this->pcm_offset_ = skip * frame_size;
+  this->start_skip_ = false;
+  this->next_seq_++;
+  this->apply_correction_();
+  return true;
+}
+
+void UdpSource::apply_correction_() {
+  const size_t frame_size = this->channels_ * 2;
+  auto frames = static_cast<int32_t>(this->pcm_size_ / frame_size);
+  if (this->correction_ == 0 || frames == 0) {
+    return;
+  }
+  if (this->correction_ > 0) {
+    // Skip the whole packet for a large correction, otherwise skip its
+    // first frame.
+    auto drop = this->correction_ >= frames ? frames : 1;
+    this->pcm_offset_ = drop * frame_size;
+    this->correction_ -= drop;
+    this->rtp_base_ += drop;
+    this->stats_.dropped += drop;
+  } else {
+    // Repeat the last frame of the packet.
+    memcpy(this->pcm_ + this->pcm_size_, this->pcm_ + this->pcm_size_ - frame_size, frame_size);
+    this->pcm_size_ += frame_size;
+    this->correction_++;
+    this->rtp_base_--;
+    this->stats_.inserted++;
+  }
+}
+
+size_t UdpSource::samples_in_(size_t payload_size) const {
+  switch (this->format_) {
+    case UDP_FORMAT_PCMU:
+      return payload_size / this->channels_;
+    case UDP_FORMAT_DVI4:
+      return payload_size > DVI4_HEADER_SIZE ? (payload_size - DVI4_HEADER_SIZE) * 2 : 0;
+    case UDP_FORMAT_L16:
+    default:
+      return payload_size / 2 / this->channels_;
+  }
+}
+
+size_t UdpSource::decode_(const Slot &slot) {
+  uint8_t *out = this->pcm_;
+  const uint8_t *in = slot.payload;
+  switch (this->format_) {
+    case UDP_FORMAT_PCMU:
+      for (size_t i = 0; i < slot.size; i++) {
+        write_le16(out + i * 2, decode_mulaw(in[i]));
+      }
+      return slot.size * 2;
+    case UDP_FORMAT_DVI4: {
+      // The state of the decoder is in the packet header, so every packet
+      // can be decoded on its own. The first sample is in the high nibble.
+      if (slot.size <= DVI4_HEADER_SIZE) {
+        return 0;
+      }
+      int32_t predictor = static_cast<int16_t>(read_be16(in));
+      int32_t index = std::min<int32_t>(in[2], 88);
+      for (size_t i = DVI4_HEADER_SIZE; i < slot.size; i++) {
+        write_le16(out, decode_ima(in[i] >> 4, predictor, index));
+        write_le16(out + 2, decode_ima(in[i] & 0x0F, predictor, index));
+        out += 4;
+      }
+      return (slot.size - DVI4_HEADER_SIZE) * 4;
+    }
+    case UDP_FORMAT_L16:
+    default: {
+      // Network byte order is big endian, WAV is little endian.
+      size_t size = slot.size & ~static_cast<size_t>(1);
+      for (size_t i = 0; i < size; i += 2) {
+        out[i] = in[i + 1];
+        out[i + 1] = in[i];
+      }
+      return size;
+    }
+  }
+}
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,245 @@
+#pragma once
+
+#include "esphome/core/defines.h"
+
+// Playing audio streams from UDP is only compiled in when it is configured
+// using the "udp_stream" option.
+#ifdef USE_VS10XX_UDP
+
+#include "vs10xx_format.h"
+#include "vs10xx_source.h"
+#include <WiFiUdp.h>
+#include <string>
+
+namespace esphome {
+namespace vs10xx {
+
+/// The number of packets that the jitter buffer can hold. Packets that are
+/// this far ahead of the playout position cause the stream to resync.
+static const uint8_t UDP_JITTER_SLOTS = 16;
+
+/// The maximum size of the RTP payload of a single packet.
+static const size_t UDP_MAX_PAYLOAD_SIZE = 1460;
+
+/// The encodings of the RTP payload. All encodings are decoded into 16 bit
+/// PCM, so the device always gets the same kind of WAV stream.
+enum UdpPayloadFormat : uint8_t {
+  /// Linear 16 bit PCM, big endian (RFC 3551 L16).
+  UDP_FORMAT_L16,
+  /// G.711 mu-law (RFC 3551 PCMU).
+  UDP_FORMAT_PCMU,
+  /// IMA ADPCM, with a predictor header in every packet (RFC 3551 DVI4).
+  UDP_FORMAT_DVI4,
+};
+
+/// Counters that describe how the UDP stream went.
+struct UdpSourceStats {
+  /// The number of packets that were received.
+  uint32_t packets{0};
+  /// The number of packets that were lost, and replaced with silence.
+  uint32_t lost{0};
+  /// The number of packets that arrived after their playout time, or
+  /// that were received twice. These are dropped.
+  uint32_t late{0};
+  /// The number of times that the playout position was moved, because the
+  /// stream jumped ahead more than the jitter buffer can hold.
+  uint32_t resyncs{0};
+  /// The interarrival jitter (in microseconds), as defined by RFC 3550.
+  uint32_t jitter_us{0};
+  /// The time (in microseconds) that the most recently played packet spent
+  /// in the jitter buffer, from its arrival until it was played out.
+  uint32_t delay_us{0};
+  /// The current target delay (in microseconds) of the jitter buffer.
+  uint32_t target_delay_us{0};
+  /// The number of frames that were inserted or dropped, to correct the
+  /// playout position (see UdpSource::set_correction()).
+  uint32_t inserted{0};
+  uint32_t dropped{0};
+};
+
+/// An AudioSource that plays an RTP audio stream from UDP, meant for
+/// short announcements like doorbell and intercom chimes that must be
+/// played with little delay.
+///
+/// Packets are received without blocking, from the main loop. They are
+/// stored in a small jitter buffer, indexed by their sequence number, so
+/// packets that arrive out of order are played in the right order. A lost
+/// packet is replaced with silence of the same duration. The playout delay
+/// adapts to the measured jitter, between a minimum and maximum delay.
+/// The payload is decoded into 16 bit PCM, which is played as a WAV stream.
+///
+/// The stream ends when no packets arrive for the idle timeout.
+///
+/// To play a stream on multiple devices, one device can relay the packets
+/// that it receives to a multicast group, which the other devices join.
+/// The start of the playout can then be held or scheduled, so all devices
+/// start with the same frame at the same moment (see VS10XXSync).
+class UdpSource : public AudioSource {
+ public:
+  explicit UdpSource() = default;
+  void set_port(uint16_t port) { this->port_ = port; }
+  void set_format(UdpPayloadFormat format) { this->format_ = format; }
+  void set_sample_rate(uint32_t sample_rate) { this->sample_rate_ = sample_rate; }
+  void set_channels(uint8_t channels) { this->channels_ = channels; }
+  void set_min_delay(uint32_t ms) { this->min_delay_us_ = ms * 1000; }
+  void set_max_delay(uint32_t ms) { this->max_delay_us_ = ms * 1000; }
+  void set_idle_timeout(uint32_t ms) { this->idle_timeout_ = ms; }
+  void set_multicast_address(const std::string &address) {
+    this->multicast_ = this->multicast_address_.fromString(address.c_str());
+  }
+  void set_relay_address(const std::string &address) {
+    this->relay_ = this->relay_address_.fromString(address.c_str());
+  }
+
+  /// Allocate the jitter buffer. PSRAM is used when available.
+  /// This must be called once, at setup time.
+  bool allocate();
+
+  /// Receive the packets that are waiting on the socket. This must be
+  /// called from the main loop, also when the source is not playing, so
+  /// packets are timestamped on arrival. Listening starts once the network
+  /// is connected. Returns true when a new stream started, i.e. a packet
+  /// arrived after the stream was idle.
+  bool poll();
+
+  void reset() override;
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override;
+  void close() override;
+
+  /// The data rate (in bytes per second) of the decoded audio.
+  uint32_t get_byte_rate() const { return this->sample_rate_ * this->channels_ * 2; }
+
+  uint32_t get_sample_rate() const { return this->sample_rate_; }
+
+  /// The largest playout delay (in microseconds) that the jitter buffer is
+  /// configured for.
+  uint32_t get_max_delay_us() const { return this->max_delay_us_; }
+
+  /// The number of frames in a packet of the stream that is being played.
+  uint32_t get_packet_samples() const { return this->packet_samples_; }
+
+  /// The SSRC identifier of the stream that is being played.
+  uint32_t get_ssrc() const { return this->ssrc_; }
+
+  /// The RTP timestamp of the first packet that was received of the stream.
+  uint32_t get_first_timestamp() const { return this->first_timestamp_; }
+
+  /// Hold the playout of the stream until a local time (see micros()), even
+  /// when the jitter buffer holds enough packets. This only affects a
+  /// stream that did not start to play out yet, and reset() ends it.
+  void hold(uint32_t at_us);
+
+  /// Schedule the playout of the stream: the frame with the RTP timestamp
+  /// plays out at the local time. When that time has passed, playout starts
+  /// from the frame that belongs to the current time instead. Like hold(),
+  /// this only affects a stream that did not start to play out yet.
+  void schedule_start(uint32_t at_us, uint32_t rtp_timestamp);
+
+  /// Check if the playout is held, e.g. for a schedule.
+  bool is_start_pending() const { return this->start_pending_; }
+
+  /// The RTP timestamp of a frame of the decoded audio, counting from the
+  /// first frame after the WAV header. This is exact for the frames that
+  /// were most recently read, and may be off by a few frames for older
+  /// frames, when a correction was done in between.
+  uint32_t get_rtp_timestamp(uint32_t frame) const { return this->rtp_base_ + frame; }
+
+  /// Correct the playout position by a number of frames. A positive number
+  /// skips ahead, a negative number delays. Small corrections, up to the
+  /// duration of a packet, are done by dropping or repeating a single frame
+  /// per packet, which is inaudible. Larger corrections are done at once,
+  /// by dropping packets or inserting silence. A new call replaces the
+  /// correction that is still pending.
+  void set_correction(int32_t frames) { this->correction_ = frames; }
+
+  /// Counters that describe how the UDP stream went.
+  const UdpSourceStats &get_stats() const { return this->stats_; }
+
+ protected:
+  /// A packet in the jitter buffer.
+  struct Slot {
+    uint16_t seq;
+    uint16_t size;
+    uint32_t timestamp;
+    uint32_t arrived_at_us;
+    bool used;
+    uint8_t payload[UDP_MAX_PAYLOAD_SIZE];
+  };
+
+  uint16_t port_{5004};
+  UdpPayloadFormat format_{UDP_FORMAT_L16};
+  uint32_t sample_rate_{16000};
+  uint8_t channels_{1};
+  uint32_t min_delay_us_{20000};
+  uint32_t max_delay_us_{100000};
+  uint32_t idle_timeout_{1000};
+  WiFiUDP udp_{};
+  bool listening_{false};
+  uint32_t listen_failed_at_{0};
+  uint8_t *packet_{nullptr};
+  IPAddress multicast_address_{};
+  bool multicast_{false};
+  IPAddress relay_address_{};
+  bool relay_{false};
+  UdpSourceStats stats_{};
+
+  // The jitter buffer. A packet is stored in the slot for its sequence
+  // number, modulo the number of slots.
+  Slot *slots_{nullptr};
+  bool active_{false};
+  bool synced_{false};
+  uint32_t ssrc_{0};
+  uint32_t first_timestamp_{0};
+  uint16_t next_seq_{0};
+  uint16_t end_seq_{0};
+  uint32_t last_packet_at_{0};
+  bool receive_(uint8_t *packet, size_t size);
+  void store_(uint16_t seq, uint32_t timestamp, const uint8_t *payload, size_t size);
+  void clear_slots_();
+
+  // Members that implement the adaptive playout delay. The delay is based
+  // on the interarrival jitter estimate from RFC 3550.
+  bool playing_{false};
+  uint32_t packet_samples_{0};
+  uint32_t packet_duration_us_{0};
+  uint32_t jitter_q4_{0};
+  uint32_t previous_transit_{0};
+  bool has_transit_{false};
+  void update_jitter_(uint32_t rtp_timestamp, uint32_t arrived_at_us);
+  void update_target_delay_();
+  uint32_t buffered_us_() const;
+
+  // The decoded audio of the packet that is being played out.
+  uint8_t header_[WAV_HEADER_SIZE]{};
+  size_t header_offset_{WAV_HEADER_SIZE};
+  uint8_t *pcm_{nullptr};
+  size_t pcm_size_{0};
+  size_t pcm_offset_{0};
+  uint32_t pcm_bytes_out_{0};
+  bool next_packet_();
+  size_t decode_(const Slot &slot);
+  size_t samples_in_(size_t payload_size) const;
+
+  // Members that map the decoded audio to the RTP timeline, and that
+  // correct the playout position.
+  uint32_t rtp_base_{0};
+  int32_t correction_{0};
+  void apply_correction_();
+
+  // Members that hold the start of the playout (see hold() and
+  // schedule_start()). The start is the first packet that is played out
+  // after reset().
+  bool started_{false};
+  bool start_pending_{false};
+  bool start_scheduled_{false};
+  bool start_skip_{false};
+  uint32_t start_at_us_{0};
+  uint32_t start_rtp_{0};
+  void skip_to_start_();
+};
+
+}  // namespace vs10xx
+}  // namespace esphome
+
+#endif
@@ -0,0 +1,108 @@
+#include "host.h"
+#include "esphome/components/vs10xx/vs1003_plugin_wavfix.h"
+#include "esphome/components/vs10xx/vs1003_plugin_wma_webcast_rw.h"
+#include "esphome/components/vs10xx/vs10xx_benchmark.h"
+#include "esphome/components/vs10xx/vs10xx_file_source.h"
+#include "esphome/components/vs10xx/vs10xx_hal_vs1053.h"
+#include "esphome/core/log.h"
+#include <FS.h>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
+
+// The host is about two orders of magnitude faster than an ESP32.
+static const uint32_t HOST_ITERATIONS_SCALE = 100;
+
+static const char *const TAG = "vs10xx";
+
+// The number of times that the file source benchmark reads the file.
+static const uint32_t FILE_PASSES = 20;
+
+// Reads an audio file from a filesystem image through the file source, in
+// reads of a burst, like the device feed does. This measures the sustained
+// throughput of the read-ahead cache, which must stay far above the byte
+// rate of the file.
+static bool bench_file_source(const char *path) {
+  using namespace esphome;
+  using namespace esphome::vs10xx;
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "%s: cannot open the file\n", path);
+    return false;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  fs::FS fs("/tmp/vs10xx_bench_" + std::to_string(getpid()) + ".img");
+  FileSource source;
+  if (!fs.add_file("/audio", data.data(), data.size()) || !source.allocate(4096)) {
+    return false;
+  }
+  source.set_file(&fs, "/audio");
+
+  uint8_t buffer[VS10XX_MAX_BURST_SIZE];
+  uint32_t reads = 0;
+  uint32_t start = micros();
+  for (uint32_t pass = 0; pass < FILE_PASSES; pass++) {
+    source.reset();
+    while (source.read(buffer, sizeof(buffer)) > 0) {
+      reads++;
+    }
+  }
+  uint32_t total_us = micros() - start;
+  ESP_LOGI(TAG, "bench: {\"name\":\"file_source_read\",\"iterations\":%u,\"total_us\":%u,\"ns_per_op\":%u}", reads,
+           total_us, reads == 0 ? 0 : static_cast<uint32_t>(uint64_t(total_us) * 1000 / reads));
+  // The byte rate of a WAV file is in its header.
+  uint32_t byte_rate = 0;
+  if (data.size() >= 32 && memcmp(data.data(), "RIFF", 4) == 0) {
+    memcpy(&byte_rate, data.data() + 28, sizeof(byte_rate));
+  }
+  double rate = total_us == 0 ? 0 : double(data.size()) * FILE_PASSES / total_us;
+  ESP_LOGI(TAG, "File source reads %s at %.1f MB/s (%.0f times its byte rate)", path, rate,
+           byte_rate == 0 ? 0 : rate * 1e6 / byte_rate);
+  return true;
+}
+
+// Runs the on-device benchmarks (see VS10XXBenchmark) on the host, on the
+// real clock, to catch regressions without a device:
+//
+//   make -C esphome-vs10xx/tests bench    # compare against bench/baseline.json
+//   build/vs10xx_bench | python3 ../tools/vs10xx_bench.py --save bench/baseline.json
+//
+// Usage: vs10xx_bench [--runs N] [--file PATH]
+// The benchmarks are run N times (5 by default), with 100 times the
+// iterations of the device. tools/vs10xx_bench.py keeps the fastest run of
+// every benchmark, which filters out most of the noise from other
+// processes. With a file, the file source is benchmarked on it as well.
+int main(int argc, char **argv) {
+  using namespace esphome;
+  using namespace esphome::vs10xx;
+  unsigned runs = 5;
+  const char *file = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+      runs = strtoul(argv[++i], nullptr, 10);
+    } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+      file = argv[++i];
+    } else {
+      fprintf(stderr, "Usage: %s [--runs N] [--file PATH]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  host::use_real_clock(true);
+  host::set_log_level(HOST_LOG_INFO);
+  VS1053Chipset chipset;
+  PluginVS1003WavFix wavfix;
+  PluginVS1003WMAWebcastRewind webcast;
+  VS10XXPlugin *const plugins[] = {&wavfix, &webcast};
+  VS10XXBenchmark benchmark(&chipset, plugins, 2);
+  benchmark.set_iterations_scale(HOST_ITERATIONS_SCALE);
+  for (unsigned run = 0; run < runs; run++) {
+    benchmark.run();
+    if (file != nullptr && !bench_file_source(file)) {
+      return 1;
+    }
+  }
+  return 0;
+}
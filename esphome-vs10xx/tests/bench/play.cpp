@@ -0,0 +1,151 @@
+#include "fixture.h"
+#include "host.h"
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+
+static const char *format_name(AudioFormat format) {
+  switch (format) {
+    case FORMAT_WAV:
+      return "WAV";
+    case FORMAT_AAC_ADTS:
+    case FORMAT_AAC_ADIF:
+    case FORMAT_AAC_MP4:
+      return "AAC";
+    case FORMAT_MP3:
+      return "MP3";
+    case FORMAT_WMA:
+      return "WMA";
+    case FORMAT_MIDI:
+      return "MIDI";
+    case FORMAT_OGG:
+      return "Ogg";
+    default:
+      return "?";
+  }
+}
+
+struct PlayResult {
+  bool finished{false};
+  AudioFormat format{FORMAT_UNKNOWN};
+  uint32_t stream_byte_rate{0};
+  uint64_t duration_us{0};
+  uint64_t first_byte_us{0};
+  uint32_t underruns{0};
+  uint32_t decoder_underruns{0};
+  uint32_t loops{0};
+  uint64_t loop_us{0};
+  uint64_t max_loop_us{0};
+  uint64_t cpu_ns{0};
+};
+
+// Plays a file through the main loop of the device, with idle_us of other
+// work between every two loops.
+static PlayResult play(const std::vector<uint8_t> &data, uint32_t idle_us) {
+  PlayResult result;
+  result.format = detect_audio_format(data.data(), data.size());
+  host::reset();
+  test::TestDevice t;
+  test::MemorySource source(data);
+  if (!t.start()) {
+    return result;
+  }
+
+  auto started = host::now_us();
+  t.device.play(&source);
+  // Twice the time that the decoder of the emulator takes at the slowest
+  // byte rate that it plays.
+  const uint64_t timeout_us = 2000000ULL * data.size() / 8000 + 1000000;
+  while (t.device.get_media_state() != MEDIA_STOPPED && host::now_us() - started < timeout_us) {
+    auto loop_started = host::now_us();
+    auto cpu_started = std::chrono::steady_clock::now();
+    t.loop();
+    result.cpu_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                           cpu_started).count();
+    auto loop_us = host::now_us() - loop_started;
+    result.loops++;
+    result.loop_us += loop_us;
+    result.max_loop_us = std::max(result.max_loop_us, loop_us);
+    result.stream_byte_rate = std::max(result.stream_byte_rate, t.transport.get_stream_byte_rate());
+    if (result.first_byte_us == 0 && t.transport.get_sdi_bytes() > 0) {
+      result.first_byte_us = host::now_us() - started;
+    }
+    host::run_scheduler();
+    host::advance_us(idle_us);
+  }
+  result.finished = t.device.get_media_state() == MEDIA_STOPPED;
+  result.duration_us = host::now_us() - started;
+  result.underruns = t.device.get_playback_stats().underruns;
+  result.decoder_underruns = t.transport.get_decoder_underruns();
+  return result;
+}
+
+// Plays audio files on the emulated device (see FakeTransport), through the
+// real main loop of the component, and reports per file:
+// - the byte rate at which the emulator decodes the file, from its header
+//   (0 when the header does not tell, e.g. for MIDI);
+// - the time from play() to the first audio byte on SDI;
+// - the underruns of the component (DREQ high without buffered data) and
+//   of the decoder (audible gaps);
+// - the time used by the loops of the device and its feed scheduler, on
+//   the fake clock, which moves with the SPI transfers and waits like the
+//   device does, as part of the playback time, and the longest loop;
+// - the host CPU time per loop.
+//
+//   make -C esphome-vs10xx/tests play     # all files in audio/
+//
+// Usage: vs10xx_play [-v] [--idle-us US] file...
+// Between two loops, the rest of the main loop takes US microseconds (1000
+// by default). The exit code is 1 when a file did not play to its end, or
+// when the decoder ran out of data.
+int main(int argc, char **argv) {
+  int log_level = HOST_LOG_NONE;
+  uint32_t idle_us = 1000;
+  std::vector<const char *> paths;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      log_level = HOST_LOG_DEBUG;
+    } else if (strcmp(argv[i], "--idle-us") == 0 && i + 1 < argc) {
+      idle_us = strtoul(argv[++i], nullptr, 10);
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty()) {
+    fprintf(stderr, "Usage: %s [-v] [--idle-us US] file...\n", argv[0]);
+    return 2;
+  }
+
+  host::set_log_level(log_level);
+  printf("%-36s %-5s %8s %8s %9s %9s %9s %9s %8s %8s\n", "File", "Type", "Bytes", "B/s", "Play ms", "TTFB ms",
+         "Underrun", "Gaps", "Loop %", "Max us");
+  int status = 0;
+  for (auto *path : paths) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      fprintf(stderr, "%s: cannot open the file\n", path);
+      return 2;
+    }
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    auto result = play(data, idle_us);
+    const char *name = strrchr(path, '/') != nullptr ? strrchr(path, '/') + 1 : path;
+    printf("%-36.36s %-5s %8u %8u %9.1f %9.1f %9u %9u %7.2f%% %8u   %.0f ns/loop%s\n", name,
+           format_name(result.format), (unsigned) data.size(), (unsigned) result.stream_byte_rate,
+           result.duration_us / 1000.0, result.first_byte_us / 1000.0, (unsigned) result.underruns,
+           (unsigned) result.decoder_underruns,
+           result.duration_us > 0 ? 100.0 * result.loop_us / result.duration_us : 0.0, (unsigned) result.max_loop_us,
+           result.loops > 0 ? double(result.cpu_ns) / result.loops : 0.0, result.finished ? "" : "  (timeout)");
+    if (!result.finished || result.decoder_underruns > 0) {
+      status = 1;
+    }
+  }
+  return status;
+}
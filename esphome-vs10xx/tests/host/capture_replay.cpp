@@ -0,0 +1,269 @@
+#include "capture_replay.h"
+#include "esphome/components/vs10xx/vs10xx_constants.h"
+#include "host.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace esphome {
+namespace test {
+
+using namespace vs10xx;
+
+// The address of endFillByte in X memory. Writing it to SCI_WRAMADDR is
+// the first step of cancelling a stream, so it marks the end of the audio.
+static const uint16_t END_FILL_BYTE_ADDRESS = 0x1E06;
+
+// The number of zeros that end a stream on chipsets without SM_CANCEL.
+static const size_t END_STREAM_ZEROS = 2048;
+
+static const char *const REGISTERS[16] = {
+    "MODE", "STATUS", "BASS", "CLOCKF", "DECODE_TIME", "AUDATA", "WRAM", "WRAMADDR",
+    "HDAT0", "HDAT1", "AIADDR", "VOL", "AICTRL0", "AICTRL1", "AICTRL2", "AICTRL3",
+};
+
+bool parse_capture(const uint8_t *data, size_t size, std::vector<CaptureRecord> &records) {
+  size_t pos = 0;
+  uint64_t time_us = 0;
+  while (pos < size) {
+    CaptureRecord record;
+    auto header = data[pos++];
+    uint32_t delta = 0;
+    for (int shift = 0;; shift += 7) {
+      if (pos >= size || shift > 28) {
+        return false;
+      }
+      auto byte = data[pos++];
+      delta |= (byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0) {
+        break;
+      }
+    }
+    time_us += delta;
+    record.time_us = time_us;
+    record.type = static_cast<CaptureRecordType>(header & 0x0F);
+    record.dreq = (header & CAPTURE_DREQ_BIT) != 0;
+    switch (record.type) {
+      case CAPTURE_SCI_WRITE:
+      case CAPTURE_SCI_READ:
+        if (pos + 3 > size) {
+          return false;
+        }
+        record.reg = data[pos];
+        record.value = data[pos + 1] << 8 | data[pos + 2];
+        pos += 3;
+        break;
+      case CAPTURE_SDI: {
+        if (pos >= size || pos + 1 + data[pos] > size) {
+          return false;
+        }
+        size_t length = data[pos];
+        record.data.assign(data + pos + 1, data + pos + 1 + length);
+        pos += 1 + length;
+        break;
+      }
+      case CAPTURE_SPI_SPEED:
+        if (pos >= size) {
+          return false;
+        }
+        record.reg = data[pos++];
+        break;
+      case CAPTURE_HARD_RESET:
+        break;
+      default:
+        return false;
+    }
+    records.push_back(std::move(record));
+  }
+  return true;
+}
+
+std::string describe_record(const CaptureRecord &record) {
+  char text[96];
+  auto dreq = record.dreq ? 'H' : 'L';
+  switch (record.type) {
+    case CAPTURE_SCI_WRITE:
+    case CAPTURE_SCI_READ:
+      snprintf(text, sizeof(text), "DREQ=%c %s SCI_%s = 0x%04x", dreq,
+               record.type == CAPTURE_SCI_WRITE ? "write" : "read ", REGISTERS[record.reg & 0x0F], record.value);
+      break;
+    case CAPTURE_SDI: {
+      int length = snprintf(text, sizeof(text), "DREQ=%c data  %u bytes: ", dreq, (unsigned) record.data.size());
+      for (size_t i = 0; i < std::min<size_t>(8, record.data.size()); i++) {
+        length += snprintf(text + length, sizeof(text) - length, "%02x", record.data[i]);
+      }
+      if (record.data.size() > 8) {
+        snprintf(text + length, sizeof(text) - length, "...");
+      }
+      break;
+    }
+    case CAPTURE_HARD_RESET:
+      snprintf(text, sizeof(text), "DREQ=%c hard reset", dreq);
+      break;
+    case CAPTURE_SPI_SPEED:
+      snprintf(text, sizeof(text), "DREQ=%c SPI speed %s", dreq, record.reg ? "fast" : "slow");
+      break;
+    default:
+      snprintf(text, sizeof(text), "unknown record type %d", record.type);
+      break;
+  }
+  return text;
+}
+
+static bool same_record(const CaptureRecord &a, const CaptureRecord &b) {
+  return a.type == b.type && a.dreq == b.dreq && a.reg == b.reg && a.value == b.value && a.data == b.data;
+}
+
+static std::vector<uint8_t> sdi_data(const std::vector<CaptureRecord> &records) {
+  std::vector<uint8_t> data;
+  for (auto &record : records) {
+    if (record.type == CAPTURE_SDI) {
+      data.insert(data.end(), record.data.begin(), record.data.end());
+    }
+  }
+  return data;
+}
+
+uint8_t capture_chip_version(const std::vector<CaptureRecord> &records) {
+  for (auto &record : records) {
+    if (record.type == CAPTURE_SCI_READ && record.reg == SCI_STATUS) {
+      return (record.value >> 4) & 0x0F;
+    }
+  }
+  return 4;
+}
+
+CaptureAudioSource::CaptureAudioSource(const std::vector<CaptureRecord> &records) {
+  for (auto &record : records) {
+    if (record.type == CAPTURE_SCI_WRITE && record.reg == SCI_WRAMADDR && record.value == END_FILL_BYTE_ADDRESS) {
+      return;
+    }
+    if (record.type == CAPTURE_SDI) {
+      this->data_.insert(this->data_.end(), record.data.begin(), record.data.end());
+    }
+  }
+  // Without a cancel, the stream was ended by sending zeros.
+  if (this->data_.size() >= END_STREAM_ZEROS &&
+      std::all_of(this->data_.end() - END_STREAM_ZEROS, this->data_.end(), [](uint8_t b) { return b == 0; })) {
+    this->data_.resize(this->data_.size() - END_STREAM_ZEROS);
+  }
+}
+
+size_t CaptureAudioSource::read(uint8_t *buffer, size_t max_size) {
+  size_t size = std::min(max_size, this->data_.size() - this->position_);
+  std::copy_n(this->data_.begin() + this->position_, size, buffer);
+  this->position_ += size;
+  return size;
+}
+
+bool CaptureAudioSource::seek(size_t position) {
+  if (position > this->data_.size()) {
+    return false;
+  }
+  this->position_ = position;
+  return true;
+}
+
+ReplayTransport::ReplayTransport(uint8_t version, const std::vector<CaptureRecord> &records)
+    : FakeTransport(version) {
+  for (auto &record : records) {
+    if (record.type == CAPTURE_SCI_READ) {
+      this->reads_[record.reg & 0x0F].push_back(record.value);
+    }
+  }
+}
+
+uint16_t ReplayTransport::read_register_(uint8_t reg) {
+  auto &reads = this->reads_[reg & 0x0F];
+  if (!this->replaying_ || reads.empty()) {
+    return FakeTransport::read_register_(reg);
+  }
+  auto value = reads.front();
+  reads.pop_front();
+  return value;
+}
+
+CaptureReplayer::CaptureReplayer(const std::vector<CaptureRecord> &records)
+    : transport(capture_chip_version(records), records),
+      hal(capture_chip_version(records) == 3 ? static_cast<VS10XXHALChipset *>(&this->vs1003) : &this->vs1053),
+      records_(records),
+      source_(records) {
+  this->hal.set_transport(&this->transport);
+  this->device.set_hal(&this->hal);
+  this->device.set_name("replay");
+  this->scheduler.add_device(&this->device, 0);
+}
+
+void CaptureReplayer::step_() {
+  this->device.loop();
+  this->scheduler.loop();
+  host::run_scheduler();
+  host::advance_ms(1);
+}
+
+bool CaptureReplayer::run_until_(const std::function<bool()> &condition, uint32_t timeout_ms) {
+  auto until = host::now_us() + timeout_ms * 1000ULL;
+  while (!condition()) {
+    if (host::now_us() >= until) {
+      return false;
+    }
+    this->step_();
+  }
+  return true;
+}
+
+ReplayResult CaptureReplayer::run(uint32_t timeout_ms) {
+  ReplayResult result;
+  result.captured = this->records_.size();
+
+  this->hal.setup();
+  this->device.setup();
+  if (!this->run_until_([this]() { return this->device.get_init_duration_us() > 0; }, 1000)) {
+    result.difference = "the device did not become ready";
+    return result;
+  }
+
+  auto &capture = this->hal.get_capture();
+  capture.start();
+  this->transport.set_replaying(true);
+  this->device.play(&this->source_);
+  this->step_();
+  bool stopped = this->run_until_([this]() { return this->device.get_media_state() == MEDIA_STOPPED; }, timeout_ms);
+  capture.stop();
+  this->transport.set_replaying(false);
+
+  std::vector<CaptureRecord> replayed;
+  if (capture.has_overflow() || !parse_capture(capture.get_data(), capture.get_size(), replayed)) {
+    result.difference = "the replay did not fit in the capture buffer";
+    return result;
+  }
+  result.replayed = replayed.size();
+  result.sdi_match = sdi_data(this->records_) == sdi_data(replayed);
+  for (auto &record : replayed) {
+    if (record.type == CAPTURE_SDI && !record.dreq) {
+      result.sdi_dreq_low++;
+    }
+  }
+
+  size_t count = std::min(this->records_.size(), replayed.size());
+  while (result.matched < count && same_record(this->records_[result.matched], replayed[result.matched])) {
+    result.matched++;
+  }
+  char text[64];
+  if (result.matched < count) {
+    snprintf(text, sizeof(text), "record %u: ", (unsigned) result.matched);
+    result.difference = std::string(text) + "expected " + describe_record(this->records_[result.matched]) +
+                        ", replayed " + describe_record(replayed[result.matched]);
+  } else if (this->records_.size() != replayed.size()) {
+    snprintf(text, sizeof(text), "record %u: ", (unsigned) count);
+    result.difference = std::string(text) + (this->records_.size() > count
+                                                  ? "expected " + describe_record(this->records_[count]) +
+                                                        ", the replay ended"
+                                                  : "the capture ended, replayed " + describe_record(replayed[count]));
+  } else if (!stopped) {
+    result.difference = "the playback did not end within the timeout";
+  }
+  return result;
+}
+
+}  // namespace test
+}  // namespace esphome
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "esphome/components/vs10xx/vs10xx.h"
+#include "esphome/components/vs10xx/vs10xx_capture.h"
+#include "esphome/components/vs10xx/vs10xx_hal_vs1003.h"
+#include "esphome/components/vs10xx/vs10xx_hal_vs1053.h"
+#include "esphome/components/vs10xx/vs10xx_scheduler.h"
+#include "fake_transport.h"
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace test {
+
+/// A single record from a capture log (see vs10xx_capture.h).
+struct CaptureRecord {
+  /// The time since the start of the capture.
+  uint64_t time_us{0};
+  vs10xx::CaptureRecordType type{vs10xx::CAPTURE_SCI_WRITE};
+  bool dreq{false};
+  /// The register and value, for SCI records. The speed, for SPI speed
+  /// records.
+  uint8_t reg{0};
+  uint16_t value{0};
+  /// The payload, for SDI records.
+  std::vector<uint8_t> data;
+};
+
+/// Decode a capture log into records. Returns false when the log is
+/// truncated or holds an unknown record type.
+bool parse_capture(const uint8_t *data, size_t size, std::vector<CaptureRecord> &records);
+
+/// Describe a record, in the format of tools/vs10xx_capture.py.
+std::string describe_record(const CaptureRecord &record);
+
+/// An audio source that plays the audio data of a capture: the SDI data up
+/// to the moment that the stream was ended or cancelled.
+class CaptureAudioSource : public vs10xx::AudioSource {
+ public:
+  explicit CaptureAudioSource(const std::vector<CaptureRecord> &records);
+
+  void reset() override { this->position_ = 0; }
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override { return this->position_ >= this->data_.size(); }
+  bool seek(size_t position) override;
+
+  size_t size() const { return this->data_.size(); }
+
+ protected:
+  std::vector<uint8_t> data_;
+  size_t position_{0};
+};
+
+/// A fake device that answers SCI reads with the values from a capture, in
+/// the order in which they were captured, so the component takes the same
+/// decisions as it did on the real device (e.g. a watchdog that sees a
+/// stuck decode time, or a cancel that does not complete). When the
+/// captured reads of a register run out, the model answers. DREQ and the
+/// timing come from the model.
+class ReplayTransport : public FakeTransport {
+ public:
+  ReplayTransport(uint8_t version, const std::vector<CaptureRecord> &records);
+
+  /// Start answering reads from the capture. Before this, e.g. during the
+  /// device initialization, the model answers.
+  void set_replaying(bool replaying) { this->replaying_ = replaying; }
+
+ protected:
+  uint16_t read_register_(uint8_t reg) override;
+
+  std::deque<uint16_t> reads_[16];
+  bool replaying_{false};
+};
+
+/// The outcome of a replay.
+struct ReplayResult {
+  /// The number of records in the capture, and in the replay.
+  size_t captured{0};
+  size_t replayed{0};
+  /// The number of records that matched, before the first difference.
+  size_t matched{0};
+  /// Whether the replay sent the same SDI data as the capture.
+  bool sdi_match{false};
+  /// The number of SDI chunks that the replay sent while DREQ was low.
+  size_t sdi_dreq_low{0};
+  /// A description of the first difference. Empty when the replay matched
+  /// the capture record for record, apart from the timing.
+  std::string difference;
+
+  bool identical() const { return this->difference.empty(); }
+};
+
+/// Replays a capture for regression checks. The audio data from the
+/// capture are played by a VS10XX component, on a ReplayTransport, while
+/// the HAL captures the transactions again. The new capture is then
+/// compared to the original, record for record. Timing is not compared,
+/// because a real device and the model differ in timing.
+///
+/// The capture must have been started before the playback, like the
+/// capture_start action followed by a play action does. Only the first
+/// stream of a capture is replayed: a switch to another source (e.g. for an
+/// announcement) shows up as a difference.
+class CaptureReplayer {
+ public:
+  explicit CaptureReplayer(const std::vector<CaptureRecord> &records);
+
+  /// Initialize the device, play the captured audio data and compare the
+  /// transactions. The timeout is in (fake) milliseconds.
+  ReplayResult run(uint32_t timeout_ms = 600000);
+
+  ReplayTransport transport;
+  vs10xx::VS1003Chipset vs1003;
+  vs10xx::VS1053Chipset vs1053;
+  vs10xx::VS10XXHAL hal;
+  vs10xx::VS10XX device;
+  vs10xx::VS10XXScheduler scheduler;
+
+ protected:
+  void step_();
+  bool run_until_(const std::function<bool()> &condition, uint32_t timeout_ms);
+
+  const std::vector<CaptureRecord> &records_;
+  CaptureAudioSource source_;
+};
+
+/// The chip version from the first captured read of SCI_STATUS, or the
+/// version of a VS1053 when the capture holds no such read.
+uint8_t capture_chip_version(const std::vector<CaptureRecord> &records);
+
+}  // namespace test
+}  // namespace esphome
@@ -0,0 +1,344 @@
+#include "fake_transport.h"
+#include "esphome/components/vs10xx/vs10xx_constants.h"
+#include "host.h"
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+
+namespace esphome {
+namespace test {
+
+// The size of the SDI FIFO of the device. DREQ is high while at least one
+// chunk of 32 bytes fits.
+static const size_t FIFO_SIZE = 2048;
+
+// The time for which DREQ is low after an SCI write, after a clock switch
+// and after a soft reset.
+static const uint64_t SCI_WRITE_BUSY_US = 20;
+static const uint64_t CLOCK_SWITCH_BUSY_US = 100;
+static const uint64_t RESET_BUSY_US = 1500;
+
+// The time from the release of XRESET until DREQ goes high. The datasheet
+// gives 22000 XTALI cycles at 12.288 MHz, i.e. 1.8 ms.
+static const uint64_t BOOT_US = 1800;
+
+// The number of data bytes after which the decoder acknowledges SM_CANCEL.
+static const size_t CANCEL_ACK_BYTES = 64;
+
+// A stream is ended by 2048 bytes of endFillByte (zero, on the model).
+static const size_t END_FILL_SIZE = 2048;
+
+// MPEG audio bitrates in kbit/s for layer III, and sample rates in Hz, for
+// MPEG 1 and MPEG 2/2.5.
+static const uint16_t MPEG1_BITRATES[16] = {0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 0};
+static const uint16_t MPEG2_BITRATES[16] = {0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160, 0};
+static const uint32_t MPEG1_SAMPLE_RATES[4] = {44100, 48000, 32000, 0};
+
+FakeTransport::FakeTransport(uint8_t version) : version_(version) {
+  this->soft_reset_();
+  this->registers_[SCI_CLOCKF] = 0;
+}
+
+void FakeTransport::violation_(const char *format, ...) {
+  char text[128];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  this->violations_.push_back(text);
+}
+
+bool FakeTransport::is_busy_() const { return host::now_us() < this->busy_until_; }
+
+void FakeTransport::soft_reset_() {
+  // The clock settings survive a soft reset.
+  auto clockf = this->registers_[SCI_CLOCKF];
+  for (auto &reg : this->registers_) {
+    reg = 0;
+  }
+  this->registers_[SCI_MODE] = SM_SDINEW;
+  this->registers_[SCI_STATUS] = this->version_ << 4;
+  this->registers_[SCI_CLOCKF] = clockf;
+  this->fifo_ = 0;
+  this->busy_until_ = host::now_us() + RESET_BUSY_US;
+  this->decode_time_base_ = 0;
+  this->decoded_bytes_ = 0;
+  if (this->hang_cure_ <= CURED_BY_SOFT_RESET) {
+    this->hung_ = false;
+  }
+  this->end_stream_();
+}
+
+void FakeTransport::end_stream_() {
+  this->header_size_ = 0;
+  this->header_decoded_ = false;
+  this->stream_byte_rate_ = 0;
+  this->stream_bytes_ = 0;
+  this->stream_size_ = 0;
+  this->zero_run_ = 0;
+  this->registers_[SCI_HDAT0] = 0;
+  this->registers_[SCI_HDAT1] = 0;
+  this->registers_[SCI_AUDATA] = 0;
+}
+
+void FakeTransport::decode_header_() {
+  const uint8_t *h = this->header_;
+  auto size = this->header_size_;
+  uint16_t hdat0 = 0;
+  uint16_t hdat1 = 0;
+  uint16_t audata = 0;
+  uint32_t byte_rate = 0;
+  if (size >= 4 && memcmp(h, "RIFF", 4) == 0) {
+    if (size < 36) {
+      return;
+    }
+    uint16_t channels = h[22] | h[23] << 8;
+    uint32_t sample_rate = h[24] | h[25] << 8 | h[26] << 16 | h[27] << 24;
+    byte_rate = h[28] | h[29] << 8 | h[30] << 16 | h[31] << 24;
+    this->stream_size_ = (h[4] | h[5] << 8 | h[6] << 16 | uint32_t(h[7]) << 24) + 8;
+    hdat1 = 0x7665;
+    hdat0 = std::min<uint32_t>(byte_rate, 0xFFFF);
+    audata = (sample_rate & 0xFFFE) | (channels == 2 ? 1 : 0);
+  } else if (size >= 4 && h[0] == 0xFF && (h[1] & 0xE0) == 0xE0 && (h[1] & 0x06) == 0x02) {
+    // An MPEG audio layer III frame header.
+    auto version = (h[1] >> 3) & 0x03;
+    auto bitrate = (version == 3 ? MPEG1_BITRATES : MPEG2_BITRATES)[h[2] >> 4];
+    auto sample_rate = MPEG1_SAMPLE_RATES[(h[2] >> 2) & 0x03] >> (version == 3 ? 0 : version == 2 ? 1 : 2);
+    hdat1 = h[0] << 8 | h[1];
+    hdat0 = h[2] << 8 | h[3];
+    byte_rate = bitrate * 1000 / 8;
+    audata = (sample_rate & 0xFFFE) | ((h[3] >> 6) != 3 ? 1 : 0);
+  } else if (size >= 4 && h[0] == 0xFF && (h[1] & 0xF6) == 0xF0) {
+    hdat1 = 0x4154;  // AAC ADTS
+  } else if (size >= 4 && memcmp(h, "MThd", 4) == 0) {
+    hdat1 = 0x4D54;
+  } else if (size >= 4 && memcmp(h, "OggS", 4) == 0) {
+    hdat1 = 0x4F67;
+  } else if (size < sizeof(this->header_)) {
+    // Wait for more data, the format might still be recognized.
+    return;
+  } else {
+    // The MPEG audio decoder syncs to the next frame header, e.g. when a
+    // stream is resumed in the middle of a frame.
+    for (size_t i = 1; i + 4 <= size; i++) {
+      if (h[i] == 0xFF && (h[i + 1] & 0xE0) == 0xE0 && (h[i + 1] & 0x06) == 0x02 && (h[i + 2] >> 4) != 0x0F) {
+        memmove(this->header_, h + i, size - i);
+        this->header_size_ = size - i;
+        this->decode_header_();
+        return;
+      }
+    }
+  }
+  this->drain_();
+  this->header_decoded_ = true;
+  this->stream_byte_rate_ = byte_rate;
+  this->registers_[SCI_HDAT0] = hdat0 != 0 || hdat1 == 0 ? hdat0 : 1;
+  this->registers_[SCI_HDAT1] = hdat1;
+  this->registers_[SCI_AUDATA] = audata;
+}
+
+void FakeTransport::drain_() {
+  auto now = host::now_us();
+  auto rate = this->stream_byte_rate_ != 0 ? this->stream_byte_rate_ : this->byte_rate_;
+  // The fraction of a byte that was drained is carried over, so the drain
+  // rate does not depend on how often the FIFO is looked at.
+  auto total = (now - this->drained_at_) * rate + this->drain_remainder_;
+  auto drained = total / 1000000;
+  if (drained > 0 || this->fifo_ == 0) {
+    this->drain_remainder_ = drained < this->fifo_ ? total % 1000000 : 0;
+    // Running out of data in the middle of a stream is an audible gap,
+    // which lasts until new data arrive.
+    if (drained > this->fifo_ && this->header_decoded_ && !this->decoder_starved_) {
+      this->decoder_starved_ = true;
+      this->decoder_underruns_++;
+    }
+    drained = std::min<uint64_t>(this->fifo_, drained);
+    this->fifo_ -= drained;
+    this->drained_at_ = now;
+    if (this->stream_byte_rate_ != 0) {
+      this->decoded_bytes_ += drained;
+    }
+  }
+}
+
+void FakeTransport::transfer_(size_t bytes) {
+  auto now = host::now_us();
+  if (this->in_reset_) {
+    this->violation_("SPI transfer while the device is held in reset");
+  } else if (now < this->booting_until_) {
+    this->violation_("SPI transfer %u us before the device finished booting", (unsigned) (this->booting_until_ - now));
+  } else if (this->fast_ && (this->registers_[SCI_CLOCKF] & SC_MULT_MASK) == 0) {
+    // Without a clock multiplier, the device runs on XTALI, which is too
+    // slow for fast SPI.
+    this->violation_("fast SPI without a clock multiplier in SCI_CLOCKF");
+  } else if (this->fast_ && now < this->clock_switch_until_) {
+    this->violation_("fast SPI while the device switches its clock");
+  }
+  // 8 bits per byte, at 4 MHz or 200 kHz.
+  host::advance_us(bytes * (this->fast_ ? 2 : 40));
+}
+
+bool FakeTransport::read_dreq() {
+  if (this->in_reset_ || this->is_busy_()) {
+    return false;
+  }
+  this->drain_();
+  return FIFO_SIZE - this->fifo_ >= vs10xx::VS10XX_CHUNK_SIZE;
+}
+
+void FakeTransport::set_reset(bool reset) {
+  if (this->in_reset_ && !reset) {
+    // A hard reset brings all registers to their power-on values, and the
+    // device boots in slow mode.
+    this->registers_[SCI_CLOCKF] = 0;
+    this->soft_reset_();
+    this->booting_until_ = host::now_us() + BOOT_US;
+    this->busy_until_ = this->booting_until_;
+    this->hung_ = false;
+    this->hard_resets_++;
+  }
+  this->in_reset_ = reset;
+}
+
+void FakeTransport::begin_command() {
+  this->mode_ = COMMAND;
+  this->command_size_ = 0;
+  this->read_size_ = 0;
+}
+
+void FakeTransport::begin_data() { this->mode_ = DATA; }
+
+void FakeTransport::end() { this->mode_ = IDLE; }
+
+uint16_t FakeTransport::read_register_(uint8_t reg) {
+  if (reg == SCI_DECODE_TIME) {
+    this->drain_();
+    if (this->hung_) {
+      return this->decode_time_base_;
+    }
+    auto seconds = this->stream_byte_rate_ != 0 ? this->decoded_bytes_ / this->stream_byte_rate_ : 0;
+    return this->decode_time_base_ + seconds;
+  }
+  return this->registers_[reg];
+}
+
+void FakeTransport::write_register_(uint8_t reg, uint16_t value) {
+  auto now = host::now_us();
+  if (now < this->busy_until_ && now >= this->booting_until_) {
+    this->violation_("SCI write of register 0x%02X while the device is busy", reg);
+  }
+  this->sci_writes_++;
+  this->register_writes_[reg]++;
+  this->busy_until_ = now + SCI_WRITE_BUSY_US;
+  if (reg == SCI_MODE && (value & SM_RESET)) {
+    this->soft_reset_();
+    this->soft_resets_++;
+    this->registers_[SCI_MODE] = value & ~SM_RESET;
+    return;
+  }
+  if (reg == SCI_MODE && (value & SM_CANCEL) && !(this->registers_[SCI_MODE] & SM_CANCEL)) {
+    this->cancel_bytes_ = 0;
+  }
+  if (reg == SCI_CLOCKF && value != this->registers_[SCI_CLOCKF]) {
+    this->clock_switch_until_ = now + CLOCK_SWITCH_BUSY_US;
+    this->busy_until_ = this->clock_switch_until_;
+  }
+  if (reg == SCI_DECODE_TIME) {
+    this->drain_();
+    this->decode_time_base_ = value;
+    this->decoded_bytes_ = 0;
+    return;
+  }
+  this->registers_[reg] = value;
+}
+
+void FakeTransport::command_byte_(uint8_t value) {
+  if (this->command_size_ < sizeof(this->command_)) {
+    this->command_[this->command_size_++] = value;
+  }
+  auto reg = this->command_[1] & 0x0F;
+  if (this->command_size_ == 2 && this->command_[0] == 3) {
+    this->read_value_ = this->read_register_(reg);
+    this->read_size_ = 0;
+  } else if (this->command_size_ == 4 && this->command_[0] == 2) {
+    this->write_register_(reg, (this->command_[2] << 8) | this->command_[3]);
+  }
+}
+
+void FakeTransport::write_byte(uint8_t value) {
+  if (this->mode_ == COMMAND) {
+    this->transfer_(1);
+    this->command_byte_(value);
+  } else if (this->mode_ == DATA) {
+    this->write_array(&value, 1);
+  }
+}
+
+void FakeTransport::write_byte16(uint16_t value) {
+  this->write_byte(value >> 8);
+  this->write_byte(value & 0xFF);
+}
+
+void FakeTransport::write_array(const uint8_t *data, size_t size) {
+  if (this->mode_ == COMMAND) {
+    for (size_t i = 0; i < size; i++) {
+      this->write_byte(data[i]);
+    }
+    return;
+  }
+  this->transfer_(size);
+  this->drain_();
+  if (this->registers_[SCI_MODE] & SM_PDOWN) {
+    this->violation_("SDI data while the device is powered down");
+  }
+  // Data that do not fit in the FIFO are lost, like on the real device.
+  if (this->fifo_ + size > FIFO_SIZE) {
+    this->violation_("SDI overflow: %u bytes sent with %u bytes free", (unsigned) size,
+                     (unsigned) (FIFO_SIZE - this->fifo_));
+  }
+  this->fifo_ = std::min(FIFO_SIZE, this->fifo_ + size);
+  this->decoder_starved_ = false;
+  this->sdi_bytes_ += size;
+  if (this->record_sdi_) {
+    this->sdi_data_.insert(this->sdi_data_.end(), data, data + size);
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    this->zero_run_ = data[i] == 0 ? this->zero_run_ + 1 : 0;
+    // The decoder skips leading zeros while looking for a stream header.
+    if (!this->header_decoded_ && (this->header_size_ > 0 || data[i] != 0)) {
+      this->header_[this->header_size_++] = data[i];
+      this->decode_header_();
+    }
+    if (this->header_size_ > 0) {
+      this->stream_bytes_++;
+    }
+  }
+  // Silence in a WAV stream is no end of it, only the zeros after its data.
+  if (this->zero_run_ >= END_FILL_SIZE && this->header_size_ > 0 && this->stream_bytes_ >= this->stream_size_) {
+    this->end_stream_();
+  }
+
+  if ((this->registers_[SCI_MODE] & SM_CANCEL) && !this->ignore_cancel_) {
+    this->cancel_bytes_ += size;
+    if (this->cancel_bytes_ >= CANCEL_ACK_BYTES) {
+      this->registers_[SCI_MODE] &= ~SM_CANCEL;
+      this->cancels_++;
+      this->fifo_ = 0;
+      if (this->hang_cure_ == CURED_BY_CANCEL) {
+        this->hung_ = false;
+      }
+      this->end_stream_();
+    }
+  }
+}
+
+uint8_t FakeTransport::read_byte() {
+  this->transfer_(1);
+  auto shift = this->read_size_++ == 0 ? 8 : 0;
+  return (this->read_value_ >> shift) & 0xFF;
+}
+
+}  // namespace test
+}  // namespace esphome
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "esphome/components/vs10xx/vs10xx_transport.h"
+#include <string>
+#include <vector>
+
+namespace esphome {
+namespace test {
+
+/// A transport that emulates a VS10XX device, closely enough to exercise
+/// the HAL and the component on the host:
+///
+/// - SCI commands are decoded into a register file. DREQ goes low for a
+///   short while after every SCI write, and for longer after a clock switch
+///   or a reset. A hard reset keeps DREQ low for the boot time.
+/// - SDI data are sunk into a FIFO. DREQ is high while a chunk fits. The
+///   "decoder" drains the FIFO at the byte rate of the stream. That byte
+///   rate comes from the stream header for MP3 and WAV, and is the
+///   configured byte rate otherwise. When the FIFO runs empty in the middle
+///   of a stream, that is counted as an underrun.
+/// - The stream header is decoded into SCI_HDAT0/SCI_HDAT1 and SCI_AUDATA,
+///   and SCI_DECODE_TIME follows the decoded data.
+/// - SM_CANCEL is acknowledged after a number of data bytes, which ends the
+///   stream. So is a run of 2048 zero bytes, like a VS1003 gets, except
+///   inside the data of a WAV stream, where it is silence.
+///
+/// Violations of the protocol are recorded, instead of being ignored:
+/// - talking to the device while it is in reset or still booting;
+/// - an SCI write while DREQ is low after a previous SCI write;
+/// - fast SPI before SCI_CLOCKF sets a clock multiplier, or while the
+///   device switches its clock;
+/// - SDI data that do not fit in the FIFO, or that are sent while the
+///   device is powered down (SM_PDOWN).
+///
+/// The fake clock moves with the SPI transfer time of every byte.
+class FakeTransport : public vs10xx::VS10XXTransport {
+ public:
+  explicit FakeTransport(uint8_t version = 4);
+
+  void setup() override {}
+  void log_config() override {}
+  void set_fast_mode(bool fast) override { this->fast_ = fast; }
+  void begin_command() override;
+  void begin_data() override;
+  void end() override;
+  void write_byte(uint8_t value) override;
+  void write_byte16(uint16_t value) override;
+  void write_array(const uint8_t *data, size_t size) override;
+  uint8_t read_byte() override;
+  bool read_dreq() override;
+  bool has_reset() const override { return this->has_reset_; }
+  void set_reset(bool reset) override;
+
+  /// The rate (in bytes per second) at which the decoder drains the FIFO,
+  /// for streams of which the header does not tell the byte rate.
+  void set_byte_rate(uint32_t byte_rate) { this->byte_rate_ = byte_rate; }
+  void set_has_reset(bool has_reset) { this->has_reset_ = has_reset; }
+  /// Keep a copy of all SDI data, for tests that check the data.
+  void set_record_sdi(bool record) { this->record_sdi_ = record; }
+  /// Make the decoder ignore SM_CANCEL, like a decoder that hangs.
+  void set_ignore_cancel(bool ignore) { this->ignore_cancel_ = ignore; }
+  /// What clears a decoder hang: an acknowledged SM_CANCEL, a soft reset
+  /// or only a hard reset. The heavier ones clear it too.
+  enum HangCure { CURED_BY_CANCEL, CURED_BY_SOFT_RESET, CURED_BY_HARD_RESET };
+  /// Make the decoder hang: it keeps accepting data, but SCI_DECODE_TIME no
+  /// longer advances, until the hang is cleared.
+  void set_hung(bool hung, HangCure cure = CURED_BY_HARD_RESET) {
+    this->hung_ = hung;
+    this->hang_cure_ = cure;
+  }
+
+  uint16_t get_register(uint8_t reg) const { return this->registers_[reg & 0x0F]; }
+  void set_register(uint8_t reg, uint16_t value) { this->registers_[reg & 0x0F] = value; }
+  uint32_t get_sdi_bytes() const { return this->sdi_bytes_; }
+  const std::vector<uint8_t> &get_sdi_data() const { return this->sdi_data_; }
+  uint32_t get_sci_writes() const { return this->sci_writes_; }
+  /// The number of SCI writes of a single register.
+  uint32_t get_sci_writes(uint8_t reg) const { return this->register_writes_[reg & 0x0F]; }
+  bool is_fast() const { return this->fast_; }
+  /// The number of hard resets, soft resets and acknowledged cancels.
+  uint32_t get_hard_resets() const { return this->hard_resets_; }
+  uint32_t get_soft_resets() const { return this->soft_resets_; }
+  uint32_t get_cancels() const { return this->cancels_; }
+  /// The byte rate of the stream that is decoded, 0 when unknown.
+  uint32_t get_stream_byte_rate() const { return this->stream_byte_rate_; }
+  /// The number of times that the decoder ran out of data in the middle of
+  /// a stream, i.e. audible gaps.
+  uint32_t get_decoder_underruns() const { return this->decoder_underruns_; }
+
+  /// The protocol violations, in order of occurrence.
+  const std::vector<std::string> &get_violations() const { return this->violations_; }
+  void clear_violations() { this->violations_.clear(); }
+
+ protected:
+  enum Mode { IDLE, COMMAND, DATA };
+  /// The value that an SCI read of a register returns.
+  virtual uint16_t read_register_(uint8_t reg);
+  void drain_();
+  void transfer_(size_t bytes);
+  void command_byte_(uint8_t value);
+  void write_register_(uint8_t reg, uint16_t value);
+  void soft_reset_();
+  void end_stream_();
+  void decode_header_();
+  void violation_(const char *format, ...);
+  bool is_busy_() const;
+
+  uint16_t registers_[16]{};
+  uint8_t version_;
+  Mode mode_{IDLE};
+  bool fast_{false};
+  bool has_reset_{true};
+  bool in_reset_{false};
+  uint32_t hard_resets_{0};
+  uint32_t soft_resets_{0};
+
+  // The SCI command that is being transferred.
+  uint8_t command_[4]{};
+  size_t command_size_{0};
+  uint16_t read_value_{0};
+  size_t read_size_{0};
+
+  // The device is busy (DREQ low) until this time. After a reset or a clock
+  // switch, no SCI or SDI access is allowed at all until then.
+  uint64_t busy_until_{0};
+  uint64_t booting_until_{0};
+  uint64_t clock_switch_until_{0};
+
+  // The decoder model.
+  uint32_t byte_rate_{16000};
+  size_t fifo_{0};
+  uint64_t drained_at_{0};
+  uint64_t drain_remainder_{0};
+  // Large enough to hold an MPEG audio frame, to find the next frame header
+  // in a stream that starts in the middle of a frame.
+  uint8_t header_[512]{};
+  size_t header_size_{0};
+  bool header_decoded_{false};
+  uint32_t stream_byte_rate_{0};
+  // The bytes of the stream so far, and its size from a WAV header.
+  uint64_t stream_bytes_{0};
+  uint64_t stream_size_{0};
+  uint64_t decoded_bytes_{0};
+  uint16_t decode_time_base_{0};
+  size_t zero_run_{0};
+  size_t cancel_bytes_{0};
+  bool ignore_cancel_{false};
+  bool hung_{false};
+  HangCure hang_cure_{CURED_BY_HARD_RESET};
+  bool decoder_starved_{false};
+  uint32_t decoder_underruns_{0};
+  uint32_t cancels_{0};
+
+  uint32_t sdi_bytes_{0};
+  uint32_t sci_writes_{0};
+  uint32_t register_writes_[16]{};
+  bool record_sdi_{false};
+  std::vector<uint8_t> sdi_data_;
+  std::vector<std::string> violations_;
+};
+
+}  // namespace test
+}  // namespace esphome
@@ -0,0 +1,151 @@
+#include "fixture.h"
+#include "esphome/components/vs10xx/vs10xx_format.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace esphome {
+namespace test {
+
+size_t PatternSource::read(uint8_t *buffer, size_t max_size) {
+  size_t size = std::min(max_size, this->size_ - std::min(this->size_, this->position_));
+  for (size_t i = 0; i < size; i++) {
+    buffer[i] = at(this->position_ + i);
+  }
+  this->position_ += size;
+  return size;
+}
+
+bool PatternSource::seek(size_t position) {
+  if (position > this->size_) {
+    return false;
+  }
+  this->position_ = position;
+  return true;
+}
+
+size_t MemorySource::read(uint8_t *buffer, size_t max_size) {
+  size_t size = std::min(max_size, this->data_.size() - std::min(this->data_.size(), this->position_));
+  memcpy(buffer, this->data_.data() + this->position_, size);
+  this->position_ += size;
+  return size;
+}
+
+bool MemorySource::seek(size_t position) {
+  this->seeks.push_back(position);
+  if (position > this->data_.size()) {
+    return false;
+  }
+  this->position_ = position;
+  return true;
+}
+
+std::vector<uint8_t> mp3_stream(size_t size) {
+  std::vector<uint8_t> data(size, 0x55);
+  const size_t frame_size = 144 * 128000 / 44100;
+  for (size_t pos = 0; pos + 4 <= size; pos += frame_size) {
+    data[pos] = 0xFF;
+    data[pos + 1] = 0xFB;
+    data[pos + 2] = 0x90;
+    data[pos + 3] = 0x44;
+  }
+  return data;
+}
+
+std::vector<uint8_t> wav_stream(size_t size) {
+  std::vector<uint8_t> data(size, 0x11);
+  vs10xx::write_wav_header(data.data(), 8000, 1, size - vs10xx::WAV_HEADER_SIZE);
+  return data;
+}
+
+uint16_t free_udp_port() {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+  socklen_t length = sizeof(address);
+  getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length);
+  ::close(fd);
+  return ntohs(address.sin_port);
+}
+
+RtpSender::RtpSender(uint16_t port, uint32_t ssrc) : ssrc_(ssrc) {
+  this->fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  this->address_.sin_family = AF_INET;
+  this->address_.sin_port = htons(port);
+  this->address_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+}
+
+RtpSender::~RtpSender() { ::close(this->fd_); }
+
+void RtpSender::send(uint16_t seq) {
+  uint8_t packet[12 + SAMPLES * 2];
+  uint32_t timestamp = seq * SAMPLES;
+  packet[0] = 0x80;
+  packet[1] = 11;
+  packet[2] = seq >> 8;
+  packet[3] = seq;
+  for (int i = 0; i < 4; i++) {
+    packet[4 + i] = timestamp >> (24 - 8 * i);
+    packet[8 + i] = this->ssrc_ >> (24 - 8 * i);
+  }
+  for (uint32_t i = 0; i < SAMPLES; i++) {
+    auto sample = sample_at(timestamp + i);
+    packet[12 + i * 2] = sample >> 8;
+    packet[13 + i * 2] = sample;
+  }
+  sendto(this->fd_, packet, sizeof(packet), 0, reinterpret_cast<sockaddr *>(&this->address_), sizeof(this->address_));
+}
+
+TestDevice::TestDevice(const char *name, uint8_t version)
+    : transport(version), hal(version == 3 ? static_cast<vs10xx::VS10XXHALChipset *>(&this->vs1003) : &this->vs1053) {
+  this->hal.set_transport(&this->transport);
+  this->device.set_hal(&this->hal);
+  this->device.set_name(name);
+  this->scheduler.add_device(&this->device, 0);
+}
+
+bool TestDevice::start() {
+  host::set_clock_offset_us(this->clock_offset_us);
+  this->hal.setup();
+  this->device.setup();
+  host::set_clock_offset_us(0);
+  // The init duration is known once the device got ready.
+  return this->run_until([this]() { return this->device.get_init_duration_us() > 0; }, 1000);
+}
+
+void TestDevice::step() {
+  this->loop();
+  host::run_scheduler();
+  host::advance_ms(1);
+}
+
+void TestDevice::loop() {
+  host::set_clock_offset_us(this->clock_offset_us);
+  this->device.loop();
+  this->scheduler.loop();
+  host::set_clock_offset_us(0);
+}
+
+void TestDevice::run(uint32_t ms) {
+  auto until = host::now_us() + ms * 1000ULL;
+  while (host::now_us() < until) {
+    this->step();
+  }
+}
+
+bool TestDevice::run_until(const std::function<bool()> &condition, uint32_t timeout_ms) {
+  auto until = host::now_us() + timeout_ms * 1000ULL;
+  while (!condition()) {
+    if (host::now_us() >= until) {
+      return false;
+    }
+    this->step();
+  }
+  return true;
+}
+
+}  // namespace test
+}  // namespace esphome
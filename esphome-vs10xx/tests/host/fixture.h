@@ -0,0 +1,140 @@
+#pragma once
+
+#include "esphome/components/vs10xx/vs10xx.h"
+#include "esphome/components/vs10xx/vs10xx_hal_vs1003.h"
+#include "esphome/components/vs10xx/vs10xx_hal_vs1053.h"
+#include "esphome/components/vs10xx/vs10xx_scheduler.h"
+#include "fake_transport.h"
+#include "host.h"
+#include <functional>
+#include <vector>
+#include <netinet/in.h>
+
+namespace esphome {
+namespace test {
+
+/// An audio source that produces a counting byte pattern. After the
+/// configured number of bytes, it either ends or starves (returns no data,
+/// without ending) until it is fed more bytes.
+class PatternSource : public vs10xx::AudioSource {
+ public:
+  explicit PatternSource(size_t size, bool starve = false) : size_(size), starve_(starve) {}
+
+  void reset() override { this->position_ = 0; }
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override { return !this->starve_ && this->position_ >= this->size_; }
+  bool seek(size_t position) override;
+  size_t prefill_size() const override { return this->prefill_; }
+  void close() override { this->closed++; }
+
+  /// Make more bytes available to a starving source.
+  void grow(size_t size) { this->size_ += size; }
+  void set_prefill_size(size_t size) { this->prefill_ = size; }
+  size_t position() const { return this->position_; }
+
+  /// The byte at a position in the pattern.
+  static uint8_t at(size_t position) { return (position * 7 + (position >> 8)) & 0xFF; }
+
+  uint32_t closed{0};
+
+ protected:
+  size_t size_;
+  bool starve_;
+  size_t prefill_{0};
+  size_t position_{0};
+};
+
+/// An audio source that plays audio data from memory, and keeps track of
+/// where it was asked to seek to.
+class MemorySource : public vs10xx::AudioSource {
+ public:
+  explicit MemorySource(std::vector<uint8_t> data) : data_(std::move(data)) {}
+
+  void reset() override {
+    this->position_ = 0;
+    this->resets++;
+  }
+  size_t read(uint8_t *buffer, size_t max_size) override;
+  bool at_end() const override { return this->position_ >= this->data_.size(); }
+  bool seek(size_t position) override;
+
+  uint32_t resets{0};
+  std::vector<size_t> seeks;
+
+ protected:
+  std::vector<uint8_t> data_;
+  size_t position_{0};
+};
+
+/// An MPEG 1 layer III stream at 128 kbit/s (16000 bytes per second),
+/// 44.1 kHz, joint stereo. Only the frame headers matter to the emulator.
+std::vector<uint8_t> mp3_stream(size_t size);
+
+/// A WAV stream of 16 bit mono PCM at 8 kHz (16000 bytes per second), of
+/// a size including the header.
+std::vector<uint8_t> wav_stream(size_t size);
+
+/// A free UDP port on the loopback interface.
+uint16_t free_udp_port();
+
+/// Sends an L16 RTP stream of 16 bit mono audio over the loopback
+/// interface. The test decides which packets are sent, and in which order.
+class RtpSender {
+ public:
+  /// The number of frames in a packet: 10 ms at 16 kHz.
+  static const uint32_t SAMPLES = 160;
+
+  explicit RtpSender(uint16_t port, uint32_t ssrc = 0x12345678);
+  ~RtpSender();
+
+  /// Send a packet. Its payload is the part of the ramp at its timestamp.
+  void send(uint16_t seq);
+
+  /// The sample at a position of the stream: a ramp, which never hits
+  /// zero, so concealed (silent) frames stand out.
+  static int16_t sample_at(uint32_t position) { return 1 + position % 30000; }
+
+ protected:
+  int fd_;
+  uint32_t ssrc_;
+  sockaddr_in address_{};
+};
+
+/// A VS1053 (or a VS1003, by its version) on a fake transport, with a feed
+/// scheduler of its own.
+class TestDevice {
+ public:
+  explicit TestDevice(const char *name = "vs10xx", uint8_t version = 4);
+
+  FakeTransport transport;
+  vs10xx::VS1003Chipset vs1003;
+  vs10xx::VS1053Chipset vs1053;
+  vs10xx::VS10XXHAL hal;
+  vs10xx::VS10XX device;
+  vs10xx::VS10XXScheduler scheduler;
+  /// The offset of the clock of the device from the fake clock (see
+  /// host::set_clock_offset_us()).
+  uint32_t clock_offset_us{0};
+
+  /// Set up the device, and run the main loop until the device is ready.
+  /// Returns false when the device did not become ready.
+  bool start();
+
+  /// Run a single main loop iteration, followed by 1 ms of idle time.
+  void step();
+
+  /// Run a single main loop iteration of the device and its scheduler,
+  /// without the component scheduler and the idle time. Tests with several
+  /// devices use this to run them in lockstep.
+  void loop();
+
+  /// Run the main loop for a while.
+  void run(uint32_t ms);
+
+  /// Run the main loop until the condition is met. Returns false when it
+  /// was not met within the timeout.
+  bool run_until(const std::function<bool()> &condition, uint32_t timeout_ms);
+};
+
+}  // namespace test
+}  // namespace esphome
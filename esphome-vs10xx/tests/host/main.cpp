@@ -0,0 +1,62 @@
+#include "test.h"
+#include "esphome/core/log.h"
+#include <cstring>
+
+namespace esphome {
+namespace test {
+
+static TestCase *tests = nullptr;
+static TestCase **tests_tail = &tests;
+static int failures = 0;
+
+bool register_test(TestCase *test) {
+  // Tests run in the order of registration, which is the link order.
+  *tests_tail = test;
+  tests_tail = &test->next;
+  return true;
+}
+
+void fail(const char *file, int line, const std::string &message) {
+  printf("  %s:%d: %s\n", file, line, message.c_str());
+  failures++;
+}
+
+}  // namespace test
+}  // namespace esphome
+
+// Usage: host_tests [-v] [name...]
+// Without names, all tests run. With -v, debug logging is written to stdout.
+int main(int argc, char **argv) {
+  using namespace esphome;
+  int log_level = HOST_LOG_NONE;
+  int first_name = 1;
+  if (argc > 1 && strcmp(argv[1], "-v") == 0) {
+    log_level = HOST_LOG_DEBUG;
+    first_name = 2;
+  }
+
+  int run = 0;
+  int failed = 0;
+  for (auto *test = test::tests; test != nullptr; test = test->next) {
+    bool selected = first_name == argc;
+    for (int i = first_name; i < argc; i++) {
+      selected |= strcmp(argv[i], test->name) == 0;
+    }
+    if (!selected) {
+      continue;
+    }
+    host::reset();
+    host::set_log_level(log_level);
+    auto failures_before = test::failures;
+    test->run();
+    run++;
+    if (test::failures != failures_before) {
+      printf("FAIL %s\n", test->name);
+      failed++;
+    } else {
+      printf("ok   %s\n", test->name);
+    }
+  }
+  printf("%d tests, %d failed\n", run, failed);
+  return failed == 0 && run > 0 ? 0 : 1;
+}
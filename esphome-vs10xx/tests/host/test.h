@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "host.h"
+
+// A minimal test framework. Tests register themselves using TEST(), and are
+// run by main.cpp. The host state (clock, scheduler, preferences) is reset
+// before every test.
+
+namespace esphome {
+namespace test {
+
+struct TestCase {
+  const char *name;
+  void (*run)();
+  TestCase *next;
+};
+
+bool register_test(TestCase *test);
+void fail(const char *file, int line, const std::string &message);
+
+template<typename A, typename B> void expect_eq(const A &a, const B &b, const char *expr, const char *file, int line) {
+  if (a == b) {
+    return;
+  }
+  std::ostringstream message;
+  message << expr << ": got " << +a << ", expected " << +b;
+  fail(file, line, message.str());
+}
+
+}  // namespace test
+}  // namespace esphome
+
+#define TEST(name) \
+  static void test_##name(); \
+  static esphome::test::TestCase test_case_##name{#name, test_##name, nullptr}; \
+  static bool test_registered_##name = esphome::test::register_test(&test_case_##name); \
+  static void test_##name()
+
+#define EXPECT(expr) \
+  do { \
+    if (!(expr)) \
+      esphome::test::fail(__FILE__, __LINE__, #expr); \
+  } while (0)
+
+#define EXPECT_EQ(a, b) esphome::test::expect_eq((a), (b), #a " == " #b, __FILE__, __LINE__)
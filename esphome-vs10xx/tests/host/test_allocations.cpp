@@ -0,0 +1,64 @@
+#include "fixture.h"
+#include "test.h"
+#include <cstdlib>
+#include <new>
+
+// The global allocator is hooked, to count the heap allocations that are
+// made while a test counts them.
+//
+// What is covered: after setup(), the device initialization, playing a blob,
+// volume changes and stopping do not allocate. What is not covered, and does
+// allocate: connecting to an HTTP stream (the URL and header parsing use
+// std::string), and registering std::function callbacks (at setup time).
+
+static bool counting = false;
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  if (counting) {
+    allocations++;
+  }
+  void *p = malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void *p) noexcept { free(p); }
+void operator delete(void *p, size_t size) noexcept { free(p); }
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+static uint8_t blob_data[32 * 1024];
+
+TEST(no_allocations_during_playback) {
+  TestDevice t;
+  t.device.set_preferences_quiet_period(100);
+  blob::Blob blob(blob_data, sizeof(blob_data));
+  t.hal.setup();
+  t.device.setup();
+
+  allocations = 0;
+  counting = true;
+  // The device initialization.
+  bool ready = t.run_until([&]() { return t.device.get_init_duration_us() > 0; }, 1000);
+  t.device.play(&blob);
+  t.run(200);
+  bool playing = t.device.get_media_state() == MEDIA_PLAYING;
+  t.device.change_volume(-0.1f);
+  t.device.set_volume(0.5f, 0.6f);
+  t.run(200);
+  t.device.stop();
+  bool stopped = t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 1000);
+  counting = false;
+
+  EXPECT(ready);
+  EXPECT(playing);
+  EXPECT(stopped);
+  EXPECT_EQ(host::preference_saves(), 1u);
+  EXPECT_EQ(allocations, 0u);
+}
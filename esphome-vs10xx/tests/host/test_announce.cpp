@@ -0,0 +1,218 @@
+#include "esphome/components/vs10xx/vs10xx_media_player.h"
+#include "fixture.h"
+#include "test.h"
+#include <algorithm>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::MemorySource;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+static const uint32_t DUCK_TIME = 300;
+
+/// A device that plays an MP3 stream, which is interrupted by an
+/// announcement of the byte pattern of a PatternSource.
+class AnnounceFixture {
+ public:
+  explicit AnnounceFixture(size_t announcement_size, bool starve = false)
+      : origin_data(test::mp3_stream(160000)), origin(origin_data), announcement(announcement_size, starve) {
+    this->t.device.set_duck_time(DUCK_TIME);
+    this->t.device.set_duck_level(0.25f);
+    this->t.transport.set_record_sdi(true);
+  }
+
+  /// Start the device, and play the MP3 stream for a while.
+  bool start() {
+    if (!this->t.start()) {
+      return false;
+    }
+    this->t.device.play(&this->origin);
+    return this->t.run_until([this]() { return this->t.transport.get_sdi_bytes() > 8000; }, 2000);
+  }
+
+  /// Run a main loop iteration, in which the loop of the device and the
+  /// loop of the feed scheduler are run separately, to tell which of them
+  /// writes the volume.
+  void step() {
+    auto writes = this->t.transport.get_sci_writes(SCI_VOL);
+    this->t.device.loop();
+    this->loop_volume_writes += this->t.transport.get_sci_writes(SCI_VOL) - writes;
+    this->loop_done_at = host::now_us();
+    writes = this->t.transport.get_sci_writes(SCI_VOL);
+    this->t.scheduler.loop();
+    this->feed_volume_writes += this->t.transport.get_sci_writes(SCI_VOL) - writes;
+    host::run_scheduler();
+    host::advance_ms(1);
+  }
+
+  /// Where the announcement starts in the audio data that were sent, or
+  /// SIZE_MAX when it did not start.
+  size_t announcement_start() const {
+    uint8_t start[32];
+    for (size_t i = 0; i < sizeof(start); i++) {
+      start[i] = PatternSource::at(i);
+    }
+    auto &sdi = this->t.transport.get_sdi_data();
+    auto found = std::search(sdi.begin(), sdi.end(), start, start + sizeof(start));
+    return found == sdi.end() ? SIZE_MAX : found - sdi.begin();
+  }
+
+  TestDevice t;
+  std::vector<uint8_t> origin_data;
+  MemorySource origin;
+  PatternSource announcement;
+  uint32_t loop_volume_writes{0};
+  uint32_t feed_volume_writes{0};
+  /// When the loop of the device ended, in the last step.
+  uint64_t loop_done_at{0};
+};
+
+// The attenuation of the louder channel. A higher value is quieter.
+static uint8_t attenuation(const TestDevice &t) {
+  auto volume = t.transport.get_register(SCI_VOL);
+  return std::min(volume >> 8, volume & 0xFF);
+}
+
+TEST(announce_ducks_from_feed_without_starving_decoder) {
+  // The announcement starves before it is prebuffered, so the audio stays
+  // ducked.
+  AnnounceFixture f(100, true);
+  EXPECT(f.start());
+  auto before = attenuation(f.t);
+  auto underruns = f.t.transport.get_decoder_underruns();
+
+  f.t.device.announce(&f.announcement);
+  std::vector<uint8_t> ramp{before};
+  auto until = host::now_us() + (DUCK_TIME + 100) * 1000ULL;
+  while (host::now_us() < until) {
+    f.step();
+    if (attenuation(f.t) != ramp.back()) {
+      ramp.push_back(attenuation(f.t));
+    }
+  }
+  // The volume is ramped down in steps, at moments that the feed loop has
+  // DREQ high, so the ramp never holds up the audio data.
+  EXPECT_EQ(f.loop_volume_writes, 0u);
+  EXPECT(f.feed_volume_writes >= 10);
+  EXPECT(ramp.size() >= 10);
+  EXPECT(std::is_sorted(ramp.begin(), ramp.end()));
+  EXPECT(ramp.back() > before);
+  EXPECT_EQ(f.t.transport.get_decoder_underruns(), underruns);
+  EXPECT(f.t.transport.get_violations().empty());
+  EXPECT(f.t.device.is_announcing());
+  EXPECT_EQ(f.announcement_start(), SIZE_MAX);
+}
+
+TEST(announce_cuts_in_once_prebuffered) {
+  // Without a prefill size, the announcement is prebuffered at the read
+  // ahead size (512 bytes). The device does not prefill it on top of that.
+  AnnounceFixture f(100, true);
+  EXPECT(f.start());
+  f.t.device.announce(&f.announcement);
+  // The duck is done, but the announcement is not prebuffered yet.
+  for (uint32_t i = 0; i < DUCK_TIME + 100; i++) {
+    f.step();
+  }
+  EXPECT(f.t.device.is_announcing());
+  EXPECT_EQ(f.announcement_start(), SIZE_MAX);
+  f.announcement.grow(400);
+  f.step();
+  EXPECT_EQ(f.announcement_start(), SIZE_MAX);
+
+  // Once it is buffered, the announcement cuts in, and plays from its
+  // start.
+  f.announcement.grow(12);
+  EXPECT(f.t.run_until([&]() { return f.announcement_start() != SIZE_MAX; }, 100));
+  f.t.run(100);
+  auto start = f.announcement_start();
+  auto &sdi = f.t.transport.get_sdi_data();
+  EXPECT(sdi.size() >= start + 512);
+  for (size_t i = 0; i < 512 && start + i < sdi.size(); i++) {
+    if (sdi[start + i] != PatternSource::at(i)) {
+      EXPECT_EQ(sdi[start + i], PatternSource::at(i));
+      break;
+    }
+  }
+  EXPECT(f.t.transport.get_violations().empty());
+}
+
+TEST(announce_resumes_mp3_where_interrupted) {
+  AnnounceFixture f(4096);
+  // The format of the interrupted audio is known from the watchdog checks,
+  // which read the status of the decoder.
+  f.t.device.set_watchdog_timeout(2000);
+  EXPECT(f.start());
+  f.t.run(2500);
+  auto before = attenuation(f.t);
+  f.t.device.announce(&f.announcement);
+  EXPECT(f.t.run_until([&]() { return !f.t.device.is_announcing(); }, 2000));
+
+  // The MP3 data that were sent before the cut in.
+  auto &sdi = f.t.transport.get_sdi_data();
+  auto mismatch = std::mismatch(sdi.begin(), sdi.end(), f.origin_data.begin());
+  size_t interrupted_at = mismatch.first - sdi.begin();
+  EXPECT(interrupted_at > 8000);
+  EXPECT(!f.origin.seeks.empty());
+  if (!f.origin.seeks.empty()) {
+    EXPECT_EQ(f.origin.seeks.back(), interrupted_at);
+  }
+
+  // After the announcement, the MP3 continues at that position, and fades
+  // back in.
+  auto sent = sdi.size();
+  EXPECT(f.t.run_until([&]() { return sdi.size() > sent + 4096; }, 1000));
+  auto resumed = std::search(sdi.begin() + sent, sdi.end(), f.origin_data.begin() + interrupted_at,
+                             f.origin_data.begin() + interrupted_at + 2048);
+  EXPECT(resumed != sdi.end());
+  EXPECT(f.t.run_until([&]() { return attenuation(f.t) == before; }, DUCK_TIME + 100));
+  EXPECT_EQ(f.t.device.get_media_state(), MEDIA_PLAYING);
+  EXPECT(f.t.transport.get_violations().empty());
+}
+
+TEST(announce_latency_from_request_to_first_data) {
+  AnnounceFixture f(4096);
+  EXPECT(f.start());
+  EXPECT_EQ(f.t.device.get_announce_latency_us(), 0u);
+  auto requested = host::now_us();
+  f.t.device.announce(&f.announcement);
+  // The latency is known once the feed loop sends the first announcement
+  // data, which is after the loop of the device made it cut in.
+  while (f.announcement_start() == SIZE_MAX && host::now_us() - requested < 2000000) {
+    f.step();
+  }
+  EXPECT(f.announcement_start() != SIZE_MAX);
+  auto latency = f.t.device.get_announce_latency_us();
+  // The announcement waits for the duck, so it cuts in after that.
+  EXPECT(latency >= DUCK_TIME * 1000);
+  EXPECT(latency >= f.loop_done_at - requested);
+  EXPECT(latency <= host::now_us() - requested);
+
+  // The next bursts leave it alone.
+  f.t.run(50);
+  EXPECT_EQ(f.t.device.get_announce_latency_us(), latency);
+}
+
+TEST(media_player_follows_announcement) {
+  AnnounceFixture f(4096);
+  VS10XXMediaPlayer player;
+  player.set_parent(&f.t.device);
+  EXPECT(f.start());
+  player.setup();
+  EXPECT_EQ(player.state, media_player::MEDIA_PLAYER_STATE_PLAYING);
+
+  f.t.device.announce(&f.announcement);
+  player.loop();
+  EXPECT_EQ(player.state, media_player::MEDIA_PLAYER_STATE_ANNOUNCING);
+  EXPECT(f.t.run_until([&]() { return !f.t.device.is_announcing(); }, 2000));
+  player.loop();
+  EXPECT_EQ(player.state, media_player::MEDIA_PLAYER_STATE_PLAYING);
+
+  player.make_call().set_command(media_player::MEDIA_PLAYER_COMMAND_PAUSE).perform();
+  EXPECT_EQ(player.state, media_player::MEDIA_PLAYER_STATE_PAUSED);
+  player.make_call().set_command(media_player::MEDIA_PLAYER_COMMAND_STOP).perform();
+  EXPECT(f.t.run_until([&]() { return f.t.device.get_media_state() == MEDIA_STOPPED; }, 1000));
+  player.loop();
+  EXPECT_EQ(player.state, media_player::MEDIA_PLAYER_STATE_IDLE);
+  EXPECT_EQ(player.publish_count, 5u);
+}
@@ -0,0 +1,120 @@
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::FakeTransport;
+using esphome::test::TestDevice;
+
+/// A device on which SCI_VOL reads back wrong on fast SPI, for a number of
+/// reads. This makes the communication test after the switch to fast SPI
+/// fail.
+class FlakyTransport : public FakeTransport {
+ public:
+  uint32_t bad_reads{0};
+
+ protected:
+  uint16_t read_register_(uint8_t reg) override {
+    auto value = FakeTransport::read_register_(reg);
+    if (reg == SCI_VOL && this->is_fast() && this->bad_reads > 0) {
+      this->bad_reads--;
+      return value ^ 0x0101;
+    }
+    return value;
+  }
+};
+
+/// A device that is started with fast boot enabled, on a flaky transport.
+class FastBootDevice : public TestDevice {
+ public:
+  FastBootDevice() {
+    this->hal.set_transport(&this->flaky);
+    this->device.set_fast_boot(true);
+  }
+
+  FlakyTransport flaky;
+};
+
+TEST(fast_boot_skips_communication_sweep) {
+  // The first boot has no verified configuration, so it does the full
+  // initialization and stores the configuration.
+  FastBootDevice first;
+  EXPECT(first.start());
+  EXPECT_EQ(first.device.get_device_state(), DEVICE_READY);
+  auto full_writes = first.flaky.get_sci_writes();
+  auto full_verify_us = first.device.get_phase_duration_us(DEVICE_VERIFY_CHIPSET);
+  EXPECT_EQ(host::preference_saves(), 1u);
+
+  // The next boot trusts it: the slow sweep is skipped, and the fast one is
+  // shortened. The configuration is not stored again.
+  FastBootDevice second;
+  EXPECT(second.start());
+  EXPECT_EQ(second.device.get_device_state(), DEVICE_READY);
+  EXPECT(second.flaky.get_sci_writes() + 20 < full_writes);
+  EXPECT(second.device.get_phase_duration_us(DEVICE_VERIFY_CHIPSET) < full_verify_us);
+  EXPECT_EQ(second.flaky.get_hard_resets(), 1u);
+  EXPECT(second.flaky.get_violations().empty());
+  EXPECT_EQ(host::preference_saves(), 1u);
+
+  // Without fast boot, the stored configuration is not used.
+  TestDevice third;
+  EXPECT(third.start());
+  EXPECT_EQ(third.transport.get_sci_writes(), full_writes);
+}
+
+TEST(fast_boot_failure_falls_back_to_full_init) {
+  FastBootDevice first;
+  EXPECT(first.start());
+  auto full_writes = first.flaky.get_sci_writes();
+
+  // The shortened test on fast SPI fails. The stored configuration is
+  // marked unverified, and the full initialization follows from a new
+  // hard reset. That one succeeds, and stores the configuration again.
+  FastBootDevice second;
+  second.flaky.bad_reads = 1;
+  EXPECT(second.start());
+  EXPECT_EQ(second.device.get_device_state(), DEVICE_READY);
+  EXPECT_EQ(second.flaky.get_hard_resets(), 2u);
+  EXPECT_EQ(host::preference_saves(), 3u);
+
+  // So the next boot is a fast one again.
+  FastBootDevice third;
+  EXPECT(third.start());
+  EXPECT(third.flaky.get_sci_writes() + 20 < full_writes);
+}
+
+TEST(fast_boot_failure_is_remembered) {
+  FastBootDevice first;
+  EXPECT(first.start());
+  auto full_writes = first.flaky.get_sci_writes();
+
+  // Both the fast and the full initialization fail, so the device fails.
+  FastBootDevice second;
+  second.flaky.bad_reads = 1000;
+  EXPECT(!second.start());
+  EXPECT_EQ(second.device.get_device_state(), DEVICE_FAILED);
+  EXPECT_EQ(host::preference_saves(), 2u);
+
+  // The configuration stays unverified, so the next boot does the full
+  // initialization.
+  FastBootDevice third;
+  EXPECT(third.start());
+  EXPECT_EQ(third.flaky.get_sci_writes(), full_writes);
+}
+
+TEST(phase_durations_published_as_sensors) {
+  TestDevice t;
+  sensor::Sensor reset, verify, audio;
+  t.device.set_phase_time_sensor(DEVICE_RESET, &reset);
+  t.device.set_phase_time_sensor(DEVICE_VERIFY_CHIPSET, &verify);
+  t.device.set_phase_time_sensor(DEVICE_INIT_AUDIO, &audio);
+  t.device.set_sensor_update_interval(1000);
+  EXPECT(t.start());
+  t.run(1500);
+  EXPECT(verify.publish_count >= 1);
+  EXPECT_EQ(verify.state, t.device.get_phase_duration_us(DEVICE_VERIFY_CHIPSET) / 1000.0f);
+  // The hard reset waits for the boot of the device, which takes about 2 ms
+  // on the emulator.
+  EXPECT(reset.state >= 1.0f);
+  EXPECT(audio.state > 0.0f);
+}
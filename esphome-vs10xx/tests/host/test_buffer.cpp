@@ -0,0 +1,109 @@
+#include "esphome/components/vs10xx/vs10xx_buffer.h"
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+
+// Drains the buffer, checking that the data follow the pattern from the
+// provided position on.
+static size_t drain(VS10XXBuffer &buffer, size_t position, size_t max_size) {
+  size_t drained = 0;
+  while (drained < max_size) {
+    size_t size;
+    auto *data = buffer.peek(max_size - drained, &size);
+    if (size == 0) {
+      break;
+    }
+    for (size_t i = 0; i < size; i++) {
+      EXPECT_EQ(data[i], PatternSource::at(position + drained + i));
+    }
+    buffer.consume(size);
+    drained += size;
+  }
+  return drained;
+}
+
+TEST(buffer_fill_and_drain) {
+  VS10XXBuffer buffer;
+  EXPECT(buffer.allocate(100));
+  EXPECT_EQ(buffer.fill_level(), 0.0f);
+  PatternSource source(1000);
+  EXPECT_EQ(buffer.fill_from(&source, 1000), 100u);
+  EXPECT_EQ(buffer.free(), 0u);
+  EXPECT_EQ(buffer.fill_level(), 1.0f);
+  EXPECT_EQ(drain(buffer, 0, 30), 30u);
+  EXPECT_EQ(buffer.available(), 70u);
+  EXPECT_EQ(buffer.fill_from(&source, 10), 10u);
+  EXPECT_EQ(buffer.available(), 80u);
+}
+
+TEST(buffer_wraps_around) {
+  VS10XXBuffer buffer;
+  buffer.allocate(100);
+  PatternSource source(1000);
+  buffer.fill_from(&source, 100);
+  drain(buffer, 0, 70);
+  // The free space is split over the end and the start of the memory, so
+  // filling it takes two reads.
+  EXPECT_EQ(buffer.fill_from(&source, 100), 70u);
+  // A peek never crosses the end of the memory.
+  size_t size;
+  buffer.peek(100, &size);
+  EXPECT_EQ(size, 30u);
+  EXPECT_EQ(drain(buffer, 70, 100), 100u);
+  EXPECT_EQ(buffer.available(), 0u);
+}
+
+TEST(buffer_stops_when_source_runs_dry) {
+  VS10XXBuffer buffer;
+  buffer.allocate(100);
+  PatternSource source(40, true);
+  EXPECT_EQ(buffer.fill_from(&source, 100), 40u);
+  EXPECT_EQ(buffer.fill_from(&source, 100), 0u);
+  source.grow(20);
+  EXPECT_EQ(buffer.fill_from(&source, 100), 20u);
+  EXPECT_EQ(drain(buffer, 0, 100), 60u);
+}
+
+TEST(buffer_clear) {
+  VS10XXBuffer buffer;
+  buffer.allocate(64);
+  PatternSource source(1000);
+  buffer.fill_from(&source, 50);
+  buffer.consume(20);
+  buffer.clear();
+  EXPECT_EQ(buffer.available(), 0u);
+  EXPECT_EQ(buffer.free(), 64u);
+}
+
+TEST(prebuffered_source_reads_buffer_first) {
+  PatternSource source(5000);
+  PrebufferedSource prebuffered;
+  prebuffered.allocate(1024);
+  prebuffered.set_source(&source);
+  prebuffered.prebuffer();
+  EXPECT_EQ(prebuffered.buffered(), 1024u);
+  EXPECT(prebuffered.is_prebuffered());
+  // A read continues with the source, after the buffered data.
+  uint8_t data[1500];
+  EXPECT_EQ(prebuffered.read(data, sizeof(data)), sizeof(data));
+  for (size_t i = 0; i < sizeof(data); i++) {
+    EXPECT_EQ(data[i], PatternSource::at(i));
+  }
+  EXPECT(!prebuffered.at_end());
+}
+
+TEST(prebuffered_source_waits_for_prefill) {
+  PatternSource source(300, true);
+  source.set_prefill_size(800);
+  PrebufferedSource prebuffered;
+  prebuffered.allocate(1024);
+  prebuffered.set_source(&source);
+  prebuffered.prebuffer();
+  EXPECT(!prebuffered.is_prebuffered());
+  source.grow(600);
+  prebuffered.prebuffer();
+  EXPECT(prebuffered.is_prebuffered());
+}
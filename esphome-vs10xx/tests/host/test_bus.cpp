@@ -0,0 +1,197 @@
+#include "fixture.h"
+#include "test.h"
+#include <utility>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::FakeTransport;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+/// A pattern source with the frame headers of an MPEG 1 layer III stream at
+/// 128 kbit/s, so the decoder plays it at 16000 bytes per second.
+class Mp3Source : public PatternSource {
+ public:
+  using PatternSource::PatternSource;
+  size_t read(uint8_t *buffer, size_t max_size) override {
+    static const uint8_t HEADER[4] = {0xFF, 0xFB, 0x90, 0x44};
+    static const size_t FRAME_SIZE = 144 * 128000 / 44100;
+    auto start = this->position();
+    auto size = PatternSource::read(buffer, max_size);
+    for (size_t i = 0; i < size; i++) {
+      auto offset = (start + i) % FRAME_SIZE;
+      if (offset < sizeof(HEADER)) {
+        buffer[i] = HEADER[offset];
+      }
+    }
+    return size;
+  }
+};
+
+TEST(bus_shared_with_large_transfers) {
+  TestDevice t;
+  EXPECT(t.start());
+  Mp3Source source(16000 * 10);
+  t.device.play(&source);
+  t.run(200);
+
+  // An SD card that reads large blocks, holding the bus for 40 ms out of
+  // every 50 ms. The device plays through every transfer from its FIFO.
+  for (int i = 0; i < 40; i++) {
+    EXPECT(t.device.request_bus());
+    host::advance_ms(40);
+    t.device.release_bus();
+    t.run(10);
+  }
+  EXPECT_EQ(t.transport.get_decoder_underruns(), 0u);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  auto &stats = t.scheduler.get_bus_stats();
+  EXPECT_EQ(stats.grants, 40u);
+  EXPECT_EQ(stats.grant_timeouts, 0u);
+  EXPECT(stats.other_us >= 40 * 40000u);
+  EXPECT(t.device.get_playback_stats().bus_time_us > 0);
+}
+
+TEST(bus_grant_blocks_sci) {
+  TestDevice t;
+  EXPECT(t.start());
+  Mp3Source source(16000 * 10);
+  t.device.play(&source);
+  t.run(100);
+
+  // The main loop keeps running while the other device holds the bus, but
+  // the volume change waits for the release.
+  EXPECT(t.device.request_bus());
+  auto writes = t.transport.get_sci_writes();
+  t.device.set_volume(0.4f, 0.4f);
+  t.run(20);
+  EXPECT_EQ(t.transport.get_sci_writes(), writes);
+  t.device.release_bus();
+  t.run(5);
+  EXPECT(t.transport.get_sci_writes() > writes);
+  EXPECT_EQ(t.transport.get_decoder_underruns(), 0u);
+}
+
+TEST(bus_grant_taken_back_after_timeout) {
+  TestDevice t;
+  t.scheduler.set_bus_grant_timeout(50);
+  EXPECT(t.start());
+  Mp3Source source(16000 * 10);
+  t.device.play(&source);
+  t.run(100);
+
+  // The other device never releases the bus.
+  EXPECT(t.device.request_bus());
+  t.run(100);
+  auto &stats = t.scheduler.get_bus_stats();
+  EXPECT(!t.scheduler.is_bus_granted());
+  EXPECT_EQ(stats.grant_timeouts, 1u);
+  EXPECT(stats.other_us >= 50000u && stats.other_us < 52000u);
+  EXPECT_EQ(t.transport.get_decoder_underruns(), 0u);
+}
+
+/// The SDI transactions on a shared bus: the device and the bytes sent.
+using SdiLog = std::vector<std::pair<char, size_t>>;
+
+/// A fake device that logs its SDI transactions to a log that it shares
+/// with the other devices on the bus.
+class LoggingTransport : public FakeTransport {
+ public:
+  LoggingTransport(char id, SdiLog *log) : id_(id), log_(log) {}
+
+  void begin_data() override {
+    FakeTransport::begin_data();
+    this->log_->push_back({this->id_, 0});
+  }
+  void write_array(const uint8_t *data, size_t size) override {
+    if (this->mode_ == DATA) {
+      this->log_->back().second += size;
+    }
+    FakeTransport::write_array(data, size);
+  }
+
+ protected:
+  char id_;
+  SdiLog *log_;
+};
+
+/// A device on a bus that is shared with another one.
+class BusDevice : public TestDevice {
+ public:
+  BusDevice(const char *name, char id, SdiLog *log, uint32_t byte_rate) : TestDevice(name), logging(id, log) {
+    this->logging.set_byte_rate(byte_rate);
+    this->hal.set_transport(&this->logging);
+  }
+
+  LoggingTransport logging;
+};
+
+TEST(bus_scheduler_serves_devices_by_priority) {
+  // A slow stream, and a fast one on a device with a higher priority. The
+  // slow one is added first, so only the priority puts the fast one first.
+  SdiLog log;
+  BusDevice slow("slow", 'S', &log, 16000);
+  BusDevice fast("fast", 'F', &log, 64000);
+  VS10XXScheduler scheduler;
+  scheduler.add_device(&slow.device, 0);
+  scheduler.add_device(&fast.device, 10);
+  EXPECT(slow.start());
+  EXPECT(fast.start());
+  auto loop = [&](uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      slow.device.loop();
+      fast.device.loop();
+      scheduler.loop();
+      host::run_scheduler();
+      host::advance_ms(1);
+    }
+  };
+
+  // After 2 s, the slow stream starves.
+  PatternSource slow_source(16000 * 2, true);
+  PatternSource fast_source(64000 * 3);
+  slow.device.play(&slow_source);
+  fast.device.play(&fast_source);
+  loop(800);
+
+  // Both FIFOs start empty, with room for several bursts. Every visit sends
+  // one burst, so the devices take turns, in order of priority.
+  EXPECT(log.size() >= 8);
+  for (size_t i = 0; i < 8 && i < log.size(); i++) {
+    char expected = i % 2 == 0 ? 'F' : 'S';
+    EXPECT_EQ(log[i].first, expected);
+  }
+  size_t slow_bursts = 0, fast_bursts = 0;
+  for (auto &entry : log) {
+    EXPECT(entry.second > 0 && entry.second <= VS10XX_MAX_BURST_SIZE);
+    (entry.first == 'S' ? slow_bursts : fast_bursts)++;
+  }
+  EXPECT_EQ(slow.logging.get_decoder_underruns(), 0u);
+  EXPECT_EQ(fast.logging.get_decoder_underruns(), 0u);
+
+  // The stats are per device: every burst is one SDI transaction, and the
+  // fast stream holds the bus for about four times as long.
+  auto &slow_stats = slow.device.get_playback_stats();
+  auto &fast_stats = fast.device.get_playback_stats();
+  EXPECT_EQ(slow_stats.bursts, slow_bursts);
+  EXPECT_EQ(fast_stats.bursts, fast_bursts);
+  EXPECT_EQ(slow_stats.sdi_bytes, slow.logging.get_sdi_bytes());
+  EXPECT_EQ(fast_stats.sdi_bytes, fast.logging.get_sdi_bytes());
+  EXPECT(slow_stats.bus_time_us > 0);
+  EXPECT(fast_stats.bus_time_us > 3 * slow_stats.bus_time_us);
+  EXPECT(fast_stats.bus_time_us < 5 * slow_stats.bus_time_us);
+  EXPECT_EQ(slow_stats.underruns, 0u);
+  EXPECT_EQ(fast_stats.underruns, 0u);
+
+  // The starving stream counts underruns of its own, which do not affect
+  // the other one.
+  loop(1500);
+  EXPECT(slow.device.get_playback_stats().underruns > 0);
+  EXPECT(slow.logging.get_decoder_underruns() > 0);
+  EXPECT_EQ(fast.device.get_playback_stats().underruns, 0u);
+  EXPECT_EQ(fast.logging.get_decoder_underruns(), 0u);
+  EXPECT_EQ(fast.device.get_media_state(), MEDIA_PLAYING);
+  EXPECT(slow.logging.get_violations().empty());
+  EXPECT(fast.logging.get_violations().empty());
+}
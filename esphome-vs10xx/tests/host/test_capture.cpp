@@ -0,0 +1,100 @@
+#include "capture_replay.h"
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::CaptureRecord;
+using esphome::test::CaptureReplayer;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+/// Capture the playback of a pattern, like the capture_start action
+/// followed by a play action does on a device.
+static std::vector<CaptureRecord> capture_playback(size_t size, uint32_t watchdog_timeout = 0) {
+  std::vector<CaptureRecord> records;
+  TestDevice t;
+  t.device.set_watchdog_timeout(watchdog_timeout);
+  EXPECT(t.start());
+  auto &capture = t.hal.get_capture();
+  capture.start();
+  PatternSource source(size);
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 5000));
+  capture.stop();
+  EXPECT(!capture.has_overflow());
+  EXPECT(test::parse_capture(capture.get_data(), capture.get_size(), records));
+  // The replay starts from a clean host state, like a fresh boot.
+  host::reset();
+  return records;
+}
+
+TEST(capture_replay_is_identical) {
+  auto records = capture_playback(16000);
+  EXPECT(records.size() > 500);
+
+  CaptureReplayer replayer(records);
+  auto result = replayer.run();
+  if (!result.identical()) {
+    printf("  %s\n", result.difference.c_str());
+  }
+  EXPECT(result.identical());
+  EXPECT(result.sdi_match);
+  EXPECT_EQ(result.replayed, result.captured);
+  EXPECT_EQ(result.sdi_dreq_low, 0u);
+}
+
+TEST(capture_replay_with_watchdog_is_identical) {
+  auto records = capture_playback(16000, 300);
+  CaptureReplayer replayer(records);
+  replayer.device.set_watchdog_timeout(300);
+  auto result = replayer.run();
+  if (!result.identical()) {
+    printf("  %s\n", result.difference.c_str());
+  }
+  EXPECT(result.identical());
+}
+
+TEST(capture_replay_reports_first_difference) {
+  auto records = capture_playback(16000);
+  CaptureReplayer replayer(records);
+  // Change an audio chunk in the capture, after the replayer took the audio
+  // data from it. The replay now sends different data than the capture
+  // holds, like a component that corrupts the audio would.
+  size_t index = 0;
+  size_t sdi = 0;
+  for (size_t i = 0; i < records.size(); i++) {
+    if (records[i].type == CAPTURE_SDI && ++sdi == 100) {
+      index = i;
+      break;
+    }
+  }
+  EXPECT(index > 0);
+  records[index].data[0] ^= 0xFF;
+
+  auto result = replayer.run();
+  EXPECT(!result.identical());
+  EXPECT(!result.sdi_match);
+  EXPECT_EQ(result.matched, index);
+}
+
+TEST(capture_replay_follows_captured_reads) {
+  auto records = capture_playback(16000, 300);
+  // The watchdog reads SCI_MODE to check that the device did not reset
+  // itself. Make one of the captured checks see a device that did. The
+  // replay must follow the captured device, so it starts a recovery that
+  // the capture does not hold.
+  size_t mode_reads = 0;
+  for (auto &record : records) {
+    if (record.type == CAPTURE_SCI_READ && record.reg == SCI_MODE && ++mode_reads == 2) {
+      record.value = 0xFFFF;
+    }
+  }
+  EXPECT(mode_reads >= 2);
+
+  CaptureReplayer replayer(records);
+  replayer.device.set_watchdog_timeout(300);
+  auto result = replayer.run();
+  EXPECT(!result.identical());
+  EXPECT(result.matched > 0);
+}
@@ -0,0 +1,197 @@
+#include "esphome/components/blob/blob_clip_bank.h"
+#include "test.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace esphome::blob;
+
+static const char *const WORDS[] = {
+    "zero",    "one",     "two",       "three",    "four",     "five",    "six",    "seven",  "eight",
+    "nine",    "ten",     "eleven",    "twelve",   "thirteen", "fourteen", "fifteen", "sixteen", "seventeen",
+    "eighteen", "nineteen", "twenty", "thirty", "forty",    "fifty",    "oh",      "oclock", "it_is",
+};
+static const size_t WORD_COUNT = sizeof(WORDS) / sizeof(WORDS[0]);
+
+/// A clip bank with a clip for every word, packed like clip_bank.py does.
+/// Every clip has a different size, and is filled with its own index, so
+/// a clip that is cut short or joined to the wrong neighbour stands out.
+struct ClipFixture {
+  ClipFixture() {
+    ClipBankHeader header{CLIP_BANK_MAGIC, CLIP_BANK_VERSION, static_cast<uint16_t>(WORD_COUNT), 22050, 1, 16};
+    this->append_(&header, sizeof(header));
+    size_t offset = sizeof(ClipBankHeader) + WORD_COUNT * sizeof(ClipBankEntry);
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+      offset += -offset % 4;
+      ClipBankEntry entry{};
+      strncpy(entry.name, WORDS[i], CLIP_NAME_SIZE);
+      entry.offset = offset;
+      entry.size = this->clip(i).size();
+      this->append_(&entry, sizeof(entry));
+      offset += entry.size;
+    }
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+      this->data.resize(this->data.size() + (-this->data.size() % 4));
+      auto content = this->clip(i);
+      this->append_(content.data(), content.size());
+    }
+    this->bank = std::unique_ptr<ClipBank>(new ClipBank(this->data.data(), this->data.size()));
+  }
+
+  /// The content of the clip of a word.
+  static std::string clip(size_t word) { return std::string(2 * (word + 3), static_cast<char>(word + 1)); }
+
+  static std::string clip(const char *word) {
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+      if (strcmp(WORDS[i], word) == 0) {
+        return clip(i);
+      }
+    }
+    return "?";
+  }
+
+  /// Check that a chunk lies within a single slice: the WAV header, or
+  /// the data of a single clip in the bank.
+  bool is_slice(const ClipPhrase &phrase, const uint8_t *start, size_t size) const {
+    auto *entries = reinterpret_cast<const ClipBankEntry *>(this->data.data() + sizeof(ClipBankHeader));
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+      auto *clip = this->data.data() + entries[i].offset;
+      if (start >= clip && start + size <= clip + entries[i].size) {
+        return true;
+      }
+    }
+    // The header is generated by the phrase, so it is not in the bank.
+    return start + size <= phrase.data + CLIP_WAV_HEADER_SIZE && start >= phrase.data;
+  }
+
+  std::vector<uint8_t> data;
+  std::unique_ptr<ClipBank> bank;
+
+ protected:
+  void append_(const void *data, size_t size) {
+    auto *bytes = static_cast<const uint8_t *>(data);
+    this->data.insert(this->data.end(), bytes, bytes + size);
+  }
+};
+
+/// The words for a time, spelled out independently of ClipPhrase.
+static std::vector<std::string> spoken_time(int hour, int minute) {
+  static const char *const HOURS[] = {"twelve", "one", "two",   "three", "four",   "five",
+                                      "six",    "seven", "eight", "nine",  "ten", "eleven"};
+  static const char *const TENS[] = {"", "", "twenty", "thirty", "forty", "fifty"};
+  std::vector<std::string> words{"it_is", HOURS[hour % 12]};
+  if (minute == 0) {
+    words.push_back("oclock");
+  } else if (minute < 10) {
+    words.push_back("oh");
+    words.push_back(WORDS[minute]);
+  } else if (minute < 20) {
+    words.push_back(WORDS[minute]);
+  } else {
+    words.push_back(TENS[minute / 10]);
+    if (minute % 10 != 0) {
+      words.push_back(WORDS[minute % 10]);
+    }
+  }
+  return words;
+}
+
+static uint32_t read_le32(const std::string &data, size_t offset) {
+  uint32_t value;
+  memcpy(&value, data.data() + offset, 4);
+  return value;
+}
+
+/// Read a phrase from its read position, in chunks of at most the provided
+/// size. Returns false when a chunk spans two slices.
+static bool read_phrase(const ClipFixture &t, ClipPhrase *phrase, size_t chunk_size, std::string *out) {
+  while (phrase->next_chunk(chunk_size)) {
+    if (phrase->chunk_size == 0 || phrase->chunk_size > chunk_size ||
+        !t.is_slice(*phrase, phrase->chunk_start, phrase->chunk_size)) {
+      return false;
+    }
+    out->append(reinterpret_cast<const char *>(phrase->chunk_start), phrase->chunk_size);
+  }
+  return phrase->at_end();
+}
+
+TEST(clips_every_time_of_day) {
+  ClipFixture t;
+  int failures = 0;
+  for (int hour = 0; hour < 24; hour++) {
+    for (int minute = 0; minute < 60; minute++) {
+      auto *phrase = t.bank->say_time(hour, minute);
+      std::string expected;
+      for (auto &word : spoken_time(hour, minute)) {
+        expected += ClipFixture::clip(word.c_str());
+      }
+      bool ok = phrase->clip_count() == spoken_time(hour, minute).size() &&
+                phrase->size == CLIP_WAV_HEADER_SIZE + expected.size();
+
+      // The header has the exact sizes, and the format of the bank.
+      std::string out;
+      phrase->reset();
+      ok = ok && read_phrase(t, phrase, 4096, &out) && out.size() == phrase->size;
+      ok = ok && out.compare(0, 4, "RIFF") == 0 && read_le32(out, 4) == out.size() - 8 &&
+           read_le32(out, 24) == 22050 && read_le32(out, 40) == expected.size();
+      ok = ok && out.compare(CLIP_WAV_HEADER_SIZE, std::string::npos, expected) == 0;
+
+      // Small chunks, which end inside the clips, give the same data.
+      for (size_t chunk_size : {1, 3, 7, 40}) {
+        std::string small;
+        phrase->reset();
+        ok = ok && read_phrase(t, phrase, chunk_size, &small) && small == out;
+      }
+
+      // Seeking lands in the right slice, also on the edges of the slices.
+      size_t edge = CLIP_WAV_HEADER_SIZE;
+      std::vector<size_t> positions{0, 1, CLIP_WAV_HEADER_SIZE - 1, phrase->size};
+      for (auto &word : spoken_time(hour, minute)) {
+        positions.push_back(edge);
+        positions.push_back(edge + 1);
+        edge += ClipFixture::clip(word.c_str()).size();
+        positions.push_back(edge - 1);
+      }
+      for (auto position : positions) {
+        std::string rest;
+        ok = ok && phrase->seek(position) && phrase->position() == position &&
+             read_phrase(t, phrase, 5, &rest) && rest == out.substr(position);
+      }
+      ok = ok && !phrase->seek(phrase->size + 1);
+
+      if (!ok && failures++ < 5) {
+        printf("  wrong phrase for %02d:%02d\n", hour, minute);
+      }
+    }
+  }
+  EXPECT_EQ(failures, 0);
+}
+
+TEST(clips_missing_clip_and_full_phrase) {
+  ClipFixture t;
+  auto *phrase = t.bank->phrase();
+  EXPECT(!phrase->add("missing"));
+  EXPECT(!phrase->add_number(100));
+  EXPECT(!phrase->add_time(24, 0));
+  EXPECT_EQ(phrase->clip_count(), 0u);
+  EXPECT_EQ(phrase->size, CLIP_WAV_HEADER_SIZE);
+  for (size_t i = 0; i < CLIP_PHRASE_MAX_CLIPS; i++) {
+    EXPECT(phrase->add("one"));
+  }
+  EXPECT(!phrase->add("one"));
+  EXPECT_EQ(phrase->size, CLIP_WAV_HEADER_SIZE + CLIP_PHRASE_MAX_CLIPS * ClipFixture::clip("one").size());
+
+  // A new phrase starts empty.
+  EXPECT_EQ(t.bank->phrase()->clip_count(), 0u);
+}
+
+TEST(clips_invalid_bank) {
+  std::vector<uint8_t> data(64, 0);
+  ClipBank bank(data.data(), data.size());
+  EXPECT(bank.get_header() == nullptr);
+  EXPECT(!bank.phrase()->add("one"));
+  // A phrase from an invalid bank is just a header, which plays as
+  // silence.
+  EXPECT_EQ(bank.say_time(7, 5)->size, CLIP_WAV_HEADER_SIZE);
+}
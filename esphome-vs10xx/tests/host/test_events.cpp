@@ -0,0 +1,116 @@
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+/// Counts how often each trigger fires.
+struct EventCounts {
+  explicit EventCounts(VS10XX &device) {
+    device.add_on_play_start_callback([this]() { this->play_start++; });
+    device.add_on_play_end_callback([this]() { this->play_end++; });
+    device.add_on_underrun_callback([this]() { this->underrun++; });
+    device.add_on_device_ready_callback([this]() { this->device_ready++; });
+    device.add_on_device_failed_callback([this]() { this->device_failed++; });
+  }
+
+  uint32_t play_start{0};
+  uint32_t play_end{0};
+  uint32_t underrun{0};
+  uint32_t device_ready{0};
+  uint32_t device_failed{0};
+};
+
+TEST(events_fire_once_per_playback) {
+  TestDevice t;
+  EventCounts events(t.device);
+  EXPECT(t.start());
+  // The device got ready in the last loop, so that fires the trigger from
+  // the next one.
+  EXPECT_EQ(events.device_ready, 0u);
+  t.step();
+  EXPECT_EQ(events.device_ready, 1u);
+
+  for (int i = 1; i <= 2; i++) {
+    PatternSource source(4096);
+    t.device.play(&source);
+    EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 2000));
+    t.run(10);
+    EXPECT_EQ(events.play_start, static_cast<uint32_t>(i));
+    EXPECT_EQ(events.play_end, static_cast<uint32_t>(i));
+  }
+  // The soft reset after playback does not make the device ready again.
+  EXPECT_EQ(events.device_ready, 1u);
+  EXPECT_EQ(events.underrun, 0u);
+  EXPECT_EQ(events.device_failed, 0u);
+}
+
+TEST(underrun_event_fires_from_loop) {
+  TestDevice t;
+  EventCounts events(t.device);
+  EXPECT(t.start());
+  PatternSource source(4096, true);
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.device.get_playback_stats().underruns == 1; }, 2000));
+
+  // An underrun that happens while feeding the device fires the trigger
+  // from the next loop of the device, not from the feed.
+  source.grow(4096);
+  EXPECT(t.run_until([&]() { return source.position() == 8192; }, 2000));
+  auto underruns = t.device.get_playback_stats().underruns;
+  auto fired = events.underrun;
+  for (int i = 0; i < 2000 && t.device.get_playback_stats().underruns == underruns; i++) {
+    t.scheduler.loop();
+    host::advance_ms(1);
+  }
+  EXPECT_EQ(t.device.get_playback_stats().underruns, underruns + 1);
+  EXPECT_EQ(events.underrun, fired);
+  t.device.loop();
+  EXPECT_EQ(events.underrun, fired + 1);
+
+  // Every underrun fires it once, while starving does not fire it again.
+  t.run(500);
+  EXPECT_EQ(events.underrun, t.device.get_playback_stats().underruns);
+  EXPECT_EQ(events.underrun, 2u);
+  EXPECT_EQ(events.play_start, 1u);
+  EXPECT_EQ(events.play_end, 0u);
+}
+
+TEST(recovery_fires_no_events) {
+  TestDevice t;
+  EventCounts events(t.device);
+  t.device.set_watchdog_timeout(300);
+  EXPECT(t.start());
+  PatternSource source(1 << 20);
+  t.device.play(&source);
+  t.run(100);
+  t.transport.set_hung(true);
+  EXPECT(t.run_until([&]() { return t.device.get_recovery_stats().recoveries == 1; }, 5000));
+  t.run(100);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  // Recovering is neither the end of playback, nor a new one, and the
+  // device does not become ready again.
+  EXPECT_EQ(events.play_start, 1u);
+  EXPECT_EQ(events.play_end, 0u);
+  EXPECT_EQ(events.device_ready, 1u);
+  EXPECT_EQ(events.device_failed, 0u);
+  EXPECT_EQ(events.underrun, 0u);
+}
+
+TEST(device_failed_event_fires_once) {
+  // A VS1003 where a VS1053 is expected fails the chipset check.
+  TestDevice t;
+  esphome::test::FakeTransport vs1003(3);
+  t.hal.set_transport(&vs1003);
+  t.device.set_recovery_interval(2000);
+  EventCounts events(t.device);
+  EXPECT(!t.start());
+  EXPECT_EQ(t.device.get_device_state(), DEVICE_FAILED);
+  EXPECT_EQ(events.device_failed, 1u);
+  // Every retry that fails is a new failure.
+  t.run(1500);
+  EXPECT_EQ(events.device_failed, 2u);
+  EXPECT_EQ(events.device_ready, 0u);
+}
@@ -0,0 +1,103 @@
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+static uint8_t fallback_data[4096];
+
+TEST(failover_after_timeout) {
+  TestDevice t;
+  blob::Blob fallback(fallback_data, sizeof(fallback_data));
+  t.device.set_fallback_blob(&fallback);
+  t.device.set_failover_timeout(3000);
+  EXPECT(t.start());
+
+  uint64_t underrun_at = 0;
+  t.device.add_on_underrun_callback([&]() {
+    if (underrun_at == 0)
+      underrun_at = host::now_us();
+  });
+  PatternSource source(8192, true);
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return underrun_at != 0; }, 2000));
+  // The failover happens once the source starved for the timeout, in the
+  // first loop iteration after that.
+  t.run(2990 - (host::now_us() - underrun_at) / 1000);
+  EXPECT(!t.device.is_failed_over());
+  EXPECT(t.run_until([&]() { return t.device.is_failed_over(); }, 20));
+  EXPECT_EQ(t.device.get_failover_stats().failovers, 1u);
+  // Without a return to the source, the source is closed right away.
+  EXPECT_EQ(source.closed, 1u);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+}
+
+TEST(failover_not_triggered_by_short_stall) {
+  TestDevice t;
+  blob::Blob fallback(fallback_data, sizeof(fallback_data));
+  t.device.set_fallback_blob(&fallback);
+  t.device.set_failover_timeout(3000);
+  EXPECT(t.start());
+  PatternSource source(8192, true);
+  t.device.play(&source);
+  t.run(2500);
+  // The source recovers within the timeout. Feeding resets the starvation.
+  source.grow(64 * 1024);
+  t.run(2000);
+  EXPECT(!t.device.is_failed_over());
+  EXPECT_EQ(t.device.get_failover_stats().failovers, 0u);
+}
+
+TEST(failover_returns_to_source) {
+  TestDevice t;
+  blob::Blob fallback(fallback_data, sizeof(fallback_data));
+  t.device.set_fallback_blob(&fallback);
+  t.device.set_failover_timeout(1000);
+  t.device.set_failover_return(true);
+  EXPECT(t.start());
+  PatternSource source(4096, true);
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.device.is_failed_over(); }, 3000));
+  EXPECT_EQ(source.closed, 0u);
+  // The source is probed while the fallback audio plays. Once it delivers
+  // again, playback returns to it at the end of the fallback audio.
+  EXPECT(fallback.in_use());
+  source.grow(64 * 1024);
+  EXPECT(t.run_until([&]() { return !t.device.is_failed_over(); }, 2000));
+  EXPECT_EQ(t.device.get_failover_stats().returns, 1u);
+  // The fallback blob is released on the return, so a blob bundle can be
+  // updated while the source plays.
+  EXPECT(!fallback.in_use());
+}
+
+TEST(failover_for_source_without_data) {
+  TestDevice t;
+  blob::Blob fallback(fallback_data, sizeof(fallback_data));
+  t.device.set_fallback_blob(&fallback);
+  EXPECT(t.start());
+  PatternSource source(0);
+  t.device.play(&source);
+  t.run(10);
+  EXPECT(t.device.is_failed_over());
+}
+
+TEST(played_blob_in_use_until_stopped) {
+  TestDevice t;
+  EXPECT(t.start());
+  blob::Blob first(fallback_data, sizeof(fallback_data));
+  blob::Blob second(fallback_data, sizeof(fallback_data));
+  t.device.play(&first);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_PLAYING; }, 1000));
+  EXPECT(first.in_use());
+
+  // Playing another blob releases the first one, also when the blob source
+  // is reused for it.
+  t.device.play(&second);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_PLAYING; }, 1000));
+  EXPECT(!first.in_use());
+  EXPECT(second.in_use());
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 2000));
+  EXPECT(!second.in_use());
+}
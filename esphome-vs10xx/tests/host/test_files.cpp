@@ -0,0 +1,149 @@
+#include "esphome/components/vs10xx/vs10xx_file_source.h"
+#include "fixture.h"
+#include "test.h"
+#include <FS.h>
+#include <algorithm>
+#include <cstring>
+#include <unistd.h>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+static const size_t CACHE_SIZE = 4096;
+
+static std::string image_path() { return "/tmp/vs10xx_test_" + std::to_string(getpid()) + ".img"; }
+
+static std::vector<uint8_t> pattern(size_t size) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = PatternSource::at(i);
+  }
+  return data;
+}
+
+/// A filesystem image with a file of the pattern, after another file, so
+/// the file does not start at the start of the image.
+class FileFixture {
+ public:
+  explicit FileFixture(size_t size) : fs(image_path()), data(pattern(size)) {
+    std::vector<uint8_t> other(1000, 0x55);
+    this->fs.add_file("/other.bin", other.data(), other.size());
+    this->fs.add_file("/audio.mp3", this->data.data(), this->data.size());
+    this->offset = this->fs.offset_of("/audio.mp3");
+    this->source.allocate(CACHE_SIZE);
+    this->source.set_file(&this->fs, "/audio.mp3");
+  }
+
+  /// Read from the source in chunks of a size, until it gives no more data.
+  std::vector<uint8_t> read_all(size_t chunk_size) {
+    std::vector<uint8_t> result;
+    std::vector<uint8_t> chunk(chunk_size);
+    while (!this->source.at_end()) {
+      auto size = this->source.read(chunk.data(), chunk.size());
+      if (size == 0) {
+        break;
+      }
+      result.insert(result.end(), chunk.begin(), chunk.begin() + size);
+    }
+    return result;
+  }
+
+  fs::FS fs;
+  std::vector<uint8_t> data;
+  size_t offset{0};
+  FileSource source;
+};
+
+TEST(file_source_reads_whole_blocks) {
+  FileFixture t(10000);
+  t.source.reset();
+  // The reads of the device feed are small, but the filesystem only sees
+  // reads of whole cache blocks, at offsets in the file that are a multiple
+  // of the cache size.
+  EXPECT(t.read_all(32) == t.data);
+  EXPECT(t.source.at_end());
+  auto &reads = t.fs.get_reads();
+  EXPECT_EQ(reads.size(), 3u);
+  for (size_t i = 0; i < reads.size(); i++) {
+    EXPECT_EQ(reads[i].offset, t.offset + i * CACHE_SIZE);
+    EXPECT_EQ(reads[i].size, i < 2 ? CACHE_SIZE : 10000 - 2 * CACHE_SIZE);
+  }
+
+  // A large read takes at most one block from the filesystem per call.
+  t.fs.clear_reads();
+  t.source.reset();
+  uint8_t buffer[10000];
+  EXPECT_EQ(t.source.read(buffer, sizeof(buffer)), CACHE_SIZE);
+  EXPECT_EQ(t.source.read(buffer + CACHE_SIZE, sizeof(buffer) - CACHE_SIZE), CACHE_SIZE);
+  EXPECT_EQ(t.fs.get_reads().size(), 2u);
+}
+
+TEST(file_source_seek_reads_aligned_block) {
+  FileFixture t(10000);
+  t.source.reset();
+  uint8_t buffer[100];
+  EXPECT_EQ(t.source.read(buffer, sizeof(buffer)), sizeof(buffer));
+
+  // A seek within the cached block needs no read.
+  t.fs.clear_reads();
+  EXPECT(t.source.seek(3000));
+  EXPECT_EQ(t.source.read(buffer, sizeof(buffer)), sizeof(buffer));
+  EXPECT(memcmp(buffer, t.data.data() + 3000, sizeof(buffer)) == 0);
+  EXPECT_EQ(t.fs.get_reads().size(), 0u);
+
+  // A seek to another block reads that whole block.
+  EXPECT(t.source.seek(5000));
+  EXPECT_EQ(t.source.read(buffer, sizeof(buffer)), sizeof(buffer));
+  EXPECT(memcmp(buffer, t.data.data() + 5000, sizeof(buffer)) == 0);
+  EXPECT_EQ(t.fs.get_reads().size(), 1u);
+  if (t.fs.get_reads().size() == 1) {
+    EXPECT_EQ(t.fs.get_reads()[0].offset, t.offset + CACHE_SIZE);
+    EXPECT_EQ(t.fs.get_reads()[0].size, CACHE_SIZE);
+  }
+
+  // Seeking past the end fails, and seeking to the end ends the file.
+  EXPECT(!t.source.seek(10001));
+  EXPECT(t.source.seek(10000));
+  EXPECT(t.source.at_end());
+  EXPECT_EQ(t.source.read(buffer, sizeof(buffer)), 0u);
+}
+
+TEST(file_source_read_error_ends_file) {
+  FileFixture t(10000);
+  // The second block cannot be read.
+  t.fs.set_fail_from(t.offset + CACHE_SIZE);
+  t.source.reset();
+  auto read = t.read_all(512);
+  EXPECT_EQ(read.size(), CACHE_SIZE);
+  EXPECT(std::equal(read.begin(), read.end(), t.data.begin()));
+  // So the file ends there, instead of playback waiting for data that
+  // never come.
+  EXPECT(t.source.at_end());
+
+  // A file that does not exist is empty.
+  t.source.set_file(&t.fs, "/missing.mp3");
+  t.source.reset();
+  uint8_t buffer[32];
+  EXPECT(t.source.at_end());
+  EXPECT_EQ(t.source.read(buffer, sizeof(buffer)), 0u);
+  EXPECT(!t.source.seek(0));
+}
+
+TEST(play_file_plays_the_whole_file) {
+  fs::FS fs(image_path());
+  auto data = esphome::test::mp3_stream(16000);
+  fs.add_file("/chime.mp3", data.data(), data.size());
+  TestDevice t;
+  t.device.set_filesystem(&fs);
+  t.transport.set_record_sdi(true);
+  EXPECT(t.start());
+  t.device.play_file("/chime.mp3");
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 3000));
+  auto &sdi = t.transport.get_sdi_data();
+  EXPECT(sdi.size() >= data.size());
+  EXPECT(std::equal(data.begin(), data.end(), sdi.begin()));
+  EXPECT_EQ(t.transport.get_decoder_underruns(), 0u);
+  EXPECT(t.transport.get_violations().empty());
+}
@@ -0,0 +1,61 @@
+#include "esphome/components/vs10xx/vs10xx_format.h"
+#include "test.h"
+#include <cstring>
+
+using namespace esphome::vs10xx;
+
+static AudioFormat detect(const char *data, size_t size) {
+  return detect_audio_format(reinterpret_cast<const uint8_t *>(data), size);
+}
+
+TEST(format_detection) {
+  EXPECT_EQ(detect("RIFF\0\0\0\0WAVEfmt ", 16), FORMAT_WAV);
+  EXPECT_EQ(detect("RIFF\0\0\0\0AVI ", 12), FORMAT_UNKNOWN);
+  EXPECT_EQ(detect("MThd\0\0\0\6", 8), FORMAT_MIDI);
+  EXPECT_EQ(detect("OggS\0\2", 6), FORMAT_OGG);
+  EXPECT_EQ(detect("ADIF", 4), FORMAT_AAC_ADIF);
+  EXPECT_EQ(detect("\0\0\0\x20" "ftypM4A ", 12), FORMAT_AAC_MP4);
+  EXPECT_EQ(detect("\x30\x26\xB2\x75\x8E\x66\xCF\x11\xA6\xD9", 10), FORMAT_WMA);
+  EXPECT_EQ(detect("ID3\4\0", 5), FORMAT_MP3);
+  EXPECT_EQ(detect("\xFF\xFB\x90\x64", 4), FORMAT_MP3);
+  EXPECT_EQ(detect("\xFF\xF1\x50\x80", 4), FORMAT_AAC_ADTS);
+  EXPECT_EQ(detect("hello", 5), FORMAT_UNKNOWN);
+}
+
+TEST(format_detection_short_data) {
+  // Prefixes of a header must not be mistaken for a format, and must not
+  // be read beyond their size.
+  EXPECT_EQ(detect("RIFF\0\0\0\0WAV", 11), FORMAT_UNKNOWN);
+  EXPECT_EQ(detect("\0\0\0\x20" "fty", 7), FORMAT_UNKNOWN);
+  EXPECT_EQ(detect("\xFF", 1), FORMAT_UNKNOWN);
+  EXPECT_EQ(detect("", 0), FORMAT_UNKNOWN);
+}
+
+TEST(wav_header_round_trip) {
+  uint8_t header[WAV_HEADER_SIZE];
+  write_wav_header(header, 22050, 1, 1000);
+  EXPECT_EQ(detect_audio_format(header, sizeof(header)), FORMAT_WAV);
+  EXPECT(memcmp(header + 36, "data", 4) == 0);
+  EXPECT_EQ(header[4] | (header[5] << 8), 1000 + 36);
+  EXPECT_EQ(header[24] | (header[25] << 8), 22050);
+  EXPECT_EQ(header[28] | (header[29] << 8) | (header[30] << 16), 44100);
+  EXPECT_EQ(header[32], 2);
+  // The RIFF size must not overflow for a streaming header.
+  write_wav_header(header, 44100, 2, WAV_STREAMING_SIZE);
+  EXPECT_EQ(header[4] & header[5] & header[6] & header[7], 0xFF);
+}
+
+TEST(clock_profile_selection) {
+  uint8_t header[WAV_HEADER_SIZE];
+  write_wav_header(header, 16000, 2, 1000);  // 64000 bytes per second
+  EXPECT_EQ(select_clock_profile(header, sizeof(header)), CLOCK_PROFILE_LOW);
+  write_wav_header(header, 44100, 2, 1000);
+  EXPECT_EQ(select_clock_profile(header, sizeof(header)), CLOCK_PROFILE_NORMAL);
+  header[20] = 0x11;  // IMA ADPCM
+  EXPECT_EQ(select_clock_profile(header, sizeof(header)), CLOCK_PROFILE_LOW);
+  // Without the fmt chunk, the data rate is not known.
+  EXPECT_EQ(select_clock_profile(header, 20), CLOCK_PROFILE_NORMAL);
+  EXPECT_EQ(select_clock_profile(reinterpret_cast<const uint8_t *>("MThd"), 4), CLOCK_PROFILE_LOW);
+  EXPECT_EQ(select_clock_profile(reinterpret_cast<const uint8_t *>("OggS"), 4), CLOCK_PROFILE_FULL);
+  EXPECT_EQ(select_clock_profile(reinterpret_cast<const uint8_t *>("\xFF\xFB\x90\x64"), 4), CLOCK_PROFILE_NORMAL);
+}
@@ -0,0 +1,221 @@
+#include "esphome/components/vs10xx/vs10xx_format.h"
+#include "esphome/components/vs10xx/vs10xx_hal.h"
+#include "esphome/components/vs10xx/vs10xx_hal_vs1003.h"
+#include "esphome/components/vs10xx/vs10xx_hal_vs1053.h"
+#include "fake_transport.h"
+#include "fixture.h"
+#include "test.h"
+#include <cstring>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::FakeTransport;
+using esphome::test::mp3_stream;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+// The HAL on top of the device emulator, without the component.
+struct HalFixture {
+  explicit HalFixture(uint8_t version = 4) : transport(version), hal(version == 3 ? (VS10XXHALChipset *) &vs1003 : &vs1053) {
+    this->hal.set_transport(&this->transport);
+    this->hal.setup();
+  }
+
+  /// Reset the device and switch to fast SPI, like the component does.
+  bool start() { return this->hal.reset() && this->hal.go_fast(); }
+
+  /// Send audio data in chunks, waiting for DREQ like the component does.
+  bool feed(const uint8_t *data, size_t size) {
+    for (size_t sent = 0; sent < size; sent += VS10XX_CHUNK_SIZE) {
+      if (!this->hal.wait_for_ready(100)) {
+        return false;
+      }
+      this->hal.begin_data_transaction();
+      this->hal.write_data(data + sent, std::min<size_t>(VS10XX_CHUNK_SIZE, size - sent));
+      this->hal.end_transaction();
+    }
+    return true;
+  }
+
+  FakeTransport transport;
+  VS1003Chipset vs1003;
+  VS1053Chipset vs1053;
+  VS10XXHAL hal;
+};
+
+static void expect_no_violations(const FakeTransport &transport) {
+  for (auto &violation : transport.get_violations()) {
+    printf("  violation: %s\n", violation.c_str());
+  }
+  EXPECT(transport.get_violations().empty());
+}
+
+TEST(hal_hard_reset_waits_for_boot) {
+  HalFixture t;
+  EXPECT(t.hal.reset());
+  EXPECT_EQ(t.transport.get_hard_resets(), 1u);
+  EXPECT(!t.transport.is_fast());
+  EXPECT(t.hal.verify_chipset());
+  expect_no_violations(t.transport);
+}
+
+TEST(emulator_flags_access_while_booting) {
+  HalFixture t;
+  t.transport.set_reset(true);
+  t.transport.set_reset(false);
+  t.hal.read_register(SCI_STATUS);
+  EXPECT(!t.transport.get_violations().empty());
+}
+
+TEST(hal_go_fast_sets_clock_first) {
+  HalFixture t;
+  EXPECT(t.start());
+  EXPECT(t.transport.is_fast());
+  EXPECT_EQ(t.transport.get_register(SCI_CLOCKF), t.hal.get_chipset()->get_fast_clockf());
+  // Talking right after the switch is safe: go_fast() waits for the new
+  // clock to settle.
+  EXPECT_EQ(t.hal.read_register(SCI_MODE, true), SM_SDINEW);
+  expect_no_violations(t.transport);
+}
+
+TEST(emulator_flags_fast_spi_before_clockf) {
+  HalFixture t;
+  EXPECT(t.hal.reset());
+  t.transport.set_fast_mode(true);
+  t.hal.read_register(SCI_MODE, true);
+  EXPECT(!t.transport.get_violations().empty());
+}
+
+TEST(hal_clock_profile_switch) {
+  HalFixture t;
+  EXPECT(t.start());
+  EXPECT(t.hal.set_clock_profile(CLOCK_PROFILE_LOW));
+  EXPECT(t.transport.is_fast());
+  EXPECT_EQ(t.transport.get_register(SCI_CLOCKF), t.hal.get_chipset()->get_clockf(CLOCK_PROFILE_LOW));
+  EXPECT(t.hal.set_clock_profile(CLOCK_PROFILE_FULL));
+  EXPECT_EQ(t.hal.read_register(SCI_MODE, true), SM_SDINEW);
+  expect_no_violations(t.transport);
+}
+
+TEST(hal_soft_reset) {
+  HalFixture t;
+  EXPECT(t.start());
+  EXPECT(t.hal.soft_reset());
+  EXPECT_EQ(t.transport.get_soft_resets(), 1u);
+  expect_no_violations(t.transport);
+}
+
+TEST(hal_status_follows_mp3_stream) {
+  HalFixture t;
+  EXPECT(t.start());
+  EXPECT(t.hal.reset_decode_time());
+  EXPECT(!t.hal.get_status().playing);
+
+  // Three seconds of audio, which the decoder plays in real time.
+  auto data = mp3_stream(3 * 16000);
+  EXPECT(t.feed(data.data(), data.size()));
+  EXPECT_EQ(t.transport.get_stream_byte_rate(), 16000u);
+  auto &status = t.hal.get_status();
+  EXPECT(status.playing);
+  EXPECT_EQ(status.format, FORMAT_MP3);
+  EXPECT_EQ(status.bitrate, 128);
+  EXPECT_EQ(status.sample_rate, 44100);
+  EXPECT(status.stereo);
+  // The FIFO still holds a bit of audio, which is not decoded yet.
+  EXPECT_EQ(status.decode_time, 2);
+  host::advance_ms(1000);
+  EXPECT_EQ(t.hal.get_status().decode_time, 3);
+  expect_no_violations(t.transport);
+}
+
+TEST(hal_status_follows_wav_stream) {
+  HalFixture t;
+  EXPECT(t.start());
+  std::vector<uint8_t> data(WAV_HEADER_SIZE + 8000, 0x11);
+  write_wav_header(data.data(), 8000, 1, 8000);
+  EXPECT(t.feed(data.data(), data.size()));
+  auto &status = t.hal.get_status();
+  EXPECT_EQ(status.format, FORMAT_WAV);
+  EXPECT_EQ(status.sample_rate, 8000);
+  EXPECT(!status.stereo);
+  EXPECT_EQ(t.transport.get_stream_byte_rate(), 16000u);
+  expect_no_violations(t.transport);
+}
+
+TEST(emulator_plays_through_wav_silence) {
+  HalFixture t;
+  EXPECT(t.start());
+  // More silence than the run of zeros that ends a stream.
+  std::vector<uint8_t> data(WAV_HEADER_SIZE + 8000, 0x11);
+  write_wav_header(data.data(), 8000, 1, 8000);
+  memset(data.data() + WAV_HEADER_SIZE + 1000, 0, 4000);
+  EXPECT(t.feed(data.data(), data.size()));
+  EXPECT_EQ(t.transport.get_stream_byte_rate(), 16000u);
+  EXPECT_EQ(t.hal.get_status().format, FORMAT_WAV);
+
+  // The zeros after the data do end it.
+  std::vector<uint8_t> end_fill(2048, 0);
+  EXPECT(t.feed(end_fill.data(), end_fill.size()));
+  EXPECT_EQ(t.transport.get_stream_byte_rate(), 0u);
+  expect_no_violations(t.transport);
+}
+
+TEST(hal_cancel_playback) {
+  HalFixture t;
+  EXPECT(t.start());
+  auto data = mp3_stream(4000);
+  EXPECT(t.feed(data.data(), data.size()));
+  EXPECT(t.hal.get_status().playing);
+  EXPECT(t.hal.cancel_playback());
+  EXPECT_EQ(t.transport.get_cancels(), 1u);
+  EXPECT(!t.hal.get_status().playing);
+  // The next stream is decoded from its own header.
+  EXPECT(t.feed(data.data(), data.size()));
+  EXPECT_EQ(t.hal.get_status().format, FORMAT_MP3);
+  expect_no_violations(t.transport);
+}
+
+TEST(hal_cancel_playback_fails_on_hung_decoder) {
+  HalFixture t;
+  EXPECT(t.start());
+  t.transport.set_ignore_cancel(true);
+  auto data = mp3_stream(4000);
+  EXPECT(t.feed(data.data(), data.size()));
+  EXPECT(!t.hal.cancel_playback());
+  EXPECT_EQ(t.transport.get_cancels(), 0u);
+  expect_no_violations(t.transport);
+}
+
+TEST(hal_end_stream_without_cancel) {
+  HalFixture t(3);
+  EXPECT(t.start());
+  EXPECT(!t.hal.can_cancel_playback());
+  auto data = mp3_stream(4000);
+  EXPECT(t.feed(data.data(), data.size()));
+  EXPECT(t.hal.get_status().playing);
+  EXPECT(t.hal.end_stream());
+  EXPECT(!t.hal.get_status().playing);
+  expect_no_violations(t.transport);
+}
+
+TEST(hal_skips_unchanged_writes) {
+  HalFixture t;
+  EXPECT(t.start());
+  EXPECT(t.hal.set_volume(0.5f, 0.5f));
+  auto writes = t.transport.get_sci_writes();
+  EXPECT(t.hal.set_volume(0.5f, 0.5f));
+  EXPECT_EQ(t.transport.get_sci_writes(), writes);
+  EXPECT_EQ(t.hal.get_sci_stats().writes_skipped, 1u);
+  expect_no_violations(t.transport);
+}
+
+TEST(component_playback_keeps_to_protocol) {
+  TestDevice t;
+  EXPECT(t.start());
+  PatternSource source(32768);
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 5000));
+  t.device.set_volume(0.3f, 0.3f);
+  t.run(50);
+  expect_no_violations(t.transport);
+}
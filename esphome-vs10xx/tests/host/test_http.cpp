@@ -0,0 +1,331 @@
+#include "esphome/components/vs10xx/vs10xx_http_source.h"
+#include "fixture.h"
+#include "test.h"
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+
+/// A local HTTP server, which answers each connection with a handler. The
+/// handler gets the socket and the requested path, and writes the response
+/// at its own pace, e.g. throttled or with a stall. The server runs in a
+/// thread, in real time, while the source runs on the fake clock.
+class TestServer {
+ public:
+  using Handler = std::function<void(TestServer &server, int fd, const std::string &path)>;
+
+  explicit TestServer(Handler handler) : handler_(std::move(handler)) {
+    this->listener_ = socket(AF_INET, SOCK_STREAM, 0);
+    int reuse = 1;
+    setsockopt(this->listener_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(this->listener_, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+    socklen_t length = sizeof(address);
+    getsockname(this->listener_, reinterpret_cast<sockaddr *>(&address), &length);
+    this->port_ = ntohs(address.sin_port);
+    listen(this->listener_, 4);
+    this->thread_ = std::thread([this]() { this->run_(); });
+  }
+
+  ~TestServer() {
+    this->stopping_ = true;
+    shutdown(this->listener_, SHUT_RDWR);
+    ::close(this->listener_);
+    this->thread_.join();
+  }
+
+  uint16_t port() const { return this->port_; }
+  std::string url(const std::string &path) const {
+    return "http://127.0.0.1:" + std::to_string(this->port_) + path;
+  }
+
+  /// The requested paths, in order.
+  std::vector<std::string> requests() {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    return this->requests_;
+  }
+
+  /// The server is stopping, so a handler that stalls should give up.
+  bool stopping() const { return this->stopping_; }
+
+  /// Send all data, in chunks with a real-time pause in between.
+  bool send_throttled(int fd, const std::string &data, size_t chunk = 0, uint32_t pause_us = 0) {
+    chunk = chunk == 0 ? data.size() : chunk;
+    for (size_t sent = 0; sent < data.size(); sent += chunk) {
+      if (this->stopping_ || send(fd, data.data() + sent, std::min(chunk, data.size() - sent), MSG_NOSIGNAL) < 0) {
+        return false;
+      }
+      if (pause_us > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(pause_us));
+      }
+    }
+    return true;
+  }
+
+  /// Keep the connection open without sending anything, until the client
+  /// closes it or the server stops.
+  void stall(int fd) {
+    char c;
+    while (!this->stopping_ && recv(fd, &c, 1, MSG_DONTWAIT) != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+ protected:
+  void run_() {
+    while (!this->stopping_) {
+      int fd = accept(this->listener_, nullptr, nullptr);
+      if (fd < 0) {
+        continue;
+      }
+      // The request line holds the path: GET /path HTTP/1.0
+      std::string request;
+      char c;
+      while (request.find("\r\n\r\n") == std::string::npos && recv(fd, &c, 1, 0) == 1) {
+        request += c;
+      }
+      auto path_start = request.find(' ') + 1;
+      auto path = request.substr(path_start, request.find(' ', path_start) - path_start);
+      {
+        std::lock_guard<std::mutex> lock(this->mutex_);
+        this->requests_.push_back(path);
+      }
+      this->handler_(*this, fd, path);
+      ::close(fd);
+    }
+  }
+
+  Handler handler_;
+  int listener_;
+  uint16_t port_{0};
+  std::atomic<bool> stopping_{false};
+  std::thread thread_;
+  std::mutex mutex_;
+  std::vector<std::string> requests_;
+};
+
+/// The audio data of the tests: the pattern of PatternSource.
+static std::string audio(size_t from, size_t size) {
+  std::string data(size, 0);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = PatternSource::at(from + i);
+  }
+  return data;
+}
+
+static bool is_audio(const std::vector<uint8_t> &data, size_t from = 0) {
+  for (size_t i = 0; i < data.size(); i++) {
+    if (data[i] != PatternSource::at(from + i)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Read from the source until the condition holds. When nothing is read,
+/// the fake clock moves by a millisecond, while the server gets a bit of
+/// real time. Returns false after the timeout, in fake milliseconds.
+static bool pump(HttpSource &source, std::vector<uint8_t> &received, const std::function<bool()> &condition,
+                 uint32_t timeout_ms = 20000) {
+  uint8_t buffer[1000];
+  auto until = host::now_us() + timeout_ms * 1000ULL;
+  while (!condition()) {
+    if (host::now_us() >= until) {
+      return false;
+    }
+    auto size = source.read(buffer, sizeof(buffer));
+    received.insert(received.end(), buffer, buffer + size);
+    if (size == 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+      host::advance_ms(1);
+    }
+  }
+  return true;
+}
+
+static void configure(HttpSource &source, const std::string &url) {
+  source.set_url(url);
+  source.set_reconnect_delay(100);
+  source.set_max_reconnect_delay(400);
+  source.set_stall_timeout(500);
+  source.reset();
+}
+
+TEST(http_throttled_stream_with_metadata) {
+  // An Icecast-like stream: metadata every 1000 bytes of audio, sent in
+  // small chunks, so reads split the metadata blocks.
+  const size_t metaint = 1000;
+  TestServer server([&](TestServer &server, int fd, const std::string &path) {
+    std::string response = "ICY 200 OK\r\nicy-metaint: 1000\r\n\r\n";
+    for (size_t block = 0; block < 20; block++) {
+      response += audio(block * metaint, metaint);
+      std::string metadata;
+      if (block == 0) {
+        metadata = "StreamTitle='Artist - Song A';StreamUrl='';";
+      } else if (block == 10) {
+        metadata = "StreamTitle='Artist - Song B';";
+      }
+      size_t blocks = (metadata.size() + 15) / 16;
+      metadata.resize(blocks * 16, '\0');
+      response += static_cast<char>(blocks);
+      response += metadata;
+    }
+    server.send_throttled(fd, response, 333, 500);
+    server.stall(fd);
+  });
+
+  HttpSource source;
+  std::vector<std::string> titles;
+  source.add_on_title_callback([&](const std::string &title) { titles.push_back(title); });
+  configure(source, server.url("/stream"));
+  std::vector<uint8_t> received;
+  EXPECT(pump(source, received, [&]() { return received.size() >= 20 * metaint; }));
+  EXPECT_EQ(received.size(), 20 * metaint);
+  EXPECT(is_audio(received));
+  EXPECT_EQ(titles.size(), 2u);
+  EXPECT(titles.size() == 2 && titles[0] == "Artist - Song A" && titles[1] == "Artist - Song B");
+  EXPECT_EQ(source.get_stats().connects, 1u);
+  EXPECT_EQ(source.get_stats().stalls, 0u);
+  source.close();
+}
+
+TEST(http_stall_reconnects) {
+  // The first connection stalls after a bit of audio. The second one
+  // streams.
+  TestServer server([&](TestServer &server, int fd, const std::string &path) {
+    bool first = server.requests().size() == 1;
+    server.send_throttled(fd, "HTTP/1.0 200 OK\r\n\r\n" + audio(0, first ? 5000 : 8000));
+    server.stall(fd);
+  });
+
+  HttpSource source;
+  configure(source, server.url("/live"));
+  std::vector<uint8_t> received;
+  EXPECT(pump(source, received, [&]() { return received.size() >= 5000; }));
+  auto stalled_at = host::now_us();
+  EXPECT(pump(source, received, [&]() { return source.get_stats().stalls > 0; }));
+  // The stall is detected after the stall timeout, not before.
+  EXPECT(host::now_us() - stalled_at >= 500000);
+  EXPECT(host::now_us() - stalled_at < 600000);
+  EXPECT(pump(source, received, [&]() { return received.size() >= 13000; }));
+  EXPECT_EQ(source.get_stats().connects, 2u);
+  EXPECT_EQ(source.get_stats().stalls, 1u);
+  EXPECT_EQ(server.requests().size(), 2u);
+  source.close();
+}
+
+TEST(http_reconnects_with_backoff) {
+  // The server is unavailable for a while: the reconnect delay doubles,
+  // up to the maximum, and is back at the start after a good connection.
+  std::vector<uint64_t> attempts;
+  TestServer server([&](TestServer &server, int fd, const std::string &path) {
+    size_t count = server.requests().size();
+    if (count <= 5) {
+      server.send_throttled(fd, "HTTP/1.0 503 Service Unavailable\r\n\r\n");
+    } else {
+      server.send_throttled(fd, "HTTP/1.0 200 OK\r\n\r\n" + audio(0, 1000));
+    }
+  });
+
+  HttpSource source;
+  configure(source, server.url("/busy"));
+  std::vector<uint8_t> received;
+  size_t seen = 0;
+  EXPECT(pump(source, received, [&]() {
+    // Note the (fake) time of each connection attempt.
+    auto count = server.requests().size();
+    for (; seen < count; seen++) {
+      attempts.push_back(host::now_us() / 1000);
+    }
+    return received.size() >= 1000;
+  }));
+  EXPECT_EQ(attempts.size(), 6u);
+  EXPECT_EQ(source.get_stats().connection_errors, 5u);
+  const uint32_t delays[] = {100, 200, 400, 400, 400};
+  for (size_t i = 1; i < attempts.size() && i <= 5; i++) {
+    auto gap = attempts[i] - attempts[i - 1];
+    EXPECT(gap >= delays[i - 1]);
+    EXPECT(gap < delays[i - 1] + 50);
+  }
+  EXPECT(is_audio(received));
+  source.close();
+}
+
+TEST(http_connection_refused_backs_off) {
+  // Nothing listens on the port: connecting fails without blocking.
+  uint16_t port;
+  {
+    TestServer server([](TestServer &, int, const std::string &) {});
+    port = server.port();
+  }
+  HttpSource source;
+  configure(source, "http://127.0.0.1:" + std::to_string(port) + "/");
+  std::vector<uint8_t> received;
+  EXPECT(pump(source, received, [&]() { return source.get_stats().connection_errors >= 3; }));
+  EXPECT(!source.at_end());
+  EXPECT_EQ(source.get_stats().connects, 0u);
+  source.close();
+}
+
+TEST(http_file_ends_with_connection) {
+  TestServer server([&](TestServer &server, int fd, const std::string &path) {
+    server.send_throttled(fd, "HTTP/1.0 200 OK\r\nContent-Length: 3000\r\n\r\n" + audio(0, 3000), 700, 200);
+  });
+  HttpSource source;
+  configure(source, server.url("/tts.mp3"));
+  std::vector<uint8_t> received;
+  EXPECT(pump(source, received, [&]() { return source.at_end(); }));
+  EXPECT_EQ(source.get_state(), HTTP_ENDED);
+  EXPECT_EQ(received.size(), 3000u);
+  EXPECT(is_audio(received));
+}
+
+TEST(http_follows_relative_redirects) {
+  TestServer server([&](TestServer &server, int fd, const std::string &path) {
+    if (path == "/radio/listen.pls") {
+      server.send_throttled(fd, "HTTP/1.1 302 Found\r\nLocation: mounts/main\r\n\r\n");
+    } else if (path == "/radio/mounts/main") {
+      server.send_throttled(fd, "HTTP/1.1 301 Moved\r\nLocation: /live?format=mp3\r\n\r\n");
+    } else if (path == "/live?format=mp3") {
+      server.send_throttled(fd, "HTTP/1.0 200 OK\r\n\r\n" + audio(0, 2000));
+      server.stall(fd);
+    } else {
+      server.send_throttled(fd, "HTTP/1.0 404 Not Found\r\n\r\n");
+    }
+  });
+  HttpSource source;
+  configure(source, server.url("/radio/listen.pls"));
+  std::vector<uint8_t> received;
+  EXPECT(pump(source, received, [&]() { return received.size() >= 2000; }));
+  auto requests = server.requests();
+  EXPECT_EQ(requests.size(), 3u);
+  EXPECT(requests.size() == 3 && requests[1] == "/radio/mounts/main" && requests[2] == "/live?format=mp3");
+  EXPECT(is_audio(received));
+  source.close();
+}
+
+TEST(http_too_many_redirects_fail) {
+  TestServer server([&](TestServer &server, int fd, const std::string &path) {
+    server.send_throttled(fd, "HTTP/1.1 302 Found\r\nLocation: /loop\r\n\r\n");
+  });
+  HttpSource source;
+  configure(source, server.url("/loop"));
+  std::vector<uint8_t> received;
+  EXPECT(pump(source, received, [&]() { return source.at_end(); }));
+  EXPECT_EQ(source.get_state(), HTTP_FAILED);
+  // The first request, and three redirects. No reconnects after that.
+  host::advance_ms(5000);
+  EXPECT(!pump(source, received, [&]() { return server.requests().size() > 4; }, 1000));
+  EXPECT_EQ(server.requests().size(), 4u);
+}
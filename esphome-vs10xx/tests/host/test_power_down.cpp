@@ -0,0 +1,161 @@
+#include "fixture.h"
+#include "test.h"
+#include <array>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+/// A plugin of a few words, that counts how often it is loaded.
+class CountingPlugin : public VS10XXPlugin {
+ public:
+  const char *description() const override { return "counting"; }
+
+  mutable uint32_t loads{0};
+
+ protected:
+  const uint16_t *plugin_data_(size_t *size) const override {
+    static const uint16_t DATA[] = {SCI_WRAMADDR, 1, 0x1800, SCI_WRAM, 0x8002, 0x1234};
+    this->loads++;
+    *size = sizeof(DATA) / sizeof(DATA[0]);
+    return DATA;
+  }
+};
+
+using RegisterWrites = std::array<uint32_t, 16>;
+
+static RegisterWrites register_writes(const TestDevice &t) {
+  RegisterWrites writes;
+  for (uint8_t reg = 0; reg < writes.size(); reg++) {
+    writes[reg] = t.transport.get_sci_writes(reg);
+  }
+  return writes;
+}
+
+// The SCI writes per register from the start of playback until the first
+// audio data are sent.
+static RegisterWrites writes_until_first_data(TestDevice &t, PatternSource &source) {
+  auto before = register_writes(t);
+  auto sdi_bytes = t.transport.get_sdi_bytes();
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.transport.get_sdi_bytes() > sdi_bytes; }, 1000));
+  auto after = register_writes(t);
+  for (size_t reg = 0; reg < after.size(); reg++) {
+    after[reg] -= before[reg];
+  }
+  return after;
+}
+
+static void run_to_end(TestDevice &t) {
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 2000));
+  t.run(10);
+}
+
+// The SCI writes for playing a short stream and reinitializing the device
+// after it was stopped.
+static uint32_t play_and_stop(TestDevice &t) {
+  PatternSource source(4096);
+  auto writes = t.transport.get_sci_writes();
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 2000));
+  t.run(10);
+  return t.transport.get_sci_writes() - writes;
+}
+
+TEST(wake_up_shortcut_only_applies_once) {
+  TestDevice t;
+  t.device.set_power_down_idle_time(1000);
+  t.device.set_power_down_hold_reset(true);
+  EXPECT(t.start());
+  auto normal = play_and_stop(t);
+
+  EXPECT(t.run_until([&]() { return t.device.get_device_state() == DEVICE_POWER_DOWN; }, 2000));
+  // Waking up skips the communication checks, but the reinitialization
+  // after the stop must do them again.
+  PatternSource source(4096);
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_PLAYING; }, 1000));
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 2000));
+  t.run(10);
+  EXPECT_EQ(play_and_stop(t), normal);
+}
+
+TEST(wake_up_from_sm_pdown_restores_mode_and_volume) {
+  TestDevice t("vs10xx", 3);
+  CountingPlugin plugin;
+  t.device.add_plugin(&plugin);
+  t.device.set_power_down_idle_time(1000);
+  EXPECT(t.start());
+  EXPECT_EQ(plugin.loads, 1u);
+  PatternSource first(4096);
+  auto awake = writes_until_first_data(t, first);
+  run_to_end(t);
+  // The reinitialization after playback loads the plugins again.
+  EXPECT_EQ(plugin.loads, 2u);
+
+  EXPECT(t.run_until([&]() { return t.device.get_device_state() == DEVICE_POWER_DOWN; }, 2000));
+  EXPECT(t.transport.get_register(SCI_MODE) & SM_PDOWN);
+  auto hard_resets = t.transport.get_hard_resets();
+  auto soft_resets = t.transport.get_soft_resets();
+
+  // Compared to starting playback on a device that is awake, waking up
+  // only clears SM_PDOWN and restores the volume.
+  PatternSource second(4096);
+  auto woken = writes_until_first_data(t, second);
+  for (uint8_t reg = 0; reg < woken.size(); reg++) {
+    auto extra = reg == SCI_MODE || reg == SCI_VOL ? 1u : 0u;
+    if (woken[reg] != awake[reg] + extra) {
+      printf("  register 0x%02X: %u writes, expected %u\n", reg, woken[reg], awake[reg] + extra);
+    }
+    EXPECT_EQ(woken[reg], awake[reg] + extra);
+  }
+  EXPECT_EQ(plugin.loads, 2u);
+  EXPECT_EQ(t.transport.get_hard_resets(), hard_resets);
+  EXPECT_EQ(t.transport.get_soft_resets(), soft_resets);
+  run_to_end(t);
+  EXPECT(t.transport.get_violations().empty());
+}
+
+TEST(wake_up_from_reset_reloads_plugins) {
+  TestDevice t("vs10xx", 3);
+  CountingPlugin plugin;
+  t.device.add_plugin(&plugin);
+  t.device.set_power_down_idle_time(1000);
+  t.device.set_power_down_hold_reset(true);
+  EXPECT(t.start());
+  EXPECT_EQ(plugin.loads, 1u);
+
+  EXPECT(t.run_until([&]() { return t.device.get_device_state() == DEVICE_POWER_DOWN; }, 2000));
+  auto hard_resets = t.transport.get_hard_resets();
+  // Being held in reset loses the plugins, so waking up loads them again.
+  PatternSource source(4096);
+  writes_until_first_data(t, source);
+  EXPECT_EQ(plugin.loads, 2u);
+  EXPECT_EQ(t.transport.get_hard_resets(), hard_resets + 1);
+  run_to_end(t);
+  EXPECT(t.transport.get_violations().empty());
+}
+
+TEST(wake_latency_set_on_first_burst) {
+  TestDevice t("vs10xx", 3);
+  t.device.set_power_down_idle_time(1000);
+  EXPECT(t.start());
+  EXPECT(t.run_until([&]() { return t.device.get_device_state() == DEVICE_POWER_DOWN; }, 2000));
+  EXPECT_EQ(t.device.get_wake_latency_us(), 0u);
+
+  PatternSource source(1 << 16);
+  auto sdi_bytes = t.transport.get_sdi_bytes();
+  auto requested = host::now_us();
+  t.device.play(&source);
+  EXPECT_EQ(t.device.get_wake_latency_us(), 0u);
+  EXPECT(t.run_until([&]() { return t.transport.get_sdi_bytes() > sdi_bytes; }, 1000));
+  auto latency = t.device.get_wake_latency_us();
+  EXPECT(latency > 0);
+  EXPECT(latency <= host::now_us() - requested);
+
+  // The bursts that follow leave it alone.
+  t.run(200);
+  EXPECT(t.transport.get_sdi_bytes() > sdi_bytes + 2048);
+  EXPECT_EQ(t.device.get_wake_latency_us(), latency);
+}
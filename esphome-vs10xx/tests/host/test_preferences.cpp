@@ -0,0 +1,185 @@
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+TEST(preferences_debounced) {
+  TestDevice t;
+  t.device.set_preferences_quiet_period(5000);
+  EXPECT(t.start());
+  // A burst of changes, like turning a rotary encoder.
+  for (int i = 1; i <= 5; i++) {
+    t.device.set_volume(i / 10.0f, i / 10.0f);
+    t.run(100);
+  }
+  t.run(4800);
+  EXPECT_EQ(host::preference_syncs(), 0u);
+  t.run(200);
+  // The flash writes are the syncs, not the saves that stage them.
+  EXPECT_EQ(host::preference_saves(), 1u);
+  EXPECT_EQ(host::preference_syncs(), 1u);
+  EXPECT_EQ(t.device.get_flash_writes_issued(), 1u);
+  EXPECT_EQ(t.device.get_flash_writes_coalesced(), 4u);
+
+  // The last value of the burst is stored.
+  TestDevice restored;
+  EXPECT(restored.start());
+  EXPECT_EQ(restored.device.get_volume(), 0.5f);
+}
+
+TEST(preferences_unchanged_not_written) {
+  TestDevice t;
+  t.device.set_preferences_quiet_period(1000);
+  EXPECT(t.start());
+  auto volume = t.device.get_volume();
+  t.device.set_volume(0.3f, 0.3f);
+  t.device.set_volume(volume, volume);
+  t.run(1500);
+  EXPECT_EQ(host::preference_syncs(), 0u);
+  EXPECT_EQ(t.device.get_flash_writes_issued(), 0u);
+  EXPECT_EQ(t.device.get_flash_writes_coalesced(), 2u);
+}
+
+TEST(preferences_forced_at_end_of_playback) {
+  TestDevice t;
+  t.device.set_preferences_quiet_period(60000);
+  EXPECT(t.start());
+  PatternSource source(16000);
+  t.device.play(&source);
+  t.run(100);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  t.device.set_volume(0.4f, 0.4f);
+  // The source plays for about a second at 16 kB/s. The end of playback
+  // writes the preferences, long before the quiet period is over.
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 3000));
+  EXPECT_EQ(host::preference_syncs(), 1u);
+  EXPECT_EQ(t.device.get_flash_writes_issued(), 1u);
+}
+
+TEST(preferences_per_device) {
+  TestDevice a("speaker_a");
+  TestDevice b("speaker_b");
+  a.device.set_preferences_quiet_period(100);
+  b.device.set_preferences_quiet_period(100);
+  EXPECT(a.start());
+  EXPECT(b.start());
+  a.device.set_volume(0.2f, 0.2f);
+  b.device.set_volume(0.7f, 0.7f);
+  a.run(200);
+  b.run(200);
+  EXPECT_EQ(host::preference_syncs(), 2u);
+
+  TestDevice restored("speaker_a");
+  EXPECT(restored.start());
+  EXPECT_EQ(restored.device.get_volume(), 0.2f);
+}
+
+TEST(preferences_migrated_from_before_names) {
+  // Stored by a version that did not name the devices yet.
+  VS10XXPreferences legacy;
+  legacy.volume_left = 0.3f;
+  legacy.volume_right = 0.3f;
+  auto legacy_store = global_preferences->make_preference<VS10XXPreferences>(fnv1_hash(""));
+  legacy_store.save(&legacy);
+
+  TestDevice other("speaker_b");
+  EXPECT(other.start());
+  EXPECT_EQ(other.device.get_volume(), 1.0f);
+
+  TestDevice t("speaker_a");
+  t.device.set_migrate_legacy_preferences(true);
+  EXPECT(t.start());
+  EXPECT_EQ(t.device.get_volume(), 0.3f);
+  EXPECT(host::has_preference(fnv1_hash("speaker_a")));
+
+  // Once migrated, the preferences of the device itself are used.
+  t.device.set_volume(0.6f, 0.6f);
+  t.run(5100);
+  TestDevice restored("speaker_a");
+  restored.device.set_migrate_legacy_preferences(true);
+  EXPECT(restored.start());
+  EXPECT_EQ(restored.device.get_volume(), 0.6f);
+}
+
+TEST(preferences_wait_for_buffered_audio) {
+  TestDevice t;
+  t.device.set_preferences_quiet_period(100);
+  EXPECT(t.start());
+  // The source is much faster than the decoder, so the buffer stays full.
+  PatternSource source(1024 * 1024);
+  t.device.play(&source);
+  t.run(100);
+  t.device.set_volume(0.4f, 0.4f);
+  t.run(150);
+  EXPECT_EQ(host::preference_saves(), 1u);
+  EXPECT_EQ(host::preference_syncs(), 1u);
+}
+
+TEST(preferences_deferral_is_bounded) {
+  TestDevice t;
+  t.device.set_preferences_quiet_period(100);
+  t.device.set_flash_write_max_deferral(2000);
+  EXPECT(t.start());
+  // The source delivers at the rate of the decoder, so the device keeps its
+  // input buffer full, while the audio buffer never fills up.
+  PatternSource source(4096, true);
+  t.device.play(&source);
+  auto step = [&](uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      source.grow(16);
+      t.step();
+    }
+  };
+  step(500);
+  EXPECT(t.device.get_buffer_fill() < 0.75f);
+  t.device.set_volume(0.4f, 0.4f);
+  step(2000);
+  EXPECT_EQ(host::preference_saves(), 0u);
+  EXPECT_EQ(host::preference_syncs(), 0u);
+  step(200);
+  EXPECT_EQ(host::preference_saves(), 1u);
+  EXPECT_EQ(host::preference_syncs(), 1u);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  EXPECT_EQ(t.device.get_playback_stats().underruns, 0u);
+}
+
+TEST(preferences_of_other_components_synced_when_safe) {
+  TestDevice t;
+  t.device.set_preferences_quiet_period(100);
+  t.device.set_flash_write_max_deferral(60000);
+  EXPECT(t.start());
+  PatternSource source(4096, true);
+  t.device.play(&source);
+  auto step = [&](uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      source.grow(16);
+      t.step();
+    }
+  };
+  step(500);
+
+  // Another component stages a preference during playback. The device
+  // does not sync it while its own write is deferred, but its own write
+  // commits both, once it is safe.
+  uint32_t value = 42;
+  auto other = global_preferences->make_preference<uint32_t>(0x12345678);
+  other.save(&value);
+  t.device.set_volume(0.4f, 0.4f);
+  step(1000);
+  EXPECT_EQ(host::preference_syncs(), 0u);
+  source.grow(16 * 1024);
+  t.run(200);
+  EXPECT_EQ(host::preference_saves(), 2u);
+  EXPECT_EQ(host::preference_syncs(), 1u);
+
+  // Without changes to its own preferences, the device syncs what other
+  // components staged at the end of playback.
+  other.save(&value);
+  t.device.stop();
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 5000));
+  t.run(10);
+  EXPECT_EQ(host::preference_syncs(), 2u);
+}
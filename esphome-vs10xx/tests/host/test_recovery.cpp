@@ -0,0 +1,126 @@
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::FakeTransport;
+using esphome::test::MemorySource;
+using esphome::test::mp3_stream;
+using esphome::test::PatternSource;
+using esphome::test::wav_stream;
+using esphome::test::TestDevice;
+
+TEST(recovery_failure_closes_source) {
+  TestDevice t;
+  // Without a reset pin, a hang that survives the soft reset cannot be
+  // recovered from.
+  t.transport.set_has_reset(false);
+  t.device.set_watchdog_timeout(300);
+  EXPECT(t.start());
+
+  PatternSource source(1 << 20);
+  t.device.play(&source);
+  t.run(100);
+  t.transport.set_hung(true);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 5000));
+  EXPECT_EQ(t.device.get_recovery_stats().failures, 1u);
+  EXPECT_EQ(source.closed, 1u);
+}
+
+/// Plays a stream, and hangs the decoder after two seconds. Returns the
+/// number of bytes that were sent to the device when the watchdog found
+/// the hang, or 0 when it did not.
+static size_t play_and_hang(TestDevice &t, MemorySource &source, FakeTransport::HangCure cure) {
+  // The decode time advances once per second at 16000 bytes per second, so
+  // the watchdog needs more than a second to tell a hang from playback.
+  t.device.set_watchdog_timeout(1500);
+  if (!t.start()) {
+    return 0;
+  }
+  auto sdi_bytes = t.transport.get_sdi_bytes();
+  t.device.play(&source);
+  t.run(2000);
+  t.transport.set_hung(true, cure);
+  if (!t.run_until([&]() { return t.device.get_media_state() == MEDIA_RECOVERING; }, 5000)) {
+    return 0;
+  }
+  return t.transport.get_sdi_bytes() - sdi_bytes;
+}
+
+TEST(recovery_by_cancel_resumes_mp3) {
+  TestDevice t;
+  MemorySource source(mp3_stream(200000));
+  auto sent = play_and_hang(t, source, FakeTransport::CURED_BY_CANCEL);
+  EXPECT(sent > 0);
+  auto soft_resets = t.transport.get_soft_resets();
+  EXPECT(t.run_until([&]() { return t.device.get_recovery_stats().recoveries == 1; }, 1000));
+  EXPECT_EQ(t.transport.get_cancels(), 1u);
+  EXPECT_EQ(t.transport.get_soft_resets(), soft_resets);
+  EXPECT_EQ(t.transport.get_hard_resets(), 1u);
+
+  // The MP3 stream resumes from where the device was, instead of replaying
+  // what was already heard.
+  EXPECT_EQ(source.seeks.size(), 1u);
+  EXPECT_EQ(source.seeks.empty() ? 0 : source.seeks[0], sent);
+  auto &stats = t.device.get_recovery_stats();
+  EXPECT(stats.stage_duration_us[RECOVERY_CANCEL] > 0);
+  EXPECT_EQ(stats.stage_duration_us[RECOVERY_SOFT_RESET], 0u);
+  EXPECT_EQ(stats.stage_duration_us[RECOVERY_HARD_RESET], 0u);
+
+  // Playback goes on, without the watchdog finding another hang.
+  t.run(3000);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  EXPECT_EQ(stats.hangs, 1u);
+  EXPECT(t.transport.get_violations().empty());
+}
+
+TEST(recovery_by_soft_reset_restarts_wav) {
+  TestDevice t;
+  t.transport.set_ignore_cancel(true);
+  MemorySource source(wav_stream(200000));
+  EXPECT(play_and_hang(t, source, FakeTransport::CURED_BY_SOFT_RESET) > 0);
+  auto soft_resets = t.transport.get_soft_resets();
+  auto resets = source.resets;
+  EXPECT(t.run_until([&]() { return t.device.get_recovery_stats().recoveries == 1; }, 1000));
+  EXPECT_EQ(t.transport.get_soft_resets(), soft_resets + 1);
+  EXPECT_EQ(t.transport.get_hard_resets(), 1u);
+
+  // A WAV stream cannot be decoded without its header, so it restarts.
+  EXPECT(source.seeks.empty());
+  EXPECT_EQ(source.resets, resets + 1);
+  auto &stats = t.device.get_recovery_stats();
+  EXPECT_EQ(stats.stage_duration_us[RECOVERY_CANCEL], 0u);
+  EXPECT(stats.stage_duration_us[RECOVERY_SOFT_RESET] > 0);
+  EXPECT_EQ(stats.stage_duration_us[RECOVERY_HARD_RESET], 0u);
+
+  t.run(3000);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  EXPECT_EQ(stats.hangs, 1u);
+  EXPECT_EQ(t.transport.get_stream_byte_rate(), 16000u);
+}
+
+TEST(recovery_by_hard_reset_after_soft_reset_fails) {
+  TestDevice t;
+  t.transport.set_ignore_cancel(true);
+  MemorySource source(mp3_stream(300000));
+  EXPECT(play_and_hang(t, source, FakeTransport::CURED_BY_HARD_RESET) > 0);
+
+  // The soft reset brings the device back, but the decoder hangs again.
+  // The watchdog finds that, and continues with the next stage.
+  EXPECT(t.run_until([&]() { return t.transport.get_hard_resets() == 2; }, 5000));
+  auto sent = t.transport.get_sdi_bytes();
+  EXPECT(t.run_until([&]() { return t.device.get_recovery_stats().recoveries == 2; }, 1000));
+  auto &stats = t.device.get_recovery_stats();
+  EXPECT_EQ(stats.hangs, 2u);
+  EXPECT(stats.stage_duration_us[RECOVERY_SOFT_RESET] > 0);
+  EXPECT(stats.stage_duration_us[RECOVERY_HARD_RESET] > 0);
+  // Both resumed the MP3 stream, the second one further on.
+  EXPECT_EQ(source.seeks.size(), 2u);
+  EXPECT(source.seeks.size() == 2 && source.seeks[1] > source.seeks[0]);
+
+  t.run(3000);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  EXPECT_EQ(stats.hangs, 2u);
+  EXPECT(t.transport.get_sdi_bytes() > sent + 40000);
+  EXPECT(t.transport.get_violations().empty());
+}
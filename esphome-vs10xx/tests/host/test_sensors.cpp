@@ -0,0 +1,119 @@
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+/// A pattern source that starts with a MIDI file header.
+class MidiSource : public PatternSource {
+ public:
+  using PatternSource::PatternSource;
+  size_t read(uint8_t *buffer, size_t max_size) override {
+    auto start = this->position();
+    auto size = PatternSource::read(buffer, max_size);
+    for (size_t i = start; i < 4 && i < start + size; i++) {
+      buffer[i - start] = "MThd"[i];
+    }
+    return size;
+  }
+};
+
+TEST(sensors_and_text_sensors_use_own_interval) {
+  TestDevice t;
+  sensor::Sensor decode_time;
+  text_sensor::TextSensor format;
+  t.device.set_decode_time_sensor(&decode_time);
+  t.device.set_format_text_sensor(&format);
+  t.device.set_sensor_update_interval(1000);
+  t.device.set_text_sensor_update_interval(60000);
+  EXPECT(t.start());
+  t.run(5000);
+  EXPECT(decode_time.publish_count >= 4);
+  EXPECT_EQ(format.publish_count, 0u);
+  t.run(55000);
+  EXPECT_EQ(format.publish_count, 1u);
+}
+
+TEST(status_poll_publishes_requested_targets) {
+  TestDevice t;
+  sensor::Sensor decode_time;
+  text_sensor::TextSensor format;
+  t.device.set_decode_time_sensor(&decode_time);
+  t.device.set_format_text_sensor(&format);
+  t.device.set_sensor_update_interval(60000);
+  t.device.set_text_sensor_update_interval(500);
+  EXPECT(t.start());
+  PatternSource source(1000000);
+  t.device.play(&source);
+  // During playback, the status is polled from the feed loop for the text
+  // sensors only, so the sensors are left alone until their own interval.
+  t.run(3000);
+  EXPECT_EQ(t.device.get_media_state(), MEDIA_PLAYING);
+  EXPECT_EQ(format.publish_count, 1u);
+  EXPECT_EQ(decode_time.publish_count, 0u);
+}
+
+TEST(clock_profile_published_on_change) {
+  TestDevice t;
+  text_sensor::TextSensor clock_profile;
+  t.device.set_clock_profile_text_sensor(&clock_profile);
+  t.device.set_text_sensor_update_interval(60000);
+  t.device.set_clock_scaling(true);
+  EXPECT(t.start());
+  t.run(10);
+  EXPECT_EQ(clock_profile.publish_count, 1u);
+  EXPECT(clock_profile.state == "Normal");
+
+  // A MIDI stream gets the low clock profile, which is published right
+  // away, instead of at the next text sensor update.
+  MidiSource source(1000000);
+  t.device.play(&source);
+  t.run(100);
+  EXPECT_EQ(clock_profile.publish_count, 2u);
+  EXPECT(clock_profile.state == "Low");
+  t.run(1000);
+  EXPECT_EQ(clock_profile.publish_count, 2u);
+}
+
+TEST(sci_stats_published_as_sensors) {
+  TestDevice t;
+  sensor::Sensor writes_issued, writes_skipped, reads_issued, reads_skipped;
+  t.device.set_sci_writes_issued_sensor(&writes_issued);
+  t.device.set_sci_writes_skipped_sensor(&writes_skipped);
+  t.device.set_sci_reads_issued_sensor(&reads_issued);
+  t.device.set_sci_reads_skipped_sensor(&reads_skipped);
+  t.device.set_sensor_update_interval(1000);
+  EXPECT(t.start());
+  // Setting the volume that the device already has is answered by the
+  // register shadow.
+  t.device.set_volume(0.5f, 0.5f);
+  t.run(10);
+  t.device.set_volume(0.5f, 0.5f);
+  t.run(1000);
+  auto &stats = t.hal.get_sci_stats();
+  EXPECT(stats.writes_skipped > 0);
+  EXPECT_EQ(writes_issued.publish_count, 1u);
+  EXPECT_EQ(writes_issued.state, static_cast<float>(stats.writes_issued));
+  EXPECT_EQ(writes_skipped.state, static_cast<float>(stats.writes_skipped));
+  EXPECT_EQ(reads_issued.state, static_cast<float>(stats.reads_issued));
+  EXPECT_EQ(reads_skipped.state, static_cast<float>(stats.reads_skipped));
+  EXPECT_EQ(writes_issued.state, static_cast<float>(t.transport.get_sci_writes()));
+}
+
+TEST(flash_writes_published_as_sensors) {
+  TestDevice t;
+  sensor::Sensor issued, coalesced;
+  t.device.set_flash_writes_issued_sensor(&issued);
+  t.device.set_flash_writes_coalesced_sensor(&coalesced);
+  t.device.set_preferences_quiet_period(100);
+  t.device.set_sensor_update_interval(1000);
+  EXPECT(t.start());
+  t.device.set_volume(0.2f, 0.2f);
+  t.device.set_volume(0.3f, 0.3f);
+  t.run(1000);
+  EXPECT_EQ(issued.state, 1.0f);
+  EXPECT_EQ(coalesced.state, 1.0f);
+  EXPECT_EQ(issued.state, static_cast<float>(host::preference_syncs()));
+}
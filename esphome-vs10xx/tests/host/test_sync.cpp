@@ -0,0 +1,278 @@
+#include "esphome/components/vs10xx/vs10xx_format.h"
+#include "esphome/components/vs10xx/vs10xx_sync.h"
+#include "fixture.h"
+#include "test.h"
+#include <algorithm>
+#include <arpa/inet.h>
+#include <cstdlib>
+#include <memory>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::RtpSender;
+using esphome::test::TestDevice;
+using esphome::test::free_udp_port;
+
+// The multicast group of the tests.
+static const char *const GROUP = "239.255.42.1";
+
+/// The layout of the messages of VS10XXSync (see vs10xx_sync.cpp).
+struct SyncMessage {
+  uint32_t magic;
+  uint8_t version;
+  uint8_t type;
+  uint8_t has_anchor;
+  uint8_t has_start;
+  uint32_t sent_at_us;
+  uint32_t anchor_ssrc;
+  uint32_t anchor_rtp;
+  uint32_t anchor_at_us;
+  uint32_t start_ssrc;
+  uint32_t start_rtp;
+  uint32_t start_at_us;
+  uint32_t follower_id;
+  uint32_t ping_sent_at_us;
+  uint32_t ping_received_at_us;
+} __attribute__((packed));
+
+static const uint32_t SYNC_MAGIC = 0x4E595356;
+enum { SYNC_CLOCK, SYNC_PING, SYNC_PONG };
+
+/// A leader that answers pings over the loopback interface, with a clock
+/// that runs at the fake clock, and with network delays that the test
+/// decides.
+class FakeLeader {
+ public:
+  explicit FakeLeader(uint16_t port) : port_(port) {
+    this->fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+    int reuse = 1;
+    setsockopt(this->fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+    in_addr interface{};
+    interface.s_addr = htonl(INADDR_LOOPBACK);
+    setsockopt(this->fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(this->fd_, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+  }
+  ~FakeLeader() { ::close(this->fd_); }
+
+  /// Send a clock message, from which the follower learns the address of
+  /// the leader.
+  void send_clock() {
+    SyncMessage message{};
+    message.magic = SYNC_MAGIC;
+    message.version = 2;
+    message.type = SYNC_CLOCK;
+    message.sent_at_us = host::now_us();
+    this->send_(message);
+  }
+
+  /// Answer a ping. The ping takes to_us to arrive, the leader takes 500
+  /// µs to answer, and the answer takes from_us to arrive.
+  bool answer(uint32_t to_us, uint32_t from_us) {
+    SyncMessage message;
+    if (recv(this->fd_, &message, sizeof(message), MSG_DONTWAIT) != sizeof(message) || message.type != SYNC_PING) {
+      return false;
+    }
+    host::advance_us(to_us);
+    message.type = SYNC_PONG;
+    message.ping_sent_at_us = message.sent_at_us;
+    message.ping_received_at_us = host::now_us();
+    host::advance_us(500);
+    message.sent_at_us = host::now_us();
+    this->send_(message);
+    host::advance_us(from_us);
+    return true;
+  }
+
+ protected:
+  void send_(const SyncMessage &message) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(this->port_);
+    inet_pton(AF_INET, GROUP, &address.sin_addr);
+    sendto(this->fd_, &message, sizeof(message), 0, reinterpret_cast<sockaddr *>(&address), sizeof(address));
+  }
+
+  int fd_;
+  uint16_t port_;
+};
+
+/// Run the loop of a follower, with its clock ahead of the fake clock.
+static void follower_loop(VS10XXSync &sync, uint32_t clock_offset_us) {
+  host::set_clock_offset_us(clock_offset_us);
+  sync.loop();
+  host::set_clock_offset_us(0);
+}
+
+TEST(sync_clock_offset_from_round_trip) {
+  auto port = free_udp_port();
+  FakeLeader leader(port);
+  VS10XXSync sync;
+  sync.set_role(SYNC_FOLLOWER);
+  sync.set_address(GROUP);
+  sync.set_port(port);
+  const uint32_t ahead = 5000;
+  follower_loop(sync, ahead);
+
+  // The follower pings once it knows the leader.
+  leader.send_clock();
+  host::advance_ms(250);
+  follower_loop(sync, ahead);
+  // The first ping is slow on the way to the leader. Half of the
+  // difference between both ways ends up in the offset.
+  EXPECT(leader.answer(10000, 2000));
+  follower_loop(sync, ahead);
+  EXPECT(sync.has_clock());
+  EXPECT_EQ(static_cast<int32_t>(sync.get_clock_offset_us()), static_cast<int32_t>(ahead) - 4000);
+  EXPECT_EQ(sync.get_stats().round_trip_us, 12000u);
+
+  // The pings after that are fast both ways. The one with the shortest
+  // round trip wins, once the window is complete.
+  for (int i = 0; i < 7; i++) {
+    host::advance_ms(250);
+    follower_loop(sync, ahead);
+    EXPECT(leader.answer(1000 + i * 100, 1000 + i * 100));
+    follower_loop(sync, ahead);
+  }
+  EXPECT_EQ(static_cast<int32_t>(sync.get_clock_offset_us()), static_cast<int32_t>(ahead));
+  EXPECT_EQ(sync.get_stats().round_trip_us, 2000u);
+  EXPECT_EQ(sync.get_stats().pings, 8u);
+}
+
+/// A leader and two followers, with clocks that are far apart. The leader
+/// receives the RTP stream, and relays it to the followers.
+struct SyncFixture {
+  SyncFixture() : udp_port(free_udp_port()), sync_port(free_udp_port()), sender(udp_port) {
+    this->add_("leader", SYNC_LEADER, 3000000, 20);
+    this->add_("follower 1", SYNC_FOLLOWER, 0, 20);
+    // A larger playout delay would make this one start later, if the start
+    // was not scheduled.
+    this->add_("follower 2", SYNC_FOLLOWER, 7654321, 60);
+  }
+
+  bool start() {
+    for (auto &device : this->devices) {
+      if (!device->start()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /// Run the main loops of all devices for a while, in lockstep. An RTP
+  /// packet is sent every 10 ms while streaming. The fake clock time at
+  /// which every device started to feed audio data is recorded.
+  void run(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      // The loops of the devices take time, so the fake clock moves more
+      // than 1 ms per iteration.
+      while (this->streaming && this->send_at <= host::now_us()) {
+        this->sender.send(this->seq++);
+        this->send_at += 10000;
+      }
+      for (size_t d = 0; d < this->devices.size(); d++) {
+        this->devices[d]->loop();
+        if (this->started_at[d] == 0 && this->devices[d]->transport.get_sdi_bytes() > WAV_HEADER_SIZE) {
+          this->started_at[d] = host::now_us();
+        }
+      }
+      host::run_scheduler();
+      host::advance_ms(1);
+    }
+  }
+
+  const VS10XXSync &sync(size_t d) const { return this->devices[d]->device.get_sync(); }
+
+  uint16_t udp_port;
+  uint16_t sync_port;
+  RtpSender sender;
+  std::vector<std::unique_ptr<TestDevice>> devices;
+  std::vector<uint64_t> started_at;
+  bool streaming{false};
+  uint64_t send_at{0};
+  uint16_t seq{0};
+
+ protected:
+  void add_(const char *name, SyncRole role, uint32_t clock_offset_us, uint32_t min_delay) {
+    auto device = std::make_unique<TestDevice>(name);
+    device->clock_offset_us = clock_offset_us;
+    device->transport.set_record_sdi(true);
+    auto &d = device->device;
+    d.set_udp_stream_enabled(true);
+    d.set_udp_port(this->udp_port);
+    d.set_udp_sample_rate(16000);
+    d.set_udp_channels(1);
+    d.set_udp_min_delay(min_delay);
+    d.set_sync_enabled(true);
+    d.set_sync_role(role);
+    d.set_sync_address(GROUP);
+    d.set_sync_port(this->sync_port);
+    if (role == SYNC_LEADER) {
+      d.set_udp_relay_address(GROUP);
+    } else {
+      d.set_udp_multicast_address(GROUP);
+    }
+    this->devices.push_back(std::move(device));
+    this->started_at.push_back(0);
+  }
+};
+
+TEST(sync_devices_start_together) {
+  SyncFixture t;
+  EXPECT(t.start());
+  // The followers find the leader, and measure the offsets of their
+  // clocks.
+  t.run(1000);
+  for (size_t d = 1; d < 3; d++) {
+    EXPECT(t.sync(d).has_clock());
+    auto expected = t.devices[d]->clock_offset_us - t.devices[0]->clock_offset_us;
+    auto error = static_cast<int32_t>(t.sync(d).get_clock_offset_us() - expected);
+    EXPECT(std::abs(error) <= 1500);
+  }
+  EXPECT(t.sync(0).get_stats().pings > 0);
+
+  t.streaming = true;
+  t.send_at = host::now_us();
+  t.run(1000);
+  EXPECT_EQ(t.sync(0).get_stats().scheduled_starts, 1u);
+  for (size_t d = 0; d < 3; d++) {
+    EXPECT(t.devices[d]->device.get_media_state() == MEDIA_PLAYING);
+    EXPECT(t.started_at[d] != 0);
+    EXPECT_EQ(t.sync(d).get_stats().scheduled_starts, 1u);
+  }
+  // All devices start with the same audio, within a few milliseconds.
+  // The devices share the fake clock, which moves with the SPI transfers
+  // of every device. So a device that runs later in a loop iteration starts
+  // later, and skips the frames that it is late for. What matters is the
+  // time at which each device would have played the first frame of the
+  // stream.
+  std::vector<uint64_t> first_frame_at;
+  for (size_t d = 0; d < 3; d++) {
+    auto &data = t.devices[d]->transport.get_sdi_data();
+    EXPECT(data.size() >= WAV_HEADER_SIZE + 2);
+    auto sample = static_cast<int16_t>(data[WAV_HEADER_SIZE] | data[WAV_HEADER_SIZE + 1] << 8);
+    auto skipped = static_cast<uint64_t>(sample - RtpSender::sample_at(0));
+    EXPECT(skipped < 16000 / 100);
+    first_frame_at.push_back(t.started_at[d] - skipped * 1000000 / 16000);
+  }
+  auto first = *std::min_element(first_frame_at.begin(), first_frame_at.end());
+  auto last = *std::max_element(first_frame_at.begin(), first_frame_at.end());
+  EXPECT(last - first <= 500);
+
+  // While playing, the anchors confirm that the followers play in sync.
+  t.run(3000);
+  for (size_t d = 1; d < 3; d++) {
+    EXPECT(t.sync(d).has_offset());
+    EXPECT(std::abs(t.sync(d).get_stats().offset_us) <= 2000);
+    EXPECT_EQ(t.sync(d).get_stats().jumps, 0u);
+  }
+  t.streaming = false;
+  for (auto &device : t.devices) {
+    device->device.stop();
+  }
+}
@@ -0,0 +1,168 @@
+#include "esphome/components/vs10xx/vs10xx_format.h"
+#include "esphome/components/vs10xx/vs10xx_tone_source.h"
+#include "test.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+using namespace esphome::vs10xx;
+
+static const uint32_t RATE = 44100;
+
+static uint32_t read_le(const std::vector<uint8_t> &data, size_t offset, size_t size) {
+  uint32_t value = 0;
+  memcpy(&value, data.data() + offset, size);
+  return value;
+}
+
+/// Read a tone pattern to the end, in chunks of an odd size, and return the
+/// frames of the first channel. Returns an empty vector when the header is
+/// wrong, or when the channels of a frame differ.
+static std::vector<int16_t> render(ToneSource &tone, uint8_t channels, size_t max_frames = 1000000) {
+  std::vector<uint8_t> data;
+  uint8_t buffer[37];
+  tone.reset();
+  while (!tone.at_end() && data.size() < WAV_HEADER_SIZE + max_frames * channels * 2) {
+    size_t size = tone.read(buffer, sizeof(buffer));
+    data.insert(data.end(), buffer, buffer + size);
+  }
+  std::vector<int16_t> frames;
+  if (data.size() < WAV_HEADER_SIZE || memcmp(data.data(), "RIFF", 4) != 0 || read_le(data, 22, 2) != channels ||
+      read_le(data, 24, 4) != RATE || (data.size() - WAV_HEADER_SIZE) % (channels * 2) != 0) {
+    return frames;
+  }
+  for (size_t pos = WAV_HEADER_SIZE; pos < data.size(); pos += channels * 2) {
+    for (uint8_t c = 1; c < channels; c++) {
+      if (memcmp(&data[pos], &data[pos + c * 2], 2) != 0) {
+        return {};
+      }
+    }
+    frames.push_back(static_cast<int16_t>(data[pos] | data[pos + 1] << 8));
+  }
+  return frames;
+}
+
+/// The frequency of a signal over a range of frames, from the time between
+/// its first and last rising zero crossings.
+static double frequency_of(const std::vector<int16_t> &frames, size_t from, size_t to) {
+  double first = -1, last = -1;
+  int periods = -1;
+  for (size_t i = from + 1; i < to; i++) {
+    if (frames[i - 1] < 0 && frames[i] >= 0) {
+      double at = i - 1 + double(-frames[i - 1]) / (frames[i] - frames[i - 1]);
+      first = first < 0 ? at : first;
+      last = at;
+      periods++;
+    }
+  }
+  return periods > 0 ? periods * RATE / (last - first) : 0;
+}
+
+TEST(tone_sine_matches_reference) {
+  ToneSource tone;
+  tone.set_sample_rate(RATE);
+  tone.set_channels(2);
+  tone.add_step({TONE_SINE, 1000, 0, 100, 50, 10, 20, 0.5f});
+  auto frames = render(tone, 2);
+  const size_t tone_frames = RATE / 10, pause_frames = RATE / 20;
+  const size_t attack = RATE / 100, release = RATE / 50;
+  EXPECT_EQ(frames.size(), tone_frames + pause_frames);
+  if (frames.size() != tone_frames + pause_frames) {
+    return;
+  }
+
+  // The envelope rises linearly over the attack, and falls linearly over
+  // the release, to the frame after the tone.
+  double max_error = 0;
+  for (size_t i = 0; i < tone_frames; i++) {
+    double envelope = std::min({1.0, double(i) / attack, double(tone_frames - i) / release});
+    double reference = 32767 * 0.5 * envelope * sin(2 * M_PI * 1000 * i / RATE);
+    max_error = std::max(max_error, std::abs(frames[i] - reference));
+  }
+  if (max_error > 4) {
+    printf("  sine is %.1f LSB off\n", max_error);
+  }
+  EXPECT(max_error <= 4);
+
+  // The edges of the envelope: the tone starts and ends in silence, and the
+  // peaks only reach the volume after the attack, and before the release.
+  EXPECT_EQ(frames[0], 0);
+  auto peak = [&](size_t from, size_t to) {
+    int16_t value = 0;
+    for (size_t i = from; i < to; i++) {
+      value = std::max<int16_t>(value, std::abs(frames[i]));
+    }
+    return value;
+  };
+  EXPECT(peak(0, attack / 4) < 32767 / 8 + 4);
+  EXPECT(peak(attack, 2 * attack) > 32767 / 2 - 8);
+  EXPECT(peak(tone_frames - release, tone_frames - release + RATE / 1000) > 32767 / 2 - 8 - 32767 / 20);
+  EXPECT(peak(tone_frames - release / 4, tone_frames) < 32767 / 8 + 4);
+
+  // The pause is digital silence.
+  EXPECT_EQ(peak(tone_frames, frames.size()), 0);
+}
+
+TEST(tone_sweep_reaches_end_frequency) {
+  ToneSource tone;
+  tone.set_sample_rate(RATE);
+  tone.set_channels(1);
+  tone.add_step({TONE_SWEEP, 500, 2000, 200, 0, 0, 0, 0.5f});
+  auto frames = render(tone, 1);
+  const size_t tone_frames = RATE / 5;
+  EXPECT_EQ(frames.size(), tone_frames);
+  if (frames.size() != tone_frames) {
+    return;
+  }
+
+  // The frequency over a window is the average of the linear glide over
+  // that window.
+  const size_t window = RATE / 50;
+  for (size_t from : {size_t(0), tone_frames / 2 - window / 2, tone_frames - window}) {
+    double middle = (from + window / 2.0) / tone_frames;
+    double expected = 500 + (2000 - 500) * middle;
+    double measured = frequency_of(frames, from, from + window);
+    if (std::abs(measured - expected) > expected / 100) {
+      printf("  sweep is at %.1f Hz at %.0f%%, expected %.1f Hz\n", measured, middle * 100, expected);
+    }
+    EXPECT(std::abs(measured - expected) <= expected / 100);
+  }
+}
+
+TEST(tone_pattern_repeats) {
+  ToneSource tone;
+  tone.set_sample_rate(RATE);
+  tone.set_channels(1);
+  tone.add_step({TONE_SINE, 880, 0, 30, 10, 5, 5, 1.0f});
+  tone.add_step({TONE_SQUARE, 440, 0, 20, 20, 0, 0, 0.25f});
+  const size_t pattern = RATE * 40 / 1000 + RATE * 40 / 1000;
+
+  tone.set_repeat(3);
+  auto frames = render(tone, 1);
+  EXPECT_EQ(frames.size(), 3 * pattern);
+  if (frames.size() != 3 * pattern) {
+    return;
+  }
+  // Every repeat starts at phase 0, so all of them are the same.
+  EXPECT(std::equal(frames.begin(), frames.begin() + pattern, frames.begin() + pattern));
+  EXPECT(std::equal(frames.begin(), frames.begin() + pattern, frames.begin() + 2 * pattern));
+  // The square wave is at the volume, without an envelope, and flips
+  // halfway through a period.
+  const size_t square = RATE * 40 / 1000;
+  EXPECT(std::abs(frames[square] - 32767 / 4) <= 1);
+  EXPECT(std::abs(frames[square + RATE / 440 / 2 + 5] + 32767 / 4) <= 1);
+
+  // With a repeat of 0, the pattern plays until playback is stopped.
+  tone.set_repeat(0);
+  frames = render(tone, 1, 10 * pattern);
+  EXPECT(!tone.at_end());
+  EXPECT(frames.size() >= 10 * pattern);
+  EXPECT(std::equal(frames.begin(), frames.begin() + pattern, frames.begin() + 9 * pattern));
+
+  // Without steps, only the header is played.
+  ToneSource empty;
+  empty.set_sample_rate(RATE);
+  EXPECT_EQ(render(empty, 1).size(), 0u);
+  EXPECT(empty.at_end());
+}
@@ -0,0 +1,24 @@
+#include "esphome/components/vs10xx/vs10xx_trace.h"
+#include "fixture.h"
+#include "test.h"
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::PatternSource;
+using esphome::test::TestDevice;
+
+// The trace is decoded by tools/vs10xx_trace.py, from the log output of
+// this test (see tests/tools/test_trace.py). The test itself only plays a
+// short stream, and records two markers at a known distance in time.
+TEST(trace_dump) {
+  TestDevice t;
+  EXPECT(t.start());
+  PatternSource source(8000);
+  t.device.play(&source);
+  EXPECT(t.run_until([&]() { return t.device.get_media_state() == MEDIA_STOPPED; }, 3000));
+
+  VS10XX_TRACE(TRACE_SCI_WRITE, SCI_AICTRL3, 0xBEEF);
+  host::advance_ms(10);
+  VS10XX_TRACE(TRACE_SCI_WRITE, SCI_AICTRL3, 0xCAFE);
+  t.device.dump_trace();
+}
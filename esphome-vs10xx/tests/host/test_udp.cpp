@@ -0,0 +1,225 @@
+#include "esphome/components/vs10xx/vs10xx_udp_source.h"
+#include "fixture.h"
+#include "test.h"
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace esphome;
+using namespace esphome::vs10xx;
+using esphome::test::RtpSender;
+using esphome::test::TestDevice;
+using esphome::test::free_udp_port;
+
+static const uint32_t SAMPLES = RtpSender::SAMPLES;
+
+static int16_t sample_at(uint32_t position) { return RtpSender::sample_at(position); }
+
+/// A UDP source on a free port, with the decoded audio that was read.
+struct UdpFixture {
+  UdpFixture() : port(free_udp_port()), sender(port) {
+    this->source.set_port(this->port);
+    this->source.set_sample_rate(16000);
+    this->source.set_channels(1);
+    this->source.set_min_delay(20);
+    this->source.set_max_delay(100);
+    this->source.allocate();
+    // Start listening, before the first packet is sent.
+    this->source.poll();
+  }
+
+  /// Send packets, one every 10 ms, while the audio is read out in real
+  /// time. The packets are sent in the given order.
+  void stream(const std::vector<uint16_t> &seqs) {
+    for (auto seq : seqs) {
+      this->sender.send(seq);
+      if (this->source.poll() && !this->started) {
+        this->started = true;
+        this->source.reset();
+      }
+      this->play(10);
+    }
+  }
+
+  /// Read the audio for a while, 1 ms at a time, at the byte rate.
+  void play(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i++) {
+      uint8_t buffer[64];
+      size_t size = this->source.read(buffer, this->header_left > 0 ? this->header_left + 32 : 32);
+      size_t skip = std::min(size, this->header_left);
+      this->header_left -= skip;
+      for (size_t pos = skip; pos + 1 < size; pos += 2) {
+        this->frames.push_back(static_cast<int16_t>(buffer[pos] | buffer[pos + 1] << 8));
+      }
+      host::advance_ms(1);
+    }
+  }
+
+  /// Check that a range of frames holds the ramp from a stream position.
+  bool is_ramp(size_t from, size_t count, uint32_t position) const {
+    if (from + count > this->frames.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (this->frames[from + i] != sample_at(position + i)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool is_silent(size_t from, size_t count) const {
+    if (from + count > this->frames.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (this->frames[from + i] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  uint16_t port;
+  RtpSender sender;
+  UdpSource source;
+  bool started{false};
+  size_t header_left{WAV_HEADER_SIZE};
+  std::vector<int16_t> frames;
+};
+
+static std::vector<uint16_t> range(uint16_t from, uint16_t to) {
+  std::vector<uint16_t> seqs;
+  for (uint16_t seq = from; seq < to; seq++) {
+    seqs.push_back(seq);
+  }
+  return seqs;
+}
+
+TEST(udp_reordered_packets_play_in_order) {
+  UdpFixture t;
+  t.stream({0, 1, 3, 2, 4, 6, 5, 7, 8, 9});
+  t.play(100);
+  EXPECT(t.started);
+  EXPECT_EQ(t.frames.size(), 10 * SAMPLES);
+  EXPECT(t.is_ramp(0, 10 * SAMPLES, 0));
+  EXPECT_EQ(t.source.get_stats().lost, 0u);
+  EXPECT_EQ(t.source.get_stats().late, 0u);
+}
+
+TEST(udp_lost_packet_is_concealed) {
+  UdpFixture t;
+  auto seqs = range(0, 12);
+  seqs.erase(seqs.begin() + 5);
+  t.stream(seqs);
+  t.play(100);
+  // The missing packet is replaced by silence of the same duration, so the
+  // packets after it keep their place.
+  EXPECT_EQ(t.frames.size(), 12 * SAMPLES);
+  EXPECT(t.is_ramp(0, 5 * SAMPLES, 0));
+  EXPECT(t.is_silent(5 * SAMPLES, SAMPLES));
+  EXPECT(t.is_ramp(6 * SAMPLES, 6 * SAMPLES, 6 * SAMPLES));
+  EXPECT_EQ(t.source.get_stats().lost, 1u);
+}
+
+TEST(udp_late_packet_is_dropped) {
+  UdpFixture t;
+  // Packet 3 arrives after its playout time, so it was concealed already.
+  t.stream({0, 1, 2, 4, 5, 6, 7, 8, 9, 3, 10});
+  t.play(100);
+  EXPECT_EQ(t.source.get_stats().lost, 1u);
+  EXPECT_EQ(t.source.get_stats().late, 1u);
+  EXPECT(t.is_silent(3 * SAMPLES, SAMPLES));
+  EXPECT(t.is_ramp(4 * SAMPLES, 7 * SAMPLES, 4 * SAMPLES));
+}
+
+TEST(udp_resyncs_after_jump) {
+  UdpFixture t;
+  // The sender skips far ahead, more than the jitter buffer can hold.
+  auto seqs = range(0, 6);
+  auto later = range(1000, 1008);
+  seqs.insert(seqs.end(), later.begin(), later.end());
+  t.stream(seqs);
+  t.play(100);
+  EXPECT_EQ(t.source.get_stats().resyncs, 1u);
+  EXPECT_EQ(t.source.get_stats().lost, 0u);
+  // Whatever was buffered before the jump is dropped. The audio continues
+  // with the packets after the jump.
+  auto tail = 8 * SAMPLES;
+  EXPECT(t.frames.size() >= tail);
+  EXPECT(t.is_ramp(t.frames.size() - tail, tail, 1000 * SAMPLES));
+}
+
+TEST(udp_small_correction_drops_and_repeats_frames) {
+  UdpFixture t;
+  t.stream(range(0, 5));
+  // Skip ahead 3 frames: one frame per packet.
+  t.source.set_correction(3);
+  t.stream(range(5, 10));
+  t.play(100);
+  EXPECT_EQ(t.source.get_stats().dropped, 3u);
+  EXPECT_EQ(t.frames.size(), 10 * SAMPLES - 3);
+
+  // Delay 2 frames: the last frame of a packet is repeated.
+  t.source.set_correction(-2);
+  t.stream(range(10, 15));
+  t.play(100);
+  EXPECT_EQ(t.source.get_stats().inserted, 2u);
+  EXPECT_EQ(t.frames.size(), 15 * SAMPLES - 1);
+  EXPECT(t.is_ramp(t.frames.size() - 2 * SAMPLES, 2 * SAMPLES, 13 * SAMPLES));
+}
+
+TEST(udp_large_correction_inserts_silence) {
+  UdpFixture t;
+  t.stream(range(0, 5));
+  t.source.set_correction(-400);
+  t.stream(range(5, 10));
+  t.play(100);
+  EXPECT_EQ(t.source.get_stats().inserted, 400u);
+  EXPECT_EQ(t.frames.size(), 10 * SAMPLES + 400);
+  // The silence is inserted whole, between two packets.
+  size_t silence = 0;
+  while (silence < t.frames.size() && t.frames[silence] != 0) {
+    silence++;
+  }
+  EXPECT_EQ(silence % SAMPLES, 0u);
+  EXPECT(t.is_silent(silence, 400));
+  EXPECT(t.is_ramp(silence + 400, 10 * SAMPLES - silence, silence));
+}
+
+TEST(udp_stream_only_on_devices_that_enable_it) {
+  auto port = free_udp_port();
+  TestDevice t;
+  t.device.set_udp_port(port);
+  EXPECT(t.start());
+  t.run(10);
+  // The port is not taken by the device.
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  EXPECT(bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) == 0);
+  ::close(fd);
+
+  RtpSender sender(port);
+  for (uint16_t seq = 0; seq < 10; seq++) {
+    sender.send(seq);
+    t.run(10);
+  }
+  EXPECT(t.device.get_media_state() != MEDIA_PLAYING);
+}
+
+TEST(udp_stream_plays_on_enabled_device) {
+  auto port = free_udp_port();
+  TestDevice t;
+  t.device.set_udp_stream_enabled(true);
+  t.device.set_udp_port(port);
+  EXPECT(t.start());
+  t.run(10);
+  RtpSender sender(port);
+  for (uint16_t seq = 0; seq < 20; seq++) {
+    sender.send(seq);
+    t.run(10);
+  }
+  EXPECT(t.device.get_media_state() == MEDIA_PLAYING);
+  t.device.stop();
+}
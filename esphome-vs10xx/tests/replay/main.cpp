@@ -0,0 +1,63 @@
+#include "capture_replay.h"
+#include "host.h"
+#include "esphome/core/log.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+// Replays a capture file for regression checks, see CaptureReplayer.
+// Capture files are saved from a device log using:
+//
+//   python3 tools/vs10xx_capture.py device.log --save capture.bin
+//
+// Usage: vs10xx_replay [-v] [--watchdog-timeout MS] capture.bin
+// The exit code is 0 when the replay matches the capture.
+int main(int argc, char **argv) {
+  using namespace esphome;
+  int log_level = HOST_LOG_NONE;
+  uint32_t watchdog_timeout = 0;
+  const char *path = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "-v") == 0) {
+      log_level = HOST_LOG_DEBUG;
+    } else if (strcmp(argv[i], "--watchdog-timeout") == 0 && i + 1 < argc) {
+      watchdog_timeout = strtoul(argv[++i], nullptr, 10);
+    } else {
+      path = argv[i];
+    }
+  }
+  if (path == nullptr) {
+    fprintf(stderr, "Usage: %s [-v] [--watchdog-timeout MS] capture.bin\n", argv[0]);
+    return 2;
+  }
+
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    fprintf(stderr, "%s: cannot open the capture file\n", path);
+    return 2;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  std::vector<test::CaptureRecord> records;
+  if (!test::parse_capture(data.data(), data.size(), records)) {
+    fprintf(stderr, "%s: not a valid capture file\n", path);
+    return 2;
+  }
+
+  host::set_log_level(log_level);
+  test::CaptureReplayer replayer(records);
+  replayer.device.set_watchdog_timeout(watchdog_timeout);
+  auto result = replayer.run();
+  printf("Captured records : %u\n", (unsigned) result.captured);
+  printf("Replayed records : %u\n", (unsigned) result.replayed);
+  printf("Matching records : %u\n", (unsigned) result.matched);
+  printf("SDI data         : %s\n", result.sdi_match ? "identical" : "different");
+  printf("Sent on DREQ low : %u SDI chunks\n", (unsigned) result.sdi_dreq_low);
+  if (!result.identical()) {
+    printf("First difference : %s\n", result.difference.c_str());
+    return 1;
+  }
+  printf("The replay matches the capture\n");
+  return 0;
+}
@@ -0,0 +1,83 @@
+#include "FS.h"
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs {
+
+bool File::seek(uint32_t position) {
+  if (this->fs_ == nullptr || position > this->size_) {
+    return false;
+  }
+  this->position_ = position;
+  return true;
+}
+
+size_t File::read(uint8_t *buffer, size_t size) {
+  if (this->fs_ == nullptr) {
+    return 0;
+  }
+  size = std::min(size, this->size_ - this->position_);
+  if (size == 0) {
+    return 0;
+  }
+  auto read = this->fs_->read_image(this->offset_ + this->position_, buffer, size);
+  this->position_ += read;
+  return read;
+}
+
+FS::FS(const std::string &image_path, size_t block_size) : image_path_(image_path), block_size_(block_size) {
+  this->fd_ = ::open(image_path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+}
+
+FS::~FS() {
+  if (this->fd_ >= 0) {
+    ::close(this->fd_);
+    ::unlink(this->image_path_.c_str());
+  }
+}
+
+bool FS::add_file(const std::string &path, const uint8_t *data, size_t size) {
+  if (this->fd_ < 0 || ::pwrite(this->fd_, data, size, this->image_size_) != static_cast<ssize_t>(size)) {
+    return false;
+  }
+  this->files_.push_back({path, this->image_size_, size});
+  this->image_size_ += (size + this->block_size_ - 1) / this->block_size_ * this->block_size_;
+  return true;
+}
+
+size_t FS::offset_of(const std::string &path) const {
+  auto *entry = this->find_(path.c_str());
+  return entry != nullptr ? entry->offset : 0;
+}
+
+File FS::open(const char *path, const char *mode, bool create) {
+  File file;
+  auto *entry = this->find_(path);
+  if (entry != nullptr && mode[0] == 'r') {
+    file.fs_ = this;
+    file.offset_ = entry->offset;
+    file.size_ = entry->size;
+  }
+  return file;
+}
+
+size_t FS::read_image(size_t offset, uint8_t *buffer, size_t size) {
+  this->reads_.push_back({offset, size});
+  if (offset + size > this->fail_from_) {
+    return 0;
+  }
+  auto read = ::pread(this->fd_, buffer, size, offset);
+  return read > 0 ? read : 0;
+}
+
+const FS::Entry *FS::find_(const char *path) const {
+  for (auto &entry : this->files_) {
+    if (entry.path == path) {
+      return &entry;
+    }
+  }
+  return nullptr;
+}
+
+}  // namespace fs
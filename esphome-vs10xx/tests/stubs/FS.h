@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A filesystem on an image file, which stands in for the block device under
+// LittleFS on flash or FAT on an SD card. The Arduino API is covered as far
+// as the file source uses it.
+//
+// Files are stored in the image back to back, every file starting at a
+// block boundary, with the directory kept in memory. Every read of the
+// image is recorded, so tests can check how the file source reads, and
+// reads of the image can be made to fail from an offset on.
+namespace fs {
+
+class FS;
+
+class File {
+ public:
+  File() = default;
+
+  explicit operator bool() const { return this->fs_ != nullptr; }
+  size_t size() const { return this->size_; }
+  size_t position() const { return this->position_; }
+  bool seek(uint32_t position);
+  size_t read(uint8_t *buffer, size_t size);
+  void close() { this->fs_ = nullptr; }
+
+ protected:
+  friend class FS;
+  FS *fs_{nullptr};
+  size_t offset_{0};
+  size_t size_{0};
+  size_t position_{0};
+};
+
+/// A read of the image: the offset in the image and the size.
+struct ImageRead {
+  size_t offset;
+  size_t size;
+};
+
+class FS {
+ public:
+  /// Create an empty image file at a path.
+  explicit FS(const std::string &image_path, size_t block_size = 512);
+  ~FS();
+
+  /// Store a file in the image.
+  bool add_file(const std::string &path, const uint8_t *data, size_t size);
+  /// The offset of a file in the image.
+  size_t offset_of(const std::string &path) const;
+
+  File open(const char *path, const char *mode = "r", bool create = false);
+  bool exists(const char *path) const { return this->find_(path) != nullptr; }
+
+  /// The reads of the image, in order.
+  const std::vector<ImageRead> &get_reads() const { return this->reads_; }
+  void clear_reads() { this->reads_.clear(); }
+  /// Make the reads that reach an offset in the image fail.
+  void set_fail_from(size_t offset) { this->fail_from_ = offset; }
+
+  /// Read from the image, as the files do.
+  size_t read_image(size_t offset, uint8_t *buffer, size_t size);
+
+ protected:
+  struct Entry {
+    std::string path;
+    size_t offset;
+    size_t size;
+  };
+  const Entry *find_(const char *path) const;
+
+  std::string image_path_;
+  int fd_{-1};
+  size_t block_size_;
+  size_t image_size_{0};
+  std::vector<Entry> files_;
+  std::vector<ImageRead> reads_;
+  size_t fail_from_{SIZE_MAX};
+};
+
+}  // namespace fs
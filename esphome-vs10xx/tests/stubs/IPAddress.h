@@ -0,0 +1,17 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <cstdint>
+
+// An IPv4 address, in network byte order, like the Arduino one.
+class IPAddress {
+ public:
+  IPAddress() = default;
+  explicit IPAddress(uint32_t address) : address_(address) {}
+
+  bool fromString(const char *address) { return inet_pton(AF_INET, address, &this->address_) == 1; }
+  operator uint32_t() const { return this->address_; }
+
+ protected:
+  uint32_t address_{0};
+};
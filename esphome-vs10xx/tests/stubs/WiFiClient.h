@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// A WiFiClient on top of POSIX sockets, so the HTTP source can be tested
+// against a local server. Like the Arduino one, a client is a shared handle
+// to a socket, which is closed when the last copy lets go of it.
+class WiFiClient {
+ public:
+  WiFiClient() = default;
+  explicit WiFiClient(int fd);
+  virtual ~WiFiClient() = default;
+
+  virtual int connect(const char *host, uint16_t port, int32_t timeout);
+  size_t write(const uint8_t *data, size_t size);
+  int available();
+  int read();
+  int read(uint8_t *buffer, size_t size);
+  uint8_t connected();
+  void stop() { this->socket_.reset(); }
+
+ protected:
+  struct Socket {
+    explicit Socket(int fd) : fd(fd) {}
+    ~Socket();
+    int fd;
+  };
+  std::shared_ptr<Socket> socket_;
+};
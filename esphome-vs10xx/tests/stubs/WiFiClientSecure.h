@@ -0,0 +1,9 @@
+#pragma once
+
+#include "WiFiClient.h"
+
+// The host tests only use plain HTTP, so this connects without TLS.
+class WiFiClientSecure : public WiFiClient {
+ public:
+  void setInsecure() {}
+};
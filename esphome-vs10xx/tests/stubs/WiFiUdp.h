@@ -0,0 +1,42 @@
+#pragma once
+
+#include "IPAddress.h"
+#include <cstddef>
+#include <cstdint>
+
+// A WiFiUDP on top of POSIX sockets, so the UDP sources can be tested over
+// the loopback interface. Like the Arduino one, parsePacket() receives a
+// datagram without blocking, which read() then takes from.
+//
+// Multicast is sent over the loopback interface. A socket that joins a
+// group is bound to the group address, and other sockets are bound to the
+// loopback address. This way, devices in one test process can share a port,
+// and still only get the unicast or the multicast that is meant for them.
+class WiFiUDP {
+ public:
+  ~WiFiUDP() { this->stop(); }
+
+  uint8_t begin(uint16_t port);
+  uint8_t begin(IPAddress address, uint16_t port);
+  uint8_t beginMulticast(IPAddress address, uint16_t port);
+  void stop();
+  int parsePacket();
+  IPAddress remoteIP() const { return this->rx_address_; }
+  uint16_t remotePort() const { return this->rx_port_; }
+  int read(uint8_t *buffer, size_t size);
+  int beginPacket(IPAddress address, uint16_t port);
+  size_t write(const uint8_t *data, size_t size);
+  int endPacket();
+
+ protected:
+  int fd_{-1};
+  uint8_t rx_[1500];
+  size_t rx_size_{0};
+  size_t rx_offset_{0};
+  IPAddress rx_address_{};
+  uint16_t rx_port_{0};
+  uint8_t tx_[1500];
+  size_t tx_size_{0};
+  IPAddress tx_address_{};
+  uint16_t tx_port_{0};
+};
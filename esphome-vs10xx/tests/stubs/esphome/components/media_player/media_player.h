@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include "esphome/core/entity_base.h"
+
+// The media player API, as far as the vs10xx media player uses it. Like in
+// ESPHome, a call is made using make_call(), and perform() hands it to the
+// control() method of the media player.
+namespace esphome {
+namespace media_player {
+
+enum MediaPlayerState : uint8_t {
+  MEDIA_PLAYER_STATE_NONE = 0,
+  MEDIA_PLAYER_STATE_IDLE = 1,
+  MEDIA_PLAYER_STATE_PLAYING = 2,
+  MEDIA_PLAYER_STATE_PAUSED = 3,
+  MEDIA_PLAYER_STATE_ANNOUNCING = 4,
+};
+
+enum MediaPlayerCommand : uint8_t {
+  MEDIA_PLAYER_COMMAND_PLAY = 0,
+  MEDIA_PLAYER_COMMAND_PAUSE = 1,
+  MEDIA_PLAYER_COMMAND_STOP = 2,
+  MEDIA_PLAYER_COMMAND_MUTE = 3,
+  MEDIA_PLAYER_COMMAND_UNMUTE = 4,
+  MEDIA_PLAYER_COMMAND_TOGGLE = 5,
+  MEDIA_PLAYER_COMMAND_VOLUME_UP = 6,
+  MEDIA_PLAYER_COMMAND_VOLUME_DOWN = 7,
+};
+
+class MediaPlayerTraits {
+ public:
+  void set_supports_pause(bool supports_pause) { this->supports_pause_ = supports_pause; }
+  bool get_supports_pause() const { return this->supports_pause_; }
+
+ protected:
+  bool supports_pause_{false};
+};
+
+class MediaPlayer;
+
+class MediaPlayerCall {
+ public:
+  explicit MediaPlayerCall(MediaPlayer *parent) : parent_(parent) {}
+
+  MediaPlayerCall &set_command(MediaPlayerCommand command) {
+    this->command_ = command;
+    return *this;
+  }
+  MediaPlayerCall &set_media_url(const std::string &url) {
+    this->media_url_ = url;
+    return *this;
+  }
+  MediaPlayerCall &set_volume(float volume) {
+    this->volume_ = volume;
+    return *this;
+  }
+  MediaPlayerCall &set_announcement(bool announce) {
+    this->announcement_ = announce;
+    return *this;
+  }
+  void perform();
+
+  const std::optional<MediaPlayerCommand> &get_command() const { return this->command_; }
+  const std::optional<std::string> &get_media_url() const { return this->media_url_; }
+  const std::optional<float> &get_volume() const { return this->volume_; }
+  const std::optional<bool> &get_announcement() const { return this->announcement_; }
+
+ protected:
+  MediaPlayer *parent_;
+  std::optional<MediaPlayerCommand> command_;
+  std::optional<std::string> media_url_;
+  std::optional<float> volume_;
+  std::optional<bool> announcement_;
+};
+
+class MediaPlayer : public EntityBase {
+ public:
+  MediaPlayerCall make_call() { return MediaPlayerCall(this); }
+
+  void publish_state() { this->publish_count++; }
+  virtual MediaPlayerTraits get_traits() = 0;
+
+  MediaPlayerState state{MEDIA_PLAYER_STATE_NONE};
+  float volume{1.0f};
+  uint32_t publish_count{0};
+
+ protected:
+  friend MediaPlayerCall;
+  virtual void control(const MediaPlayerCall &call) = 0;
+};
+
+inline void MediaPlayerCall::perform() { this->parent_->control(*this); }
+
+}  // namespace media_player
+}  // namespace esphome
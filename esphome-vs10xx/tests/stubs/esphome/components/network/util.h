@@ -0,0 +1,10 @@
+#pragma once
+
+namespace esphome {
+namespace network {
+
+/// The loopback interface is always connected.
+bool is_connected();
+
+}  // namespace network
+}  // namespace esphome
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cmath>
+#include "esphome/core/entity_base.h"
+
+namespace esphome {
+namespace sensor {
+
+class Sensor : public EntityBase {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    this->publish_count++;
+  }
+  float state{NAN};
+  uint32_t publish_count{0};
+};
+
+}  // namespace sensor
+}  // namespace esphome
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "esphome/core/entity_base.h"
+
+namespace esphome {
+namespace text_sensor {
+
+class TextSensor : public EntityBase {
+ public:
+  void publish_state(const std::string &state) {
+    this->state = state;
+    this->publish_count++;
+  }
+  std::string state;
+  uint32_t publish_count{0};
+};
+
+}  // namespace text_sensor
+}  // namespace esphome
@@ -0,0 +1,26 @@
+#pragma once
+
+// The defines that the code generator would emit for a configuration that
+// uses the features that are covered by the host tests.
+#define USE_VS1003
+#define USE_VS1053
+#define USE_SENSOR
+#define USE_TEXT_SENSOR
+#define USE_VS10XX_CAPTURE
+#define USE_VS10XX_BENCHMARK
+#define USE_VS10XX_TONES
+#define USE_VS10XX_HTTP
+#define USE_VS10XX_UDP
+#define USE_VS10XX_SYNC
+#define USE_VS10XX_FILES
+#define USE_VS10XX_ANNOUNCE
+#define USE_BLOB_CLIPS
+// The benchmarks measure the default configuration, without the trace.
+#ifndef HOST_BENCHMARK
+#define USE_VS10XX_TRACE
+#endif
+
+#define VS10XX_MAX_DEVICES 2
+#define VS10XX_MAX_PLUGINS 2
+#define VS10XX_CAPTURE_SIZE 65536
+#define VS10XX_TRACE_SIZE 4096
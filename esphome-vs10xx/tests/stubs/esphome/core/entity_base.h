@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+
+class EntityBase {
+ public:
+  const std::string &get_name() const { return this->name_; }
+  void set_name(const char *name);
+
+  /// The hash of the object id, which is derived from the name like
+  /// ESPHome does: the snake cased and sanitized name, hashed using FNV-1.
+  uint32_t get_object_id_hash() const;
+
+ protected:
+  std::string name_;
+};
+
+}  // namespace esphome
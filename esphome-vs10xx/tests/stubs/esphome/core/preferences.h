@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+
+/// The preferences are kept in memory by the host, see host.h.
+class ESPPreferenceObject {
+ public:
+  ESPPreferenceObject() = default;
+  explicit ESPPreferenceObject(uint32_t hash) : hash_(hash), valid_(true) {}
+
+  template<typename T> bool save(const T *src) { return this->save_(reinterpret_cast<const uint8_t *>(src), sizeof(T)); }
+  template<typename T> bool load(T *dest) { return this->load_(reinterpret_cast<uint8_t *>(dest), sizeof(T)); }
+
+ protected:
+  bool save_(const uint8_t *data, size_t size);
+  bool load_(uint8_t *data, size_t size);
+
+  uint32_t hash_{0};
+  bool valid_{false};
+};
+
+class ESPPreferences {
+ public:
+  template<typename T> ESPPreferenceObject make_preference(uint32_t hash, bool in_flash = false) {
+    return ESPPreferenceObject(hash);
+  }
+  /// Commit the saved preferences to flash, see host::preference_syncs().
+  bool sync();
+};
+
+extern ESPPreferences *global_preferences;
+
+}  // namespace esphome
@@ -0,0 +1,270 @@
+#include "host.h"
+#include "esphome/core/component.h"
+#include "esphome/core/entity_base.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include "esphome/core/preferences.h"
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+namespace esphome {
+
+namespace setup_priority {
+const float BUS = 1000.0f;
+const float IO = 900.0f;
+const float HARDWARE = 800.0f;
+const float DATA = 600.0f;
+const float PROCESSOR = 400.0f;
+const float AFTER_WIFI = 200.0f;
+const float LATE = -100.0f;
+}  // namespace setup_priority
+
+namespace host {
+
+static uint64_t fake_now_us = 0;
+static bool real_clock = false;
+static uint32_t clock_offset_us = 0;
+static int log_level = HOST_LOG_NONE;
+static uint32_t saves = 0;
+static uint32_t syncs = 0;
+static bool staged = false;
+
+struct Scheduled {
+  Component *component;
+  std::string name;
+  uint32_t interval;
+  uint64_t due_us;
+  bool repeat;
+  std::function<void()> f;
+};
+static std::vector<Scheduled> scheduled;
+
+static uint64_t real_now_us() {
+  static auto start = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+uint64_t now_us() { return real_clock ? real_now_us() : fake_now_us; }
+
+void advance_us(uint64_t us) { fake_now_us += us; }
+
+void set_clock_offset_us(uint32_t offset) { clock_offset_us = offset; }
+
+void use_real_clock(bool real) { real_clock = real; }
+
+void run_scheduler() {
+  // Callbacks can schedule or cancel, so the list is walked by index.
+  for (size_t i = 0; i < scheduled.size(); i++) {
+    if (now_us() < scheduled[i].due_us) {
+      continue;
+    }
+    auto f = scheduled[i].f;
+    if (scheduled[i].repeat) {
+      scheduled[i].due_us += scheduled[i].interval * 1000ULL;
+    } else {
+      scheduled.erase(scheduled.begin() + i);
+      i--;
+    }
+    f();
+  }
+}
+
+void set_log_level(int level) { log_level = level; }
+
+// The preferences are stored in fixed slots, so saving them does not
+// allocate (see test_allocations.cpp).
+struct PreferenceSlot {
+  uint32_t hash;
+  size_t size;
+  uint8_t data[64];
+};
+static PreferenceSlot preference_slots[16];
+static size_t preference_count = 0;
+
+static PreferenceSlot *find_preference(uint32_t hash) {
+  for (size_t i = 0; i < preference_count; i++) {
+    if (preference_slots[i].hash == hash) {
+      return &preference_slots[i];
+    }
+  }
+  return nullptr;
+}
+
+bool has_preference(uint32_t hash) { return find_preference(hash) != nullptr; }
+
+uint32_t preference_saves() { return saves; }
+
+uint32_t preference_syncs() { return syncs; }
+
+void reset() {
+  fake_now_us = 0;
+  real_clock = false;
+  clock_offset_us = 0;
+  saves = 0;
+  syncs = 0;
+  staged = false;
+  scheduled.clear();
+  preference_count = 0;
+}
+
+static void schedule(Component *component, const std::string &name, uint32_t ms, bool repeat,
+                     std::function<void()> &&f) {
+  for (auto &s : scheduled) {
+    if (s.component == component && s.name == name) {
+      s = {component, name, ms, now_us() + ms * 1000ULL, repeat, std::move(f)};
+      return;
+    }
+  }
+  scheduled.push_back({component, name, ms, now_us() + ms * 1000ULL, repeat, std::move(f)});
+}
+
+static bool cancel(Component *component, const std::string &name) {
+  for (auto it = scheduled.begin(); it != scheduled.end(); ++it) {
+    if (it->component == component && it->name == name) {
+      scheduled.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+static void forget(Component *component) {
+  for (auto it = scheduled.begin(); it != scheduled.end();) {
+    it = it->component == component ? scheduled.erase(it) : it + 1;
+  }
+}
+
+static void count_save() {
+  saves++;
+  staged = true;
+}
+
+static bool commit_staged() {
+  if (staged) {
+    syncs++;
+    staged = false;
+  }
+  return true;
+}
+
+}  // namespace host
+
+uint32_t millis() { return (host::now_us() + host::clock_offset_us) / 1000; }
+uint32_t micros() { return host::now_us() + host::clock_offset_us; }
+
+void delay(uint32_t ms) { delayMicroseconds(ms * 1000); }
+
+void delayMicroseconds(uint32_t us) {
+  if (host::real_clock) {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  } else {
+    host::advance_us(us);
+  }
+}
+
+// A 240 MHz CPU, like the ESP32.
+uint32_t arch_get_cpu_cycle_count() { return host::now_us() * 240; }
+uint32_t arch_get_cpu_freq_hz() { return 240000000UL; }
+void yield() {}
+
+void host_log(int level, const char *tag, const char *format, ...) {
+  static const char LETTERS[] = " EWICDVV";
+  if (level > host::log_level) {
+    return;
+  }
+  printf("[%c][%s] ", LETTERS[level], tag);
+  va_list args;
+  va_start(args, format);
+  vprintf(format, args);
+  va_end(args);
+  printf("\n");
+}
+
+uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for (char c : str) {
+    hash *= 16777619UL;
+    hash ^= c;
+  }
+  return hash;
+}
+
+uint32_t random_uint32() { return (static_cast<uint32_t>(rand()) << 16) ^ rand(); }
+
+std::string str_lower_case(const std::string &str) {
+  std::string result = str;
+  std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+  return result;
+}
+
+std::string str_snake_case(const std::string &str) {
+  std::string result = str_lower_case(str);
+  std::replace(result.begin(), result.end(), ' ', '_');
+  return result;
+}
+
+std::string str_sanitize(const std::string &str) {
+  std::string result = str;
+  for (auto &c : result) {
+    if (!isalnum(c) && c != '-' && c != '_') {
+      c = '_';
+    }
+  }
+  return result;
+}
+
+Component::~Component() { host::forget(this); }
+
+void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+  host::schedule(this, name, interval, true, std::move(f));
+}
+
+bool Component::cancel_interval(const std::string &name) { return host::cancel(this, name); }
+
+void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+  host::schedule(this, name, timeout, false, std::move(f));
+}
+
+bool Component::cancel_timeout(const std::string &name) { return host::cancel(this, name); }
+
+void EntityBase::set_name(const char *name) { this->name_ = name; }
+
+uint32_t EntityBase::get_object_id_hash() const { return fnv1_hash(str_sanitize(str_snake_case(this->name_))); }
+
+bool ESPPreferenceObject::save_(const uint8_t *data, size_t size) {
+  if (!this->valid_ || size > sizeof(host::PreferenceSlot::data)) {
+    return false;
+  }
+  auto *slot = host::find_preference(this->hash_);
+  if (slot == nullptr) {
+    if (host::preference_count == std::size(host::preference_slots)) {
+      return false;
+    }
+    slot = &host::preference_slots[host::preference_count++];
+    slot->hash = this->hash_;
+  }
+  slot->size = size;
+  memcpy(slot->data, data, size);
+  host::count_save();
+  return true;
+}
+
+bool ESPPreferenceObject::load_(uint8_t *data, size_t size) {
+  auto *slot = this->valid_ ? host::find_preference(this->hash_) : nullptr;
+  if (slot == nullptr || slot->size != size) {
+    return false;
+  }
+  memcpy(data, slot->data, size);
+  return true;
+}
+
+bool ESPPreferences::sync() { return host::commit_staged(); }
+
+static ESPPreferences host_preferences;
+ESPPreferences *global_preferences = &host_preferences;
+
+}  // namespace esphome
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+
+// Controls for the host implementation of the ESPHome core stubs. The clock
+// is a fake clock, which only moves when the tests (or a fake device) move
+// it, so timing behavior is deterministic.
+
+namespace esphome {
+namespace host {
+
+/// The fake clock, in microseconds since the start of the test.
+uint64_t now_us();
+
+/// Move the fake clock forward.
+void advance_us(uint64_t us);
+inline void advance_ms(uint32_t ms) { advance_us(ms * 1000ULL); }
+
+/// Offset the clock that the code under test reads (millis() and
+/// micros()) from the fake clock. Tests with several devices set this per
+/// device, as if every device has a clock of its own.
+void set_clock_offset_us(uint32_t offset);
+
+/// Use the real (monotonic) clock instead of the fake clock, e.g. for
+/// benchmarks. delay() then really sleeps.
+void use_real_clock(bool real);
+
+/// Run the intervals and timeouts that are due at the current time.
+void run_scheduler();
+
+/// The messages up to this level are written to stdout (see log.h).
+void set_log_level(int level);
+
+/// Check if a preference is stored under a hash.
+bool has_preference(uint32_t hash);
+
+/// The number of preference saves since the last reset(). Like on the
+/// device, a save only stages the data.
+uint32_t preference_saves();
+
+/// The number of syncs since the last reset() that committed staged
+/// preferences, i.e. the flash writes.
+uint32_t preference_syncs();
+
+/// Reset the clock, the scheduler and the preferences, before a test.
+void reset();
+
+}  // namespace host
+}  // namespace esphome
@@ -0,0 +1,183 @@
+#include "WiFiClient.h"
+#include "WiFiUdp.h"
+#include "esphome/components/network/util.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+WiFiClient::WiFiClient(int fd) : socket_(std::make_shared<Socket>(fd)) {}
+
+WiFiClient::Socket::~Socket() { ::close(this->fd); }
+
+int WiFiClient::connect(const char *host, uint16_t port, int32_t timeout) {
+  addrinfo hints{};
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  addrinfo *result = nullptr;
+  if (getaddrinfo(host, nullptr, &hints, &result) != 0 || result == nullptr) {
+    return 0;
+  }
+  auto address = *reinterpret_cast<sockaddr_in *>(result->ai_addr);
+  freeaddrinfo(result);
+  address.sin_port = htons(port);
+  int fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (fd < 0) {
+    return 0;
+  }
+  this->socket_ = std::make_shared<Socket>(fd);
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0) {
+    this->socket_.reset();
+    return 0;
+  }
+  return 1;
+}
+
+size_t WiFiClient::write(const uint8_t *data, size_t size) {
+  if (!this->socket_) {
+    return 0;
+  }
+  auto sent = send(this->socket_->fd, data, size, MSG_NOSIGNAL);
+  return sent < 0 ? 0 : sent;
+}
+
+int WiFiClient::available() {
+  int size = 0;
+  if (!this->socket_ || ioctl(this->socket_->fd, FIONREAD, &size) < 0) {
+    return 0;
+  }
+  return size;
+}
+
+int WiFiClient::read() {
+  uint8_t value;
+  return this->read(&value, 1) == 1 ? value : -1;
+}
+
+int WiFiClient::read(uint8_t *buffer, size_t size) {
+  if (!this->socket_) {
+    return -1;
+  }
+  auto got = recv(this->socket_->fd, buffer, size, MSG_DONTWAIT);
+  return got < 0 ? -1 : got;
+}
+
+uint8_t WiFiClient::connected() {
+  if (!this->socket_) {
+    return 0;
+  }
+  // Like the Arduino client: connected while data are pending, or while
+  // the peer did not close the connection.
+  uint8_t value;
+  auto got = recv(this->socket_->fd, &value, 1, MSG_DONTWAIT | MSG_PEEK);
+  return got > 0 || (got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) { return this->begin(IPAddress(htonl(INADDR_LOOPBACK)), port); }
+
+uint8_t WiFiUDP::begin(IPAddress address, uint16_t port) {
+  this->stop();
+  this->fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+  if (this->fd_ < 0) {
+    return 0;
+  }
+  int reuse = 1;
+  setsockopt(this->fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+  in_addr interface{};
+  interface.s_addr = htonl(INADDR_LOOPBACK);
+  setsockopt(this->fd_, IPPROTO_IP, IP_MULTICAST_IF, &interface, sizeof(interface));
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(port);
+  local.sin_addr.s_addr = address;
+  if (bind(this->fd_, reinterpret_cast<sockaddr *>(&local), sizeof(local)) < 0) {
+    this->stop();
+    return 0;
+  }
+  fcntl(this->fd_, F_SETFL, O_NONBLOCK);
+  return 1;
+}
+
+uint8_t WiFiUDP::beginMulticast(IPAddress address, uint16_t port) {
+  if (!this->begin(address, port)) {
+    return 0;
+  }
+  ip_mreq request{};
+  request.imr_multiaddr.s_addr = address;
+  request.imr_interface.s_addr = htonl(INADDR_LOOPBACK);
+  if (setsockopt(this->fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &request, sizeof(request)) < 0) {
+    this->stop();
+    return 0;
+  }
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  if (this->fd_ >= 0) {
+    ::close(this->fd_);
+    this->fd_ = -1;
+  }
+}
+
+int WiFiUDP::parsePacket() {
+  this->rx_size_ = 0;
+  this->rx_offset_ = 0;
+  if (this->fd_ < 0) {
+    return 0;
+  }
+  sockaddr_in remote{};
+  socklen_t length = sizeof(remote);
+  auto got = recvfrom(this->fd_, this->rx_, sizeof(this->rx_), 0, reinterpret_cast<sockaddr *>(&remote), &length);
+  if (got <= 0) {
+    return 0;
+  }
+  this->rx_size_ = got;
+  this->rx_address_ = IPAddress(remote.sin_addr.s_addr);
+  this->rx_port_ = ntohs(remote.sin_port);
+  return got;
+}
+
+int WiFiUDP::read(uint8_t *buffer, size_t size) {
+  size = std::min(size, this->rx_size_ - this->rx_offset_);
+  memcpy(buffer, this->rx_ + this->rx_offset_, size);
+  this->rx_offset_ += size;
+  return size;
+}
+
+int WiFiUDP::beginPacket(IPAddress address, uint16_t port) {
+  this->tx_address_ = address;
+  this->tx_port_ = port;
+  this->tx_size_ = 0;
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t *data, size_t size) {
+  size = std::min(size, sizeof(this->tx_) - this->tx_size_);
+  memcpy(this->tx_ + this->tx_size_, data, size);
+  this->tx_size_ += size;
+  return size;
+}
+
+int WiFiUDP::endPacket() {
+  if (this->fd_ < 0) {
+    return 0;
+  }
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(this->tx_port_);
+  address.sin_addr.s_addr = this->tx_address_;
+  return sendto(this->fd_, this->tx_, this->tx_size_, 0, reinterpret_cast<sockaddr *>(&address), sizeof(address)) >= 0;
+}
+
+namespace esphome {
+namespace network {
+
+bool is_connected() { return true; }
+
+}  // namespace network
+}  // namespace esphome
@@ -0,0 +1,112 @@
+"""Tests for tools/blob_pack.py: the bundle layout and the index lookup,
+which must match blob_bundle.h and BlobBundle::reload() on the device."""
+
+import os
+import struct
+import subprocess
+import sys
+import zlib
+
+import pytest
+
+TOOLS = os.path.join(os.path.dirname(__file__), "..", "..", "tools")
+sys.path.insert(0, TOOLS)
+
+import blob_pack  # noqa: E402
+
+BLOBS = [
+    ("arcade", "mp3", b"\xff\xfb\x90\x44" + bytes(range(200))),
+    ("bike_horn", "wav", b"RIFF" + b"\x01" * 33),
+    ("empty", "raw", b""),
+]
+
+
+def test_layout_matches_device_structs():
+    # sizeof(BundleHeader) and sizeof(BundleEntry) in blob_bundle.h.
+    assert blob_pack.HEADER.size == 16
+    assert blob_pack.ENTRY.size == 32 + 4 + 4 + 4 + 8
+    bundle = blob_pack.pack(BLOBS)
+    magic, version, count, size, _ = struct.unpack_from("<IHHII", bundle)
+    assert magic == 0x4E424C42  # BUNDLE_MAGIC
+    assert version == 1
+    assert count == len(BLOBS)
+    assert size == len(bundle)
+
+
+def test_index_round_trip():
+    bundle = blob_pack.pack(BLOBS)
+    entries = blob_pack.read_index(bundle)
+    assert [e["name"] for e in entries] == [name for name, _, _ in BLOBS]
+    for entry, (name, type_, data) in zip(entries, BLOBS):
+        assert entry["type"] == type_
+        assert entry["size"] == len(data)
+        assert entry["crc"] == zlib.crc32(data)
+        assert entry["offset"] % blob_pack.ALIGNMENT == 0
+        assert entry["valid"]
+        assert bundle[entry["offset"]:entry["offset"] + entry["size"]] == data
+
+
+def test_find():
+    bundle = blob_pack.pack(BLOBS)
+    for name, _, data in BLOBS:
+        assert blob_pack.find(bundle, name) == data
+    assert blob_pack.find(bundle, "missing") is None
+    # A name is matched in full, not by prefix.
+    assert blob_pack.find(bundle, "bike") is None
+
+
+def test_find_rejects_corrupt_blob():
+    bundle = bytearray(blob_pack.pack(BLOBS))
+    entry = blob_pack.read_index(bytes(bundle))[0]
+    bundle[entry["offset"]] ^= 0xFF
+    entries = blob_pack.read_index(bytes(bundle))
+    assert not entries[0]["valid"]
+    assert entries[1]["valid"]
+    assert blob_pack.find(bytes(bundle), "arcade") is None
+    assert blob_pack.find(bytes(bundle), "bike_horn") == BLOBS[1][2]
+
+
+def test_find_ignores_data_after_bundle():
+    # The bundle is read from a partition, which is larger than the bundle.
+    bundle = blob_pack.pack(BLOBS) + b"\xff" * 4096
+    assert blob_pack.find(bundle, "bike_horn") == BLOBS[1][2]
+
+
+@pytest.mark.parametrize(
+    "corrupt, message",
+    [
+        (lambda b: b[:8], "too small"),
+        (lambda b: b"XXXX" + b[4:], "Not a blob bundle"),
+        (lambda b: b[:4] + b"\x02\x00" + b[6:], "Not a blob bundle"),
+        (lambda b: b[:40], "truncated"),
+        (lambda b: b[:20] + bytes([b[20] ^ 1]) + b[21:], "Index checksum"),
+    ],
+)
+def test_read_index_rejects_invalid_bundles(corrupt, message):
+    with pytest.raises(ValueError, match=message):
+        blob_pack.read_index(corrupt(blob_pack.pack(BLOBS)))
+
+
+def test_name_too_long():
+    with pytest.raises(ValueError, match="Name too long"):
+        blob_pack.pack([("x" * 32, "mp3", b"data")])
+
+
+def test_command_line(tmp_path):
+    files = []
+    for name, type_, data in BLOBS:
+        path = tmp_path / f"{name}.{type_}"
+        path.write_bytes(data)
+        files.append(f"{name}={path}")
+    bundle = tmp_path / "audio.bin"
+    tool = [sys.executable, os.path.join(TOOLS, "blob_pack.py")]
+    subprocess.run(tool + ["pack", "-o", str(bundle)] + files, check=True, capture_output=True)
+    assert blob_pack.find(bundle.read_bytes(), "bike_horn") == BLOBS[1][2]
+
+    listed = subprocess.run(tool + ["list", str(bundle)], check=True, capture_output=True, text=True)
+    assert listed.stdout.count(" ok") == len(BLOBS)
+    found = subprocess.run(tool + ["find", str(bundle), "arcade"], capture_output=True, text=True)
+    assert found.returncode == 0
+    assert found.stdout.strip() == f"arcade: {len(BLOBS[0][2])} bytes"
+    missing = subprocess.run(tool + ["find", str(bundle), "missing"], capture_output=True, text=True)
+    assert missing.returncode == 1
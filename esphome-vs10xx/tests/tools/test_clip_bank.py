@@ -0,0 +1,188 @@
+"""Tests for blob/clip_bank.py: the normalization of the clips, and the clip
+bank layout, which must match blob_clip_bank.h and ClipBank::find() on the
+device."""
+
+import array
+import math
+import os
+import struct
+import sys
+import wave
+
+import pytest
+
+BLOB = os.path.join(os.path.dirname(__file__), "..", "..", "components", "blob")
+sys.path.insert(0, BLOB)
+
+import clip_bank  # noqa: E402
+
+RATE = 16000
+
+
+def tone(seconds, amplitude=0.5, frequency=440, rate=RATE):
+    count = int(seconds * rate)
+    return [amplitude * math.sin(2 * math.pi * frequency * i / rate) for i in range(count)]
+
+
+def rms(samples):
+    return math.sqrt(sum(s * s for s in samples) / len(samples))
+
+
+def write_wav(path, samples, rate=RATE, channels=1, width=2):
+    if width == 1:
+        frames = bytes(max(0, min(255, round(s * 128) + 128)) for s in samples)
+    else:
+        pcm = array.array("h", (max(-32768, min(32767, round(s * 32767))) for s in samples))
+        if sys.byteorder == "big":
+            pcm.byteswap()
+        frames = pcm.tobytes()
+    with wave.open(str(path), "wb") as fh:
+        fh.setnchannels(channels)
+        fh.setsampwidth(width)
+        fh.setframerate(rate)
+        fh.writeframes(frames)
+
+
+def find(bank, name):
+    """Look up a clip like ClipBank::find() does."""
+    magic, version, count, rate, channels, bits = clip_bank.CLIP_BANK_HEADER.unpack_from(bank)
+    for i in range(count):
+        offset = clip_bank.CLIP_BANK_HEADER.size + i * clip_bank.CLIP_BANK_ENTRY.size
+        entry_name, data_offset, size = clip_bank.CLIP_BANK_ENTRY.unpack_from(bank, offset)
+        if entry_name.rstrip(b"\0") == name.encode():
+            return bank[data_offset : data_offset + size]
+    return None
+
+
+def test_layout_matches_device_structs():
+    # sizeof(ClipBankHeader) and sizeof(ClipBankEntry) in blob_clip_bank.h.
+    assert clip_bank.CLIP_BANK_HEADER.size == 16
+    assert clip_bank.CLIP_BANK_ENTRY.size == clip_bank.CLIP_NAME_SIZE + 4 + 4
+    bank = clip_bank.pack_clip_bank([("one", b"\x01\x00" * 3)], 22050)
+    magic, version, count, rate, channels, bits = struct.unpack_from("<IHHIHH", bank)
+    assert magic == 0x42504C43  # CLIP_BANK_MAGIC
+    assert version == 1
+    assert (count, rate, channels, bits) == (1, 22050, 1, 16)
+
+
+def test_pack_round_trip():
+    clips = [("it_is", b"\x01\x02" * 5), ("seven", b"\x03\x04" * 7), ("oclock", b"\x05\x06")]
+    bank = clip_bank.pack_clip_bank(clips, RATE)
+    for name, data in clips:
+        assert find(bank, name) == data
+    assert find(bank, "eight") is None
+    # A name is matched in full, not by prefix.
+    assert find(bank, "it") is None
+    for i in range(len(clips)):
+        offset = clip_bank.CLIP_BANK_HEADER.size + i * clip_bank.CLIP_BANK_ENTRY.size
+        _, data_offset, _ = clip_bank.CLIP_BANK_ENTRY.unpack_from(bank, offset)
+        assert data_offset % clip_bank.CLIP_ALIGNMENT == 0
+
+
+def test_name_uses_all_bytes():
+    # A name of CLIP_NAME_SIZE characters is not zero terminated, which
+    # ClipBank::find() handles with strncmp().
+    name = "x" * clip_bank.CLIP_NAME_SIZE
+    bank = clip_bank.pack_clip_bank([(name, b"\x01\x00")], RATE)
+    assert find(bank, name) == b"\x01\x00"
+
+
+def test_clip_name():
+    assert clip_bank.clip_name("sounds/words/it_is.wav") == "it_is"
+
+
+def test_normalize_loudness_and_peak():
+    quiet = clip_bank.normalize(tone(0.5, amplitude=0.05), RATE, 0)
+    loud = clip_bank.normalize(tone(0.5, amplitude=0.9), RATE, 0)
+    # The middle of the clips, away from the fades.
+    middle = slice(RATE // 10, -RATE // 10)
+    assert rms(quiet[middle]) == pytest.approx(clip_bank.TARGET_RMS, rel=0.02)
+    assert rms(loud[middle]) == pytest.approx(clip_bank.TARGET_RMS, rel=0.02)
+
+    # A clip with a high crest factor is limited by its peak instead.
+    hum = [0.05 * (-1) ** i for i in range(1000)]
+    spike = hum + [0.9] + hum
+    limited = clip_bank.normalize(spike, RATE, 0)
+    assert max(abs(s) for s in limited) == pytest.approx(clip_bank.PEAK_LIMIT, rel=1e-6)
+
+
+def test_normalize_removes_dc_and_trims_silence():
+    samples = [0.0] * 800 + tone(0.25) + [0.0] * 1600
+    samples = [s + 0.1 for s in samples]
+    result = clip_bank.normalize(samples, RATE, 0)
+    assert sum(result) / len(result) == pytest.approx(0.0, abs=0.01)
+    # Most of the silence is trimmed, both at the start and at the end.
+    assert len(result) < len(tone(0.25)) + 100
+
+
+def test_normalize_fades_and_adds_gap():
+    gap_ms = 50
+    result = clip_bank.normalize(tone(0.25, amplitude=0.5, frequency=50), RATE, gap_ms)
+    gap = RATE * gap_ms // 1000
+    assert result[-gap:] == [0.0] * gap
+    fade = RATE * clip_bank.FADE_MS // 1000
+    # The edges start and end at zero, and rise over the fade.
+    assert result[0] == 0.0
+    assert result[-gap - 1] == 0.0
+    assert abs(result[fade // 4]) < abs(result[fade])
+
+
+def test_normalize_rejects_silence():
+    with pytest.raises(ValueError, match="silent"):
+        clip_bank.normalize([0.001] * 1000, RATE, 0)
+
+
+def test_resample():
+    ramp = [i / 1000 for i in range(1000)]
+    result = clip_bank.resample(ramp, 8000, 16000)
+    assert len(result) == 2000
+    # Linear interpolation keeps a ramp a ramp.
+    assert result[101] == pytest.approx(0.0505)
+    assert clip_bank.resample(ramp, RATE, RATE) is ramp
+    assert len(clip_bank.resample(ramp, 16000, 8000)) == 500
+
+
+@pytest.mark.parametrize("channels, width, rate", [(1, 2, RATE), (2, 2, RATE), (1, 1, RATE), (1, 2, 44100)])
+def test_load_clip(tmp_path, channels, width, rate):
+    samples = tone(0.2, amplitude=0.4, rate=rate)
+    interleaved = [s for s in samples for _ in range(channels)]
+    path = tmp_path / "seven.wav"
+    write_wav(path, interleaved, rate=rate, channels=channels, width=width)
+    data = clip_bank.load_clip(str(path), RATE, 20)
+    pcm = array.array("h", data)
+    if sys.byteorder == "big":
+        pcm.byteswap()
+    # 16 bit mono at the target rate, normalized, with the gap at the end.
+    expected = round(0.2 * RATE) + RATE * 20 // 1000
+    assert abs(len(pcm) - expected) < RATE // 100
+    middle = [s / 32767 for s in pcm[len(pcm) // 4 : len(pcm) // 2]]
+    assert rms(middle) == pytest.approx(clip_bank.TARGET_RMS, rel=0.05)
+
+
+def test_build_clip_bank(tmp_path):
+    paths = []
+    for name in ["it_is", "seven", "oclock"]:
+        path = tmp_path / f"{name}.wav"
+        write_wav(path, tone(0.1))
+        paths.append(str(path))
+    bank = clip_bank.build_clip_bank(paths, RATE, 10)
+    for path in paths:
+        assert find(bank, clip_bank.clip_name(path)) == clip_bank.load_clip(path, RATE, 10)
+
+
+def test_build_clip_bank_names_the_bad_file(tmp_path):
+    good = tmp_path / "one.wav"
+    write_wav(good, tone(0.1))
+    wide = tmp_path / "two.wav"
+    with wave.open(str(wide), "wb") as fh:
+        fh.setnchannels(1)
+        fh.setsampwidth(3)
+        fh.setframerate(RATE)
+        fh.writeframes(b"\x00\x10\x20" * 100)
+    with pytest.raises(ValueError, match="two.wav: only 8 and 16 bit"):
+        clip_bank.build_clip_bank([str(good), str(wide)], RATE, 0)
+
+    silent = tmp_path / "three.wav"
+    write_wav(silent, [0.0] * 1000)
+    with pytest.raises(ValueError, match="three.wav: clip is silent"):
+        clip_bank.build_clip_bank([str(silent)], RATE, 0)
@@ -0,0 +1,75 @@
+"""Round trip of the event trace: the trace_dump host test records a trace
+and dumps it to the log, and tools/vs10xx_trace.py decodes that log."""
+
+import io
+import os
+import subprocess
+import sys
+
+import pytest
+
+TESTS = os.path.join(os.path.dirname(__file__), "..")
+sys.path.insert(0, os.path.join(TESTS, "..", "tools"))
+
+import vs10xx_trace  # noqa: E402
+
+HOST_TESTS = os.path.join(TESTS, "build", "host_tests")
+
+
+@pytest.fixture(scope="module")
+def log():
+    if not os.path.exists(HOST_TESTS):
+        pytest.skip("the host tests are not built, run make -C esphome-vs10xx/tests")
+    # With -v, the log output of the test is written to stdout.
+    result = subprocess.run([HOST_TESTS, "-v", "trace_dump"], capture_output=True, text=True, check=True)
+    return result.stdout.splitlines()
+
+
+def timeline(log):
+    traces = list(vs10xx_trace.parse(log))
+    assert len(traces) == 1
+    freq, records = traces[0]
+    out = io.StringIO()
+    vs10xx_trace.render(freq, records, out)
+    # Every line is "<time> us  <event> <details>".
+    fields = [line.split() for line in out.getvalue().splitlines()]
+    return [(float(f[0]), f[2], " ".join(f[3:])) for f in fields]
+
+
+def test_dump_decodes_to_records(log):
+    freq, records = next(vs10xx_trace.parse(log))
+    # The fake CPU clock of the host stubs.
+    assert freq == 240000000
+    assert len(records) > 100
+    for _, event, _, _ in records:
+        assert event in vs10xx_trace.EVENTS
+
+
+def test_timeline_follows_playback(log):
+    events = timeline(log)
+    states = [details for _, event, details in events if event in ("DEVICE_STATE", "MEDIA_STATE")]
+    # The initialization (which starts in RESET, so that is not a change),
+    # and a stream that is played to its end.
+    assert states[:2] == ["VERIFY_CHIPSET", "SOFT_RESET"]
+    ready = states.index("READY")
+    playing = states.index("PLAYING")
+    assert ready < playing
+    assert states.index("STOPPED", playing) > playing
+
+    chunks = [details for _, event, details in events if event == "CHUNK_SENT"]
+    assert sum(int(details.split()[0]) for details in chunks) >= 8000
+    assert any(event == "SCI_WRITE" and details.startswith("SCI_CLOCKF") for _, event, details in events)
+
+    # The 8000 bytes play at the 16 kB/s of the emulated decoder. Playback
+    # ends when the last data are sent, with the 2048 byte FIFO still full.
+    start = next(time for time, event, details in events if details == "PLAYING")
+    end = next(time for time, event, details in events if details == "STOPPED" and time > start)
+    assert end - start == pytest.approx((8000 - 2048) / 16000 * 1e6, rel=0.05)
+
+
+def test_timeline_timestamps(log):
+    events = timeline(log)
+    first, second = events[-2:]
+    assert first[1:] == ("SCI_WRITE", "SCI_AICTRL3 = 0xbeef")
+    assert second[1:] == ("SCI_WRITE", "SCI_AICTRL3 = 0xcafe")
+    assert second[0] - first[0] == pytest.approx(10000, abs=1)
@@ -0,0 +1,144 @@
+#!/usr/bin/env python3
+"""Pack audio files into a blob bundle, or inspect an existing bundle.
+
+Blobs that are configured with a "partition" are not stored in the firmware,
+but in a bundle that lives in a separate data partition. The code generator
+writes the bundle to the build directory (blob_<partition>.bin). This script
+can be used to build a bundle without compiling the firmware, e.g. to change
+an alarm sound, and to inspect a bundle:
+
+    python3 tools/blob_pack.py pack -o audio.bin bike_horn=audio/bike_horn.wav arcade=audio/arcade.mp3
+    python3 tools/blob_pack.py list audio.bin
+    python3 tools/blob_pack.py find audio.bin bike_horn
+
+The names must match the blob IDs in the configuration. The bundle is
+written to its partition on its own, without touching the firmware:
+
+    parttool.py --port /dev/ttyUSB0 write_partition --partition-name audio --input audio.bin
+
+Or over the air, by serving the bundle over HTTP and triggering the
+blob.update_bundle action on the device:
+
+    python3 -m http.server 8000
+    # on the device: blob.update_bundle: {partition: audio, url: "http://<host>:8000/audio.bin"}
+
+The device needs a partition table with a data partition for the bundle,
+e.g. this line in a custom partitions CSV:
+
+    audio, data, 0x40, , 1M
+"""
+
+import argparse
+import os
+import struct
+import sys
+import zlib
+
+# Keep these in sync with blob_bundle.h and blob/__init__.py.
+MAGIC = b"BLBN"
+VERSION = 1
+HEADER = struct.Struct("<4sHHII")
+ENTRY = struct.Struct("<32sIII8s")
+NAME_SIZE = 32
+TYPE_SIZE = 8
+ALIGNMENT = 4
+
+
+def pack(blobs):
+    """Pack a list of (name, type, data) tuples into a blob bundle."""
+    index_size = HEADER.size + ENTRY.size * len(blobs)
+    index = b""
+    data = b""
+    for name, type_, content in blobs:
+        if len(name.encode()) >= NAME_SIZE:
+            raise ValueError(f"Name too long (max {NAME_SIZE - 1} characters): {name}")
+        data += b"\0" * (-(index_size + len(data)) % ALIGNMENT)
+        index += ENTRY.pack(
+            name.encode(), index_size + len(data), len(content), zlib.crc32(content),
+            type_.encode()[:TYPE_SIZE],
+        )
+        data += content
+    header = HEADER.pack(MAGIC, VERSION, len(blobs), index_size + len(data), zlib.crc32(index))
+    return header + index + data
+
+
+def read_index(bundle):
+    """Validate a bundle and return its index as a list of dicts."""
+    if len(bundle) < HEADER.size:
+        raise ValueError("Bundle too small")
+    magic, version, count, size, index_crc = HEADER.unpack_from(bundle)
+    if magic != MAGIC or version != VERSION:
+        raise ValueError("Not a blob bundle (or an unsupported version)")
+    index_end = HEADER.size + ENTRY.size * count
+    if size > len(bundle) or index_end > size:
+        raise ValueError("Bundle truncated")
+    if zlib.crc32(bundle[HEADER.size:index_end]) != index_crc:
+        raise ValueError("Index checksum mismatch")
+    entries = []
+    for i in range(count):
+        name, offset, length, crc, type_ = ENTRY.unpack_from(bundle, HEADER.size + i * ENTRY.size)
+        entries.append({
+            "name": name.rstrip(b"\0").decode(),
+            "type": type_.rstrip(b"\0").decode(),
+            "offset": offset,
+            "size": length,
+            "crc": crc,
+            "valid": offset + length <= size and zlib.crc32(bundle[offset:offset + length]) == crc,
+        })
+    return entries
+
+
+def find(bundle, name):
+    """Look up a blob by name, the way the device does it.
+    Returns the blob data, or None when it is not found or invalid."""
+    for entry in read_index(bundle):
+        if entry["name"] == name:
+            return bundle[entry["offset"]:entry["offset"] + entry["size"]] if entry["valid"] else None
+    return None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+    pack_parser = commands.add_parser("pack", help="pack files into a bundle")
+    pack_parser.add_argument("-o", "--output", required=True, help="the bundle file to write")
+    pack_parser.add_argument("blobs", nargs="+", metavar="NAME=FILE", help="the blobs to pack")
+    list_parser = commands.add_parser("list", help="list and verify the blobs in a bundle")
+    list_parser.add_argument("bundle")
+    find_parser = commands.add_parser("find", help="look up a blob in a bundle")
+    find_parser.add_argument("bundle")
+    find_parser.add_argument("name")
+    args = parser.parse_args()
+
+    if args.command == "pack":
+        blobs = []
+        for spec in args.blobs:
+            name, _, path = spec.partition("=")
+            if not path:
+                parser.error(f"Expected NAME=FILE, got: {spec}")
+            with open(path, "rb") as fh:
+                blobs.append((name, os.path.splitext(path)[1].lstrip(".").lower(), fh.read()))
+        bundle = pack(sorted(blobs))
+        with open(args.output, "wb") as fh:
+            fh.write(bundle)
+        print(f"Wrote {len(blobs)} blobs, {len(bundle)} bytes to {args.output}")
+        return 0
+
+    with open(args.bundle, "rb") as fh:
+        bundle = fh.read()
+    if args.command == "list":
+        entries = read_index(bundle)
+        for entry in entries:
+            status = "ok" if entry["valid"] else "CORRUPT"
+            print(f"{entry['name']:<32} {entry['type']:<8} {entry['offset']:>10} {entry['size']:>10}  {status}")
+        return 0 if all(entry["valid"] for entry in entries) else 1
+    data = find(bundle, args.name)
+    if data is None:
+        print(f"Blob not found or corrupt: {args.name}", file=sys.stderr)
+        return 1
+    print(f"{args.name}: {len(data)} bytes")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""Collect vs10xx benchmark results from ESPHome log output.
+
+Enable the benchmarks using the vs10xx "benchmark" option, trigger the
+"vs10xx.benchmark" action while no audio is playing, and feed the log
+output to this script:
+
+    esphome logs example.yaml | tee bench.log
+    python3 tools/vs10xx_bench.py bench.log                       # print results
+    python3 tools/vs10xx_bench.py bench.log --save baseline.json  # store a baseline
+    python3 tools/vs10xx_bench.py bench.log --compare baseline.json
+
+When comparing, the exit code is 1 when any benchmark got slower than
+the allowed tolerance (10% by default).
+
+The same benchmarks run on the host, against the committed baseline in
+tests/bench/baseline.json (see tests/bench/main.cpp):
+
+    make -C tests bench
+"""
+
+import argparse
+import json
+import re
+import sys
+
+RESULT = re.compile(r"bench: (\{.*\})")
+
+
+def ns_per_op(result):
+    """The time per operation, unrounded: ns_per_op in the log is rounded
+    down to whole nanoseconds, which is too coarse for fast operations."""
+    if not result["iterations"]:
+        return 0.0
+    return result["total_us"] * 1000.0 / result["iterations"]
+
+
+def parse(lines):
+    """Return {name: result} for the benchmark results in the log.
+    When the benchmarks were run multiple times, the fastest run wins,
+    which filters out the runs that were disturbed."""
+    results = {}
+    for line in lines:
+        match = RESULT.search(line)
+        if match:
+            result = json.loads(match.group(1))
+            old = results.get(result["name"])
+            if old is None or ns_per_op(result) < ns_per_op(old):
+                results[result["name"]] = result
+    return results
+
+
+def compare(results, baseline, tolerance):
+    regressions = 0
+    for name, result in sorted(results.items()):
+        if name not in baseline:
+            print(f"{name:<40} {ns_per_op(result):>10.1f} ns/op  (new)")
+            continue
+        old = ns_per_op(baseline[name])
+        new = ns_per_op(result)
+        change = (new - old) / old if old else 0.0
+        flag = ""
+        if change > tolerance:
+            flag = "  REGRESSION"
+            regressions += 1
+        elif change < -tolerance:
+            flag = "  improved"
+        print(f"{name:<40} {old:>10.1f} -> {new:>10.1f} ns/op  {change:+7.1%}{flag}")
+    for name in sorted(set(baseline) - set(results)):
+        print(f"{name:<40} missing from the results")
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("log", nargs="?", help="log file (default: stdin)")
+    parser.add_argument("--save", metavar="FILE", help="store the results as a baseline")
+    parser.add_argument("--compare", metavar="FILE", help="compare the results against a baseline")
+    parser.add_argument("--tolerance", type=float, default=0.10, help="allowed slowdown (default: 0.10)")
+    args = parser.parse_args()
+
+    source = open(args.log, encoding="utf-8", errors="replace") if args.log else sys.stdin
+    results = parse(source)
+    if not results:
+        sys.exit("No benchmark results found in the log")
+
+    if args.save:
+        with open(args.save, "w", encoding="utf-8") as out:
+            json.dump(results, out, indent=2, sort_keys=True)
+            out.write("\n")
+
+    if args.compare:
+        with open(args.compare, encoding="utf-8") as baseline:
+            sys.exit(1 if compare(results, json.load(baseline), args.tolerance) else 0)
+
+    json.dump(results, sys.stdout, indent=2, sort_keys=True)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,160 @@
+#!/usr/bin/env python3
+"""Decode a vs10xx SPI transaction capture from ESPHome log output.
+
+Enable the capture using the vs10xx "capture_size" option, and use the
+"vs10xx.capture_start", "vs10xx.capture_stop" and "vs10xx.capture_dump"
+actions to record and dump it. Then feed the log output to this script:
+
+    python3 tools/vs10xx_capture.py trace.log              # transaction log
+    python3 tools/vs10xx_capture.py trace.log --summary    # statistics only
+    python3 tools/vs10xx_capture.py trace.log --save capture.bin
+
+A saved capture file holds the raw capture log, which uses the record
+format that is documented in vs10xx_capture.h. Capture files can be passed
+to this script instead of log output.
+
+A saved capture file can be replayed on the host, for regression checks:
+the component plays the captured audio data against a model of the device
+that answers register reads like the captured device did, and the new
+transactions are compared to the captured ones:
+
+    make -C tests replay
+    tests/build/vs10xx_replay capture.bin
+"""
+
+import argparse
+import re
+import sys
+
+# Keep these in sync with the CaptureRecordType enum in vs10xx_capture.h.
+SCI_WRITE = 1
+SCI_READ = 2
+SDI = 3
+HARD_RESET = 4
+SPI_SPEED = 5
+DREQ_BIT = 0x80
+
+REGISTERS = [
+    "MODE", "STATUS", "BASS", "CLOCKF", "DECODE_TIME", "AUDATA", "WRAM",
+    "WRAMADDR", "HDAT0", "HDAT1", "AIADDR", "VOL", "AICTRL0", "AICTRL1",
+    "AICTRL2", "AICTRL3",
+]
+
+BEGIN = re.compile(r"capture-begin bytes=(\d+)")
+DATA = re.compile(r"capture: ([0-9a-f]+)")
+END = re.compile(r"capture-end")
+
+
+def from_log(lines):
+    """Return the raw bytes of the last capture dump in the log."""
+    capture = None
+    data = None
+    for line in lines:
+        if BEGIN.search(line):
+            data = bytearray()
+        elif data is not None and DATA.search(line):
+            data += bytes.fromhex(DATA.search(line).group(1))
+        elif data is not None and END.search(line):
+            capture, data = bytes(data), None
+    return capture
+
+
+def records(data):
+    """Yield (time in us, type, dreq, payload) for the records in a capture."""
+    pos = 0
+    time_us = 0
+    while pos < len(data):
+        header = data[pos]
+        pos += 1
+        delta = shift = 0
+        while True:
+            byte = data[pos]
+            pos += 1
+            delta |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        time_us += delta
+        kind = header & 0x0F
+        dreq = bool(header & DREQ_BIT)
+        if kind in (SCI_WRITE, SCI_READ):
+            payload = (data[pos], data[pos + 1] << 8 | data[pos + 2])
+            pos += 3
+        elif kind == SDI:
+            size = data[pos]
+            payload = data[pos + 1:pos + 1 + size]
+            pos += 1 + size
+        elif kind == SPI_SPEED:
+            payload = data[pos]
+            pos += 1
+        else:
+            payload = None
+        yield time_us, kind, dreq, payload
+
+
+def register_name(reg):
+    return "SCI_" + (REGISTERS[reg] if reg < len(REGISTERS) else f"0x{reg:02x}")
+
+
+def print_log(data, out):
+    for time_us, kind, dreq, payload in records(data):
+        prefix = f"{time_us:12d} us  DREQ={'H' if dreq else 'L'}  "
+        if kind == SCI_WRITE:
+            out.write(f"{prefix}write {register_name(payload[0])} = 0x{payload[1]:04x}\n")
+        elif kind == SCI_READ:
+            out.write(f"{prefix}read  {register_name(payload[0])} = 0x{payload[1]:04x}\n")
+        elif kind == SDI:
+            out.write(f"{prefix}data  {len(payload)} bytes: {payload[:8].hex()}{'...' if len(payload) > 8 else ''}\n")
+        elif kind == HARD_RESET:
+            out.write(f"{prefix}hard reset\n")
+        elif kind == SPI_SPEED:
+            out.write(f"{prefix}SPI speed {'fast' if payload else 'slow'}\n")
+        else:
+            out.write(f"{prefix}unknown record type {kind}\n")
+
+
+def print_summary(data, out):
+    counts = {}
+    sdi_bytes = 0
+    sdi_dreq_low = 0
+    last_time = 0
+    for time_us, kind, dreq, payload in records(data):
+        counts[kind] = counts.get(kind, 0) + 1
+        last_time = time_us
+        if kind == SDI:
+            sdi_bytes += len(payload)
+            sdi_dreq_low += 0 if dreq else 1
+    seconds = last_time / 1e6
+    out.write(f"Duration         : {seconds:.3f} s\n")
+    out.write(f"SCI writes       : {counts.get(SCI_WRITE, 0)}\n")
+    out.write(f"SCI reads        : {counts.get(SCI_READ, 0)}\n")
+    out.write(f"SDI chunks       : {counts.get(SDI, 0)} ({sdi_dreq_low} sent while DREQ was low)\n")
+    out.write(f"SDI bytes        : {sdi_bytes}\n")
+    if seconds > 0:
+        out.write(f"SDI throughput   : {sdi_bytes / seconds:.0f} B/s\n")
+    out.write(f"Hard resets      : {counts.get(HARD_RESET, 0)}\n")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("input", help="ESPHome log output or a saved capture file")
+    parser.add_argument("--save", metavar="FILE", help="save the raw capture to a file")
+    parser.add_argument("--summary", action="store_true", help="only print statistics")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as fh:
+        raw = fh.read()
+    data = from_log(raw.decode("utf-8", errors="replace").splitlines())
+    if data is None:
+        data = raw
+    if args.save:
+        with open(args.save, "wb") as fh:
+            fh.write(data)
+    if args.summary:
+        print_summary(data, sys.stdout)
+    else:
+        print_log(data, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
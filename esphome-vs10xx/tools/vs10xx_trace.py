@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""Decode a vs10xx event trace from ESPHome log output into a timeline.
+
+Enable the trace using the vs10xx "trace_size" option, trigger the
+"vs10xx.dump_trace" action, and feed the log output to this script:
+
+    esphome logs example.yaml | tee trace.log
+    python3 tools/vs10xx_trace.py trace.log
+"""
+
+import re
+import struct
+import sys
+
+# Keep these in sync with the TraceEvent enum in vs10xx_trace.h.
+EVENTS = {
+    1: "DEVICE_STATE",
+    2: "MEDIA_STATE",
+    3: "CHUNK_SENT",
+    4: "DREQ_LOW",
+    5: "DREQ_HIGH",
+    6: "UNDERRUN",
+    7: "SCI_WRITE",
+    8: "SCI_WRITE_SKIP",
+    9: "SCI_READ",
+    10: "SCI_READ_SHADOW",
+    11: "PREFS_SYNC",
+    12: "PREFS_STORE",
+    13: "RECOVERY",
+}
+
+DEVICE_STATES = [
+    "RESET", "VERIFY_CHIPSET", "SOFT_RESET", "TO_FAST_SPI", "LOAD_PLUGINS",
+    "INIT_AUDIO", "REPORT_FAILED", "FAILED", "READY", "POWER_DOWN",
+]
+
+MEDIA_STATES = ["STOPPED", "STARTING", "PLAYING", "STOPPING", "RECOVERING"]
+
+RECOVERY_STAGES = ["NONE", "CANCEL", "SOFT_RESET", "HARD_RESET"]
+
+REGISTERS = [
+    "MODE", "STATUS", "BASS", "CLOCKF", "DECODE_TIME", "AUDATA", "WRAM",
+    "WRAMADDR", "HDAT0", "HDAT1", "AIADDR", "VOL", "AICTRL0", "AICTRL1",
+    "AICTRL2", "AICTRL3",
+]
+
+RECORD = struct.Struct("<IBBH")
+BEGIN = re.compile(r"trace-begin freq=(\d+) records=(\d+)")
+DATA = re.compile(r"trace: ([0-9a-f]+)")
+END = re.compile(r"trace-end")
+
+
+def _name(names, index):
+    return names[index] if index < len(names) else str(index)
+
+
+def describe(event, arg8, arg16):
+    if event == 1:
+        return _name(DEVICE_STATES, arg8)
+    if event == 2:
+        return _name(MEDIA_STATES, arg8)
+    if event == 3:
+        return f"{arg16} bytes"
+    if event in (7, 8, 9, 10):
+        return f"SCI_{_name(REGISTERS, arg8)} = 0x{arg16:04x}"
+    if event == 11:
+        return f"changes=0x{arg8:02x}"
+    if event == 12:
+        return "written" if arg16 else "coalesced"
+    if event == 13:
+        return _name(RECOVERY_STAGES, arg8)
+    return ""
+
+
+def parse(lines):
+    """Yield (cpu frequency, [records]) for every trace dump in the log."""
+    freq = None
+    data = b""
+    for line in lines:
+        match = BEGIN.search(line)
+        if match:
+            freq = int(match.group(1))
+            data = b""
+            continue
+        if freq is None:
+            continue
+        match = DATA.search(line)
+        if match:
+            data += bytes.fromhex(match.group(1))
+            continue
+        if END.search(line):
+            usable = len(data) - len(data) % RECORD.size
+            yield freq, [RECORD.unpack_from(data, i) for i in range(0, usable, RECORD.size)]
+            freq = None
+
+
+def render(freq, records, out):
+    previous = None
+    elapsed = 0
+    dreq_low_at = None
+    for cycles, event, arg8, arg16 in records:
+        # The cycle counter is 32 bit and wraps around quickly; unwrap it
+        # by assuming that records are in chronological order.
+        if previous is not None:
+            elapsed += (cycles - previous) & 0xFFFFFFFF
+        previous = cycles
+        time_us = elapsed * 1e6 / freq
+        details = describe(event, arg8, arg16)
+        if event == 4:
+            dreq_low_at = time_us
+        elif event == 5 and dreq_low_at is not None:
+            details = f"waited {time_us - dreq_low_at:.1f} us"
+            dreq_low_at = None
+        out.write(f"{time_us:14.1f} us  {EVENTS.get(event, f'EVENT_{event}'):<16} {details}\n")
+
+
+def main():
+    source = open(sys.argv[1], encoding="utf-8", errors="replace") if len(sys.argv) > 1 else sys.stdin
+    for number, (freq, records) in enumerate(parse(source)):
+        sys.stdout.write(f"=== trace {number + 1}: {len(records)} records at {freq} Hz\n")
+        render(freq, records, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()